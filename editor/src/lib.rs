@@ -89,8 +89,9 @@ use crate::fyrox::{
         Material, MaterialResource, PropertyValue,
     },
     resource::texture::{
-        CompressionOptions, TextureImportOptions, TextureKind, TextureMinificationFilter,
-        TextureResource, TextureResourceExtension,
+        import_cache::TextureImportCache, loader::TextureLoader, CompressionOptions,
+        TextureImportOptions, TextureKind, TextureMinificationFilter, TextureResource,
+        TextureResourceExtension,
     },
     scene::{graph::GraphUpdateSwitches, mesh::Mesh, Scene, SceneLoader},
     utils::{translate_cursor_icon, translate_event},
@@ -2050,6 +2051,19 @@ impl Editor {
             }
         }
 
+        // Imported textures are cached in the project directory, so re-opening the project is fast.
+        // The working directory is the project directory at this point.
+        if let Ok(project_root) = std::env::current_dir() {
+            if let Some(texture_loader) = engine
+                .resource_manager
+                .state()
+                .loaders
+                .find_mut::<TextureLoader>()
+            {
+                texture_loader.import_cache = Some(TextureImportCache::for_project(project_root));
+            }
+        }
+
         engine.resource_manager.state().destroy_unused_resources();
 
         graphics_context.renderer.flush();
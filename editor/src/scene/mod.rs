@@ -30,7 +30,7 @@ use crate::fyrox::{
         base::BaseBuilder,
         camera::{Camera, Projection},
         debug::{Line, SceneDrawingContext},
-        graph::{Graph, GraphUpdateSwitches},
+        graph::{Graph, GraphUpdateSwitches, HierarchyUpdateMode},
         light::{point::PointLight, spot::SpotLight},
         mesh::Mesh,
         navmesh::NavigationalMesh,
@@ -159,6 +159,10 @@ impl GameScene {
                 // Update only editor's camera.
                 node_overrides: Some(Default::default()),
                 paused: false,
+                // Scene nodes are edited via reflection, use the mode that catches every change.
+                hierarchy_update_mode: HierarchyUpdateMode::Full,
+                spatial_index: true,
+                parallel_animation: true,
             },
             sender,
             camera_state: Default::default(),
@@ -0,0 +1,508 @@
+//! Compressed, immutable representation of track data, that is optimized for fast sampling. See
+//! [`CompressedTrackData`] docs for more info.
+
+use crate::{
+    container::{TrackDataContainer, TrackValueKind},
+    core::{
+        algebra::{Quaternion, UnitQuaternion, Vector2, Vector3, Vector4},
+        math::{curve::CurveKeyKind, quat_from_euler, RotationOrder},
+    },
+    value::TrackValue,
+};
+
+/// Maximum amount of source samples, that could be replaced by a single linear segment. It limits
+/// the time needed for key reduction of long flat curves.
+const MAX_SEGMENT_LENGTH: usize = 256;
+
+/// Settings of track data compression. See [`CompressedTrackData`] docs for more info.
+#[derive(Clone, Debug, PartialEq)]
+pub struct CompressionSettings {
+    /// Maximum allowed absolute error of every component of real and vector values. Quantization adds
+    /// at most `range / 131070` error on top of it, where `range` is the range of values of a component.
+    pub tolerance: f32,
+    /// Maximum allowed angular error of rotations (in radians).
+    pub rotation_tolerance: f32,
+    /// Amount of samples per second, which is used to approximate non-linear parts (cubic and constant
+    /// key frames) of the source curves.
+    pub sample_rate: f32,
+}
+
+impl Default for CompressionSettings {
+    fn default() -> Self {
+        Self {
+            tolerance: 0.0001,
+            rotation_tolerance: 0.1f32.to_radians(),
+            sample_rate: 60.0,
+        }
+    }
+}
+
+/// Sampling cursor remembers the last sampled key span of a track. Animations are usually played
+/// monotonically, so the next sample is in the same or in the next span, and it could be found in
+/// `O(1)` instead of binary search. Any cursor can be used with any track, an outdated cursor just
+/// falls back to binary search.
+#[derive(Clone, Copy, Debug, Default, PartialEq, Eq)]
+pub struct SamplingCursor {
+    key: usize,
+}
+
+/// Compressed, immutable representation of track data (see [`TrackDataContainer`]).
+///
+/// Compression does the following:
+///
+/// - Samples every curve of the container at every key location and with uniform rate (see
+/// [`CompressionSettings::sample_rate`]) and merges the components of the value, so all of them share
+/// the same key locations. Rotations are stored as quaternions instead of three Euler angle curves.
+/// - Removes every key, that could be restored by linear interpolation (or normalized linear interpolation
+/// for rotations) of its neighbours with the given error tolerance.
+/// - Quantizes the values of the keys to 16 bits per component.
+///
+/// Long clips with densely sampled data (motion capture, for example) usually take many times less
+/// memory after compression. Sampling is a linear interpolation between two keys, the keys could be
+/// found in amortized `O(1)` when used with [`SamplingCursor`].
+#[derive(Clone, Debug, PartialEq)]
+pub struct CompressedTrackData {
+    kind: TrackValueKind,
+    times: Vec<f32>,
+    // Quantized values of the keys, `stride` values per key.
+    values: Vec<u16>,
+    stride: usize,
+    offsets: [f32; 4],
+    scales: [f32; 4],
+}
+
+fn stride(kind: TrackValueKind) -> usize {
+    match kind {
+        TrackValueKind::Real => 1,
+        TrackValueKind::Vector2 => 2,
+        TrackValueKind::Vector3 => 3,
+        TrackValueKind::Vector4 | TrackValueKind::UnitQuaternion => 4,
+    }
+}
+
+fn lerp_components(a: &[f32; 4], b: &[f32; 4], t: f32) -> [f32; 4] {
+    [
+        a[0] + (b[0] - a[0]) * t,
+        a[1] + (b[1] - a[1]) * t,
+        a[2] + (b[2] - a[2]) * t,
+        a[3] + (b[3] - a[3]) * t,
+    ]
+}
+
+fn to_quaternion(v: &[f32; 4]) -> UnitQuaternion<f32> {
+    UnitQuaternion::new_normalize(Quaternion::new(v[3], v[0], v[1], v[2]))
+}
+
+// Greedy key reduction. Returns indices of the samples, that must be kept. `fits(a, b, i)` must return
+// `true` if the sample `i` could be restored by interpolation between the samples `a` and `b`.
+fn reduce_keys<F>(count: usize, fits: F) -> Vec<usize>
+where
+    F: Fn(usize, usize, usize) -> bool,
+{
+    let mut keys = Vec::new();
+    if count == 0 {
+        return keys;
+    }
+
+    keys.push(0);
+    let mut anchor = 0;
+    let mut end = 1;
+    while end < count {
+        let next = end + 1;
+        if next < count
+            && next - anchor <= MAX_SEGMENT_LENGTH
+            && (anchor + 1..next).all(|i| fits(anchor, next, i))
+        {
+            end = next;
+        } else {
+            keys.push(end);
+            anchor = end;
+            end = anchor + 1;
+        }
+    }
+    keys
+}
+
+impl CompressedTrackData {
+    /// Compresses the given track data using the given settings. Returns `None` if the container is
+    /// malformed and cannot produce values (see [`TrackDataContainer::fetch`]).
+    pub fn from_container(
+        container: &TrackDataContainer,
+        settings: &CompressionSettings,
+    ) -> Option<Self> {
+        let kind = container.value_kind();
+        let curves = container.curves_ref().get(..kind.components_count())?;
+
+        // Collect sample locations: every key, a moment right before every step of constant keys and
+        // uniform samples to approximate cubic keys.
+        let mut times = Vec::new();
+        for curve in curves {
+            for keys in curve.keys().windows(2) {
+                if keys[0].kind == CurveKeyKind::Constant {
+                    let span = keys[1].location - keys[0].location;
+                    times.push(keys[1].location - (span * 0.5).min(0.0001));
+                }
+            }
+            times.extend(curve.keys().iter().map(|k| k.location));
+        }
+        let (Some(start), Some(end)) = (
+            times.iter().cloned().reduce(f32::min),
+            times.iter().cloned().reduce(f32::max),
+        ) else {
+            return Some(Self {
+                kind,
+                times: Vec::new(),
+                values: Vec::new(),
+                stride: stride(kind),
+                offsets: Default::default(),
+                scales: Default::default(),
+            });
+        };
+        if settings.sample_rate > 0.0 {
+            let count = ((end - start) * settings.sample_rate) as usize;
+            times.extend((1..count).map(|i| start + i as f32 / settings.sample_rate));
+        }
+        times.sort_by(|a, b| a.total_cmp(b));
+        times.dedup();
+
+        // Sample the source data.
+        let mut samples = Vec::with_capacity(times.len());
+        let mut previous = UnitQuaternion::identity();
+        for &time in times.iter() {
+            let mut sample = [0.0; 4];
+            for (component, curve) in sample.iter_mut().zip(curves) {
+                *component = curve.value_at(time);
+            }
+            if kind == TrackValueKind::UnitQuaternion {
+                let mut rotation = quat_from_euler(
+                    Vector3::new(sample[0], sample[1], sample[2]),
+                    RotationOrder::XYZ,
+                );
+                // Keep neighbouring keys in the same hemisphere, so interpolation will take the
+                // shortest path.
+                if rotation.coords.dot(&previous.coords) < 0.0 {
+                    rotation = UnitQuaternion::new_unchecked(-rotation.into_inner());
+                }
+                previous = rotation;
+                sample = [rotation.i, rotation.j, rotation.k, rotation.w];
+            }
+            samples.push(sample);
+        }
+
+        let stride = stride(kind);
+        let keys = if kind == TrackValueKind::UnitQuaternion {
+            reduce_keys(samples.len(), |a, b, i| {
+                let t = (times[i] - times[a]) / (times[b] - times[a]);
+                let restored = to_quaternion(&lerp_components(&samples[a], &samples[b], t));
+                restored.angle_to(&to_quaternion(&samples[i])) <= settings.rotation_tolerance
+            })
+        } else {
+            reduce_keys(samples.len(), |a, b, i| {
+                let t = (times[i] - times[a]) / (times[b] - times[a]);
+                let restored = lerp_components(&samples[a], &samples[b], t);
+                restored
+                    .iter()
+                    .zip(samples[i].iter())
+                    .take(stride)
+                    .all(|(r, s)| (r - s).abs() <= settings.tolerance)
+            })
+        };
+
+        // Quantize the values of the remaining keys.
+        let mut offsets = [0.0; 4];
+        let mut scales = [0.0; 4];
+        for c in 0..stride {
+            let min = keys.iter().map(|&k| samples[k][c]).fold(f32::MAX, f32::min);
+            let max = keys.iter().map(|&k| samples[k][c]).fold(f32::MIN, f32::max);
+            offsets[c] = min;
+            scales[c] = (max - min) / u16::MAX as f32;
+        }
+        let mut values = Vec::with_capacity(keys.len() * stride);
+        for &k in keys.iter() {
+            for c in 0..stride {
+                values.push(if scales[c] > 0.0 {
+                    ((samples[k][c] - offsets[c]) / scales[c]).round() as u16
+                } else {
+                    0
+                });
+            }
+        }
+
+        Some(Self {
+            kind,
+            times: keys.iter().map(|&k| times[k]).collect(),
+            values,
+            stride,
+            offsets,
+            scales,
+        })
+    }
+
+    /// Returns the kind of output value produced by the data.
+    pub fn value_kind(&self) -> TrackValueKind {
+        self.kind
+    }
+
+    /// Returns the amount of keys left after compression.
+    pub fn key_count(&self) -> usize {
+        self.times.len()
+    }
+
+    /// Returns approximate amount of memory (in bytes) used by the data.
+    pub fn memory_usage(&self) -> usize {
+        std::mem::size_of::<Self>()
+            + self.times.capacity() * std::mem::size_of::<f32>()
+            + self.values.capacity() * std::mem::size_of::<u16>()
+    }
+
+    fn key(&self, index: usize) -> [f32; 4] {
+        let mut value = [0.0; 4];
+        let quantized = &self.values[index * self.stride..(index + 1) * self.stride];
+        for (c, q) in quantized.iter().enumerate() {
+            value[c] = self.offsets[c] + *q as f32 * self.scales[c];
+        }
+        value
+    }
+
+    // Returns an index of the key, that starts a span with the given time (or the first/last key if
+    // the time is outside of the track). `hint` is checked first.
+    fn find_key(&self, time: f32, hint: usize) -> usize {
+        let last = self.times.len() - 1;
+        if time <= self.times[0] {
+            return 0;
+        }
+        if time >= self.times[last] {
+            return last;
+        }
+
+        // Check the hint and a few next spans, this is the common case for monotonic playback.
+        let mut index = hint.min(last);
+        if self.times[index] <= time {
+            for _ in 0..4 {
+                if time < self.times[index + 1] {
+                    return index;
+                }
+                index += 1;
+            }
+        }
+
+        self.times.partition_point(|t| *t <= time) - 1
+    }
+
+    fn sample(&self, time: f32, hint: usize) -> Option<(TrackValue, usize)> {
+        if self.times.is_empty() {
+            return None;
+        }
+
+        let index = self.find_key(time, hint);
+        let left = self.key(index);
+        let value = if index + 1 < self.times.len() && time > self.times[index] {
+            let t = (time - self.times[index]) / (self.times[index + 1] - self.times[index]);
+            lerp_components(&left, &self.key(index + 1), t)
+        } else {
+            left
+        };
+
+        let value = match self.kind {
+            TrackValueKind::Real => TrackValue::Real(value[0]),
+            TrackValueKind::Vector2 => TrackValue::Vector2(Vector2::new(value[0], value[1])),
+            TrackValueKind::Vector3 => {
+                TrackValue::Vector3(Vector3::new(value[0], value[1], value[2]))
+            }
+            TrackValueKind::Vector4 => {
+                TrackValue::Vector4(Vector4::new(value[0], value[1], value[2], value[3]))
+            }
+            TrackValueKind::UnitQuaternion => TrackValue::UnitQuaternion(to_quaternion(&value)),
+        };
+
+        Some((value, index))
+    }
+
+    /// Tries to get a value at a given time. Returns `None` if the data is empty.
+    pub fn fetch(&self, time: f32) -> Option<TrackValue> {
+        self.sample(time, 0).map(|(value, _)| value)
+    }
+
+    /// Does the same as [`Self::fetch`], but uses and updates the given cursor to speed up the search
+    /// of keys.
+    pub fn fetch_with_cursor(&self, time: f32, cursor: &mut SamplingCursor) -> Option<TrackValue> {
+        self.sample(time, cursor.key).map(|(value, key)| {
+            cursor.key = key;
+            value
+        })
+    }
+}
+
+#[cfg(test)]
+mod test {
+    use super::*;
+    use crate::core::math::curve::{Curve, CurveKey};
+    use std::time::Instant;
+
+    // Creates a container with densely sampled noisy data, similar to motion capture clips.
+    fn make_container(
+        kind: TrackValueKind,
+        key_count: usize,
+        frame_rate: f32,
+    ) -> TrackDataContainer {
+        let mut container = TrackDataContainer::new(kind);
+        for (c, curve) in container.curves_mut().iter_mut().enumerate() {
+            *curve = Curve::from(
+                (0..key_count)
+                    .map(|i| {
+                        let t = i as f32 / frame_rate;
+                        let value = (t * (1.0 + c as f32)).sin()
+                            + 0.3 * (t * 7.0 + c as f32).cos()
+                            + if (i / 500) % 2 == 0 { 0.0 } else { 1.0 };
+                        CurveKey::new(t, value, CurveKeyKind::Linear)
+                    })
+                    .collect::<Vec<_>>(),
+            );
+        }
+        container
+    }
+
+    fn source_memory_usage(container: &TrackDataContainer) -> usize {
+        container
+            .curves_ref()
+            .iter()
+            .map(|c| c.keys().len() * std::mem::size_of::<CurveKey>())
+            .sum()
+    }
+
+    #[test]
+    fn test_compressed_vector_track_is_within_tolerance() {
+        let container = make_container(TrackValueKind::Vector3, 2000, 30.0);
+        let settings = CompressionSettings::default();
+        let compressed = CompressedTrackData::from_container(&container, &settings).unwrap();
+        assert!(compressed.key_count() < 2000);
+        assert!(compressed.memory_usage() < source_memory_usage(&container));
+
+        let quantization_error = compressed.scales.iter().cloned().fold(0.0, f32::max);
+        let mut cursor = SamplingCursor::default();
+        for i in 0..4000 {
+            let time = i as f32 / 60.0;
+            let Some(TrackValue::Vector3(expected)) = container.fetch(time) else {
+                unreachable!()
+            };
+            let Some(TrackValue::Vector3(actual)) = compressed.fetch_with_cursor(time, &mut cursor)
+            else {
+                unreachable!()
+            };
+            assert_eq!(compressed.fetch(time), Some(TrackValue::Vector3(actual)));
+            // Between source keys there's no samples, but the source is linear there too.
+            assert!((expected - actual).amax() <= 2.0 * settings.tolerance + quantization_error);
+        }
+
+        // Cursor must work for backward playback and jumps too.
+        for i in (0..100).rev() {
+            let time = i as f32 * 0.7;
+            assert_eq!(
+                compressed.fetch_with_cursor(time, &mut cursor),
+                compressed.fetch(time)
+            );
+        }
+    }
+
+    #[test]
+    fn test_compressed_rotation_track() {
+        let container = make_container(TrackValueKind::UnitQuaternion, 600, 30.0);
+        let settings = CompressionSettings::default();
+        let compressed = CompressedTrackData::from_container(&container, &settings).unwrap();
+        assert_eq!(compressed.value_kind(), TrackValueKind::UnitQuaternion);
+
+        let mut cursor = SamplingCursor::default();
+        for i in 0..600 {
+            let time = i as f32 / 30.0;
+            let Some(TrackValue::UnitQuaternion(expected)) = container.fetch(time) else {
+                unreachable!()
+            };
+            let Some(TrackValue::UnitQuaternion(actual)) =
+                compressed.fetch_with_cursor(time, &mut cursor)
+            else {
+                unreachable!()
+            };
+            assert!(expected.angle_to(&actual) <= 2.0 * settings.rotation_tolerance);
+        }
+    }
+
+    #[test]
+    fn test_compressed_constant_and_empty_tracks() {
+        let mut container = TrackDataContainer::new(TrackValueKind::Real);
+        container.curves_mut()[0] = Curve::from(vec![
+            CurveKey::new(0.0, 1.0, CurveKeyKind::Constant),
+            CurveKey::new(1.0, 2.0, CurveKeyKind::Constant),
+            CurveKey::new(2.0, 2.0, CurveKeyKind::Constant),
+        ]);
+        let compressed =
+            CompressedTrackData::from_container(&container, &Default::default()).unwrap();
+        for (time, expected) in [(0.5, 1.0), (0.99, 1.0), (1.5, 2.0), (5.0, 2.0)] {
+            let Some(TrackValue::Real(value)) = compressed.fetch(time) else {
+                unreachable!()
+            };
+            assert!((value - expected).abs() < 0.001);
+        }
+
+        let empty = TrackDataContainer::new(TrackValueKind::Vector2);
+        let compressed = CompressedTrackData::from_container(&empty, &Default::default()).unwrap();
+        assert_eq!(compressed.fetch(0.0), None);
+
+        assert!(CompressedTrackData::from_container(
+            &TrackDataContainer::default(),
+            &Default::default()
+        )
+        .is_none());
+    }
+
+    #[ignore = "takes multiple seconds to run"]
+    #[test]
+    /// Measures memory usage and sampling speed of compressed tracks against the source curves.
+    fn compressed_track_benchmark() {
+        for (kind, key_count) in [
+            (TrackValueKind::Vector3, 3_000),
+            (TrackValueKind::Vector3, 30_000),
+            (TrackValueKind::UnitQuaternion, 30_000),
+        ] {
+            let container = make_container(kind, key_count, 30.0);
+            let settings = CompressionSettings::default();
+
+            let start_time = Instant::now();
+            let compressed = CompressedTrackData::from_container(&container, &settings).unwrap();
+            println!(
+                "{:?} track with {} keys, compressed in {:?}: {} keys, {} bytes -> {} bytes",
+                kind,
+                key_count,
+                Instant::now() - start_time,
+                compressed.key_count(),
+                source_memory_usage(&container),
+                compressed.memory_usage()
+            );
+
+            let duration = key_count as f32 / 30.0;
+            let sample_count = 1_000_000;
+            let dt = duration / sample_count as f32;
+
+            let start_time = Instant::now();
+            for i in 0..sample_count {
+                std::hint::black_box(container.fetch(i as f32 * dt));
+            }
+            println!("\tsource: {:?}", Instant::now() - start_time);
+
+            let start_time = Instant::now();
+            for i in 0..sample_count {
+                std::hint::black_box(compressed.fetch(i as f32 * dt));
+            }
+            println!("\tcompressed: {:?}", Instant::now() - start_time);
+
+            let start_time = Instant::now();
+            let mut cursor = SamplingCursor::default();
+            for i in 0..sample_count {
+                std::hint::black_box(compressed.fetch_with_cursor(i as f32 * dt, &mut cursor));
+            }
+            println!(
+                "\tcompressed with cursor: {:?}",
+                Instant::now() - start_time
+            );
+        }
+    }
+}
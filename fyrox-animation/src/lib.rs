@@ -26,10 +26,12 @@ pub use fyrox_core as core;
 use fyrox_core::pool::ErasedHandle;
 use fyrox_core::uuid::uuid;
 
+pub use compression::{CompressedTrackData, CompressionSettings, SamplingCursor};
 pub use pose::{AnimationPose, NodePose};
 pub use signal::{AnimationEvent, AnimationSignal};
 use value::{TrackValue, ValueBinding};
 
+pub mod compression;
 pub mod container;
 pub mod machine;
 pub mod pose;
@@ -190,6 +192,10 @@ pub struct Animation<T: EntityId> {
     #[reflect(hidden)]
     #[visit(skip)]
     events: VecDeque<AnimationEvent>,
+    // Non-serialized
+    #[reflect(hidden)]
+    #[visit(skip)]
+    cursors: Vec<SamplingCursor>,
 }
 
 impl<T: EntityId> TypeUuidProvider for Animation<T> {
@@ -268,6 +274,7 @@ impl<T: EntityId> Clone for Animation<T> {
             events: Default::default(),
             time_slice: self.time_slice.clone(),
             root_motion: self.root_motion.clone(),
+            cursors: Default::default(),
         }
     }
 }
@@ -456,7 +463,7 @@ impl<T: EntityId> Animation<T> {
             };
 
             let mut root_motion = RootMotion::default();
-            if let Some(root_pose) = self.pose.poses_mut().get_mut(&root_motion_settings.node) {
+            if let Some(root_pose) = self.pose.node_pose_mut(root_motion_settings.node) {
                 for bound_value in root_pose.values.values.iter_mut() {
                     match bound_value.binding {
                         ValueBinding::Position => {
@@ -738,11 +745,20 @@ impl<T: EntityId> Animation<T> {
         self.tracks.clear();
     }
 
+    /// Compresses every track of the animation using the given settings. Compressed tracks take less memory
+    /// and could be sampled faster. See [`CompressedTrackData`] docs for more info.
+    pub fn compress(&mut self, settings: &CompressionSettings) {
+        for track in self.tracks.iter_mut() {
+            track.compress(settings);
+        }
+    }
+
     fn update_pose(&mut self) {
         self.pose.reset();
-        for track in self.tracks.iter() {
+        self.cursors.resize(self.tracks.len(), Default::default());
+        for (track, cursor) in self.tracks.iter().zip(self.cursors.iter_mut()) {
             if track.is_enabled() {
-                if let Some(bound_value) = track.fetch(self.time_position) {
+                if let Some(bound_value) = track.fetch_with_cursor(self.time_position, cursor) {
                     self.pose.add_to_node_pose(track.target(), bound_value);
                 }
             }
@@ -769,6 +785,7 @@ impl<T: EntityId> Default for Animation<T> {
             root_motion_settings: None,
             events: Default::default(),
             time_slice: Default::default(),
+            cursors: Default::default(),
             root_motion: None,
         }
     }
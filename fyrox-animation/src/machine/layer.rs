@@ -677,8 +677,7 @@ impl<T: EntityId> MachineLayer<T> {
         }
 
         self.final_pose
-            .poses_mut()
-            .retain(|h, _| self.mask.should_animate(*h));
+            .retain(|pose| self.mask.should_animate(pose.node));
 
         &self.final_pose
     }
@@ -2,7 +2,6 @@
 
 use crate::{value::BoundValue, value::BoundValueCollection, EntityId, RootMotion};
 use fxhash::FxHashMap;
-use std::collections::hash_map::Entry;
 
 /// A "captured" state of properties of some animated scene node. The pose can be considered as container of values of some
 /// properties.
@@ -24,20 +23,24 @@ impl<T: EntityId> NodePose<T> {
 }
 
 /// Animations pose is a set of node poses. See [`NodePose`] docs for more info.
+///
+/// Node poses are stored in a dense array, in order of their addition. Poses of the same animation (or
+/// of animations that animate the same set of nodes) have the same layout, so blending of such poses
+/// is a simple linear pass over two arrays without any look-ups. Poses with different layouts are
+/// blended using an index of node positions.
 #[derive(Default, Debug, Clone, PartialEq)]
 pub struct AnimationPose<T: EntityId> {
-    poses: FxHashMap<T, NodePose<T>>,
+    poses: Vec<NodePose<T>>,
+    index: FxHashMap<T, usize>,
     root_motion: Option<RootMotion>,
 }
 
 impl<T: EntityId> AnimationPose<T> {
     /// Clears the set of node poses in the given animation pose and clones poses from the current animation pose to the given.
     pub fn clone_into(&self, dest: &mut AnimationPose<T>) {
-        dest.reset();
-        for (handle, local_pose) in self.poses.iter() {
-            dest.poses.insert(*handle, local_pose.clone());
-        }
-        dest.root_motion = self.root_motion.clone();
+        dest.poses.clone_from(&self.poses);
+        dest.index.clone_from(&self.index);
+        dest.root_motion.clone_from(&self.root_motion);
     }
 
     /// Sets root motion for the animation pose; the root motion will be blended with other motions
@@ -51,14 +54,29 @@ impl<T: EntityId> AnimationPose<T> {
         self.root_motion.as_ref()
     }
 
+    fn has_same_layout(&self, other: &AnimationPose<T>) -> bool {
+        self.poses.len() == other.poses.len()
+            && self
+                .poses
+                .iter()
+                .zip(other.poses.iter())
+                .all(|(a, b)| a.node == b.node)
+    }
+
     /// Blends current animation pose with another using a weight coefficient. Missing node poses (from either animation poses)
     /// will become a simple copies of a respective node pose.
     pub fn blend_with(&mut self, other: &AnimationPose<T>, weight: f32) {
-        for (handle, other_pose) in other.poses.iter() {
-            if let Some(current_pose) = self.poses.get_mut(handle) {
+        if self.has_same_layout(other) {
+            for (current_pose, other_pose) in self.poses.iter_mut().zip(other.poses.iter()) {
                 current_pose.blend_with(other_pose, weight);
-            } else {
-                self.add_node_pose(other_pose.clone());
+            }
+        } else {
+            for other_pose in other.poses.iter() {
+                if let Some(&i) = self.index.get(&other_pose.node) {
+                    self.poses[i].blend_with(other_pose, weight);
+                } else {
+                    self.add_node_pose(other_pose.clone());
+                }
             }
         }
 
@@ -68,37 +86,66 @@ impl<T: EntityId> AnimationPose<T> {
     }
 
     fn add_node_pose(&mut self, local_pose: NodePose<T>) {
-        self.poses.insert(local_pose.node, local_pose);
+        self.index.insert(local_pose.node, self.poses.len());
+        self.poses.push(local_pose);
     }
 
     pub(super) fn add_to_node_pose(&mut self, node: T, bound_value: BoundValue) {
-        match self.poses.entry(node) {
-            Entry::Occupied(entry) => {
-                entry.into_mut().values.values.push(bound_value);
-            }
-            Entry::Vacant(entry) => {
-                entry.insert(NodePose {
-                    node,
-                    values: BoundValueCollection {
-                        values: vec![bound_value],
-                    },
-                });
-            }
+        // Tracks of the same node are usually stored one after another, so check the last pose first.
+        if let Some(last) = self.poses.last_mut().filter(|last| last.node == node) {
+            last.values.values.push(bound_value);
+        } else if let Some(&i) = self.index.get(&node) {
+            self.poses[i].values.values.push(bound_value);
+        } else {
+            self.add_node_pose(NodePose {
+                node,
+                values: BoundValueCollection {
+                    values: vec![bound_value],
+                },
+            });
         }
     }
 
     /// Clears the pose.
     pub fn reset(&mut self) {
         self.poses.clear();
+        self.index.clear();
     }
 
-    /// Returns a reference to inner node pose map.
-    pub fn poses(&self) -> &FxHashMap<T, NodePose<T>> {
+    /// Returns a reference to inner node poses, in order of their addition.
+    pub fn poses(&self) -> &[NodePose<T>] {
         &self.poses
     }
 
-    /// Returns a reference to inner node pose map.
-    pub fn poses_mut(&mut self) -> &mut FxHashMap<T, NodePose<T>> {
+    /// Returns a reference to inner node poses, in order of their addition. Node handles of the poses
+    /// must not be changed, use [`Self::retain`] to remove poses.
+    pub fn poses_mut(&mut self) -> &mut [NodePose<T>] {
         &mut self.poses
     }
+
+    /// Tries to find a pose of the given node.
+    pub fn node_pose(&self, node: T) -> Option<&NodePose<T>> {
+        self.index.get(&node).map(|&i| &self.poses[i])
+    }
+
+    /// Tries to find a pose of the given node.
+    pub fn node_pose_mut(&mut self, node: T) -> Option<&mut NodePose<T>> {
+        self.index.get(&node).map(|&i| &mut self.poses[i])
+    }
+
+    /// Keeps only the node poses for which the given predicate returns `true`. Relative order of the
+    /// poses is preserved.
+    pub fn retain<F>(&mut self, mut predicate: F)
+    where
+        F: FnMut(&NodePose<T>) -> bool,
+    {
+        let count = self.poses.len();
+        self.poses.retain(|pose| predicate(pose));
+        if self.poses.len() != count {
+            self.index.clear();
+            for (i, pose) in self.poses.iter().enumerate() {
+                self.index.insert(pose.node, i);
+            }
+        }
+    }
 }
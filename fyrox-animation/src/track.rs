@@ -1,16 +1,21 @@
 //! Track is responsible in animating a property of a single scene node. See [`Track`] docs for more info.
 
 use crate::{
+    compression::{CompressedTrackData, CompressionSettings, SamplingCursor},
     container::{TrackDataContainer, TrackValueKind},
     core::{reflect::prelude::*, uuid::Uuid, visitor::prelude::*},
     value::{BoundValue, ValueBinding},
     EntityId,
 };
-use std::fmt::Debug;
+use std::{fmt::Debug, sync::Arc};
 
 /// Track is responsible in animating a property of a single scene node. The track consists up to 4 parametric curves
 /// that contains the actual property data. Parametric curves allows the engine to perform various interpolations between
 /// key values.
+///
+/// A track could be compressed (see [`Self::compress`]), in this case its values are fetched from the compressed
+/// data (see [`CompressedTrackData`]). The compressed data is shared between clones of the track, and it is
+/// discarded when the curves of the track are modified.
 #[derive(Debug, Reflect, Clone, PartialEq)]
 pub struct Track<T: EntityId> {
     binding: ValueBinding,
@@ -18,6 +23,8 @@ pub struct Track<T: EntityId> {
     enabled: bool,
     target: T,
     id: Uuid,
+    #[reflect(hidden)]
+    compressed: Option<Arc<CompressedTrackData>>,
 }
 
 impl<T: EntityId> Visit for Track<T> {
@@ -43,6 +50,7 @@ impl<T: EntityId> Default for Track<T> {
             enabled: true,
             target: Default::default(),
             id: Uuid::new_v4(),
+            compressed: None,
         }
     }
 }
@@ -116,19 +124,56 @@ impl<T: EntityId> Track<T> {
         &self.frames
     }
 
-    /// Returns a reference to the data container.
+    /// Returns a reference to the data container. Discards the compressed data of the track (if any).
     pub fn data_container_mut(&mut self) -> &mut TrackDataContainer {
+        self.compressed = None;
         &mut self.frames
     }
 
-    /// Sets new data container and returns the previous one.
+    /// Sets new data container and returns the previous one. Discards the compressed data of the track
+    /// (if any).
     pub fn set_data_container(&mut self, container: TrackDataContainer) -> TrackDataContainer {
+        self.compressed = None;
         std::mem::replace(&mut self.frames, container)
     }
 
+    /// Compresses the data of the track using the given settings. The source data container is kept
+    /// as is, so it could still be edited. Keep in mind, that changes of the data container made via
+    /// reflection do not discard the compressed data. See [`CompressedTrackData`] docs for more info.
+    pub fn compress(&mut self, settings: &CompressionSettings) {
+        self.compressed = CompressedTrackData::from_container(&self.frames, settings).map(Arc::new);
+    }
+
+    /// Returns a reference to the compressed data of the track (if any).
+    pub fn compressed_data(&self) -> Option<&CompressedTrackData> {
+        self.compressed.as_deref()
+    }
+
+    /// Discards the compressed data of the track, the values will be fetched from the data container.
+    pub fn discard_compressed_data(&mut self) {
+        self.compressed = None;
+    }
+
     /// Tries to get a new property value at a given time position.
     pub fn fetch(&self, time: f32) -> Option<BoundValue> {
-        self.frames.fetch(time).map(|v| BoundValue {
+        let value = match self.compressed.as_ref() {
+            Some(compressed) => compressed.fetch(time),
+            None => self.frames.fetch(time),
+        };
+        value.map(|v| BoundValue {
+            binding: self.binding.clone(),
+            value: v,
+        })
+    }
+
+    /// Does the same as [`Self::fetch`], but uses the given cursor to speed up sampling of the compressed
+    /// data. See [`SamplingCursor`] docs for more info.
+    pub fn fetch_with_cursor(&self, time: f32, cursor: &mut SamplingCursor) -> Option<BoundValue> {
+        let value = match self.compressed.as_ref() {
+            Some(compressed) => compressed.fetch_with_cursor(time, cursor),
+            None => self.frames.fetch(time),
+        };
+        value.map(|v| BoundValue {
             binding: self.binding.clone(),
             value: v,
         })
@@ -170,11 +170,59 @@ impl ColorGradientBuilder {
     }
 }
 
+/// Pre-sampled color gradient, that allows you to fetch a color at a given location in constant
+/// time. It is useful when the same gradient is sampled many times per frame (for example, once
+/// per each particle of a particle system). The color is taken from the nearest sample, so the
+/// resolution of the table defines the precision.
+#[derive(Clone, PartialEq, Debug)]
+pub struct ColorGradientLut {
+    gradient: ColorGradient,
+    colors: Vec<Color>,
+}
+
+impl Default for ColorGradientLut {
+    fn default() -> Self {
+        Self::new(&ColorGradient::default(), 1)
+    }
+}
+
+impl ColorGradientLut {
+    /// Default amount of samples in a table.
+    pub const DEFAULT_RESOLUTION: usize = 256;
+
+    /// Samples the given gradient at `resolution` evenly distributed locations in `[0; 1]` range.
+    pub fn new(gradient: &ColorGradient, resolution: usize) -> Self {
+        let resolution = resolution.max(1);
+        let last = resolution.saturating_sub(1).max(1) as f32;
+        Self {
+            gradient: gradient.clone(),
+            colors: (0..resolution)
+                .map(|i| gradient.get_color(i as f32 / last))
+                .collect(),
+        }
+    }
+
+    /// Returns the gradient from which the table was created. Could be used to check whether the
+    /// table must be re-created or not.
+    #[inline]
+    pub fn gradient(&self) -> &ColorGradient {
+        &self.gradient
+    }
+
+    /// Returns the color at the given location. Locations outside of `[0; 1]` range are clamped.
+    #[inline]
+    pub fn get_color(&self, location: f32) -> Color {
+        let last = self.colors.len() - 1;
+        let index = (location.clamp(0.0, 1.0) * last as f32 + 0.5) as usize;
+        self.colors[index.min(last)]
+    }
+}
+
 #[cfg(test)]
 mod test {
     use crate::{
         color::Color,
-        color_gradient::{ColorGradient, ColorGradientBuilder},
+        color_gradient::{ColorGradient, ColorGradientBuilder, ColorGradientLut},
     };
 
     use super::GradientPoint;
@@ -274,4 +322,25 @@ mod test {
             }
         );
     }
+
+    #[test]
+    fn test_color_gradient_lut() {
+        let gradient = ColorGradientBuilder::new()
+            .with_point(GradientPoint::new(0.0, Color::BLACK))
+            .with_point(GradientPoint::new(1.0, Color::WHITE))
+            .build();
+
+        let lut = ColorGradientLut::new(&gradient, 3);
+        assert_eq!(lut.gradient(), &gradient);
+        assert_eq!(lut.get_color(-1.0), Color::BLACK);
+        assert_eq!(lut.get_color(0.2), Color::BLACK);
+        assert_eq!(lut.get_color(0.5), gradient.get_color(0.5));
+        assert_eq!(lut.get_color(0.8), Color::WHITE);
+        assert_eq!(lut.get_color(2.0), Color::WHITE);
+
+        assert_eq!(
+            ColorGradientLut::default().get_color(0.5),
+            ColorGradient::STUB_COLOR
+        );
+    }
 }
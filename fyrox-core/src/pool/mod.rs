@@ -21,6 +21,7 @@
 //! friendliness.
 
 use crate::{reflect::prelude::*, visitor::prelude::*, ComponentProvider};
+use rayon::prelude::*;
 use std::{
     any::{Any, TypeId},
     fmt::Debug,
@@ -52,6 +53,7 @@ where
 {
     records: Vec<PoolRecord<T, P>>,
     free_stack: Vec<u32>,
+    alive_index: Option<AliveIndex>,
 }
 
 impl<T, P> Reflect for Pool<T, P>
@@ -183,6 +185,120 @@ where
     payload: Payload<P>,
 }
 
+/// Packed set of indices of occupied (alive or reserved) records of a pool. It allows iterating over
+/// the objects of a pool without touching its free records, so the cost of iteration depends on the
+/// amount of objects and not on the capacity of the pool.
+#[derive(Debug, Default, Clone)]
+struct AliveIndex {
+    // Indices of occupied records, in ascending order unless `needs_sort` is set.
+    indices: Vec<u32>,
+    // Position of every record in `indices` or `AliveIndex::ABSENT` if the record is free.
+    positions: Vec<u32>,
+    needs_sort: bool,
+}
+
+impl AliveIndex {
+    const ABSENT: u32 = u32::MAX;
+
+    fn insert(&mut self, index: u32) {
+        let index_usize = index as usize;
+        if index_usize >= self.positions.len() {
+            self.positions.resize(index_usize + 1, Self::ABSENT);
+        }
+        if self.positions[index_usize] == Self::ABSENT {
+            if self.indices.last().map_or(false, |last| *last > index) {
+                self.needs_sort = true;
+            }
+            self.positions[index_usize] = self.indices.len() as u32;
+            self.indices.push(index);
+        }
+    }
+
+    fn remove(&mut self, index: u32) {
+        if let Some(position) = self.positions.get_mut(index as usize) {
+            if *position != Self::ABSENT {
+                let position = std::mem::replace(position, Self::ABSENT) as usize;
+                if position + 1 != self.indices.len() {
+                    self.needs_sort = true;
+                }
+                self.indices.swap_remove(position);
+                if let Some(moved) = self.indices.get(position) {
+                    self.positions[*moved as usize] = position as u32;
+                }
+            }
+        }
+    }
+
+    fn clear(&mut self) {
+        self.indices.clear();
+        self.positions.clear();
+        self.needs_sort = false;
+    }
+
+    fn sort(&mut self) {
+        if self.needs_sort {
+            // Swap removals and spawns into free records leave the indices almost sorted, stable sort
+            // handles such runs in nearly linear time.
+            self.indices.sort();
+            for (position, index) in self.indices.iter().enumerate() {
+                self.positions[*index as usize] = position as u32;
+            }
+            self.needs_sort = false;
+        }
+    }
+
+    fn rebuild(&mut self, record_count: usize, free_stack: &[u32]) {
+        self.clear();
+        self.positions.resize(record_count, 0);
+        for free_index in free_stack {
+            if let Some(position) = self.positions.get_mut(*free_index as usize) {
+                *position = Self::ABSENT;
+            }
+        }
+        for (index, position) in self.positions.iter_mut().enumerate() {
+            if *position != Self::ABSENT {
+                *position = self.indices.len() as u32;
+                self.indices.push(index as u32);
+            }
+        }
+    }
+}
+
+/// A mapping between the handles of a pool before and after [`Pool::compact`] call.
+pub struct HandleRemap<T> {
+    // Pairs (old generation, new handle) for every record index before the compaction.
+    entries: Vec<(u32, Handle<T>)>,
+}
+
+impl<T> HandleRemap<T> {
+    /// Returns a new handle of an object that had the given handle before the compaction. Returns
+    /// [`Handle::NONE`] if the given handle was invalid.
+    #[inline]
+    pub fn get(&self, old: Handle<T>) -> Handle<T> {
+        match self.entries.get(old.index as usize) {
+            Some((generation, new)) if *generation == old.generation => *new,
+            _ => Handle::NONE,
+        }
+    }
+
+    /// Returns an iterator over pairs `(old, new)` of the handles of objects that were moved during the
+    /// compaction.
+    #[inline]
+    pub fn moved(&self) -> impl Iterator<Item = (Handle<T>, Handle<T>)> + '_ {
+        self.entries
+            .iter()
+            .enumerate()
+            .filter_map(|(index, (generation, new))| {
+                let old = Handle::new(index as u32, *generation);
+                if new.is_some() && *new != old {
+                    Some((old, *new))
+                } else {
+                    None
+                }
+            })
+    }
+}
+
 impl<T, P> PartialEq for PoolRecord<T, P>
 where
     T: PartialEq,
@@ -241,6 +357,11 @@ where
         let mut region = visitor.enter_region(name)?;
         self.records.visit("Records", &mut region)?;
         self.free_stack.visit("FreeStack", &mut region)?;
+        if region.is_reading() {
+            if let Some(alive_index) = self.alive_index.as_mut() {
+                alive_index.rebuild(self.records.len(), &self.free_stack);
+            }
+        }
         Ok(())
     }
 }
@@ -289,6 +410,7 @@ impl<T: Clone> Clone for Pool<T> {
         Self {
             records: self.records.clone(),
             free_stack: self.free_stack.clone(),
+            alive_index: self.alive_index.clone(),
         }
     }
 }
@@ -302,6 +424,7 @@ where
         Pool {
             records: Vec::new(),
             free_stack: Vec::new(),
+            alive_index: None,
         }
     }
 
@@ -311,6 +434,7 @@ where
         Pool {
             records: Vec::with_capacity(capacity),
             free_stack: Vec::new(),
+            alive_index: None,
         }
     }
 
@@ -328,6 +452,57 @@ where
         self.records.get_mut(index)
     }
 
+    fn mark_occupied(&mut self, index: u32) {
+        if let Some(alive_index) = self.alive_index.as_mut() {
+            alive_index.insert(index);
+        }
+    }
+
+    fn mark_free(&mut self, index: u32) {
+        if let Some(alive_index) = self.alive_index.as_mut() {
+            alive_index.remove(index);
+        }
+    }
+
+    /// Enables or disables the packed index of occupied records. When enabled, the pool keeps a dense
+    /// array of indices of its occupied records in sync on every spawn and free. It makes
+    /// [`Self::alive_pair_iter`], [`Self::alive_pair_iter_mut`], [`Self::alive_count`] and parallel
+    /// iterators proportional to the amount of objects in the pool, instead of its capacity. It is
+    /// useful for pools that have a lot of free records, which is typical for pools with frequent
+    /// spawns and frees (projectiles, particles, temporary scene nodes, etc.). The index costs 8 bytes
+    /// per record.
+    #[inline]
+    pub fn set_alive_index_enabled(&mut self, enabled: bool) {
+        if enabled {
+            if self.alive_index.is_none() {
+                let mut alive_index = AliveIndex::default();
+                alive_index.rebuild(self.records.len(), &self.free_stack);
+                self.alive_index = Some(alive_index);
+            }
+        } else {
+            self.alive_index = None;
+        }
+    }
+
+    /// Sorts the packed index of occupied records (see [`Self::set_alive_index_enabled`]), so
+    /// [`Self::alive_pair_iter`] and [`Self::alive_pair_iter_mut`] visit objects in the same order as
+    /// [`Self::pair_iter`]. The index remembers whether it is sorted, so the call is free if no object
+    /// was freed or spawned into a free record since the previous call. Does nothing if the index is
+    /// disabled.
+    #[inline]
+    pub fn sort_alive_index(&mut self) {
+        if let Some(alive_index) = self.alive_index.as_mut() {
+            alive_index.sort();
+        }
+    }
+
+    /// Returns `true` if the packed index of occupied records is enabled. See
+    /// [`Self::set_alive_index_enabled`] for more info.
+    #[inline]
+    pub fn is_alive_index_enabled(&self) -> bool {
+        self.alive_index.is_some()
+    }
+
     #[inline]
     #[must_use]
     pub fn spawn(&mut self, payload: T) -> Handle<T> {
@@ -400,6 +575,8 @@ where
                     record.generation = generation;
                     record.payload = Payload::new(payload);
 
+                    self.mark_occupied(index);
+
                     Ok(Handle::new(index, generation))
                 }
             },
@@ -426,6 +603,8 @@ where
                     payload: Payload::new(payload),
                 });
 
+                self.mark_occupied(index);
+
                 Ok(Handle::new(index, generation))
             }
         }
@@ -459,6 +638,7 @@ where
 
             record.generation = generation;
             record.payload.replace(payload);
+            self.mark_occupied(free_index);
             handle
         } else {
             // No free records, create new one
@@ -479,6 +659,7 @@ where
             };
 
             self.records.push(record);
+            self.mark_occupied(handle.index);
 
             handle
         }
@@ -515,6 +696,7 @@ where
 
             record.generation = generation;
             record.payload.replace(payload);
+            self.mark_occupied(free_index);
             handle
         } else {
             // No free records, create new one
@@ -535,6 +717,7 @@ where
             };
 
             self.records.push(record);
+            self.mark_occupied(handle.index);
 
             handle
         }
@@ -822,6 +1005,7 @@ where
                 self.free_stack.push(handle.index);
                 // Return current payload.
                 if let Some(payload) = record.payload.take() {
+                    self.mark_free(handle.index);
                     payload
                 } else {
                     panic!("Attempt to double free object at handle {:?}!", handle);
@@ -843,18 +1027,15 @@ where
     #[inline]
     pub fn try_free(&mut self, handle: Handle<T>) -> Option<T> {
         let index = usize::try_from(handle.index).expect("index overflowed usize");
-        self.records.get_mut(index).and_then(|record| {
-            if record.generation == handle.generation {
-                if let Some(payload) = record.payload.take() {
-                    self.free_stack.push(handle.index);
-                    Some(payload)
-                } else {
-                    None
-                }
-            } else {
-                None
-            }
-        })
+        let record = self.records.get_mut(index)?;
+        if record.generation == handle.generation {
+            let payload = record.payload.take()?;
+            self.free_stack.push(handle.index);
+            self.mark_free(handle.index);
+            Some(payload)
+        } else {
+            None
+        }
     }
 
     /// Moves an object out of the pool using the given handle with a promise that the object will be returned back.
@@ -950,9 +1131,50 @@ where
     #[inline]
     pub fn forget_ticket(&mut self, ticket: Ticket<T>) {
         self.free_stack.push(ticket.index);
+        self.mark_free(ticket.index);
         std::mem::forget(ticket);
     }
 
+    /// Reserves an empty record in the pool and returns a ticket for it together with a handle, that
+    /// the object will have when it is put back using [`Self::put_back`]. It could be used to build
+    /// objects that reference each other by handles before they're placed in the pool (for example,
+    /// on other thread). The reserved record is not available for spawning until the ticket is
+    /// either put back or forgotten (see [`Self::forget_ticket`]).
+    #[inline]
+    pub fn reserve_handle(&mut self) -> (Ticket<T>, Handle<T>) {
+        let index = if let Some(free_index) = self.free_stack.pop() {
+            let record = self
+                .records_get_mut(free_index)
+                .expect("free stack contained invalid index");
+
+            if record.payload.is_some() {
+                panic!(
+                    "Attempt to reserve pool record with payload! Record index is {}",
+                    free_index
+                );
+            }
+
+            record.generation += 1;
+            free_index
+        } else {
+            self.records.push(PoolRecord {
+                ref_counter: Default::default(),
+                generation: 1,
+                payload: Payload::new_empty(),
+            });
+            self.records_len() - 1
+        };
+
+        self.mark_occupied(index);
+
+        let handle = Handle::new(index, self.records[index as usize].generation);
+        let ticket = Ticket {
+            index,
+            marker: PhantomData,
+        };
+        (ticket, handle)
+    }
+
     /// Returns total capacity of pool. Capacity has nothing about real amount of objects in pool!
     #[inline]
     #[must_use]
@@ -971,6 +1193,9 @@ where
     pub fn clear(&mut self) {
         self.records.clear();
         self.free_stack.clear();
+        if let Some(alive_index) = self.alive_index.as_mut() {
+            alive_index.clear();
+        }
     }
 
     #[inline]
@@ -1001,7 +1226,9 @@ where
     ///
     /// Records that have been reserved (e.g. by [`take_reserve`]) are *not* counted.
     ///
-    /// It iterates through the entire pool to count the live objects so the complexity is `O(n)`.
+    /// It iterates through the entire pool to count the live objects so the complexity is `O(n)`, where
+    /// `n` is the capacity of the pool. If the alive index is enabled (see
+    /// [`Self::set_alive_index_enabled`]), `n` is the amount of occupied records.
     ///
     /// See also [`total_count`].
     ///
@@ -1020,7 +1247,7 @@ where
     #[inline]
     #[must_use]
     pub fn alive_count(&self) -> u32 {
-        let cnt = self.iter().count();
+        let cnt = self.alive_pair_iter().count();
         u32::try_from(cnt).expect("alive_count overflowed u32")
     }
 
@@ -1047,7 +1274,9 @@ where
             if record.generation == handle.generation {
                 self.free_stack.retain(|i| *i != handle.index);
 
-                record.payload.replace(payload)
+                let old = record.payload.replace(payload);
+                self.mark_occupied(handle.index);
+                old
             } else {
                 panic!("Attempt to replace object in pool using dangling handle! Handle is {:?}, but pool record has {} generation", handle, record.generation);
             }
@@ -1152,6 +1381,98 @@ where
         }
     }
 
+    /// Creates new pair iterator that iterates over alive objects using pair (handle, payload). Unlike
+    /// [`Self::pair_iter`] it does not touch free records of the pool if the alive index is enabled
+    /// (see [`Self::set_alive_index_enabled`]), otherwise it is the same as [`Self::pair_iter`]. The
+    /// order of iteration is unspecified if the alive index is enabled, unless
+    /// [`Self::sort_alive_index`] was called after the last change of the pool.
+    #[inline]
+    pub fn alive_pair_iter(&self) -> PoolAlivePairIterator<T, P> {
+        PoolAlivePairIterator {
+            indices: self.alive_index.as_ref().map(|i| i.indices.iter()),
+            full: PoolPairIterator {
+                pool: self,
+                current: if self.alive_index.is_some() {
+                    self.records.len()
+                } else {
+                    0
+                },
+            },
+        }
+    }
+
+    /// Mutable version of [`Self::alive_pair_iter`].
+    #[inline]
+    pub fn alive_pair_iter_mut(&mut self) -> PoolAlivePairIteratorMut<T, P> {
+        let begin = self.records.as_mut_ptr();
+        let len = self.records.len();
+        let indices = self.alive_index.as_ref().map(|i| i.indices.iter());
+        // SAFETY: If the alive index is enabled, the full iterator is empty.
+        unsafe {
+            PoolAlivePairIteratorMut {
+                full: PoolPairIteratorMut {
+                    current: 0,
+                    ptr: if indices.is_some() {
+                        begin.add(len)
+                    } else {
+                        begin
+                    },
+                    end: begin.add(len),
+                    marker: PhantomData,
+                },
+                records: begin,
+                indices,
+            }
+        }
+    }
+
+    /// Moves all the objects to the beginning of the pool, removing free records between them and
+    /// releasing the tail of the pool. The relative order of the objects is preserved. Returns a
+    /// mapping between old and new handles, every handle that was obtained before compaction must be
+    /// remapped using it.
+    ///
+    /// # Panics
+    ///
+    /// Panics if the pool has reserved records (see [`Self::take_reserve`]).
+    #[inline]
+    pub fn compact(&mut self) -> HandleRemap<T> {
+        assert_eq!(
+            self.records.len() - self.free_stack.len(),
+            self.iter().count(),
+            "Unable to compact a pool with reserved records!"
+        );
+
+        let mut entries = Vec::with_capacity(self.records.len());
+        let mut next = 0;
+        for index in 0..self.records.len() {
+            let generation = self.records[index].generation;
+            if self.records[index].payload.is_some() {
+                let new_generation = if index == next {
+                    generation
+                } else {
+                    // Make sure that old handles of the destination record won't be valid again.
+                    let new_generation = generation.max(self.records[next].generation) + 1;
+                    self.records.swap(index, next);
+                    self.records[next].generation = new_generation;
+                    new_generation
+                };
+                entries.push((generation, Handle::new(next as u32, new_generation)));
+                next += 1;
+            } else {
+                entries.push((generation, Handle::NONE));
+            }
+        }
+
+        self.records.truncate(next);
+        self.records.shrink_to_fit();
+        self.free_stack.clear();
+        if let Some(alive_index) = self.alive_index.as_mut() {
+            alive_index.rebuild(self.records.len(), &self.free_stack);
+        }
+
+        HandleRemap { entries }
+    }
+
     /// Retains pool records selected by `pred`. Useful when you need to remove all pool records
     /// by some criteria.
     #[inline]
@@ -1172,6 +1493,9 @@ where
 
             if !retain {
                 self.free_stack.push(i as u32);
+                if let Some(alive_index) = self.alive_index.as_mut() {
+                    alive_index.remove(i as u32);
+                }
                 record.payload.take(); // and Drop
             }
         }
@@ -1188,6 +1512,9 @@ where
     #[inline]
     pub fn drain(&mut self) -> impl Iterator<Item = T> + '_ {
         self.free_stack.clear();
+        if let Some(alive_index) = self.alive_index.as_mut() {
+            alive_index.clear();
+        }
         self.records.drain(..).filter_map(|mut r| r.payload.take())
     }
 
@@ -1217,6 +1544,109 @@ where
     }
 }
 
+// Raw pointer to the records of a pool, that could be shared across threads. It is used to mutably
+// access records at unique indices from multiple threads.
+struct SharedRecords<T, P>(*mut PoolRecord<T, P>)
+where
+    P: PayloadContainer<Element = T>;
+
+// SAFETY: The pointer is used only to access records at unique indices.
+unsafe impl<T: Send, P: PayloadContainer<Element = T>> Send for SharedRecords<T, P> {}
+unsafe impl<T: Send, P: PayloadContainer<Element = T>> Sync for SharedRecords<T, P> {}
+
+impl<T, P> SharedRecords<T, P>
+where
+    P: PayloadContainer<Element = T>,
+{
+    // SAFETY: The index must be in bounds and must not be accessed by anyone else.
+    unsafe fn get<'a>(&self, index: u32) -> &'a mut PoolRecord<T, P> {
+        &mut *self.0.add(index as usize)
+    }
+}
+
+impl<T, P> Pool<T, P>
+where
+    P: PayloadContainer<Element = T> + 'static,
+{
+    /// Creates new parallel iterator over alive objects using pair (handle, payload). Uses the alive
+    /// index if it is enabled (see [`Self::set_alive_index_enabled`]). The order of iteration is
+    /// unspecified.
+    #[inline]
+    pub fn par_pair_iter(&self) -> impl ParallelIterator<Item = (Handle<T>, &T)> + '_
+    where
+        T: Sync,
+    {
+        match self.alive_index.as_ref() {
+            Some(alive_index) => {
+                rayon::iter::Either::Left(alive_index.indices.par_iter().filter_map(move |index| {
+                    let record = &self.records[*index as usize];
+                    record
+                        .payload
+                        .as_ref()
+                        .map(|payload| (Handle::new(*index, record.generation), payload))
+                }))
+            }
+            None => rayon::iter::Either::Right(self.records.par_iter().enumerate().filter_map(
+                |(index, record)| {
+                    record
+                        .payload
+                        .as_ref()
+                        .map(|payload| (Handle::new(index as u32, record.generation), payload))
+                },
+            )),
+        }
+    }
+
+    /// Creates new parallel iterator over alive objects. See [`Self::par_pair_iter`] for more info.
+    #[inline]
+    pub fn par_iter(&self) -> impl ParallelIterator<Item = &T> + '_
+    where
+        T: Sync,
+    {
+        self.par_pair_iter().map(|(_, payload)| payload)
+    }
+
+    /// Mutable version of [`Self::par_pair_iter`].
+    #[inline]
+    pub fn par_pair_iter_mut(&mut self) -> impl ParallelIterator<Item = (Handle<T>, &mut T)> + '_
+    where
+        T: Send,
+    {
+        let records = SharedRecords(self.records.as_mut_ptr());
+        match self.alive_index.as_ref() {
+            Some(alive_index) => {
+                rayon::iter::Either::Left(alive_index.indices.par_iter().filter_map(move |index| {
+                    // SAFETY: Indices in the alive index are unique and in bounds.
+                    let record = unsafe { records.get(*index) };
+                    let generation = record.generation;
+                    record
+                        .payload
+                        .as_mut()
+                        .map(|payload| (Handle::new(*index, generation), payload))
+                }))
+            }
+            None => rayon::iter::Either::Right(self.records.par_iter_mut().enumerate().filter_map(
+                |(index, record)| {
+                    let generation = record.generation;
+                    record
+                        .payload
+                        .as_mut()
+                        .map(|payload| (Handle::new(index as u32, generation), payload))
+                },
+            )),
+        }
+    }
+
+    /// Mutable version of [`Self::par_iter`].
+    #[inline]
+    pub fn par_iter_mut(&mut self) -> impl ParallelIterator<Item = &mut T> + '_
+    where
+        T: Send,
+    {
+        self.par_pair_iter_mut().map(|(_, payload)| payload)
+    }
+}
+
 impl<T, P> Pool<T, P>
 where
     T: ComponentProvider,
@@ -1443,6 +1873,66 @@ where
     }
 }
 
+pub struct PoolAlivePairIterator<'a, T, P: PayloadContainer<Element = T>> {
+    indices: Option<std::slice::Iter<'a, u32>>,
+    full: PoolPairIterator<'a, T, P>,
+}
+
+impl<'a, T, P> Iterator for PoolAlivePairIterator<'a, T, P>
+where
+    P: PayloadContainer<Element = T>,
+{
+    type Item = (Handle<T>, &'a T);
+
+    #[inline]
+    fn next(&mut self) -> Option<Self::Item> {
+        match self.indices.as_mut() {
+            Some(indices) => loop {
+                let index = *indices.next()?;
+                let pool = self.full.pool;
+                let record = &pool.records[index as usize];
+                // Reserved records are skipped.
+                if let Some(payload) = record.payload.as_ref() {
+                    return Some((Handle::new(index, record.generation), payload));
+                }
+            },
+            None => self.full.next(),
+        }
+    }
+}
+
+pub struct PoolAlivePairIteratorMut<'a, T, P>
+where
+    P: PayloadContainer<Element = T>,
+{
+    records: *mut PoolRecord<T, P>,
+    indices: Option<std::slice::Iter<'a, u32>>,
+    full: PoolPairIteratorMut<'a, T, P>,
+}
+
+impl<'a, T, P> Iterator for PoolAlivePairIteratorMut<'a, T, P>
+where
+    P: PayloadContainer<Element = T> + 'static,
+{
+    type Item = (Handle<T>, &'a mut T);
+
+    #[inline]
+    fn next(&mut self) -> Option<Self::Item> {
+        match self.indices.as_mut() {
+            Some(indices) => loop {
+                let index = *indices.next()?;
+                // SAFETY: Indices in the alive index are unique and in bounds.
+                let record = unsafe { &mut *self.records.add(index as usize) };
+                // Reserved records are skipped.
+                if let Some(payload) = record.payload.as_mut() {
+                    return Some((Handle::new(index, record.generation), payload));
+                }
+            },
+            None => self.full.next(),
+        }
+    }
+}
+
 #[cfg(test)]
 mod test {
     use crate::{
@@ -1694,6 +2184,30 @@ mod test {
         assert_ne!(a.generation, b.generation);
     }
 
+    #[test]
+    fn pool_reserve_handle() {
+        let mut pool = Pool::<u32>::new();
+        let a = pool.spawn(1);
+        pool.free(a);
+
+        let (ticket_a, reserved_a) = pool.reserve_handle();
+        let (ticket_b, reserved_b) = pool.reserve_handle();
+        assert_eq!(reserved_a.index, a.index);
+        assert_ne!(reserved_a.generation, a.generation);
+        assert_eq!(reserved_b.index, 1);
+        assert!(pool.try_borrow(reserved_a).is_none());
+
+        // Reserved records must not be used for spawning.
+        let c = pool.spawn(3);
+        assert_eq!(c.index, 2);
+
+        assert_eq!(pool.put_back(ticket_a, 42), reserved_a);
+        assert_eq!(pool[reserved_a], 42);
+
+        pool.forget_ticket(ticket_b);
+        assert_eq!(pool.spawn(4).index, reserved_b.index);
+    }
+
     #[test]
     fn pool_get_capacity() {
         let mut pool = Pool::<u32>::new();
@@ -1861,4 +2375,173 @@ mod test {
         assert_eq!(pool[h3], 3);
         assert_eq!(pool[h4], 4);
     }
+
+    fn sorted_alive_handles(pool: &Pool<u32>) -> Vec<Handle<u32>> {
+        let mut handles = pool.alive_pair_iter().map(|(h, _)| h).collect::<Vec<_>>();
+        handles.sort_by_key(|h| h.index);
+        handles
+    }
+
+    #[test]
+    fn pool_alive_index() {
+        let mut pool = Pool::<u32>::new();
+        let a = pool.spawn(1);
+        let b = pool.spawn(2);
+        pool.set_alive_index_enabled(true);
+        assert!(pool.is_alive_index_enabled());
+        let c = pool.spawn(3);
+        let d = pool.spawn_at(5, 4).unwrap();
+        pool.free(b);
+        assert_eq!(pool.try_free(b), None);
+        assert_eq!(sorted_alive_handles(&pool), [a, c, d]);
+        assert_eq!(pool.alive_count(), 3);
+
+        // Reserved records are skipped, but stay in the index.
+        let (ticket, value) = pool.take_reserve(c);
+        assert_eq!(sorted_alive_handles(&pool), [a, d]);
+        assert_eq!(pool.put_back(ticket, value), c);
+        assert_eq!(sorted_alive_handles(&pool), [a, c, d]);
+        let (ticket, _) = pool.take_reserve(c);
+        pool.forget_ticket(ticket);
+        assert_eq!(sorted_alive_handles(&pool), [a, d]);
+
+        let e = pool.spawn(5);
+        pool.retain(|v| *v != 1);
+        for (_, value) in pool.alive_pair_iter_mut() {
+            *value *= 10;
+        }
+        assert_eq!(sorted_alive_handles(&pool), [e, d]);
+        assert_eq!(pool[e], 50);
+        assert_eq!(pool[d], 40);
+
+        {
+            let ctx = pool.begin_multi_borrow();
+            ctx.free(e).unwrap();
+        }
+        assert_eq!(sorted_alive_handles(&pool), [d]);
+
+        let mut visitor = Visitor::new();
+        pool.visit("Pool", &mut visitor).unwrap();
+        let mut visitor =
+            Visitor::load_from_memory(&visitor.save_binary_to_vec().unwrap()).unwrap();
+        let mut loaded = Pool::<u32>::new();
+        loaded.set_alive_index_enabled(true);
+        loaded.visit("Pool", &mut visitor).unwrap();
+        assert_eq!(sorted_alive_handles(&loaded), [d]);
+
+        pool.clear();
+        assert_eq!(pool.alive_count(), 0);
+        assert_eq!(pool.alive_pair_iter().count(), 0);
+    }
+
+    #[test]
+    fn pool_sorted_alive_index() {
+        let mut pool = Pool::<u32>::new();
+        pool.set_alive_index_enabled(true);
+        let handles = (0..100).map(|i| pool.spawn(i)).collect::<Vec<_>>();
+        for handle in handles.iter().step_by(7) {
+            pool.free(*handle);
+        }
+        pool.spawn(1000);
+        pool.spawn(1001);
+
+        let ordered = |pool: &Pool<u32>| {
+            pool.alive_pair_iter()
+                .map(|(handle, _)| handle)
+                .eq(pool.pair_iter().map(|(handle, _)| handle))
+        };
+
+        assert!(!ordered(&pool));
+        pool.sort_alive_index();
+        assert!(ordered(&pool));
+
+        // The index must stay consistent after sorting.
+        pool.free(handles[1]);
+        pool.spawn(2000);
+        pool.sort_alive_index();
+        assert!(ordered(&pool));
+        assert_eq!(pool.alive_count(), pool.pair_iter().count() as u32);
+    }
+
+    #[test]
+    fn pool_par_iter() {
+        use rayon::prelude::*;
+
+        for enabled in [false, true] {
+            let mut pool = Pool::<u32>::new();
+            pool.set_alive_index_enabled(enabled);
+            let handles = (0..1000).map(|i| pool.spawn(i)).collect::<Vec<_>>();
+            for handle in handles.iter().step_by(3) {
+                pool.free(*handle);
+            }
+            pool.par_iter_mut().for_each(|v| *v += 1);
+            let sum: u32 = pool.par_iter().sum();
+            assert_eq!(sum, pool.iter().sum());
+            assert_eq!(pool.par_pair_iter().count(), pool.pair_iter().count());
+            assert!(pool.par_pair_iter_mut().all(|(h, v)| h.index + 1 == *v));
+        }
+    }
+
+    #[test]
+    fn pool_compact() {
+        let mut pool = Pool::<u32>::new();
+        pool.set_alive_index_enabled(true);
+        let handles = (0..10).map(|i| pool.spawn(i)).collect::<Vec<_>>();
+        for handle in handles.iter().filter(|h| h.index % 2 == 0) {
+            pool.free(*handle);
+        }
+        let stale = pool.spawn(100);
+        pool.free(stale);
+
+        let remap = pool.compact();
+        assert_eq!(pool.get_capacity(), 5);
+        assert_eq!(pool.total_count(), 5);
+        assert_eq!(remap.get(stale), Handle::NONE);
+        assert_eq!(remap.moved().count(), 5);
+        for (i, handle) in handles.iter().enumerate() {
+            let new = remap.get(*handle);
+            if i % 2 == 0 {
+                assert_eq!(new, Handle::NONE);
+            } else {
+                assert_eq!(pool[new], i as u32);
+                assert_eq!(new.index, i as u32 / 2);
+            }
+        }
+        // Old handles must not point to moved objects.
+        assert!(!pool.is_valid_handle(handles[0]));
+        assert!(!pool.is_valid_handle(stale));
+        assert_eq!(pool.alive_pair_iter().count(), 5);
+        let _ = pool.spawn(123);
+        assert_eq!(pool.get_capacity(), 6);
+    }
+
+    #[ignore = "takes multiple seconds to run"]
+    #[test]
+    fn pool_alive_iteration_benchmark() {
+        for enabled in [false, true] {
+            let mut pool = Pool::<[f32; 4]>::new();
+            pool.set_alive_index_enabled(enabled);
+            // Simulate churn - a big pool with only a small amount of alive objects.
+            let handles = (0..1_000_000)
+                .map(|_| pool.spawn([1.0; 4]))
+                .collect::<Vec<_>>();
+            for handle in handles.iter().filter(|h| h.index % 100 != 0) {
+                pool.free(*handle);
+            }
+
+            let instant = std::time::Instant::now();
+            let mut sum = 0.0;
+            for _ in 0..100 {
+                for (_, value) in pool.alive_pair_iter() {
+                    sum += value[0];
+                }
+            }
+            println!(
+                "Alive index: {enabled}, capacity: {}, alive: {}, 100 iterations took: {:?} (sum {sum})",
+                pool.get_capacity(),
+                pool.alive_count(),
+                instant.elapsed()
+            );
+        }
+    }
 }
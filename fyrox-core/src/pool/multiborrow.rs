@@ -172,9 +172,13 @@ where
     P: PayloadContainer<Element = T> + 'static,
 {
     fn drop(&mut self) {
-        self.pool
-            .free_stack
-            .extend_from_slice(&self.free_indices.borrow())
+        let free_indices = self.free_indices.borrow();
+        self.pool.free_stack.extend_from_slice(&free_indices);
+        if let Some(alive_index) = self.pool.alive_index.as_mut() {
+            for index in free_indices.iter() {
+                alive_index.remove(*index);
+            }
+        }
     }
 }
 
@@ -10,6 +10,8 @@
 
 pub use fyrox_core_derive::Visit;
 
+mod lz;
+
 pub mod prelude {
     //! Types to use `#[derive(Visit)]`
     pub use super::{Visit, VisitError, VisitResult, Visitor};
@@ -21,12 +23,13 @@ use crate::{
         SVector, Scalar, UnitComplex, UnitQuaternion, Vector2, Vector3, Vector4, U1,
     },
     io::{self, FileLoadError},
+    math::TriangleDefinition,
     pool::{Handle, Pool},
     replace_slashes,
 };
 
 use base64::Engine;
-use byteorder::{LittleEndian, ReadBytesExt, WriteBytesExt};
+use byteorder::{ByteOrder, LittleEndian, ReadBytesExt, WriteBytesExt};
 use fxhash::FxHashMap;
 use std::any::TypeId;
 use std::error::Error;
@@ -70,6 +73,17 @@ pub enum FieldKind {
         element_size: u32,
         bytes: Vec<u8>,
     },
+    /// Bulk binary data, written by [`PodVecView`] and [`BinaryBlob`]. In indexed files it is stored
+    /// aligned and it is not decoded until it is requested, so it can be copied into its destination
+    /// with a single `memcpy` (see [`Visitor::borrow_pod_slice`] for zero-copy access).
+    PodBlob {
+        type_id: u8,
+        element_size: u32,
+        compression: BlobCompression,
+        /// Size of the uncompressed data in bytes.
+        len: u64,
+        data: BlobData,
+    },
     Matrix2(Matrix2<f32>),
 
     Vector2F32(Vector2<f32>),
@@ -113,6 +127,124 @@ pub enum FieldKind {
     Vector4I64(Vector4<i64>),
 }
 
+/// Compression of a binary blob.
+#[derive(Copy, Clone, Debug, Default, PartialEq, Eq)]
+#[repr(u8)]
+pub enum BlobCompression {
+    /// No compression, the blob can be copied or borrowed as is.
+    #[default]
+    None = 0,
+    /// Fast LZ77-style compression in LZ4 block format. It is worth to use for data with lots of
+    /// repetitions, such as masks or height maps.
+    Lz4 = 1,
+}
+
+impl BlobCompression {
+    /// Blobs smaller than this will not be compressed, because there's no benefit in it.
+    pub const MIN_COMPRESSED_SIZE: usize = 256;
+
+    fn from_id(id: u8) -> Result<Self, VisitError> {
+        match id {
+            0 => Ok(Self::None),
+            1 => Ok(Self::Lz4),
+            _ => Err(VisitError::NotSupportedFormat),
+        }
+    }
+}
+
+/// Storage of a binary blob.
+pub enum BlobData {
+    /// The blob is stored in memory.
+    Owned(Vec<u8>),
+    /// The blob is a range of bytes of the data of an indexed file (see [`Visitor::load_from_vec`]).
+    Indexed(Range<usize>),
+}
+
+fn align_padding(position: usize) -> usize {
+    (BLOB_ALIGNMENT - position % BLOB_ALIGNMENT) % BLOB_ALIGNMENT
+}
+
+/// Type id of [`BinaryBlob`] data. Such blobs are untyped and only their length is checked on load.
+const UNTYPED_BLOB_ID: u8 = u8::MAX;
+/// Alignment of blob data in indexed files.
+const BLOB_ALIGNMENT: usize = 16;
+/// Size of the header of a blob in binary files, it includes field type id.
+const BLOB_HEADER_SIZE: usize = 24;
+
+fn make_blob(
+    type_id: u8,
+    element_size: u32,
+    bytes: &[u8],
+    compression: BlobCompression,
+) -> FieldKind {
+    let (compression, data) = match compression {
+        BlobCompression::Lz4 if bytes.len() >= BlobCompression::MIN_COMPRESSED_SIZE => {
+            let compressed = lz::compress(bytes);
+            if compressed.len() < bytes.len() {
+                (BlobCompression::Lz4, compressed)
+            } else {
+                (BlobCompression::None, bytes.to_vec())
+            }
+        }
+        _ => (BlobCompression::None, bytes.to_vec()),
+    };
+    FieldKind::PodBlob {
+        type_id,
+        element_size,
+        compression,
+        len: bytes.len() as u64,
+        data: BlobData::Owned(data),
+    }
+}
+
+/// Decodes blob data into a vector with a single copy (or decompression) directly into its memory.
+fn decode_blob<T: Copy>(
+    bytes: &[u8],
+    compression: BlobCompression,
+    len: u64,
+) -> Result<Vec<T>, VisitError> {
+    let len = len as usize;
+    let element_size = std::mem::size_of::<T>();
+    if element_size == 0 || len % element_size != 0 {
+        return Err(VisitError::TypeMismatch);
+    }
+    // Validate the length before allocating anything, it comes from the file and could be anything.
+    match compression {
+        BlobCompression::None => {
+            if bytes.len() != len {
+                return Err(VisitError::NotSupportedFormat);
+            }
+        }
+        BlobCompression::Lz4 => {
+            // LZ4 cannot expand data more than ~255 times.
+            if len > bytes.len().saturating_mul(255).saturating_add(16) {
+                return Err(VisitError::NotSupportedFormat);
+            }
+        }
+    }
+    let count = len / element_size;
+    let mut data = Vec::<T>::with_capacity(count);
+    match compression {
+        BlobCompression::None => {
+            // SAFETY: The vector has enough capacity and T is a plain-old-data type.
+            unsafe {
+                std::ptr::copy_nonoverlapping(bytes.as_ptr(), data.as_mut_ptr() as *mut u8, len);
+                data.set_len(count);
+            }
+        }
+        BlobCompression::Lz4 => {
+            // SAFETY: The memory is zeroed before it is exposed as a byte slice, T is plain-old-data.
+            let dst = unsafe {
+                std::ptr::write_bytes(data.as_mut_ptr() as *mut u8, 0, len);
+                data.set_len(count);
+                std::slice::from_raw_parts_mut(data.as_mut_ptr() as *mut u8, len)
+            };
+            lz::decompress_into(bytes, dst).ok_or(VisitError::NotSupportedFormat)?;
+        }
+    }
+    Ok(data)
+}
+
 pub trait Pod: Copy {
     fn type_id() -> u8;
 }
@@ -177,9 +309,18 @@ impl Pod for f64 {
     }
 }
 
+impl Pod for TriangleDefinition {
+    fn type_id() -> u8 {
+        10
+    }
+}
+
+/// Proxy for bulk data of [`Pod`] elements. The data is stored as a single binary blob, optionally
+/// compressed, and it is loaded with a single copy directly into the vector memory.
 pub struct PodVecView<'a, T: Pod> {
     type_id: u8,
     vec: &'a mut Vec<T>,
+    compression: BlobCompression,
 }
 
 impl<'a, T: Pod> PodVecView<'a, T> {
@@ -187,65 +328,40 @@ impl<'a, T: Pod> PodVecView<'a, T> {
         Self {
             type_id: T::type_id(),
             vec,
+            compression: BlobCompression::None,
         }
     }
+
+    /// Sets compression, that will be used when the data is written. Small blobs are never compressed,
+    /// see [`BlobCompression::MIN_COMPRESSED_SIZE`].
+    pub fn with_compression(mut self, compression: BlobCompression) -> Self {
+        self.compression = compression;
+        self
+    }
 }
 
 impl<'a, T: Pod> Visit for PodVecView<'a, T> {
-    #[allow(clippy::uninit_vec)]
     fn visit(&mut self, name: &str, visitor: &mut Visitor) -> VisitResult {
         if visitor.reading {
-            if let Some(field) = visitor.find_field(name) {
-                match &field.kind {
-                    FieldKind::PodArray {
-                        type_id,
-                        element_size,
-                        bytes,
-                    } => {
-                        if *type_id == self.type_id {
-                            let len = bytes.len() / *element_size as usize;
-                            let mut data = Vec::<T>::with_capacity(len);
-                            unsafe {
-                                data.set_len(len);
-                                std::ptr::copy_nonoverlapping(
-                                    bytes.as_ptr(),
-                                    data.as_mut_ptr() as *mut u8,
-                                    bytes.len(),
-                                );
-                            }
-                            *self.vec = data;
-                            Ok(())
-                        } else {
-                            Err(VisitError::TypeMismatch)
-                        }
-                    }
-                    _ => Err(VisitError::FieldTypeDoesNotMatch),
-                }
-            } else {
-                Err(VisitError::FieldDoesNotExist(name.to_owned()))
-            }
-        } else if visitor.find_field(name).is_some() {
-            Err(VisitError::FieldAlreadyExists(name.to_owned()))
+            *self.vec = visitor.read_blob(name, self.type_id)?;
+            Ok(())
         } else {
-            let node = visitor.current_node();
-            node.fields.push(Field::new(
+            // SAFETY: T is a plain-old-data type.
+            let bytes = unsafe {
+                std::slice::from_raw_parts(
+                    self.vec.as_ptr() as *const u8,
+                    std::mem::size_of_val(self.vec.as_slice()),
+                )
+            };
+            visitor.write_blob(
                 name,
-                FieldKind::PodArray {
-                    type_id: T::type_id(),
-                    element_size: std::mem::size_of::<T>() as u32,
-                    bytes: unsafe {
-                        let mut data = self.vec.clone();
-                        let bytes = Vec::from_raw_parts(
-                            data.as_mut_ptr() as *mut u8,
-                            data.len() * std::mem::size_of::<T>(),
-                            data.capacity() * std::mem::size_of::<T>(),
-                        );
-                        std::mem::forget(data);
-                        bytes
-                    },
-                },
-            ));
-            Ok(())
+                make_blob(
+                    self.type_id,
+                    std::mem::size_of::<T>() as u32,
+                    bytes,
+                    self.compression,
+                ),
+            )
         }
     }
 }
@@ -389,6 +505,18 @@ impl FieldKind {
                     type_id, element_size, base64_encoded
                 )
             }
+            FieldKind::PodBlob {
+                type_id,
+                element_size,
+                compression,
+                len,
+                ..
+            } => {
+                format!(
+                    "<podblob = {}; {}; {:?}; {}>",
+                    type_id, element_size, compression, len
+                )
+            }
             Self::Matrix2(data) => {
                 let mut out = String::from("<mat2 = ");
                 for f in data.iter() {
@@ -501,49 +629,32 @@ where
 {
     fn visit(&mut self, name: &str, visitor: &mut Visitor) -> VisitResult {
         if visitor.reading {
-            if let Some(field) = visitor.find_field(name) {
-                match &field.kind {
-                    FieldKind::BinaryBlob(data) => {
-                        let mut bytes = std::mem::ManuallyDrop::new(data.clone());
-
-                        // SAFETY: This is kinda safe, but may cause portability issues because of various byte order.
-                        // However it seems to be fine, since big-endian is pretty much dead and unused nowadays.
-                        *self.vec = unsafe {
-                            Vec::from_raw_parts(
-                                bytes.as_mut_ptr() as *mut T,
-                                bytes.len() / std::mem::size_of::<T>(),
-                                bytes.capacity() / std::mem::size_of::<T>(),
-                            )
-                        };
-
-                        Ok(())
-                    }
-                    _ => Err(VisitError::FieldTypeDoesNotMatch),
-                }
-            } else {
-                Err(VisitError::FieldDoesNotExist(name.to_owned()))
-            }
-        } else if visitor.find_field(name).is_some() {
-            Err(VisitError::FieldAlreadyExists(name.to_owned()))
-        } else {
-            let node = visitor.current_node();
-
-            let len_bytes = self.vec.len() * std::mem::size_of::<T>();
-            let mut bytes = Vec::<u8>::with_capacity(len_bytes);
-            bytes.extend_from_slice(unsafe {
-                std::slice::from_raw_parts(self.vec.as_ptr() as *const u8, len_bytes)
-            });
-
-            node.fields
-                .push(Field::new(name, FieldKind::BinaryBlob(bytes)));
-
+            *self.vec = visitor.read_blob(name, UNTYPED_BLOB_ID)?;
             Ok(())
+        } else {
+            // SAFETY: This is kinda safe, but may cause portability issues because of various byte order.
+            // However it seems to be fine, since big-endian is pretty much dead and unused nowadays.
+            let bytes = unsafe {
+                std::slice::from_raw_parts(
+                    self.vec.as_ptr() as *const u8,
+                    std::mem::size_of_val(self.vec.as_slice()),
+                )
+            };
+            visitor.write_blob(
+                name,
+                make_blob(
+                    UNTYPED_BLOB_ID,
+                    std::mem::size_of::<T>() as u32,
+                    bytes,
+                    BlobCompression::None,
+                ),
+            )
         }
     }
 }
 
 pub struct Field {
-    name: String,
+    name: Rc<str>,
     kind: FieldKind,
 }
 
@@ -672,12 +783,21 @@ impl_visitable_elementary_field!(i64, write_i64, read_i64, LittleEndian);
 impl Field {
     pub fn new(name: &str, kind: FieldKind) -> Self {
         Self {
-            name: name.to_owned(),
+            name: name.into(),
             kind,
         }
     }
 
     fn save(field: &Field, file: &mut dyn Write) -> VisitResult {
+        let name = field.name.as_bytes();
+        file.write_u32::<LittleEndian>(name.len() as u32)?;
+        file.write_all(name)?;
+        Self::save_kind(&field.kind, file, 0)
+    }
+
+    /// Writes the field kind. `position` is the position of the field data in the stream, it is used
+    /// to align blobs.
+    fn save_kind(kind: &FieldKind, file: &mut dyn Write, position: usize) -> VisitResult {
         fn write_vec_n<T, const N: usize>(
             file: &mut dyn Write,
             type_id: u8,
@@ -693,10 +813,7 @@ impl Field {
             Ok(())
         }
 
-        let name = field.name.as_bytes();
-        file.write_u32::<LittleEndian>(name.len() as u32)?;
-        file.write_all(name)?;
-        match &field.kind {
+        match kind {
             FieldKind::U8(data) => {
                 file.write_u8(1)?;
                 file.write_u8(*data)?;
@@ -794,6 +911,29 @@ impl Field {
                 file.write_u64::<LittleEndian>(bytes.len() as u64)?;
                 file.write_all(bytes)?;
             }
+            FieldKind::PodBlob {
+                type_id,
+                element_size,
+                compression,
+                len,
+                data,
+            } => {
+                let BlobData::Owned(bytes) = data else {
+                    return Err(VisitError::User(
+                        "Blobs of a loaded indexed file cannot be saved".to_string(),
+                    ));
+                };
+                let padding = align_padding(position + BLOB_HEADER_SIZE);
+                file.write_u8(50)?;
+                file.write_u8(*type_id)?;
+                file.write_u32::<LittleEndian>(*element_size)?;
+                file.write_u8(*compression as u8)?;
+                file.write_u64::<LittleEndian>(*len)?;
+                file.write_u64::<LittleEndian>(bytes.len() as u64)?;
+                file.write_u8(padding as u8)?;
+                file.write_all(&[0; BLOB_ALIGNMENT][..padding])?;
+                file.write_all(bytes)?;
+            }
             FieldKind::Matrix2(data) => {
                 file.write_u8(22)?;
                 for f in data.iter() {
@@ -894,6 +1034,41 @@ impl Field {
     }
 
     fn load(file: &mut dyn Read) -> Result<Field, VisitError> {
+        let name_len = file.read_u32::<LittleEndian>()? as usize;
+        let mut raw_name = vec![Default::default(); name_len];
+        file.read_exact(raw_name.as_mut_slice())?;
+        Ok(Field {
+            name: String::from_utf8(raw_name)?.into(),
+            kind: Self::load_kind(file)?,
+        })
+    }
+
+    /// Reads the header of a blob, the id of the field must be read already. Returns the blob kind with
+    /// empty data and the size of the stored data.
+    fn load_blob_header(file: &mut dyn Read) -> Result<(FieldKind, usize), VisitError> {
+        let type_id = file.read_u8()?;
+        let element_size = file.read_u32::<LittleEndian>()?;
+        let compression = BlobCompression::from_id(file.read_u8()?)?;
+        let len = file.read_u64::<LittleEndian>()?;
+        let stored_len = file.read_u64::<LittleEndian>()? as usize;
+        let padding = file.read_u8()? as usize;
+        if padding >= BLOB_ALIGNMENT {
+            return Err(VisitError::NotSupportedFormat);
+        }
+        file.read_exact(&mut [0; BLOB_ALIGNMENT][..padding])?;
+        Ok((
+            FieldKind::PodBlob {
+                type_id,
+                element_size,
+                compression,
+                len,
+                data: BlobData::Owned(Vec::new()),
+            },
+            stored_len,
+        ))
+    }
+
+    fn load_kind(file: &mut dyn Read) -> Result<FieldKind, VisitError> {
         fn read_vec_n<T, S, const N: usize>(
             file: &mut dyn Read,
         ) -> Result<Matrix<T, Const<N>, U1, S>, VisitError>
@@ -908,137 +1083,136 @@ impl Field {
             Ok(vec)
         }
 
-        let name_len = file.read_u32::<LittleEndian>()? as usize;
-        let mut raw_name = vec![Default::default(); name_len];
-        file.read_exact(raw_name.as_mut_slice())?;
         let id = file.read_u8()?;
-        Ok(Field::new(
-            String::from_utf8(raw_name)?.as_str(),
-            match id {
-                1 => FieldKind::U8(file.read_u8()?),
-                2 => FieldKind::I8(file.read_i8()?),
-                3 => FieldKind::U16(file.read_u16::<LittleEndian>()?),
-                4 => FieldKind::I16(file.read_i16::<LittleEndian>()?),
-                5 => FieldKind::U32(file.read_u32::<LittleEndian>()?),
-                6 => FieldKind::I32(file.read_i32::<LittleEndian>()?),
-                7 => FieldKind::U64(file.read_u64::<LittleEndian>()?),
-                8 => FieldKind::I64(file.read_i64::<LittleEndian>()?),
-                9 => FieldKind::F32(file.read_f32::<LittleEndian>()?),
-                10 => FieldKind::F64(file.read_f64::<LittleEndian>()?),
-                11 => FieldKind::Vector3F32({
-                    let x = file.read_f32::<LittleEndian>()?;
-                    let y = file.read_f32::<LittleEndian>()?;
-                    let z = file.read_f32::<LittleEndian>()?;
-                    Vector3::new(x, y, z)
-                }),
-                12 => FieldKind::UnitQuaternion({
-                    let x = file.read_f32::<LittleEndian>()?;
-                    let y = file.read_f32::<LittleEndian>()?;
-                    let z = file.read_f32::<LittleEndian>()?;
-                    let w = file.read_f32::<LittleEndian>()?;
-                    UnitQuaternion::new_normalize(Quaternion::new(w, x, y, z))
-                }),
-                13 => FieldKind::Matrix4({
-                    let mut f = [0.0f32; 16];
-                    for n in &mut f {
-                        *n = file.read_f32::<LittleEndian>()?;
-                    }
-                    Matrix4::from_row_slice(&f)
-                }),
-                14 => FieldKind::BinaryBlob({
-                    let len = file.read_u32::<LittleEndian>()? as usize;
-                    let mut vec = vec![Default::default(); len];
-                    file.read_exact(vec.as_mut_slice())?;
-                    vec
-                }),
-                15 => FieldKind::Bool(file.read_u8()? != 0),
-                16 => FieldKind::Matrix3({
-                    let mut f = [0.0f32; 9];
-                    for n in &mut f {
-                        *n = file.read_f32::<LittleEndian>()?;
-                    }
-                    Matrix3::from_row_slice(&f)
-                }),
-                17 => FieldKind::Vector2F32({
-                    let x = file.read_f32::<LittleEndian>()?;
-                    let y = file.read_f32::<LittleEndian>()?;
-                    Vector2::new(x, y)
-                }),
-                18 => FieldKind::Vector4F32({
-                    let x = file.read_f32::<LittleEndian>()?;
-                    let y = file.read_f32::<LittleEndian>()?;
-                    let z = file.read_f32::<LittleEndian>()?;
-                    let w = file.read_f32::<LittleEndian>()?;
-                    Vector4::new(x, y, z, w)
-                }),
-                19 => FieldKind::Uuid({
-                    let mut bytes = uuid::Bytes::default();
-                    file.read_exact(&mut bytes)?;
-                    Uuid::from_bytes(bytes)
-                }),
-                20 => FieldKind::UnitComplex({
-                    let re = file.read_f32::<LittleEndian>()?;
-                    let im = file.read_f32::<LittleEndian>()?;
-                    UnitComplex::from_complex(Complex::new(re, im))
-                }),
-                21 => {
-                    let type_id = file.read_u8()?;
-                    let element_size = file.read_u32::<LittleEndian>()?;
-                    let data_size = file.read_u64::<LittleEndian>()?;
-                    let mut bytes = vec![0; data_size as usize];
-                    file.read_exact(&mut bytes)?;
-                    FieldKind::PodArray {
-                        type_id,
-                        element_size,
-                        bytes,
-                    }
+        Ok(match id {
+            1 => FieldKind::U8(file.read_u8()?),
+            2 => FieldKind::I8(file.read_i8()?),
+            3 => FieldKind::U16(file.read_u16::<LittleEndian>()?),
+            4 => FieldKind::I16(file.read_i16::<LittleEndian>()?),
+            5 => FieldKind::U32(file.read_u32::<LittleEndian>()?),
+            6 => FieldKind::I32(file.read_i32::<LittleEndian>()?),
+            7 => FieldKind::U64(file.read_u64::<LittleEndian>()?),
+            8 => FieldKind::I64(file.read_i64::<LittleEndian>()?),
+            9 => FieldKind::F32(file.read_f32::<LittleEndian>()?),
+            10 => FieldKind::F64(file.read_f64::<LittleEndian>()?),
+            11 => FieldKind::Vector3F32({
+                let x = file.read_f32::<LittleEndian>()?;
+                let y = file.read_f32::<LittleEndian>()?;
+                let z = file.read_f32::<LittleEndian>()?;
+                Vector3::new(x, y, z)
+            }),
+            12 => FieldKind::UnitQuaternion({
+                let x = file.read_f32::<LittleEndian>()?;
+                let y = file.read_f32::<LittleEndian>()?;
+                let z = file.read_f32::<LittleEndian>()?;
+                let w = file.read_f32::<LittleEndian>()?;
+                UnitQuaternion::new_normalize(Quaternion::new(w, x, y, z))
+            }),
+            13 => FieldKind::Matrix4({
+                let mut f = [0.0f32; 16];
+                for n in &mut f {
+                    *n = file.read_f32::<LittleEndian>()?;
                 }
-                22 => FieldKind::Matrix2({
-                    let mut f = [0.0f32; 3];
-                    for n in &mut f {
-                        *n = file.read_f32::<LittleEndian>()?;
-                    }
-                    Matrix2::from_row_slice(&f)
-                }),
-                23 => FieldKind::Vector2F64(read_vec_n(file)?),
-                24 => FieldKind::Vector3F64(read_vec_n(file)?),
-                25 => FieldKind::Vector4F64(read_vec_n(file)?),
-
-                26 => FieldKind::Vector2I8(read_vec_n(file)?),
-                27 => FieldKind::Vector3I8(read_vec_n(file)?),
-                28 => FieldKind::Vector4I8(read_vec_n(file)?),
-
-                29 => FieldKind::Vector2U8(read_vec_n(file)?),
-                30 => FieldKind::Vector3U8(read_vec_n(file)?),
-                31 => FieldKind::Vector4U8(read_vec_n(file)?),
-
-                32 => FieldKind::Vector2I16(read_vec_n(file)?),
-                33 => FieldKind::Vector3I16(read_vec_n(file)?),
-                34 => FieldKind::Vector4I16(read_vec_n(file)?),
-
-                35 => FieldKind::Vector2U16(read_vec_n(file)?),
-                36 => FieldKind::Vector3U16(read_vec_n(file)?),
-                37 => FieldKind::Vector4U16(read_vec_n(file)?),
-
-                38 => FieldKind::Vector2I32(read_vec_n(file)?),
-                39 => FieldKind::Vector3I32(read_vec_n(file)?),
-                40 => FieldKind::Vector4I32(read_vec_n(file)?),
-
-                41 => FieldKind::Vector2U32(read_vec_n(file)?),
-                42 => FieldKind::Vector3U32(read_vec_n(file)?),
-                43 => FieldKind::Vector4U32(read_vec_n(file)?),
-
-                44 => FieldKind::Vector2I64(read_vec_n(file)?),
-                45 => FieldKind::Vector3I64(read_vec_n(file)?),
-                46 => FieldKind::Vector4I64(read_vec_n(file)?),
-
-                47 => FieldKind::Vector2U64(read_vec_n(file)?),
-                48 => FieldKind::Vector3U64(read_vec_n(file)?),
-                49 => FieldKind::Vector4U64(read_vec_n(file)?),
+                Matrix4::from_row_slice(&f)
+            }),
+            14 => FieldKind::BinaryBlob({
+                let len = file.read_u32::<LittleEndian>()?;
+                read_bytes(file, len as u64)?
+            }),
+            15 => FieldKind::Bool(file.read_u8()? != 0),
+            16 => FieldKind::Matrix3({
+                let mut f = [0.0f32; 9];
+                for n in &mut f {
+                    *n = file.read_f32::<LittleEndian>()?;
+                }
+                Matrix3::from_row_slice(&f)
+            }),
+            17 => FieldKind::Vector2F32({
+                let x = file.read_f32::<LittleEndian>()?;
+                let y = file.read_f32::<LittleEndian>()?;
+                Vector2::new(x, y)
+            }),
+            18 => FieldKind::Vector4F32({
+                let x = file.read_f32::<LittleEndian>()?;
+                let y = file.read_f32::<LittleEndian>()?;
+                let z = file.read_f32::<LittleEndian>()?;
+                let w = file.read_f32::<LittleEndian>()?;
+                Vector4::new(x, y, z, w)
+            }),
+            19 => FieldKind::Uuid({
+                let mut bytes = uuid::Bytes::default();
+                file.read_exact(&mut bytes)?;
+                Uuid::from_bytes(bytes)
+            }),
+            20 => FieldKind::UnitComplex({
+                let re = file.read_f32::<LittleEndian>()?;
+                let im = file.read_f32::<LittleEndian>()?;
+                UnitComplex::from_complex(Complex::new(re, im))
+            }),
+            21 => {
+                let type_id = file.read_u8()?;
+                let element_size = file.read_u32::<LittleEndian>()?;
+                let data_size = file.read_u64::<LittleEndian>()?;
+                let bytes = read_bytes(file, data_size)?;
+                FieldKind::PodArray {
+                    type_id,
+                    element_size,
+                    bytes,
+                }
+            }
+            22 => FieldKind::Matrix2({
+                let mut f = [0.0f32; 3];
+                for n in &mut f {
+                    *n = file.read_f32::<LittleEndian>()?;
+                }
+                Matrix2::from_row_slice(&f)
+            }),
+            23 => FieldKind::Vector2F64(read_vec_n(file)?),
+            24 => FieldKind::Vector3F64(read_vec_n(file)?),
+            25 => FieldKind::Vector4F64(read_vec_n(file)?),
+
+            26 => FieldKind::Vector2I8(read_vec_n(file)?),
+            27 => FieldKind::Vector3I8(read_vec_n(file)?),
+            28 => FieldKind::Vector4I8(read_vec_n(file)?),
+
+            29 => FieldKind::Vector2U8(read_vec_n(file)?),
+            30 => FieldKind::Vector3U8(read_vec_n(file)?),
+            31 => FieldKind::Vector4U8(read_vec_n(file)?),
+
+            32 => FieldKind::Vector2I16(read_vec_n(file)?),
+            33 => FieldKind::Vector3I16(read_vec_n(file)?),
+            34 => FieldKind::Vector4I16(read_vec_n(file)?),
+
+            35 => FieldKind::Vector2U16(read_vec_n(file)?),
+            36 => FieldKind::Vector3U16(read_vec_n(file)?),
+            37 => FieldKind::Vector4U16(read_vec_n(file)?),
+
+            38 => FieldKind::Vector2I32(read_vec_n(file)?),
+            39 => FieldKind::Vector3I32(read_vec_n(file)?),
+            40 => FieldKind::Vector4I32(read_vec_n(file)?),
+
+            41 => FieldKind::Vector2U32(read_vec_n(file)?),
+            42 => FieldKind::Vector3U32(read_vec_n(file)?),
+            43 => FieldKind::Vector4U32(read_vec_n(file)?),
+
+            44 => FieldKind::Vector2I64(read_vec_n(file)?),
+            45 => FieldKind::Vector3I64(read_vec_n(file)?),
+            46 => FieldKind::Vector4I64(read_vec_n(file)?),
+
+            47 => FieldKind::Vector2U64(read_vec_n(file)?),
+            48 => FieldKind::Vector3U64(read_vec_n(file)?),
+            49 => FieldKind::Vector4U64(read_vec_n(file)?),
+
+            50 => {
+                let (mut kind, stored_len) = Self::load_blob_header(file)?;
+                if let FieldKind::PodBlob { data, .. } = &mut kind {
+                    *data = BlobData::Owned(read_bytes(file, stored_len as u64)?);
+                }
+                kind
+            }
 
-                _ => return Err(VisitError::UnknownFieldType(id)),
-            },
-        ))
+            _ => return Err(VisitError::UnknownFieldType(id)),
+        })
     }
 
     fn as_string(&self) -> String {
@@ -1047,19 +1221,23 @@ impl Field {
 }
 
 pub struct VisitorNode {
-    name: String,
+    name: Rc<str>,
     fields: Vec<Field>,
     parent: Handle<VisitorNode>,
     children: Vec<Handle<VisitorNode>>,
+    /// Index of the node in the region table of an indexed file. Such nodes do not store their
+    /// children, they're decoded on demand instead.
+    indexed: Option<u32>,
 }
 
 impl VisitorNode {
     fn new(name: &str, parent: Handle<VisitorNode>) -> Self {
         Self {
-            name: name.to_owned(),
+            name: name.into(),
             fields: Vec::new(),
             parent,
             children: Vec::new(),
+            indexed: None,
         }
     }
 }
@@ -1067,14 +1245,230 @@ impl VisitorNode {
 impl Default for VisitorNode {
     fn default() -> Self {
         Self {
-            name: String::new(),
+            name: "".into(),
             fields: Vec::new(),
             parent: Handle::NONE,
             children: Vec::new(),
+            indexed: None,
         }
     }
 }
 
+/// A marker that follows [`Visitor::MAGIC`] in files saved in the indexed format. Legacy files store
+/// the length of the root region name at this place, so it can never be equal to the marker.
+const INDEXED_FORMAT_MARKER: u32 = u32::MAX;
+const INDEXED_FORMAT_VERSION: u32 = 1;
+const INDEXED_ENTRY_SIZE: usize = 24;
+
+/// An entry of the region table of the indexed format. Regions are stored in breadth-first order, so
+/// children of every region occupy a contiguous range of the table, sorted by their name ids.
+#[derive(Copy, Clone)]
+struct IndexedEntry {
+    name: u32,
+    first_child: u32,
+    child_count: u32,
+    field_count: u32,
+    fields_offset: u64,
+}
+
+impl IndexedEntry {
+    fn write(&self, writer: &mut dyn Write) -> VisitResult {
+        writer.write_u32::<LittleEndian>(self.name)?;
+        writer.write_u32::<LittleEndian>(self.first_child)?;
+        writer.write_u32::<LittleEndian>(self.child_count)?;
+        writer.write_u32::<LittleEndian>(self.field_count)?;
+        writer.write_u64::<LittleEndian>(self.fields_offset)?;
+        Ok(())
+    }
+
+    fn read(bytes: &[u8]) -> Self {
+        Self {
+            name: LittleEndian::read_u32(&bytes[0..4]),
+            first_child: LittleEndian::read_u32(&bytes[4..8]),
+            child_count: LittleEndian::read_u32(&bytes[8..12]),
+            field_count: LittleEndian::read_u32(&bytes[12..16]),
+            fields_offset: LittleEndian::read_u64(&bytes[16..24]),
+        }
+    }
+}
+
+#[derive(Default)]
+struct NameTable<'a> {
+    ids: FxHashMap<&'a str, u32>,
+    names: Vec<&'a str>,
+}
+
+impl<'a> NameTable<'a> {
+    fn intern(&mut self, name: &'a str) -> u32 {
+        *self.ids.entry(name).or_insert_with(|| {
+            self.names.push(name);
+            self.names.len() as u32 - 1
+        })
+    }
+}
+
+/// Reads exactly `len` bytes. Unlike reading into a pre-allocated buffer, memory is allocated only for
+/// the bytes that are actually read, so a corrupted length cannot cause a huge allocation.
+fn read_bytes(file: &mut dyn Read, len: u64) -> Result<Vec<u8>, VisitError> {
+    let mut bytes = Vec::new();
+    file.take(len).read_to_end(&mut bytes)?;
+    if bytes.len() as u64 != len {
+        return Err(VisitError::NotSupportedFormat);
+    }
+    Ok(bytes)
+}
+
+/// Contents of a file in the indexed format. Only the name table is decoded when the file is loaded,
+/// everything else is read straight from the bytes when a region is entered.
+struct IndexedData {
+    bytes: Vec<u8>,
+    names: Vec<Rc<str>>,
+    name_ids: FxHashMap<Rc<str>, u32>,
+    table_offset: usize,
+    entry_count: u32,
+    data: Range<usize>,
+    /// Handles of currently decoded regions, indexed by region table entries.
+    decoded: Vec<Handle<VisitorNode>>,
+}
+
+impl IndexedData {
+    fn new(bytes: Vec<u8>) -> Result<Self, VisitError> {
+        let mut reader = Cursor::new(bytes.as_slice());
+        reader.set_position((Visitor::MAGIC.len() + std::mem::size_of::<u32>()) as u64);
+        if reader.read_u32::<LittleEndian>()? > INDEXED_FORMAT_VERSION {
+            return Err(VisitError::NotSupportedFormat);
+        }
+        let name_count = reader.read_u32::<LittleEndian>()?;
+        let entry_count = reader.read_u32::<LittleEndian>()?;
+        let data_len = usize::try_from(reader.read_u64::<LittleEndian>()?)
+            .map_err(|_| VisitError::NotSupportedFormat)?;
+
+        // Counts and lengths are not trusted, every name takes at least 4 bytes (its length), so the
+        // amount of names cannot exceed the amount of remaining bytes divided by 4.
+        let remaining = |reader: &Cursor<&[u8]>| bytes.len() - reader.position() as usize;
+        if name_count as usize > remaining(&reader) / std::mem::size_of::<u32>() {
+            return Err(VisitError::NotSupportedFormat);
+        }
+
+        let mut names = Vec::with_capacity(name_count as usize);
+        let mut name_ids = FxHashMap::default();
+        for id in 0..name_count {
+            let len = reader.read_u32::<LittleEndian>()? as usize;
+            if len > remaining(&reader) {
+                return Err(VisitError::NotSupportedFormat);
+            }
+            let mut raw_name = vec![0; len];
+            reader.read_exact(&mut raw_name)?;
+            let name = Rc::<str>::from(String::from_utf8(raw_name)?);
+            name_ids.insert(name.clone(), id);
+            names.push(name);
+        }
+
+        let table_offset = reader.position() as usize;
+        if entry_count == 0 || entry_count as usize > remaining(&reader) / INDEXED_ENTRY_SIZE {
+            return Err(VisitError::NotSupportedFormat);
+        }
+        let table_end = table_offset + entry_count as usize * INDEXED_ENTRY_SIZE;
+        let data_start = table_end + align_padding(table_end);
+        let data_end = data_start
+            .checked_add(data_len)
+            .filter(|data_end| *data_end <= bytes.len())
+            .ok_or(VisitError::NotSupportedFormat)?;
+
+        Ok(Self {
+            bytes,
+            names,
+            name_ids,
+            table_offset,
+            entry_count,
+            data: data_start..data_end,
+            decoded: vec![Handle::NONE; entry_count as usize],
+        })
+    }
+
+    fn entry(&self, index: u32) -> Result<IndexedEntry, VisitError> {
+        if index >= self.entry_count {
+            return Err(VisitError::NotSupportedFormat);
+        }
+        let offset = self.table_offset + index as usize * INDEXED_ENTRY_SIZE;
+        Ok(IndexedEntry::read(
+            &self.bytes[offset..offset + INDEXED_ENTRY_SIZE],
+        ))
+    }
+
+    fn name(&self, id: u32) -> Result<Rc<str>, VisitError> {
+        self.names
+            .get(id as usize)
+            .cloned()
+            .ok_or(VisitError::InvalidName)
+    }
+
+    /// Searches for a child region with the given name using binary search over the children range.
+    fn find_child(&self, parent: u32, name: &str) -> Result<Option<u32>, VisitError> {
+        let Some(&name_id) = self.name_ids.get(name) else {
+            // A name that was never interned cannot be a name of any region.
+            return Ok(None);
+        };
+        let parent = self.entry(parent)?;
+        let mut begin = parent.first_child;
+        let mut end = parent.first_child.saturating_add(parent.child_count);
+        while begin < end {
+            let middle = begin + (end - begin) / 2;
+            let child = self.entry(middle)?;
+            match child.name.cmp(&name_id) {
+                std::cmp::Ordering::Less => begin = middle + 1,
+                std::cmp::Ordering::Greater => end = middle,
+                std::cmp::Ordering::Equal => return Ok(Some(middle)),
+            }
+        }
+        Ok(None)
+    }
+
+    fn decode(&self, index: u32, parent: Handle<VisitorNode>) -> Result<VisitorNode, VisitError> {
+        let entry = self.entry(index)?;
+        let data = &self.bytes[self.data.clone()];
+        let mut reader = Cursor::new(
+            data.get(entry.fields_offset as usize..)
+                .ok_or(VisitError::NotSupportedFormat)?,
+        );
+        // Every field takes at least 5 bytes (name id and type id), the count is not trusted.
+        if entry.field_count as usize > reader.get_ref().len() / 5 {
+            return Err(VisitError::NotSupportedFormat);
+        }
+        let mut fields = Vec::with_capacity(entry.field_count as usize);
+        for _ in 0..entry.field_count {
+            let name = self.name(reader.read_u32::<LittleEndian>()?)?;
+            let position = reader.position();
+            let kind = if reader.read_u8()? == 50 {
+                // Blobs are not copied, they're read directly from the file data when requested.
+                let (mut kind, stored_len) = Field::load_blob_header(&mut reader)?;
+                let start = self.data.start + entry.fields_offset as usize;
+                let blob_start = start + reader.position() as usize;
+                let blob_end = blob_start
+                    .checked_add(stored_len)
+                    .filter(|blob_end| *blob_end <= self.data.end)
+                    .ok_or(VisitError::NotSupportedFormat)?;
+                if let FieldKind::PodBlob { data, .. } = &mut kind {
+                    *data = BlobData::Indexed(blob_start..blob_end);
+                }
+                reader.set_position(reader.position() + stored_len as u64);
+                kind
+            } else {
+                reader.set_position(position);
+                Field::load_kind(&mut reader)?
+            };
+            fields.push(Field { name, kind });
+        }
+        Ok(VisitorNode {
+            name: self.name(entry.name)?,
+            fields,
+            parent,
+            children: Vec::new(),
+            indexed: Some(index),
+        })
+    }
+}
+
 #[must_use = "the guard must be used"]
 pub struct RegionGuard<'a>(&'a mut Visitor);
 
@@ -1138,6 +1532,7 @@ pub struct Visitor {
     reading: bool,
     current_node: Handle<VisitorNode>,
     root: Handle<VisitorNode>,
+    indexed: Option<IndexedData>,
     pub blackboard: Blackboard,
 }
 
@@ -1164,6 +1559,7 @@ impl Visitor {
             reading: false,
             current_node: root,
             root,
+            indexed: None,
             blackboard: Blackboard::new(),
         }
     }
@@ -1173,13 +1569,100 @@ impl Visitor {
             .borrow_mut(self.current_node)
             .fields
             .iter_mut()
-            .find(|field| field.name == name)
+            .find(|field| &*field.name == name)
     }
 
     pub fn is_reading(&self) -> bool {
         self.reading
     }
 
+    fn find_field_ref(&self, name: &str) -> Option<&Field> {
+        self.nodes
+            .try_borrow(self.current_node)?
+            .fields
+            .iter()
+            .find(|field| &*field.name == name)
+    }
+
+    fn blob_bytes<'a>(&'a self, data: &'a BlobData) -> Result<&'a [u8], VisitError> {
+        match data {
+            BlobData::Owned(bytes) => Ok(bytes.as_slice()),
+            BlobData::Indexed(range) => self
+                .indexed
+                .as_ref()
+                .and_then(|indexed| indexed.bytes.get(range.clone()))
+                .ok_or(VisitError::NotSupportedFormat),
+        }
+    }
+
+    /// Reads a blob field of the current region. Type id is checked for typed blobs only.
+    fn read_blob<T: Copy>(&self, name: &str, expected_type_id: u8) -> Result<Vec<T>, VisitError> {
+        let field = self
+            .find_field_ref(name)
+            .ok_or_else(|| VisitError::FieldDoesNotExist(name.to_owned()))?;
+        match &field.kind {
+            FieldKind::PodBlob {
+                type_id,
+                element_size,
+                compression,
+                len,
+                data,
+            } => {
+                if *type_id != expected_type_id
+                    || (*type_id != UNTYPED_BLOB_ID
+                        && *element_size as usize != std::mem::size_of::<T>())
+                {
+                    return Err(VisitError::TypeMismatch);
+                }
+                decode_blob(self.blob_bytes(data)?, *compression, *len)
+            }
+            // Legacy formats.
+            FieldKind::PodArray { type_id, bytes, .. } => {
+                if *type_id != expected_type_id {
+                    return Err(VisitError::TypeMismatch);
+                }
+                decode_blob(bytes, BlobCompression::None, bytes.len() as u64)
+            }
+            FieldKind::BinaryBlob(bytes) if expected_type_id == UNTYPED_BLOB_ID => {
+                decode_blob(bytes, BlobCompression::None, bytes.len() as u64)
+            }
+            _ => Err(VisitError::FieldTypeDoesNotMatch),
+        }
+    }
+
+    fn write_blob(&mut self, name: &str, kind: FieldKind) -> VisitResult {
+        if self.find_field(name).is_some() {
+            Err(VisitError::FieldAlreadyExists(name.to_owned()))
+        } else {
+            self.current_node().fields.push(Field::new(name, kind));
+            Ok(())
+        }
+    }
+
+    /// Returns a slice of [`Pod`] elements stored by [`PodVecView`] in the current region without any
+    /// copying. This is possible only for uncompressed data of the same type, that happens to be
+    /// properly aligned in memory. Neither of the formats guarantees any alignment of the data, so
+    /// `None` could be returned for any blob and the data should be read by [`PodVecView`] instead.
+    pub fn borrow_pod_slice<T: Pod>(&self, name: &str) -> Option<&[T]> {
+        let field = self.find_field_ref(name)?;
+        let FieldKind::PodBlob {
+            type_id,
+            element_size,
+            compression: BlobCompression::None,
+            data,
+            ..
+        } = &field.kind
+        else {
+            return None;
+        };
+        if *type_id != T::type_id() || *element_size as usize != std::mem::size_of::<T>() {
+            return None;
+        }
+        // SAFETY: T is a plain-old-data type, alignment is checked below.
+        let (prefix, slice, suffix) = unsafe { self.blob_bytes(data).ok()?.align_to::<T>() };
+        (prefix.is_empty() && suffix.is_empty()).then_some(slice)
+    }
+
     fn current_node(&mut self) -> &mut VisitorNode {
         self.nodes.borrow_mut(self.current_node)
     }
@@ -1187,10 +1670,23 @@ impl Visitor {
     pub fn enter_region(&mut self, name: &str) -> Result<RegionGuard, VisitError> {
         let node = self.nodes.borrow(self.current_node);
         if self.reading {
+            if let (Some(indexed), Some(index)) = (self.indexed.as_mut(), node.indexed) {
+                let Some(child) = indexed.find_child(index, name)? else {
+                    return Err(VisitError::RegionDoesNotExist(name.to_owned()));
+                };
+                let mut region = indexed.decoded[child as usize];
+                if region.is_none() {
+                    region = self.nodes.spawn(indexed.decode(child, self.current_node)?);
+                    indexed.decoded[child as usize] = region;
+                }
+                self.current_node = region;
+                return Ok(RegionGuard(self));
+            }
+
             let mut region = Handle::NONE;
             for child_handle in node.children.iter() {
                 let child = self.nodes.borrow(*child_handle);
-                if child.name == name {
+                if &*child.name == name {
                     region = *child_handle;
                     break;
                 }
@@ -1205,7 +1701,7 @@ impl Visitor {
             // Make sure that node does not exists already.
             for child_handle in node.children.iter() {
                 let child = self.nodes.borrow(*child_handle);
-                if child.name == name {
+                if &*child.name == name {
                     return Err(VisitError::RegionAlreadyExists(name.to_owned()));
                 }
             }
@@ -1222,13 +1718,21 @@ impl Visitor {
     }
 
     pub fn current_region(&self) -> Option<&str> {
-        self.nodes
-            .try_borrow(self.current_node)
-            .map(|n| n.name.as_str())
+        self.nodes.try_borrow(self.current_node).map(|n| &*n.name)
     }
 
     fn leave_region(&mut self) -> VisitResult {
-        self.current_node = self.nodes.borrow(self.current_node).parent;
+        let node = self.nodes.borrow(self.current_node);
+        let parent = node.parent;
+        if parent.is_some() {
+            if let (Some(indexed), Some(index)) = (self.indexed.as_mut(), node.indexed) {
+                // Regions of indexed files can be decoded again at any time, there's no need to keep
+                // them in memory after they were visited.
+                indexed.decoded[index as usize] = Handle::NONE;
+                self.nodes.free(self.current_node);
+            }
+        }
+        self.current_node = parent;
         if self.current_node.is_none() {
             Err(VisitError::NoActiveNode)
         } else {
@@ -1269,7 +1773,72 @@ impl Visitor {
         out_string
     }
 
+    /// Writes the visitor in the indexed binary format. The format consists of the name table (every
+    /// region and field name is stored only once), the region table with offsets of the region fields
+    /// and the field data. It allows readers to decode regions lazily and to find child regions by
+    /// binary search, instead of decoding the entire file upfront.
     pub fn save_binary_to_memory<W: Write>(&self, mut writer: W) -> VisitResult {
+        let mut names = NameTable::default();
+        let mut entries = Vec::new();
+        let mut data = Vec::new();
+
+        // Breadth-first order makes children of every region contiguous in the region table.
+        let mut queue = vec![self.root];
+        let mut position = 0;
+        while let Some(&node_handle) = queue.get(position) {
+            let node = self.nodes.borrow(node_handle);
+
+            let mut children = node
+                .children
+                .iter()
+                .map(|child| (names.intern(&self.nodes.borrow(*child).name), *child))
+                .collect::<Vec<_>>();
+            children.sort_unstable_by_key(|(name, _)| *name);
+
+            entries.push(IndexedEntry {
+                name: names.intern(&node.name),
+                first_child: queue.len() as u32,
+                child_count: children.len() as u32,
+                field_count: node.fields.len() as u32,
+                fields_offset: data.len() as u64,
+            });
+
+            for field in node.fields.iter() {
+                data.write_u32::<LittleEndian>(names.intern(&field.name))?;
+                let position = data.len();
+                Field::save_kind(&field.kind, &mut data, position)?;
+            }
+
+            queue.extend(children.into_iter().map(|(_, child)| child));
+            position += 1;
+        }
+
+        writer.write_all(Self::MAGIC.as_bytes())?;
+        writer.write_u32::<LittleEndian>(INDEXED_FORMAT_MARKER)?;
+        writer.write_u32::<LittleEndian>(INDEXED_FORMAT_VERSION)?;
+        writer.write_u32::<LittleEndian>(names.names.len() as u32)?;
+        writer.write_u32::<LittleEndian>(entries.len() as u32)?;
+        writer.write_u64::<LittleEndian>(data.len() as u64)?;
+        let mut position = Self::MAGIC.len() + 24;
+        for name in names.names {
+            writer.write_u32::<LittleEndian>(name.len() as u32)?;
+            writer.write_all(name.as_bytes())?;
+            position += 4 + name.len();
+        }
+        for entry in entries.iter() {
+            entry.write(&mut writer)?;
+        }
+        position += entries.len() * INDEXED_ENTRY_SIZE;
+        // Field data is aligned, so blobs in it are aligned too.
+        writer.write_all(&[0; BLOB_ALIGNMENT][..align_padding(position)])?;
+        writer.write_all(&data)?;
+        Ok(())
+    }
+
+    /// Writes the visitor in the legacy binary format, that decodes the entire tree on load. It is
+    /// still supported by [`Self::load_from_memory`], but [`Self::save_binary_to_memory`] should be
+    /// preferred.
+    pub fn save_legacy_binary_to_memory<W: Write>(&self, mut writer: W) -> VisitResult {
         writer.write_all(Self::MAGIC.as_bytes())?;
         let mut stack = vec![self.root];
         while let Some(node_handle) = stack.pop() {
@@ -1306,7 +1875,7 @@ impl Visitor {
         file.read_exact(raw_name.as_mut_slice())?;
 
         let mut node = VisitorNode {
-            name: String::from_utf8(raw_name)?,
+            name: String::from_utf8(raw_name)?.into(),
             ..VisitorNode::default()
         };
 
@@ -1334,27 +1903,60 @@ impl Visitor {
     }
 
     pub async fn load_binary<P: AsRef<Path>>(path: P) -> Result<Self, VisitError> {
-        Self::load_from_memory(&io::load_file(path).await?)
+        Self::load_from_vec(io::load_file(path).await?)
     }
 
-    pub fn load_from_memory(data: &[u8]) -> Result<Self, VisitError> {
+    fn is_indexed_format(data: &[u8]) -> Result<bool, VisitError> {
         let mut reader = Cursor::new(data);
         let mut magic: [u8; 4] = Default::default();
         reader.read_exact(&mut magic)?;
         if !magic.eq(Self::MAGIC.as_bytes()) {
             return Err(VisitError::NotSupportedFormat);
         }
-        let mut visitor = Self {
+        Ok(reader.read_u32::<LittleEndian>()? == INDEXED_FORMAT_MARKER)
+    }
+
+    fn new_reading() -> Self {
+        Self {
             nodes: Pool::new(),
             rc_map: Default::default(),
             arc_map: Default::default(),
             reading: true,
             current_node: Handle::NONE,
             root: Handle::NONE,
+            indexed: None,
             blackboard: Blackboard::new(),
-        };
-        visitor.root = visitor.load_node_binary(&mut reader)?;
+        }
+    }
+
+    /// Loads a visitor from the given data, both indexed and legacy formats are supported. Indexed
+    /// data is copied, use [`Self::load_from_vec`] to avoid the copy.
+    pub fn load_from_memory(data: &[u8]) -> Result<Self, VisitError> {
+        if Self::is_indexed_format(data)? {
+            Self::load_from_vec(data.to_vec())
+        } else {
+            let mut reader = Cursor::new(data);
+            reader.set_position(Self::MAGIC.len() as u64);
+            let mut visitor = Self::new_reading();
+            visitor.root = visitor.load_node_binary(&mut reader)?;
+            visitor.current_node = visitor.root;
+            Ok(visitor)
+        }
+    }
+
+    /// Loads a visitor from the given data, both indexed and legacy formats are supported. Indexed data
+    /// is not decoded upfront, the visitor takes the ownership over it and decodes regions only when
+    /// they're entered.
+    pub fn load_from_vec(data: Vec<u8>) -> Result<Self, VisitError> {
+        if !Self::is_indexed_format(&data)? {
+            return Self::load_from_memory(&data);
+        }
+        let mut indexed = IndexedData::new(data)?;
+        let mut visitor = Self::new_reading();
+        visitor.root = visitor.nodes.spawn(indexed.decode(0, Handle::NONE)?);
         visitor.current_node = visitor.root;
+        indexed.decoded[0] = visitor.root;
+        visitor.indexed = Some(indexed);
         Ok(visitor)
     }
 }
@@ -2016,6 +2618,155 @@ mod test {
         }
     }
 
+    #[test]
+    fn visitor_indexed_and_legacy_formats() {
+        let expected_values = (0..100u32).collect::<Vec<_>>();
+
+        let mut visitor = Visitor::new();
+        let mut values = expected_values.clone();
+        values.visit("Values", &mut visitor).unwrap();
+        let mut model = Model { data: 555 };
+        model.visit("Model", &mut visitor).unwrap();
+
+        let indexed = visitor.save_binary_to_vec().unwrap();
+        let mut legacy = Vec::new();
+        visitor.save_legacy_binary_to_memory(&mut legacy).unwrap();
+
+        for data in [indexed, legacy] {
+            let mut visitor = Visitor::load_from_vec(data).unwrap();
+
+            // Regions must be accessible in any order and any number of times.
+            let mut model = Model::default();
+            model.visit("Model", &mut visitor).unwrap();
+            assert_eq!(model.data, 555);
+
+            for _ in 0..2 {
+                let mut values = Vec::<u32>::new();
+                values.visit("Values", &mut visitor).unwrap();
+                assert_eq!(values, expected_values);
+            }
+
+            assert!(visitor.enter_region("Missing").is_err());
+            assert_eq!(visitor.current_region(), Some("__ROOT__"));
+        }
+    }
+
+    #[test]
+    fn visitor_indexed_corrupted_data() {
+        let mut visitor = Visitor::new();
+        let mut values = (0..100u32).collect::<Vec<_>>();
+        values.visit("Values", &mut visitor).unwrap();
+        let mut bytes = vec![1u8; 100];
+        BinaryBlob { vec: &mut bytes }
+            .visit("Bytes", &mut visitor)
+            .unwrap();
+        let data = visitor.save_binary_to_vec().unwrap();
+        assert!(Visitor::load_from_vec(data.clone()).is_ok());
+
+        // Truncated data.
+        for len in Visitor::MAGIC.len() + 8..data.len() {
+            assert!(Visitor::load_from_vec(data[..len].to_vec()).is_err());
+        }
+
+        let corrupted = |offset: usize, value: &[u8]| {
+            let mut data = data.clone();
+            data[offset..offset + value.len()].copy_from_slice(value);
+            Visitor::load_from_vec(data)
+        };
+        let header = Visitor::MAGIC.len() + 8;
+
+        // Name count, entry count and data length.
+        assert!(corrupted(header, &u32::MAX.to_le_bytes()).is_err());
+        assert!(corrupted(header + 4, &u32::MAX.to_le_bytes()).is_err());
+        assert!(corrupted(header + 8, &u64::MAX.to_le_bytes()).is_err());
+        assert!(corrupted(header + 8, &(u64::MAX - 1024).to_le_bytes()).is_err());
+
+        // Length of the first name.
+        assert!(corrupted(header + 16, &u32::MAX.to_le_bytes()).is_err());
+
+        // Field count of the root region.
+        let name_count = LittleEndian::read_u32(&data[header..]);
+        let mut table_offset = header + 16;
+        for _ in 0..name_count {
+            table_offset += 4 + LittleEndian::read_u32(&data[table_offset..]) as usize;
+        }
+        assert!(corrupted(table_offset + 12, &u32::MAX.to_le_bytes()).is_err());
+    }
+
+    #[test]
+    fn visitor_pod_blobs() {
+        let expected_floats = (0..10000).map(|i| (i / 10) as f32).collect::<Vec<_>>();
+        let expected_bytes = (0..1000).map(|i| i as u8).collect::<Vec<_>>();
+
+        let mut visitor = Visitor::new();
+        let mut floats = expected_floats.clone();
+        PodVecView::from_pod_vec(&mut floats)
+            .visit("Floats", &mut visitor)
+            .unwrap();
+        PodVecView::from_pod_vec(&mut floats)
+            .with_compression(BlobCompression::Lz4)
+            .visit("CompressedFloats", &mut visitor)
+            .unwrap();
+        let mut bytes = expected_bytes.clone();
+        BinaryBlob { vec: &mut bytes }
+            .visit("Bytes", &mut visitor)
+            .unwrap();
+
+        let indexed = visitor.save_binary_to_vec().unwrap();
+        let mut legacy = Vec::new();
+        visitor.save_legacy_binary_to_memory(&mut legacy).unwrap();
+
+        for data in [indexed, legacy] {
+            let mut visitor = Visitor::load_from_vec(data).unwrap();
+
+            for name in ["Floats", "CompressedFloats"] {
+                let mut floats = Vec::<f32>::new();
+                PodVecView::from_pod_vec(&mut floats)
+                    .visit(name, &mut visitor)
+                    .unwrap();
+                assert_eq!(floats, expected_floats);
+            }
+
+            let mut bytes = Vec::<u8>::new();
+            BinaryBlob { vec: &mut bytes }
+                .visit("Bytes", &mut visitor)
+                .unwrap();
+            assert_eq!(bytes, expected_bytes);
+
+            let mut wrong_type = Vec::<u32>::new();
+            assert!(PodVecView::from_pod_vec(&mut wrong_type)
+                .visit("Floats", &mut visitor)
+                .is_err());
+            assert!(visitor
+                .borrow_pod_slice::<f32>("CompressedFloats")
+                .is_none());
+        }
+
+        // Alignment of the data is not guaranteed, so the slice could be borrowed only sometimes.
+        let visitor = Visitor::load_from_vec(visitor.save_binary_to_vec().unwrap()).unwrap();
+        if let Some(slice) = visitor.borrow_pod_slice::<f32>("Floats") {
+            assert_eq!(slice, expected_floats.as_slice());
+        }
+    }
+
+    #[test]
+    fn decode_blob_validates_length() {
+        let bytes = [1u8, 2, 3, 4, 5, 6, 7, 8];
+        assert_eq!(
+            decode_blob::<u32>(&bytes, BlobCompression::None, 8).unwrap(),
+            vec![
+                u32::from_ne_bytes([1, 2, 3, 4]),
+                u32::from_ne_bytes([5, 6, 7, 8])
+            ]
+        );
+
+        // Length of the data does not match the length from the header.
+        assert!(decode_blob::<u32>(&bytes, BlobCompression::None, 4).is_err());
+        assert!(decode_blob::<u32>(&bytes, BlobCompression::None, 1 << 40).is_err());
+        // Corrupted length must be rejected before any allocation.
+        assert!(decode_blob::<u32>(&bytes, BlobCompression::Lz4, u64::MAX & !3).is_err());
+    }
+
     #[test]
     fn pod_vec_view_from_pod_vec() {
         // Pod for u8
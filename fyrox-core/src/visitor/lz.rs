@@ -0,0 +1,226 @@
+//! Fast LZ77-style compression of binary blobs. The compressed data uses LZ4 block format: a sequence
+//! of literal runs, each followed by a back-reference (offset and length) into already decompressed
+//! data. It is tuned for speed, not for compression ratio, because it is used for bulk data (vertices,
+//! height maps, textures), that must be loaded as fast as possible.
+
+const MIN_MATCH: usize = 4;
+const HASH_LOG: u32 = 14;
+const MAX_OFFSET: usize = u16::MAX as usize;
+// Last bytes of a block are always stored as literals, this matches LZ4 block format requirements.
+const END_LITERALS: usize = 5;
+const MATCH_FIND_LIMIT: usize = 12;
+
+#[inline]
+fn read_u32(data: &[u8], position: usize) -> u32 {
+    u32::from_le_bytes([
+        data[position],
+        data[position + 1],
+        data[position + 2],
+        data[position + 3],
+    ])
+}
+
+#[inline]
+fn hash(sequence: u32) -> usize {
+    (sequence.wrapping_mul(2654435761) >> (32 - HASH_LOG)) as usize
+}
+
+fn write_length(out: &mut Vec<u8>, mut length: usize) {
+    while length >= 255 {
+        out.push(255);
+        length -= 255;
+    }
+    out.push(length as u8);
+}
+
+fn write_literals(out: &mut Vec<u8>, token: &mut u8, literals: &[u8]) {
+    if literals.len() >= 15 {
+        *token |= 15 << 4;
+        write_length(out, literals.len() - 15);
+    } else {
+        *token |= (literals.len() as u8) << 4;
+    }
+}
+
+fn write_sequence(out: &mut Vec<u8>, literals: &[u8], offset: usize, match_length: usize) {
+    let token_position = out.len();
+    out.push(0);
+    let mut token = 0;
+    write_literals(out, &mut token, literals);
+    out.extend_from_slice(literals);
+    out.extend_from_slice(&(offset as u16).to_le_bytes());
+    let match_length = match_length - MIN_MATCH;
+    if match_length >= 15 {
+        token |= 15;
+        write_length(out, match_length - 15);
+    } else {
+        token |= match_length as u8;
+    }
+    out[token_position] = token;
+}
+
+/// Compresses the given data.
+pub fn compress(src: &[u8]) -> Vec<u8> {
+    let mut out = Vec::with_capacity(src.len() / 2 + 16);
+    let mut table = vec![0u32; 1 << HASH_LOG];
+    let mut anchor = 0;
+    let mut position = 0;
+
+    if src.len() > MATCH_FIND_LIMIT {
+        let limit = src.len() - MATCH_FIND_LIMIT;
+        let match_limit = src.len() - END_LITERALS;
+        while position < limit {
+            let sequence = read_u32(src, position);
+            let slot = &mut table[hash(sequence)];
+            // Positions are stored with +1 offset, so zero means "empty slot".
+            let candidate = *slot as usize;
+            *slot = position as u32 + 1;
+
+            if candidate != 0 {
+                let candidate = candidate - 1;
+                if position - candidate <= MAX_OFFSET && read_u32(src, candidate) == sequence {
+                    let mut length = MIN_MATCH;
+                    while position + length < match_limit
+                        && src[candidate + length] == src[position + length]
+                    {
+                        length += 1;
+                    }
+                    write_sequence(
+                        &mut out,
+                        &src[anchor..position],
+                        position - candidate,
+                        length,
+                    );
+                    position += length;
+                    anchor = position;
+                    continue;
+                }
+            }
+
+            position += 1;
+        }
+    }
+
+    let literals = &src[anchor..];
+    let token_position = out.len();
+    out.push(0);
+    let mut token = 0;
+    write_literals(&mut out, &mut token, literals);
+    out[token_position] = token;
+    out.extend_from_slice(literals);
+
+    out
+}
+
+fn read_length(src: &[u8], position: &mut usize) -> Option<usize> {
+    let mut length = 0;
+    loop {
+        let byte = *src.get(*position)?;
+        *position += 1;
+        length += byte as usize;
+        if byte != 255 {
+            return Some(length);
+        }
+    }
+}
+
+/// Decompresses the given data into the destination buffer. Returns `None` if the data is corrupted or
+/// its decompressed size does not match the size of the destination buffer.
+pub fn decompress_into(src: &[u8], dst: &mut [u8]) -> Option<()> {
+    let mut src_position = 0;
+    let mut dst_position = 0;
+    loop {
+        let token = *src.get(src_position)?;
+        src_position += 1;
+
+        let mut literal_count = (token >> 4) as usize;
+        if literal_count == 15 {
+            literal_count += read_length(src, &mut src_position)?;
+        }
+        let literals = src.get(src_position..src_position.checked_add(literal_count)?)?;
+        dst.get_mut(dst_position..dst_position + literal_count)?
+            .copy_from_slice(literals);
+        src_position += literal_count;
+        dst_position += literal_count;
+
+        if src_position == src.len() {
+            return if dst_position == dst.len() {
+                Some(())
+            } else {
+                None
+            };
+        }
+
+        let offset =
+            u16::from_le_bytes([*src.get(src_position)?, *src.get(src_position + 1)?]) as usize;
+        src_position += 2;
+        if offset == 0 || offset > dst_position {
+            return None;
+        }
+
+        let mut match_length = (token & 15) as usize;
+        if match_length == 15 {
+            match_length += read_length(src, &mut src_position)?;
+        }
+        match_length += MIN_MATCH;
+        if dst_position + match_length > dst.len() {
+            return None;
+        }
+
+        let match_start = dst_position - offset;
+        if offset >= match_length {
+            dst.copy_within(match_start..match_start + match_length, dst_position);
+        } else {
+            // Overlapping match, it repeats last `offset` bytes.
+            for i in 0..match_length {
+                dst[dst_position + i] = dst[match_start + i];
+            }
+        }
+        dst_position += match_length;
+    }
+}
+
+#[cfg(test)]
+mod test {
+    use super::{compress, decompress_into};
+
+    fn round_trip(data: &[u8]) -> usize {
+        let compressed = compress(data);
+        let mut decompressed = vec![0; data.len()];
+        decompress_into(&compressed, &mut decompressed).unwrap();
+        assert_eq!(decompressed, data);
+        compressed.len()
+    }
+
+    #[test]
+    fn test_lz_round_trip() {
+        round_trip(&[]);
+        round_trip(&[1, 2, 3]);
+        round_trip(&[7; 1000]);
+        round_trip(b"abcabcabcabcabcabcabcabcabcabcabcabcabcabcabcabc");
+
+        let values = (0..10000u32)
+            .map(|i| (i / 7) as f32 * 0.25)
+            .flat_map(|v| v.to_le_bytes())
+            .collect::<Vec<_>>();
+        assert!(round_trip(&values) < values.len());
+
+        let mut state = 12345u32;
+        let noise = (0..5000)
+            .map(|_| {
+                state = state.wrapping_mul(1103515245).wrapping_add(12345);
+                (state >> 16) as u8
+            })
+            .collect::<Vec<_>>();
+        round_trip(&noise);
+    }
+
+    #[test]
+    fn test_lz_corrupted_data() {
+        let compressed = compress(&[5; 100]);
+        let mut decompressed = vec![0; 99];
+        assert!(decompress_into(&compressed, &mut decompressed).is_none());
+        let mut decompressed = vec![0; 100];
+        assert!(decompress_into(&compressed[..compressed.len() - 1], &mut decompressed).is_none());
+    }
+}
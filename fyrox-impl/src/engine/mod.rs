@@ -41,18 +41,19 @@ use crate::{
     scene::{
         base::NodeScriptMessage,
         camera::SkyBoxKind,
-        graph::{GraphUpdateSwitches, NodePool},
+        graph::{Graph, GraphUpdateSwitches, NodePool},
         navmesh,
         node::{constructor::NodeConstructorContainer, Node},
         sound::SoundEngine,
         Scene, SceneContainer, SceneLoader,
     },
     script::{
-        constructor::ScriptConstructorContainer, RoutingStrategy, Script, ScriptContext,
+        constructor::ScriptConstructorContainer, GraphSnapshot, ParallelScriptContext,
+        RoutingStrategy, Script, ScriptAccess, ScriptCommandBuffer, ScriptContext,
         ScriptDeinitContext, ScriptMessage, ScriptMessageContext, ScriptMessageKind,
         ScriptMessageSender,
     },
-    script::{PluginsRefMut, UniversalScriptContext},
+    script::{ParallelSceneAccess, PluginsRefMut, UniversalScriptContext},
     window::{Window, WindowBuilder},
 };
 use fxhash::{FxHashMap, FxHashSet};
@@ -74,6 +75,7 @@ use glutin::{
 use glutin_winit::{DisplayBuilder, GlWindow};
 #[cfg(not(target_arch = "wasm32"))]
 use raw_window_handle::HasRawWindowHandle;
+use rayon::prelude::*;
 
 #[cfg(not(target_arch = "wasm32"))]
 use std::{ffi::CString, num::NonZeroU32};
@@ -621,6 +623,81 @@ impl ScriptMessageDispatcher {
     }
 }
 
+/// A compact list of scene nodes that have at least one script. It is used to avoid scanning the entire
+/// scene graph every frame, which is quite expensive for large scenes with only a few scripted nodes.
+/// The list is filled with a full scan of the graph only once, then it is maintained using script
+/// initialization messages (every script, that is added to a graph, sends such message).
+struct ScriptedNodes {
+    handles: Vec<Handle<Node>>,
+    // Length of the sorted part of the list, that was formed by the last refresh.
+    refreshed_len: usize,
+    needs_sort: bool,
+    needs_full_scan: bool,
+}
+
+impl Default for ScriptedNodes {
+    fn default() -> Self {
+        Self {
+            handles: Default::default(),
+            refreshed_len: 0,
+            needs_sort: false,
+            needs_full_scan: true,
+        }
+    }
+}
+
+impl ScriptedNodes {
+    fn insert(&mut self, handle: Handle<Node>) {
+        self.handles.push(handle);
+        self.needs_sort = true;
+    }
+
+    /// Removes unused script entries of the scripted nodes and removes the nodes without scripts (or
+    /// deleted ones) from the list. The list is kept sorted by node indices, so the scripts are processed
+    /// in the same order as they're stored in the graph.
+    fn refresh(&mut self, graph: &mut Graph) {
+        if self.needs_full_scan {
+            self.handles.clear();
+            self.handles.extend(
+                graph
+                    .pair_iter()
+                    .filter(|(_, node)| !node.scripts.is_empty())
+                    .map(|(handle, _)| handle),
+            );
+            self.needs_full_scan = false;
+        } else if self.needs_sort {
+            self.handles
+                .sort_unstable_by_key(|handle| (handle.index(), handle.generation()));
+            self.handles.dedup();
+        }
+        self.needs_sort = false;
+
+        self.handles.retain(|handle| {
+            graph.try_get_mut(*handle).map_or(false, |node| {
+                // Remove unused script entries.
+                node.scripts
+                    .retain(|e| e.script.is_some() && !e.should_be_deleted);
+                !node.scripts.is_empty()
+            })
+        });
+        self.refreshed_len = self.handles.len();
+    }
+
+    /// Checks whether the node was in the list at the moment of the last refresh. Scripts of such nodes
+    /// are already in the update queue of the current frame.
+    fn was_refreshed(&self, handle: Handle<Node>) -> bool {
+        self.handles[..self.refreshed_len]
+            .binary_search_by_key(&(handle.index(), handle.generation()), |h| {
+                (h.index(), h.generation())
+            })
+            .is_ok()
+    }
+
+    fn handles(&self) -> &[Handle<Node>] {
+        &self.handles
+    }
+}
+
 /// Scripted scene is a handle to scene with some additional data associated with it.
 pub struct ScriptedScene {
     /// Handle of a scene.
@@ -628,6 +705,8 @@ pub struct ScriptedScene {
     /// Script message sender.
     pub message_sender: ScriptMessageSender,
     message_dispatcher: ScriptMessageDispatcher,
+    scripted_nodes: ScriptedNodes,
+    graph_snapshot: GraphSnapshot,
 }
 
 /// Script processor is used to run script methods in a strict order.
@@ -656,6 +735,8 @@ impl ScriptProcessor {
             handle: scene,
             message_sender: ScriptMessageSender { sender: tx },
             message_dispatcher: ScriptMessageDispatcher::new(rx),
+            scripted_nodes: Default::default(),
+            graph_snapshot: Default::default(),
         });
 
         self.wait_list
@@ -695,11 +776,9 @@ impl ScriptProcessor {
             let mut update_queue = VecDeque::new();
             let mut start_queue = VecDeque::new();
             let script_message_sender = scene.graph.script_message_sender.clone();
-            for (handle, node) in scene.graph.pair_iter_mut() {
-                // Remove unused script entries.
-                node.scripts
-                    .retain(|e| e.script.is_some() && !e.should_be_deleted);
-
+            scripted_scene.scripted_nodes.refresh(&mut scene.graph);
+            for &handle in scripted_scene.scripted_nodes.handles() {
+                let node = &scene.graph[handle];
                 if node.is_globally_enabled() {
                     for (i, entry) in node.scripts.iter().enumerate() {
                         if let Some(script) = entry.script.as_ref() {
@@ -754,6 +833,13 @@ impl ScriptProcessor {
                                 handle,
                                 script_index,
                             } => {
+                                // Nodes that were put back into the graph (after `take_reserve`) are
+                                // not in the update queue of this frame, but their scripts could be
+                                // started already.
+                                let untracked =
+                                    !scripted_scene.scripted_nodes.was_refreshed(handle);
+                                scripted_scene.scripted_nodes.insert(handle);
+
                                 context.handle = handle;
                                 context.script_index = script_index;
 
@@ -766,8 +852,14 @@ impl ScriptProcessor {
                                             script.initialized = true;
                                         }
 
-                                        // `on_start` must be called even if the script was initialized.
-                                        start_queue.push_back((handle, script_index));
+                                        if script.started {
+                                            if untracked {
+                                                update_queue.push_back((handle, script_index));
+                                            }
+                                        } else {
+                                            // `on_start` must be called even if the script was initialized.
+                                            start_queue.push_back((handle, script_index));
+                                        }
                                     },
                                 );
                             }
@@ -820,6 +912,14 @@ impl ScriptProcessor {
                 if update_queue.is_empty() {
                     break 'update_loop;
                 } else {
+                    // Scripts that opted in for parallel update go first, the rest is updated
+                    // one-by-one.
+                    update_scripts_in_parallel(
+                        &mut context,
+                        &mut update_queue,
+                        &mut scripted_scene.graph_snapshot,
+                    );
+
                     while let Some((handle, script_index)) = update_queue.pop_front() {
                         context.handle = handle;
                         context.script_index = script_index;
@@ -1096,6 +1196,194 @@ where
     }
 }
 
+/// Minimal amount of scripts processed by a single thread in the parallel update phase. Splitting the
+/// work more granularly makes no sense, because of the scheduling overhead.
+const PARALLEL_SCRIPT_MIN_JOB_LEN: usize = 32;
+
+struct ParallelScriptJob {
+    handle: Handle<Node>,
+    script_index: usize,
+    script: Script,
+    commands: ScriptCommandBuffer,
+}
+
+struct ReadOnlyGraph<'a>(&'a Graph);
+
+// SAFETY: The graph is borrowed immutably for the entire read-only phase of the parallel script update.
+// The only parts of it that are not thread-safe are the script message receiver (never used by scripts)
+// and interior mutable caches of scene nodes. Scripts can reach the graph only via unsafe
+// `ParallelScriptContext::graph`, which obliges the caller to not touch the caches.
+unsafe impl Sync for ReadOnlyGraph<'_> {}
+
+impl<'a> ReadOnlyGraph<'a> {
+    fn get(&self) -> &'a Graph {
+        self.0
+    }
+}
+
+struct NodePtr(*mut Node);
+
+// SAFETY: Every pointer points to a distinct node and all the scripts of a node are processed by
+// the same thread, so there's no aliasing. The graph itself is borrowed mutably for the entire
+// write phase, so the nodes can't be moved or destroyed.
+unsafe impl Send for NodePtr {}
+
+/// Updates every script from the queue, that declared non-exclusive access (see [`ScriptAccess`]),
+/// on the thread pool. Read-only scripts are updated first (they read the given snapshot of the graph,
+/// which is re-captured only if there are such scripts), then the scripts that write to their own
+/// nodes only. Deferred commands of the scripts are executed afterward on the current thread. Scripts
+/// with exclusive access are left in the queue.
+fn update_scripts_in_parallel(
+    context: &mut ScriptContext,
+    queue: &mut VecDeque<(Handle<Node>, usize)>,
+    snapshot: &mut GraphSnapshot,
+) {
+    let mut read_jobs = Vec::new();
+    let mut write_jobs = Vec::new();
+    let graph = &mut context.scene.graph;
+    queue.retain(|&(handle, script_index)| {
+        let Some(entry) = graph
+            .try_get_mut(handle)
+            .filter(|node| node.is_globally_enabled())
+            .and_then(|node| node.scripts.get_mut(script_index))
+        else {
+            return true;
+        };
+
+        let access = entry
+            .script
+            .as_ref()
+            .map_or(ScriptAccess::Exclusive, |script| script.update_access());
+        if access == ScriptAccess::Exclusive {
+            return true;
+        }
+
+        let Some(script) = entry.script.take() else {
+            return true;
+        };
+
+        let job = ParallelScriptJob {
+            handle,
+            script_index,
+            script,
+            commands: Default::default(),
+        };
+        if access == ScriptAccess::ReadOnly {
+            read_jobs.push(job);
+        } else {
+            write_jobs.push(job);
+        }
+
+        false
+    });
+
+    if read_jobs.is_empty() && write_jobs.is_empty() {
+        return;
+    }
+
+    let dt = context.dt;
+    let elapsed_time = context.elapsed_time;
+
+    if !read_jobs.is_empty() {
+        snapshot.capture(&context.scene.graph);
+        let snapshot = &*snapshot;
+        let graph = ReadOnlyGraph(&context.scene.graph);
+        read_jobs
+            .par_iter_mut()
+            .with_min_len(PARALLEL_SCRIPT_MIN_JOB_LEN)
+            .for_each(|job| {
+                let mut ctx = ParallelScriptContext {
+                    dt,
+                    elapsed_time,
+                    handle: job.handle,
+                    script_index: job.script_index,
+                    commands: &mut job.commands,
+                    access: ParallelSceneAccess::ReadOnly {
+                        snapshot,
+                        graph: graph.get(),
+                    },
+                };
+                job.script.on_parallel_update(&mut ctx);
+            });
+    }
+
+    if !write_jobs.is_empty() {
+        // Group the scripts by their nodes, all the scripts of a node must be processed by the same
+        // thread.
+        write_jobs.sort_by_key(|job| (job.handle.index(), job.script_index));
+
+        let graph = &mut context.scene.graph;
+        let mut groups = Vec::new();
+        let mut rest = write_jobs.as_mut_slice();
+        while let Some(first) = rest.first() {
+            let handle = first.handle;
+            let count = rest.iter().take_while(|job| job.handle == handle).count();
+            let (group, tail) = std::mem::take(&mut rest).split_at_mut(count);
+            groups.push((NodePtr(&mut graph[handle]), group));
+            rest = tail;
+        }
+
+        groups
+            .into_par_iter()
+            .with_min_len(PARALLEL_SCRIPT_MIN_JOB_LEN)
+            .for_each(|(node, jobs)| {
+                // SAFETY: See `NodePtr` docs.
+                let node = unsafe { &mut *node.0 };
+                for job in jobs {
+                    let mut ctx = ParallelScriptContext {
+                        dt,
+                        elapsed_time,
+                        handle: job.handle,
+                        script_index: job.script_index,
+                        commands: &mut job.commands,
+                        access: ParallelSceneAccess::Node(&mut *node),
+                    };
+                    job.script.on_parallel_update(&mut ctx);
+                }
+            });
+    }
+
+    // Put the scripts back first, so the deferred commands will see the scene in consistent state.
+    let mut pending_commands = Vec::new();
+    for job in read_jobs.into_iter().chain(write_jobs) {
+        let ParallelScriptJob {
+            handle,
+            script_index,
+            script,
+            commands,
+        } = job;
+
+        match context.scene.graph.try_get_mut(handle) {
+            Some(node) => {
+                let entry = node
+                    .scripts
+                    .get_mut(script_index)
+                    .expect("Scripts array cannot be modified!");
+
+                if entry.should_be_deleted {
+                    context.destroy_script_deferred(script, script_index);
+                } else {
+                    entry.script = Some(script);
+                }
+            }
+            None => context.destroy_script_deferred(script, script_index),
+        }
+
+        if !commands.is_empty() {
+            pending_commands.push((handle, script_index, commands));
+        }
+    }
+
+    for (handle, script_index, mut commands) in pending_commands {
+        context.handle = handle;
+        context.script_index = script_index;
+
+        for command in commands.drain() {
+            command(&mut *context);
+        }
+    }
+}
+
 pub(crate) fn process_scripts<T>(
     scene: &mut Scene,
     scene_handle: Handle<Scene>,
@@ -1106,6 +1394,7 @@ pub(crate) fn process_scripts<T>(
     task_pool: &mut TaskPoolHandler,
     graphics_context: &mut GraphicsContext,
     user_interface: &mut UserInterface,
+    nodes: &[Handle<Node>],
     dt: f32,
     elapsed_time: f32,
     mut func: T,
@@ -1128,8 +1417,8 @@ pub(crate) fn process_scripts<T>(
         script_index: 0,
     };
 
-    for node_index in 0..context.scene.graph.capacity() {
-        context.handle = context.scene.graph.handle_from_index(node_index);
+    for &handle in nodes {
+        context.handle = handle;
 
         process_node_scripts(&mut context, &mut func);
     }
@@ -1198,6 +1487,8 @@ pub(crate) fn initialize_resource_manager_loaders(
     loaders.set(model_loader);
     loaders.set(TextureLoader {
         default_import_options: Default::default(),
+        // The cache writes files, so it must be enabled explicitly with a writable directory.
+        import_cache: None,
     });
     loaders.set(SoundBufferLoader {
         default_import_options: Default::default(),
@@ -2239,6 +2530,7 @@ impl Engine {
                     &mut self.task_pool,
                     &mut self.graphics_context,
                     &mut self.user_interface,
+                    scripted_scene.scripted_nodes.handles(),
                     dt,
                     self.elapsed_time,
                     |script, context| {
@@ -2897,8 +3189,8 @@ mod test {
         gui::UserInterface,
         scene::{base::BaseBuilder, node::Node, pivot::PivotBuilder, Scene, SceneContainer},
         script::{
-            ScriptContext, ScriptDeinitContext, ScriptMessageContext, ScriptMessagePayload,
-            ScriptTrait,
+            ParallelScriptContext, ScriptAccess, ScriptContext, ScriptDeinitContext,
+            ScriptMessageContext, ScriptMessagePayload, ScriptTrait,
         },
     };
     use std::sync::{
@@ -3602,4 +3894,194 @@ mod test {
             }
         }
     }
+
+    #[derive(Debug, Clone, Default, Reflect, Visit, TypeUuidProvider, ComponentProvider)]
+    #[type_uuid(id = "b3a1f2c4-5d6e-4f70-8a91-b2c3d4e5f607")]
+    struct AgentScript {
+        updates: u32,
+    }
+
+    impl ScriptTrait for AgentScript {
+        fn update_access(&self) -> ScriptAccess {
+            ScriptAccess::DisjointWrite
+        }
+
+        fn on_update(&mut self, _ctx: &mut ScriptContext) {
+            unreachable!("Parallel scripts must not be updated serially!")
+        }
+
+        fn on_parallel_update(&mut self, ctx: &mut ParallelScriptContext) {
+            assert!(ctx.snapshot().is_none());
+            self.updates += 1;
+            let name = format!("Agent{}", self.updates);
+            ctx.node_mut().unwrap().set_name(name);
+        }
+    }
+
+    #[derive(Debug, Clone, Default, Reflect, Visit, TypeUuidProvider, ComponentProvider)]
+    #[type_uuid(id = "c4b2e3d5-6e7f-4081-9ba2-c3d4e5f60718")]
+    struct ObserverScript {
+        spawned: bool,
+    }
+
+    impl ScriptTrait for ObserverScript {
+        fn update_access(&self) -> ScriptAccess {
+            ScriptAccess::ReadOnly
+        }
+
+        fn on_parallel_update(&mut self, ctx: &mut ParallelScriptContext) {
+            let snapshot = ctx.snapshot().unwrap();
+            assert!(snapshot.is_valid_handle(ctx.handle));
+            assert!(ctx.node().is_none());
+            if !self.spawned {
+                ctx.commands.push(|ctx| {
+                    PivotBuilder::new(BaseBuilder::new().with_name("Spawned"))
+                        .build(&mut ctx.scene.graph);
+                });
+                self.spawned = true;
+            }
+        }
+    }
+
+    #[test]
+    fn test_parallel_update() {
+        let resource_manager = ResourceManager::new(Arc::new(Default::default()));
+        let mut scene = Scene::new();
+
+        let agents = (0..100)
+            .map(|_| {
+                PivotBuilder::new(BaseBuilder::new().with_script(AgentScript::default()))
+                    .build(&mut scene.graph)
+            })
+            .collect::<Vec<_>>();
+        for _ in 0..100 {
+            PivotBuilder::new(BaseBuilder::new()).build(&mut scene.graph);
+        }
+        PivotBuilder::new(BaseBuilder::new().with_script(ObserverScript::default()))
+            .build(&mut scene.graph);
+
+        let mut scene_container = SceneContainer::new(Default::default());
+        let scene_handle = scene_container.add(scene);
+        let mut script_processor = ScriptProcessor::default();
+        script_processor.register_scripted_scene(scene_handle, &resource_manager);
+        let mut task_pool = TaskPoolHandler::new(Arc::new(TaskPool::new()));
+        let mut gc = GraphicsContext::Uninitialized(Default::default());
+        let mut user_interface = UserInterface::default();
+
+        for _ in 0..2 {
+            script_processor.handle_scripts(
+                &mut scene_container,
+                &mut Vec::new(),
+                &resource_manager,
+                &mut task_pool,
+                &mut gc,
+                &mut user_interface,
+                0.0,
+                0.0,
+            );
+        }
+
+        let graph = &scene_container[scene_handle].graph;
+        for agent in agents {
+            assert_eq!(graph[agent].name(), "Agent2");
+        }
+        assert_eq!(
+            graph
+                .linear_iter()
+                .filter(|node| node.name() == "Spawned")
+                .count(),
+            1
+        );
+        // Only scripted nodes must be tracked.
+        assert_eq!(
+            script_processor.scripted_scenes[0]
+                .scripted_nodes
+                .handles()
+                .len(),
+            101
+        );
+    }
+
+    #[test]
+    fn test_sub_graph_round_trip_keeps_scripts() {
+        let resource_manager = ResourceManager::new(Arc::new(Default::default()));
+        let mut scene = Scene::new();
+
+        let (tx, rx) = mpsc::channel();
+
+        let child =
+            PivotBuilder::new(BaseBuilder::new().with_script(MySubScript { sender: tx.clone() }))
+                .build(&mut scene.graph);
+        let parent = PivotBuilder::new(
+            BaseBuilder::new()
+                .with_script(MySubScript { sender: tx })
+                .with_children(&[child]),
+        )
+        .build(&mut scene.graph);
+
+        let mut scene_container = SceneContainer::new(Default::default());
+        let scene_handle = scene_container.add(scene);
+        let mut script_processor = ScriptProcessor::default();
+        script_processor.register_scripted_scene(scene_handle, &resource_manager);
+        let mut task_pool = TaskPoolHandler::new(Arc::new(TaskPool::new()));
+        let mut gc = GraphicsContext::Uninitialized(Default::default());
+        let mut user_interface = UserInterface::default();
+
+        let mut handle_scripts = |scene_container: &mut SceneContainer| {
+            script_processor.handle_scripts(
+                scene_container,
+                &mut Vec::new(),
+                &resource_manager,
+                &mut task_pool,
+                &mut gc,
+                &mut user_interface,
+                0.0,
+                0.0,
+            );
+        };
+
+        let update_count = |source: Handle<Node>, events: &[Event]| {
+            events
+                .iter()
+                .filter(|event| {
+                    **event
+                        == Event::Updated(Source {
+                            node_handle: source,
+                            script_index: 0,
+                        })
+                })
+                .count()
+        };
+
+        handle_scripts(&mut scene_container);
+        let events = rx.try_iter().collect::<Vec<_>>();
+        assert_eq!(update_count(parent, &events), 1);
+        assert_eq!(update_count(child, &events), 1);
+
+        // Scripts of the extracted sub-graph must not be updated.
+        let sub_graph = scene_container[scene_handle]
+            .graph
+            .take_reserve_sub_graph(parent);
+        handle_scripts(&mut scene_container);
+        let events = rx.try_iter().collect::<Vec<_>>();
+        assert_eq!(update_count(parent, &events), 0);
+        assert_eq!(update_count(child, &events), 0);
+
+        // Every scripted node of the sub-graph must be updated exactly once in the frame it is put
+        // back, without re-initialization.
+        scene_container[scene_handle]
+            .graph
+            .put_sub_graph_back(sub_graph);
+        handle_scripts(&mut scene_container);
+        let events = rx.try_iter().collect::<Vec<_>>();
+        assert_eq!(update_count(parent, &events), 1);
+        assert_eq!(update_count(child, &events), 1);
+        assert_eq!(events.len(), 2);
+
+        // And it must be updated as usual in the next frames.
+        handle_scripts(&mut scene_container);
+        let events = rx.try_iter().collect::<Vec<_>>();
+        assert_eq!(update_count(parent, &events), 1);
+        assert_eq!(update_count(child, &events), 1);
+    }
 }
@@ -24,10 +24,11 @@ use crate::{
         node::Node,
     },
 };
-use fxhash::{FxBuildHasher, FxHashMap, FxHasher};
+use fxhash::{FxHashMap, FxHashSet, FxHasher};
+use rayon::prelude::*;
 use std::{
     collections::hash_map::DefaultHasher,
-    fmt::{Debug, Formatter},
+    fmt::{Debug, Display, Formatter},
     hash::{Hash, Hasher},
 };
 
@@ -145,6 +146,7 @@ pub struct RenderDataBundle {
     /// A decal layer index of the bundle.
     pub decal_layer_index: u8,
     sort_index: u64,
+    key: u64,
 }
 
 impl Debug for RenderDataBundle {
@@ -207,6 +209,20 @@ pub trait RenderDataBundleStorageTrait {
         sort_index: u64,
         instance_data: SurfaceInstanceData,
     );
+
+    /// Returns an empty buffer for bone matrices of a surface instance (see
+    /// [`SurfaceInstanceData::bone_matrices`]). A storage could reuse buffers from previous frames,
+    /// so this method should be used instead of allocating a new buffer.
+    fn bone_matrices_buffer(&mut self) -> Vec<Matrix4<f32>> {
+        Vec::new()
+    }
+
+    /// Returns an empty buffer for blend shape weights of a surface instance (see
+    /// [`SurfaceInstanceData::blend_shapes_weights`]). A storage could reuse buffers from previous
+    /// frames, so this method should be used instead of allocating a new buffer.
+    fn blend_shapes_weights_buffer(&mut self) -> Vec<f32> {
+        Vec::new()
+    }
 }
 
 /// Bundle storage handles bundle generation for a scene before rendering. It is used to optimize
@@ -216,75 +232,721 @@ pub struct RenderDataBundleStorage {
     bundle_map: FxHashMap<u64, usize>,
     /// A sorted list of bundles.
     pub bundles: Vec<RenderDataBundle>,
+    buffers: BundleBuffers,
+}
+
+/// Minimal capacity of a graph at which [`RenderDataBundleStorage::from_graph`] switches to parallel
+/// render data collection. Smaller graphs are processed faster on a single thread.
+pub const PARALLEL_COLLECTION_THRESHOLD: usize = 4096;
+
+// A minimal amount of candidates of the spatial index query, that will be processed by a single task.
+const MIN_CANDIDATES_PER_TASK: usize = 256;
+
+// A wrapper that allows sharing a graph across worker threads during render data collection.
+struct SharedGraph<'a>(&'a Graph);
+
+// SAFETY: The graph is borrowed immutably for the entire collection process. The only parts of it that
+// are not thread-safe are the script message receiver (never used during the collection) and interior
+// mutable caches of scene nodes. Every node is visited by exactly one thread, so its caches are never
+// accessed concurrently.
+unsafe impl Sync for SharedGraph<'_> {}
+
+impl<'a> SharedGraph<'a> {
+    fn get(&self) -> &'a Graph {
+        self.0
+    }
+}
+
+fn make_lod_filter<'a>(
+    graph: &Graph,
+    lod_group_owners: impl Iterator<Item = &'a Node>,
+    observer_info: &ObserverInfo,
+    lod_filter: &mut Vec<bool>,
+) {
+    lod_filter.clear();
+    lod_filter.resize(graph.capacity() as usize, true);
+    for node in lod_group_owners {
+        if let Some(lod_group) = node.lod_group() {
+            for level in lod_group.levels.iter() {
+                for &object in level.objects.iter() {
+                    if let Some(object_ref) = graph.try_get(object) {
+                        let distance = observer_info
+                            .observer_position
+                            .metric_distance(&object_ref.global_position());
+                        let z_range = observer_info.z_far - observer_info.z_near;
+                        let normalized_distance = (distance - observer_info.z_near) / z_range;
+                        let visible = normalized_distance >= level.begin()
+                            && normalized_distance <= level.end();
+                        lod_filter[object.index() as usize] = visible;
+                    }
+                }
+            }
+        }
+    }
+}
+
+// Shared state of a render data collection process.
+struct CollectionContext<'a> {
+    graph: &'a Graph,
+    observer_info: &'a ObserverInfo,
+    frustum: &'a Frustum,
+    lod_filter: &'a [bool],
+    render_pass_name: &'a ImmutableString,
+}
+
+/// Allocation statistics of render data bundle storages for one frame. See
+/// [`RenderDataBundleStoragePool`] for more info.
+#[derive(Debug, Copy, Clone, Default)]
+pub struct BundleStorageStatistics {
+    /// Amount of storages that were created from scratch.
+    pub storages_allocated: usize,
+    /// Amount of storages that were taken from the pool.
+    pub storages_reused: usize,
+    /// Amount of buffers (instance lists, bone matrices, blend shape weights) that were allocated.
+    pub buffers_allocated: usize,
+    /// Amount of buffers that were reused.
+    pub buffers_reused: usize,
+}
+
+impl Display for BundleStorageStatistics {
+    fn fmt(&self, f: &mut Formatter<'_>) -> std::fmt::Result {
+        write!(
+            f,
+            "Bundle Storages: {} allocated, {} reused\n\
+            Bundle Buffers: {} allocated, {} reused",
+            self.storages_allocated,
+            self.storages_reused,
+            self.buffers_allocated,
+            self.buffers_reused
+        )
+    }
+}
+
+// Empty buffers of recycled bundles.
+#[derive(Default)]
+struct BundleBuffers {
+    instances: Vec<Vec<SurfaceInstanceData>>,
+    bone_matrices: Vec<Vec<Matrix4<f32>>>,
+    blend_shapes_weights: Vec<Vec<f32>>,
+    allocated: usize,
+    reused: usize,
+}
+
+impl BundleBuffers {
+    fn take<T>(buffers: &mut Vec<Vec<T>>, allocated: &mut usize, reused: &mut usize) -> Vec<T> {
+        if let Some(buffer) = buffers.pop() {
+            *reused += 1;
+            buffer
+        } else {
+            *allocated += 1;
+            Vec::new()
+        }
+    }
+
+    fn take_instances(&mut self) -> Vec<SurfaceInstanceData> {
+        Self::take(&mut self.instances, &mut self.allocated, &mut self.reused)
+    }
+
+    fn take_bone_matrices(&mut self) -> Vec<Matrix4<f32>> {
+        Self::take(
+            &mut self.bone_matrices,
+            &mut self.allocated,
+            &mut self.reused,
+        )
+    }
+
+    fn take_blend_shapes_weights(&mut self) -> Vec<f32> {
+        Self::take(
+            &mut self.blend_shapes_weights,
+            &mut self.allocated,
+            &mut self.reused,
+        )
+    }
+
+    fn recycle(&mut self, mut instances: Vec<SurfaceInstanceData>) {
+        for instance in instances.drain(..) {
+            let SurfaceInstanceData {
+                mut bone_matrices,
+                mut blend_shapes_weights,
+                ..
+            } = instance;
+            if bone_matrices.capacity() != 0 {
+                bone_matrices.clear();
+                self.bone_matrices.push(bone_matrices);
+            }
+            if blend_shapes_weights.capacity() != 0 {
+                blend_shapes_weights.clear();
+                self.blend_shapes_weights.push(blend_shapes_weights);
+            }
+        }
+        if instances.capacity() != 0 {
+            self.instances.push(instances);
+        }
+    }
+
+    fn append(&mut self, other: &mut Self) {
+        self.instances.append(&mut other.instances);
+        self.bone_matrices.append(&mut other.bone_matrices);
+        self.blend_shapes_weights
+            .append(&mut other.blend_shapes_weights);
+        self.allocated += std::mem::take(&mut other.allocated);
+        self.reused += std::mem::take(&mut other.reused);
+    }
+}
+
+/// A pool of render data bundle storages, that allows reusing storages and their buffers (instance
+/// lists, bone matrices, blend shape weights, LOD filters) across render passes and frames. A
+/// storage could be taken from the pool using [`RenderDataBundleStorage::from_graph_pooled`] and it
+/// must be returned back using [`Self::recycle`], when it is no longer needed. After a few frames
+/// the pool contains enough memory for every render pass, and render data collection does not
+/// allocate memory anymore.
+#[derive(Default)]
+pub struct RenderDataBundleStoragePool {
+    storages: Vec<RenderDataBundleStorage>,
+    buffers: BundleBuffers,
+    lod_filter: Vec<bool>,
+    statistics: BundleStorageStatistics,
+}
+
+impl RenderDataBundleStoragePool {
+    /// Takes an empty storage from the pool, or creates a new one if the pool is empty.
+    pub fn take(&mut self) -> RenderDataBundleStorage {
+        if let Some(mut storage) = self.storages.pop() {
+            self.statistics.storages_reused += 1;
+            // Share the buffers, storages are recycled in arbitrary order.
+            storage.buffers.append(&mut self.buffers);
+            storage
+        } else {
+            self.statistics.storages_allocated += 1;
+            let mut storage = RenderDataBundleStorage::default();
+            storage.buffers.append(&mut self.buffers);
+            storage
+        }
+    }
+
+    /// Returns the storage to the pool. Every bundle of the storage is destroyed, but the memory of
+    /// the storage and its buffers is kept for further use.
+    pub fn recycle(&mut self, mut storage: RenderDataBundleStorage) {
+        storage.clear();
+        self.statistics.buffers_allocated += std::mem::take(&mut storage.buffers.allocated);
+        self.statistics.buffers_reused += std::mem::take(&mut storage.buffers.reused);
+        self.buffers.append(&mut storage.buffers);
+        self.storages.push(storage);
+    }
+
+    /// Returns allocation statistics since the previous call of this method and resets them.
+    pub fn end_frame(&mut self) -> BundleStorageStatistics {
+        std::mem::take(&mut self.statistics)
+    }
 }
 
 impl RenderDataBundleStorage {
     /// Creates a new render bundle storage from the given graph and observer info. It "asks" every node in the
     /// graph one-by-one to give render data which is then put in the storage, sorted and ready for rendering.
     /// Frustum culling is done on scene node side ([`crate::scene::node::NodeTrait::collect_render_data`]).
+    ///
+    /// If the spatial index of the graph is up-to-date, only potentially visible nodes are visited, see
+    /// [`Self::from_graph_indexed`] for more info. Otherwise, large graphs (see
+    /// [`PARALLEL_COLLECTION_THRESHOLD`]) are processed in parallel, see [`Self::from_graph_parallel`]
+    /// for more info.
     pub fn from_graph(
         graph: &Graph,
         observer_info: ObserverInfo,
         render_pass_name: ImmutableString,
     ) -> Self {
+        Self::from_graph_pooled(
+            graph,
+            observer_info,
+            render_pass_name,
+            &mut Default::default(),
+        )
+    }
+
+    /// Does the same as [`Self::from_graph`], but reuses memory of the storages from the given pool.
+    /// The storage should be returned to the pool (see [`RenderDataBundleStoragePool::recycle`]) when
+    /// it is no longer needed.
+    pub fn from_graph_pooled(
+        graph: &Graph,
+        observer_info: ObserverInfo,
+        render_pass_name: ImmutableString,
+        pool: &mut RenderDataBundleStoragePool,
+    ) -> Self {
+        if graph.spatial_index().is_some() {
+            Self::collect_indexed(graph, observer_info, render_pass_name, pool)
+        } else if graph.capacity() as usize >= PARALLEL_COLLECTION_THRESHOLD
+            && rayon::current_num_threads() > 1
+        {
+            Self::collect_parallel(graph, observer_info, render_pass_name, pool)
+        } else {
+            Self::collect_serial(graph, observer_info, render_pass_name, pool)
+        }
+    }
+
+    /// Does the same as [`Self::from_graph`], but always on the current thread.
+    pub fn from_graph_serial(
+        graph: &Graph,
+        observer_info: ObserverInfo,
+        render_pass_name: ImmutableString,
+    ) -> Self {
+        Self::collect_serial(
+            graph,
+            observer_info,
+            render_pass_name,
+            &mut Default::default(),
+        )
+    }
+
+    fn collect_serial(
+        graph: &Graph,
+        observer_info: ObserverInfo,
+        render_pass_name: ImmutableString,
+        pool: &mut RenderDataBundleStoragePool,
+    ) -> Self {
+        let mut storage = pool.take();
+
         // Aim for the worst-case scenario when every node has unique render data.
-        let capacity = graph.node_count() as usize;
-        let mut storage = Self {
-            bundle_map: FxHashMap::with_capacity_and_hasher(capacity, FxBuildHasher::default()),
-            bundles: Vec::with_capacity(capacity),
+        let capacity = graph.capacity() as usize;
+        storage.bundle_map.reserve(capacity);
+        storage.bundles.reserve(capacity);
+
+        make_lod_filter(
+            graph,
+            graph.linear_iter(),
+            &observer_info,
+            &mut pool.lod_filter,
+        );
+
+        let frustum = Frustum::from_view_projection_matrix(
+            observer_info.projection_matrix * observer_info.view_matrix,
+        )
+        .unwrap_or_default();
+
+        let ctx = CollectionContext {
+            graph,
+            observer_info: &observer_info,
+            frustum: &frustum,
+            lod_filter: &pool.lod_filter,
+            render_pass_name: &render_pass_name,
         };
 
-        let mut lod_filter = vec![true; graph.capacity() as usize];
-        for node in graph.linear_iter() {
-            if let Some(lod_group) = node.lod_group() {
-                for level in lod_group.levels.iter() {
-                    for &object in level.objects.iter() {
-                        if let Some(object_ref) = graph.try_get(object) {
-                            let distance = observer_info
-                                .observer_position
-                                .metric_distance(&object_ref.global_position());
-                            let z_range = observer_info.z_far - observer_info.z_near;
-                            let normalized_distance = (distance - observer_info.z_near) / z_range;
-                            let visible = normalized_distance >= level.begin()
-                                && normalized_distance <= level.end();
-                            lod_filter[object.index() as usize] = visible;
-                        }
-                    }
-                }
+        let mut stack = Vec::with_capacity(capacity / 4);
+        stack.push(graph.root());
+        storage.collect(&ctx, &mut stack, None);
+
+        storage.sort();
+
+        storage
+    }
+
+    /// Does the same as [`Self::from_graph`], but splits the graph into a set of independent hierarchies
+    /// and collects render data of each set on a separate thread into a separate storage. Then these
+    /// storages are merged in a deterministic order and sorted, so the result does not depend on thread
+    /// scheduling.
+    ///
+    /// # Important notes
+    ///
+    /// [`crate::scene::node::NodeTrait::collect_render_data`] of different scene nodes could be called
+    /// concurrently, so its implementation must not modify the state of other scene nodes.
+    pub fn from_graph_parallel(
+        graph: &Graph,
+        observer_info: ObserverInfo,
+        render_pass_name: ImmutableString,
+    ) -> Self {
+        Self::collect_parallel(
+            graph,
+            observer_info,
+            render_pass_name,
+            &mut Default::default(),
+        )
+    }
+
+    fn collect_parallel(
+        graph: &Graph,
+        observer_info: ObserverInfo,
+        render_pass_name: ImmutableString,
+        pool: &mut RenderDataBundleStoragePool,
+    ) -> Self {
+        let mut storage = pool.take();
+
+        make_lod_filter(
+            graph,
+            graph.linear_iter(),
+            &observer_info,
+            &mut pool.lod_filter,
+        );
+        let lod_filter = std::mem::take(&mut pool.lod_filter);
+
+        let frustum = Frustum::from_view_projection_matrix(
+            observer_info.projection_matrix * observer_info.view_matrix,
+        )
+        .unwrap_or_default();
+
+        let ctx = CollectionContext {
+            graph,
+            observer_info: &observer_info,
+            frustum: &frustum,
+            lod_filter: &lod_filter,
+            render_pass_name: &render_pass_name,
+        };
+
+        // Process a few top levels of the hierarchy on the current thread to get enough independent
+        // sub-hierarchies to feed every worker thread.
+        let thread_count = rayon::current_num_threads();
+        let mut roots = vec![graph.root()];
+        for _ in 0..4 {
+            if roots.is_empty() || roots.len() >= thread_count * 4 {
+                break;
+            }
+            let mut next_roots = Vec::new();
+            for root in roots.drain(..) {
+                let mut stack = vec![root];
+                storage.collect(&ctx, &mut stack, Some(&mut next_roots));
+            }
+            roots = next_roots;
+        }
+
+        if !roots.is_empty() {
+            let shared_graph = SharedGraph(graph);
+            let chunk_count = thread_count * 2;
+            let chunk_size = ((roots.len() + chunk_count - 1) / chunk_count).max(1);
+            let mut partial_storages = roots
+                .chunks(chunk_size)
+                .map(|_| pool.take())
+                .collect::<Vec<_>>();
+            roots
+                .par_chunks(chunk_size)
+                .zip(partial_storages.par_iter_mut())
+                .for_each(|(chunk, partial_storage)| {
+                    let ctx = CollectionContext {
+                        graph: shared_graph.get(),
+                        observer_info: &observer_info,
+                        frustum: &frustum,
+                        lod_filter: &lod_filter,
+                        render_pass_name: &render_pass_name,
+                    };
+                    let mut stack = chunk.to_vec();
+                    // Stack is processed in reverse order.
+                    stack.reverse();
+                    partial_storage.collect(&ctx, &mut stack, None);
+                });
+
+            for mut partial_storage in partial_storages {
+                storage.merge_from(&mut partial_storage);
+                pool.recycle(partial_storage);
             }
         }
 
+        pool.lod_filter = lod_filter;
+
+        storage.sort();
+
+        storage
+    }
+
+    /// Does the same as [`Self::from_graph`], but visits only the nodes that were found by a frustum
+    /// query to the spatial index of the graph (see [`Graph::spatial_index`]), their indexed ancestors
+    /// and the nodes without bounds. Nodes with empty bounds are never visited, since they have nothing
+    /// to render. Falls back to [`Self::from_graph_serial`] if the index is outdated.
+    ///
+    /// The result is the same as if the whole hierarchy was traversed: a node is skipped if one of
+    /// its ancestors is filtered out by a LOD group, or if one of its ancestors has collected render
+    /// data of its descendants (returned [`RdcControlFlow::Break`]).
+    ///
+    /// Large sets of candidates (see [`PARALLEL_COLLECTION_THRESHOLD`]) are processed in parallel, level
+    /// by level of the hierarchy, the same notes as for [`Self::from_graph_parallel`] apply.
+    pub fn from_graph_indexed(
+        graph: &Graph,
+        observer_info: ObserverInfo,
+        render_pass_name: ImmutableString,
+    ) -> Self {
+        Self::collect_indexed(
+            graph,
+            observer_info,
+            render_pass_name,
+            &mut Default::default(),
+        )
+    }
+
+    fn collect_indexed(
+        graph: &Graph,
+        observer_info: ObserverInfo,
+        render_pass_name: ImmutableString,
+        pool: &mut RenderDataBundleStoragePool,
+    ) -> Self {
+        let Some(spatial_index) = graph.spatial_index() else {
+            return Self::collect_serial(graph, observer_info, render_pass_name, pool);
+        };
+
+        let mut storage = pool.take();
+
+        make_lod_filter(
+            graph,
+            spatial_index
+                .lod_group_owners()
+                .iter()
+                .filter_map(|handle| graph.try_get(*handle)),
+            &observer_info,
+            &mut pool.lod_filter,
+        );
+        let lod_filter = &pool.lod_filter;
+
         let frustum = Frustum::from_view_projection_matrix(
             observer_info.projection_matrix * observer_info.view_matrix,
         )
         .unwrap_or_default();
 
-        let mut ctx = RenderContext {
+        let mut candidates = Vec::new();
+        spatial_index.frustum_query(&frustum, |handle| candidates.push(handle));
+        candidates.extend_from_slice(spatial_index.unbounded());
+
+        // Sort the candidates by their depth in the hierarchy, so ancestors are always visited before
+        // their descendants. Discard the candidates filtered out by LOD groups. Indexed ancestors of the
+        // candidates are visited too, even if they're outside the frustum, because they could collect
+        // render data of their descendants (and return `RdcControlFlow::Break`).
+        let mut sorted_candidates = Vec::with_capacity(candidates.len());
+        let mut chain = Vec::new();
+        let mut visited_ancestors = FxHashSet::default();
+        'candidate_loop: for handle in candidates {
+            chain.clear();
+            let mut ancestor = handle;
+            while let Some(ancestor_ref) = graph.try_get(ancestor) {
+                if !lod_filter[ancestor.index() as usize] {
+                    continue 'candidate_loop;
+                }
+                chain.push(ancestor);
+                ancestor = ancestor_ref.parent();
+            }
+
+            let depth = chain.len() as u32;
+            if depth == 0 {
+                continue;
+            }
+            sorted_candidates.push((depth, handle));
+
+            for (i, ancestor) in chain.iter().enumerate().skip(1) {
+                if !visited_ancestors.insert(*ancestor) {
+                    // The rest of the chain is already visited.
+                    break;
+                }
+                if spatial_index.is_indexed(*ancestor) {
+                    sorted_candidates.push((depth - i as u32, *ancestor));
+                }
+            }
+        }
+        sorted_candidates.sort_unstable_by_key(|(depth, handle)| (*depth, handle.index()));
+        sorted_candidates.dedup();
+
+        // Candidates of the same depth never depend on each other, so every level of the hierarchy is
+        // split into chunks, that are processed in parallel into partial storages.
+        let thread_count = rayon::current_num_threads();
+        let task_count =
+            if sorted_candidates.len() >= PARALLEL_COLLECTION_THRESHOLD && thread_count > 1 {
+                thread_count * 2
+            } else {
+                0
+            };
+        let mut partial_storages = (0..task_count)
+            .map(|_| (pool.take(), Vec::new()))
+            .collect::<Vec<_>>();
+        let shared_graph = SharedGraph(graph);
+
+        // Nodes that have collected render data of their descendants.
+        let mut collectors = FxHashSet::default();
+        let mut new_collectors = Vec::new();
+        let mut level_start = 0;
+        while level_start < sorted_candidates.len() {
+            let depth = sorted_candidates[level_start].0;
+            let level_end = sorted_candidates[level_start..]
+                .iter()
+                .position(|(candidate_depth, _)| *candidate_depth != depth)
+                .map_or(sorted_candidates.len(), |offset| level_start + offset);
+            let level = &sorted_candidates[level_start..level_end];
+
+            if task_count > 0 && level.len() >= MIN_CANDIDATES_PER_TASK * 2 {
+                let chunk_size =
+                    ((level.len() + task_count - 1) / task_count).max(MIN_CANDIDATES_PER_TASK);
+                level
+                    .par_chunks(chunk_size)
+                    .zip(partial_storages.par_iter_mut())
+                    .for_each(|(chunk, (partial_storage, partial_collectors))| {
+                        partial_storage.collect_candidates(
+                            shared_graph.get(),
+                            &observer_info,
+                            &frustum,
+                            &render_pass_name,
+                            chunk,
+                            &collectors,
+                            partial_collectors,
+                        );
+                    });
+                for (_, partial_collectors) in partial_storages.iter_mut() {
+                    new_collectors.append(partial_collectors);
+                }
+            } else {
+                storage.collect_candidates(
+                    graph,
+                    &observer_info,
+                    &frustum,
+                    &render_pass_name,
+                    level,
+                    &collectors,
+                    &mut new_collectors,
+                );
+            }
+
+            collectors.extend(new_collectors.drain(..));
+            level_start = level_end;
+        }
+
+        for (mut partial_storage, _) in partial_storages {
+            storage.merge_from(&mut partial_storage);
+            pool.recycle(partial_storage);
+        }
+
+        storage.sort();
+
+        storage
+    }
+
+    // Collects render data of the given candidates of `collect_indexed`. A candidate is skipped if
+    // one of its ancestors is in `collectors`. Candidates, that have collected render data of their
+    // descendants, are written to `new_collectors`.
+    #[allow(clippy::too_many_arguments)]
+    fn collect_candidates(
+        &mut self,
+        graph: &Graph,
+        observer_info: &ObserverInfo,
+        frustum: &Frustum,
+        render_pass_name: &ImmutableString,
+        candidates: &[(u32, Handle<Node>)],
+        collectors: &FxHashSet<Handle<Node>>,
+        new_collectors: &mut Vec<Handle<Node>>,
+    ) {
+        let mut render_context = RenderContext {
             observer_position: &observer_info.observer_position,
             z_near: observer_info.z_near,
             z_far: observer_info.z_far,
             view_matrix: &observer_info.view_matrix,
             projection_matrix: &observer_info.projection_matrix,
-            frustum: Some(&frustum),
-            storage: &mut storage,
+            frustum: Some(frustum),
+            storage: self,
             graph,
-            render_pass_name: &render_pass_name,
+            render_pass_name,
+        };
+
+        for (_, handle) in candidates {
+            let node = graph.node(*handle);
+
+            if !collectors.is_empty() {
+                let mut ancestor = node.parent();
+                let mut is_collected = false;
+                while let Some(ancestor_ref) = graph.try_get(ancestor) {
+                    if collectors.contains(&ancestor) {
+                        is_collected = true;
+                        break;
+                    }
+                    ancestor = ancestor_ref.parent();
+                }
+                if is_collected {
+                    continue;
+                }
+            }
+
+            if let RdcControlFlow::Break = node.collect_render_data(&mut render_context) {
+                new_collectors.push(*handle);
+            }
+        }
+    }
+
+    // Collects render data of the nodes in the stack and their descendants. If `children` is set, then
+    // children of the nodes in the stack will be written there instead of being visited.
+    fn collect(
+        &mut self,
+        ctx: &CollectionContext,
+        stack: &mut Vec<Handle<Node>>,
+        mut children: Option<&mut Vec<Handle<Node>>>,
+    ) {
+        let mut render_context = RenderContext {
+            observer_position: &ctx.observer_info.observer_position,
+            z_near: ctx.observer_info.z_near,
+            z_far: ctx.observer_info.z_far,
+            view_matrix: &ctx.observer_info.view_matrix,
+            projection_matrix: &ctx.observer_info.projection_matrix,
+            frustum: Some(ctx.frustum),
+            storage: self,
+            graph: ctx.graph,
+            render_pass_name: ctx.render_pass_name,
         };
 
-        let mut stack = Vec::with_capacity(capacity / 4);
-        stack.push(graph.root());
         while let Some(handle) = stack.pop() {
-            if lod_filter[handle.index() as usize] {
-                let node = graph.node(handle);
-                if let RdcControlFlow::Continue = node.collect_render_data(&mut ctx) {
-                    stack.extend_from_slice(node.children());
+            if ctx.lod_filter[handle.index() as usize] {
+                let node = ctx.graph.node(handle);
+                if let RdcControlFlow::Continue = node.collect_render_data(&mut render_context) {
+                    match children {
+                        Some(ref mut children) => children.extend_from_slice(node.children()),
+                        None => stack.extend_from_slice(node.children()),
+                    }
                 }
             }
         }
+    }
 
-        storage.sort();
+    /// Moves every bundle of the other storage to this storage. Bundles with the same key are merged:
+    /// instances of the other bundle are added to the instances of the existing bundle and dynamically
+    /// batched geometry is appended to the existing geometry.
+    pub fn merge(&mut self, mut other: RenderDataBundleStorage) {
+        self.merge_from(&mut other);
+    }
 
-        storage
+    // Does the same as `merge`, but keeps the memory of the other storage, so it could be reused.
+    fn merge_from(&mut self, other: &mut RenderDataBundleStorage) {
+        other.bundle_map.clear();
+        self.buffers.append(&mut other.buffers);
+
+        for mut bundle in other.bundles.drain(..) {
+            let Some(&index) = self.bundle_map.get(&bundle.key) else {
+                self.bundle_map.insert(bundle.key, self.bundles.len());
+                self.bundles.push(bundle);
+                continue;
+            };
+
+            let existing = &mut self.bundles[index];
+            if existing.data == bundle.data {
+                existing.instances.append(&mut bundle.instances);
+            } else {
+                // Dynamic batch (see `push_triangles`). It has temporary data with a single instance
+                // so the geometry must be merged instead.
+                let source = bundle.data.lock();
+                let mut dest = existing.data.lock();
+                let dest = &mut *dest;
+
+                let vertex_size = source.vertex_buffer.vertex_size() as usize;
+                if vertex_size != 0 {
+                    let start_vertex_index = dest.vertex_buffer.vertex_count();
+                    let mut vertex_buffer = dest.vertex_buffer.modify();
+                    for vertex in source.vertex_buffer.raw_data().chunks_exact(vertex_size) {
+                        vertex_buffer.push_vertex_raw(vertex).unwrap();
+                    }
+                    drop(vertex_buffer);
+
+                    dest.geometry_buffer.modify().push_triangles_with_offset(
+                        start_vertex_index,
+                        source.geometry_buffer.triangles_ref(),
+                    );
+                }
+            }
+
+            self.buffers.recycle(bundle.instances);
+        }
+    }
+
+    /// Removes every bundle from the storage, but keeps the memory of the storage and the buffers of
+    /// the bundles, so they could be reused.
+    pub fn clear(&mut self) {
+        self.bundle_map.clear();
+        for bundle in self.bundles.drain(..) {
+            self.buffers.recycle(bundle.instances);
+        }
     }
 
     /// Sorts the bundles by their respective sort index.
@@ -357,27 +1019,28 @@ impl RenderDataBundleStorageTrait for RenderDataBundleStorage {
 
             self.bundle_map.insert(key, self.bundles.len());
             let persistent_identifier = PersistentIdentifier::new_combined(&data, node_handle, 0);
+            let mut instances = self.buffers.take_instances();
+            // Each bundle must have at least one instance to be rendered.
+            instances.push(SurfaceInstanceData {
+                world_transform: Matrix4::identity(),
+                bone_matrices: Default::default(),
+                depth_offset: Default::default(),
+                blend_shapes_weights: Default::default(),
+                element_range: Default::default(),
+                persistent_identifier,
+                node_handle,
+            });
             self.bundles.push(RenderDataBundle {
                 data,
                 sort_index,
-                instances: vec![
-                    // Each bundle must have at least one instance to be rendered.
-                    SurfaceInstanceData {
-                        world_transform: Matrix4::identity(),
-                        bone_matrices: Default::default(),
-                        depth_offset: Default::default(),
-                        blend_shapes_weights: Default::default(),
-                        element_range: Default::default(),
-                        persistent_identifier,
-                        node_handle,
-                    },
-                ],
+                instances,
                 material: material.clone(),
                 is_skinned,
                 render_path,
                 decal_layer_index,
                 // Temporary buffer lives one frame.
                 time_to_live: TimeToLive(0.0),
+                key,
             });
             self.bundles.last_mut().unwrap()
         };
@@ -417,19 +1080,363 @@ impl RenderDataBundleStorageTrait for RenderDataBundleStorage {
             self.bundles.get_mut(bundle_index).unwrap()
         } else {
             self.bundle_map.insert(key, self.bundles.len());
+            let instances = self.buffers.take_instances();
             self.bundles.push(RenderDataBundle {
                 data: data.clone(),
                 sort_index,
-                instances: Default::default(),
+                instances,
                 material: material.clone(),
                 is_skinned,
                 render_path,
                 decal_layer_index,
                 time_to_live: Default::default(),
+                key,
             });
             self.bundles.last_mut().unwrap()
         };
 
         bundle.instances.push(instance_data)
     }
+
+    fn bone_matrices_buffer(&mut self) -> Vec<Matrix4<f32>> {
+        self.buffers.take_bone_matrices()
+    }
+
+    fn blend_shapes_weights_buffer(&mut self) -> Vec<f32> {
+        self.buffers.take_blend_shapes_weights()
+    }
+}
+
+#[cfg(test)]
+mod test {
+    use crate::{
+        core::{
+            algebra::{Matrix4, Point3, Vector3},
+            sstorage::ImmutableString,
+        },
+        graph::BaseSceneGraph,
+        renderer::bundle::{ObserverInfo, RenderDataBundleStorage, RenderDataBundleStoragePool},
+        scene::{
+            base::BaseBuilder,
+            graph::Graph,
+            mesh::{
+                surface::{SurfaceBuilder, SurfaceData, SurfaceSharedData},
+                BatchingMode, MeshBuilder,
+            },
+            pivot::PivotBuilder,
+            transform::TransformBuilder,
+        },
+    };
+    use std::time::Instant;
+
+    // Creates a synthetic graph with a set of groups of meshes, that share a small set of surfaces.
+    fn make_graph(group_count: usize, meshes_per_group: usize) -> Graph {
+        let mut graph = Graph::new();
+
+        let surfaces = (0..4)
+            .map(|_| SurfaceSharedData::new(SurfaceData::make_cube(Matrix4::identity())))
+            .collect::<Vec<_>>();
+
+        for i in 0..group_count {
+            let group = PivotBuilder::new(
+                BaseBuilder::new().with_local_transform(
+                    TransformBuilder::new()
+                        .with_local_position(Vector3::new(
+                            (i % 32) as f32 - 16.0,
+                            (i / 32 % 32) as f32 - 16.0,
+                            10.0 + (i / 1024) as f32,
+                        ))
+                        .build(),
+                ),
+            )
+            .build(&mut graph);
+
+            for j in 0..meshes_per_group {
+                let mesh = MeshBuilder::new(
+                    BaseBuilder::new().with_local_transform(
+                        TransformBuilder::new()
+                            .with_local_position(Vector3::new(0.0, 0.0, j as f32))
+                            .build(),
+                    ),
+                )
+                .with_surfaces(vec![SurfaceBuilder::new(
+                    surfaces[j % surfaces.len()].clone(),
+                )
+                .build()])
+                .build(&mut graph);
+                graph.link_nodes(mesh, group);
+            }
+        }
+
+        graph.update_hierarchical_data();
+
+        graph
+    }
+
+    fn observer_info() -> ObserverInfo {
+        ObserverInfo {
+            observer_position: Default::default(),
+            z_near: 0.025,
+            z_far: 2048.0,
+            view_matrix: Matrix4::look_at_rh(
+                &Point3::origin(),
+                &Point3::new(0.0, 0.0, 1.0),
+                &Vector3::y_axis(),
+            ),
+            projection_matrix: Matrix4::new_perspective(1.0, 90.0f32.to_radians(), 0.025, 2048.0),
+        }
+    }
+
+    fn assert_same_instances(a: &RenderDataBundleStorage, b: &RenderDataBundleStorage) {
+        assert_eq!(a.bundles.len(), b.bundles.len());
+        for bundle in a.bundles.iter() {
+            let other = b
+                .bundles
+                .iter()
+                .find(|b| b.data == bundle.data && b.material == bundle.material)
+                .unwrap();
+            let mut a = bundle
+                .instances
+                .iter()
+                .map(|i| i.node_handle)
+                .collect::<Vec<_>>();
+            let mut b = other
+                .instances
+                .iter()
+                .map(|i| i.node_handle)
+                .collect::<Vec<_>>();
+            a.sort();
+            b.sort();
+            assert_eq!(a, b);
+        }
+    }
+
+    #[test]
+    fn test_parallel_collection_matches_serial() {
+        let graph = make_graph(256, 8);
+
+        let serial = RenderDataBundleStorage::from_graph_serial(
+            &graph,
+            observer_info(),
+            ImmutableString::new("GBuffer"),
+        );
+        let parallel = RenderDataBundleStorage::from_graph_parallel(
+            &graph,
+            observer_info(),
+            ImmutableString::new("GBuffer"),
+        );
+
+        assert!(!serial.bundles.is_empty());
+        assert_same_instances(&serial, &parallel);
+
+        // The result must not depend on thread scheduling.
+        let parallel2 = RenderDataBundleStorage::from_graph_parallel(
+            &graph,
+            observer_info(),
+            ImmutableString::new("GBuffer"),
+        );
+        for (a, b) in parallel.bundles.iter().zip(parallel2.bundles.iter()) {
+            assert!(a.data == b.data);
+            assert!(a
+                .instances
+                .iter()
+                .map(|i| i.node_handle)
+                .eq(b.instances.iter().map(|i| i.node_handle)));
+        }
+    }
+
+    #[test]
+    fn test_indexed_collection_matches_serial() {
+        let mut graph = make_graph(256, 8);
+
+        // Index must be refreshed first.
+        assert!(graph.spatial_index().is_none());
+        graph.update_spatial_index();
+        assert!(graph.spatial_index().is_some());
+
+        let check = |graph: &Graph| {
+            let serial = RenderDataBundleStorage::from_graph_serial(
+                graph,
+                observer_info(),
+                ImmutableString::new("GBuffer"),
+            );
+            let indexed = RenderDataBundleStorage::from_graph_indexed(
+                graph,
+                observer_info(),
+                ImmutableString::new("GBuffer"),
+            );
+            assert!(!serial.bundles.is_empty());
+            assert_same_instances(&serial, &indexed);
+        };
+
+        check(&graph);
+
+        // Move a few groups behind the observer, the index must follow them.
+        let groups = graph[graph.get_root()].children()[..16].to_vec();
+        for group in groups {
+            graph[group]
+                .local_transform_mut()
+                .set_position(Vector3::new(0.0, 0.0, -100.0));
+        }
+        graph.update_hierarchical_data();
+        graph.update_spatial_index();
+        check(&graph);
+
+        // Large sets of candidates are processed in parallel.
+        let mut large_graph = make_graph(1024, 8);
+        large_graph.update_spatial_index();
+        check(&large_graph);
+
+        // Any structural change makes the index outdated.
+        PivotBuilder::new(BaseBuilder::new()).build(&mut graph);
+        assert!(graph.spatial_index().is_none());
+    }
+
+    #[test]
+    fn test_indexed_collection_respects_culled_ancestors() {
+        let mut graph = Graph::new();
+        let surface = SurfaceSharedData::new(SurfaceData::make_cube(Matrix4::identity()));
+        let cube = |graph: &mut Graph, z: f32| {
+            MeshBuilder::new(
+                BaseBuilder::new().with_local_transform(
+                    TransformBuilder::new()
+                        .with_local_position(Vector3::new(0.0, 0.0, z))
+                        .build(),
+                ),
+            )
+            .with_surfaces(vec![SurfaceBuilder::new(surface.clone()).build()])
+            .build(graph)
+        };
+
+        // Static batch behind the observer.
+        let batched = cube(&mut graph, -100.0);
+        let batch = MeshBuilder::new(BaseBuilder::new().with_children(&[batched]))
+            .with_batching_mode(BatchingMode::Static)
+            .build(&mut graph);
+        let pivot = PivotBuilder::new(BaseBuilder::new()).build(&mut graph);
+        let visible = cube(&mut graph, 10.0);
+        graph.link_nodes(visible, pivot);
+        graph.update_hierarchical_data();
+        graph.update_spatial_index();
+
+        // Nodes without anything to render are not indexed at all.
+        let spatial_index = graph.spatial_index().unwrap();
+        assert!(!spatial_index.is_indexed(pivot));
+        assert!(!spatial_index.unbounded().contains(&pivot));
+        assert!(!spatial_index.unbounded().contains(&graph.get_root()));
+        assert!(spatial_index.is_indexed(visible));
+
+        let check = |graph: &Graph| {
+            let serial = RenderDataBundleStorage::from_graph_serial(
+                graph,
+                observer_info(),
+                ImmutableString::new("GBuffer"),
+            );
+            let indexed = RenderDataBundleStorage::from_graph_indexed(
+                graph,
+                observer_info(),
+                ImmutableString::new("GBuffer"),
+            );
+            assert!(!serial.bundles.is_empty());
+            assert_same_instances(&serial, &indexed);
+        };
+
+        // The batch is not built yet, so it has no bounds and it must be visited.
+        assert!(spatial_index.unbounded().contains(&batch));
+        check(&graph);
+
+        // Now the batch is built and it is outside the frustum, but its descendant is inside. The batch
+        // must still prevent its descendant from being rendered on its own.
+        graph[batched]
+            .local_transform_mut()
+            .set_position(Vector3::new(0.0, 0.0, 10.0));
+        graph.update_hierarchical_data();
+        graph.update_spatial_index();
+        assert!(!graph.spatial_index().unwrap().unbounded().contains(&batch));
+        check(&graph);
+    }
+
+    #[test]
+    fn test_pooled_collection_reuses_storages() {
+        let graph = make_graph(64, 8);
+        let mut pool = RenderDataBundleStoragePool::default();
+
+        let serial = RenderDataBundleStorage::from_graph_serial(
+            &graph,
+            observer_info(),
+            ImmutableString::new("GBuffer"),
+        );
+
+        let first = RenderDataBundleStorage::from_graph_pooled(
+            &graph,
+            observer_info(),
+            ImmutableString::new("GBuffer"),
+            &mut pool,
+        );
+        assert_same_instances(&serial, &first);
+        pool.recycle(first);
+        let stats = pool.end_frame();
+        assert!(stats.buffers_allocated > 0);
+
+        // Second frame must not allocate anything new.
+        let second = RenderDataBundleStorage::from_graph_pooled(
+            &graph,
+            observer_info(),
+            ImmutableString::new("GBuffer"),
+            &mut pool,
+        );
+        assert_same_instances(&serial, &second);
+        pool.recycle(second);
+        let stats = pool.end_frame();
+        assert_eq!(stats.storages_allocated, 0);
+        assert!(stats.storages_reused > 0);
+        assert_eq!(stats.buffers_allocated, 0);
+        assert!(stats.buffers_reused > 0);
+    }
+
+    #[ignore = "takes multiple seconds to run"]
+    #[test]
+    /// Measures CPU-side bundle generation, no GPU is needed.
+    fn render_bundle_collection_benchmark() {
+        for (group_count, meshes_per_group) in [(64, 16), (1024, 16), (8192, 16)] {
+            let mut graph = make_graph(group_count, meshes_per_group);
+            graph.update_spatial_index();
+            println!(
+                "benchmarking graph with {} nodes",
+                group_count * meshes_per_group
+            );
+
+            let iterations = 20;
+
+            let start_time = Instant::now();
+            for _ in 0..iterations {
+                RenderDataBundleStorage::from_graph_serial(
+                    &graph,
+                    observer_info(),
+                    ImmutableString::new("GBuffer"),
+                );
+            }
+            println!("serial: {:?}", start_time.elapsed() / iterations);
+
+            let start_time = Instant::now();
+            for _ in 0..iterations {
+                RenderDataBundleStorage::from_graph_parallel(
+                    &graph,
+                    observer_info(),
+                    ImmutableString::new("GBuffer"),
+                );
+            }
+            println!("parallel: {:?}", start_time.elapsed() / iterations);
+
+            let start_time = Instant::now();
+            for _ in 0..iterations {
+                RenderDataBundleStorage::from_graph_indexed(
+                    &graph,
+                    observer_info(),
+                    ImmutableString::new("GBuffer"),
+                );
+            }
+            println!("indexed: {:?}\n", start_time.elapsed() / iterations);
+        }
+    }
 }
@@ -1,6 +1,6 @@
 use crate::{
     renderer::{
-        cache::{TemporaryCache, TimeToLive},
+        cache::{CacheStatistics, TemporaryCache, TimeToLive},
         framework::{
             error::FrameworkError,
             geometry_buffer::{GeometryBuffer, GeometryBufferKind},
@@ -9,7 +9,7 @@ use crate::{
     },
     scene::mesh::surface::{SurfaceData, SurfaceSharedData},
 };
-use fyrox_core::log::Log;
+use fyrox_core::{log::Log, math::TriangleDefinition};
 
 struct SurfaceRenderData {
     buffer: GeometryBuffer,
@@ -23,6 +23,11 @@ pub struct GeometryCache {
     buffer: TemporaryCache<SurfaceRenderData>,
 }
 
+fn surface_data_size(data: &SurfaceData) -> usize {
+    data.vertex_buffer.raw_data().len()
+        + data.geometry_buffer.triangles_ref().len() * std::mem::size_of::<TriangleDefinition>()
+}
+
 fn create_geometry_buffer(
     data: &SurfaceData,
     state: &PipelineState,
@@ -47,12 +52,15 @@ impl GeometryCache {
     ) -> Option<&'a mut GeometryBuffer> {
         let data = data.lock();
 
-        match self
-            .buffer
-            .get_entry_mut_or_insert_with(&data.cache_index, time_to_live, || {
-                create_geometry_buffer(&data, state)
-            }) {
-            Ok(entry) => {
+        match self.buffer.try_get_entry_mut_or_insert_with(
+            &data.cache_index,
+            time_to_live,
+            surface_data_size(&data),
+            || create_geometry_buffer(&data, state),
+        ) {
+            // The upload was postponed, the surface won't be rendered this frame.
+            Ok(None) => None,
+            Ok(Some(entry)) => {
                 // We also must check if buffer's layout changed, and if so - recreate the entire
                 // buffer.
                 if entry.layout_hash == data.vertex_buffer.layout_hash() {
@@ -88,6 +96,25 @@ impl GeometryCache {
         }
     }
 
+    /// Sets the maximum amount of geometry data (in bytes), that could be uploaded to GPU per frame
+    /// when creating new buffers. Surfaces, which buffers do not fit in the budget, are not rendered
+    /// until their buffers are created on next frames. See [`TemporaryCache::set_upload_budget`] for
+    /// more info.
+    pub fn set_upload_budget(&mut self, bytes_per_frame: Option<usize>) {
+        self.buffer.set_upload_budget(bytes_per_frame)
+    }
+
+    /// Sets the maximum amount of memory (in bytes), that could be used by geometry buffers. See
+    /// [`TemporaryCache::set_memory_budget`] for more info.
+    pub fn set_memory_budget(&mut self, bytes: Option<usize>) {
+        self.buffer.set_memory_budget(bytes)
+    }
+
+    /// Returns statistics of the cache.
+    pub fn statistics(&self) -> CacheStatistics {
+        self.buffer.statistics()
+    }
+
     pub fn update(&mut self, dt: f32) {
         self.buffer.update(dt);
     }
@@ -40,6 +40,10 @@ pub struct CacheEntry<T> {
     pub value: T,
     pub time_to_live: TimeToLive,
     pub self_index: Arc<AtomicIndex>,
+    /// Approximate size of the entry in GPU memory (in bytes). It is used for memory budget.
+    pub size: usize,
+    /// Index of the frame at which the entry was used last time.
+    pub last_used: u64,
 }
 
 impl<T> Drop for CacheEntry<T> {
@@ -68,14 +72,47 @@ impl<T> DerefMut for CacheEntry<T> {
     }
 }
 
+/// Statistics of a cache.
+#[derive(Copy, Clone, Default, Debug, PartialEq, Eq)]
+pub struct CacheStatistics {
+    /// Amount of entries in the cache.
+    pub entry_count: usize,
+    /// Total size (in bytes) of the entries in the cache.
+    pub memory_usage: usize,
+    /// Amount of bytes uploaded to GPU during last frame.
+    pub uploaded_bytes: usize,
+    /// Amount of new entries, which creation was postponed during last frame, because the upload
+    /// budget was exceeded.
+    pub deferred_uploads: usize,
+    /// Amount of entries that were removed during last update, because the memory budget was
+    /// exceeded.
+    pub evicted_entries: usize,
+}
+
+/// A cache of GPU objects with limited lifetime. Every entry is removed if it wasn't used for its
+/// time-to-live. Optionally, the cache could limit the amount of bytes uploaded to GPU per frame
+/// (see [`Self::set_upload_budget`]) and the total amount of memory used by its entries (see
+/// [`Self::set_memory_budget`]).
 pub struct TemporaryCache<T> {
     pub buffer: SparseBuffer<CacheEntry<T>>,
+    upload_budget: Option<usize>,
+    memory_budget: Option<usize>,
+    frame: u64,
+    uploaded_bytes: usize,
+    deferred_uploads: usize,
+    statistics: CacheStatistics,
 }
 
 impl<T> Default for TemporaryCache<T> {
     fn default() -> Self {
         Self {
             buffer: Default::default(),
+            upload_budget: None,
+            memory_budget: None,
+            frame: 0,
+            uploaded_bytes: 0,
+            deferred_uploads: 0,
+            statistics: Default::default(),
         }
     }
 }
@@ -91,6 +128,8 @@ impl<T> TemporaryCache<T> {
             value,
             time_to_live,
             self_index,
+            size: 0,
+            last_used: self.frame,
         });
 
         self.buffer
@@ -102,9 +141,85 @@ impl<T> TemporaryCache<T> {
         index
     }
 
+    /// Sets the maximum amount of bytes, that could be uploaded to GPU per frame when creating new
+    /// entries. New entries, that do not fit in the budget, are postponed to next frames, users of
+    /// the cache should use placeholders for them. At least one entry is created per frame, even if
+    /// it is larger than the budget. `None` means unlimited uploads.
+    pub fn set_upload_budget(&mut self, bytes_per_frame: Option<usize>) {
+        self.upload_budget = bytes_per_frame;
+    }
+
+    /// Returns current upload budget, see [`Self::set_upload_budget`] for more info.
+    pub fn upload_budget(&self) -> Option<usize> {
+        self.upload_budget
+    }
+
+    /// Sets the maximum total size of the entries of the cache. When the size is exceeded, least
+    /// recently used entries are removed, regardless of their time-to-live. Entries with infinite
+    /// time-to-live and entries used during last frame are never removed this way. `None` means that
+    /// the entries are removed only by their time-to-live.
+    pub fn set_memory_budget(&mut self, bytes: Option<usize>) {
+        self.memory_budget = bytes;
+    }
+
+    /// Returns current memory budget, see [`Self::set_memory_budget`] for more info.
+    pub fn memory_budget(&self) -> Option<usize> {
+        self.memory_budget
+    }
+
+    /// Returns statistics of the cache, it is updated in [`Self::update`].
+    pub fn statistics(&self) -> CacheStatistics {
+        self.statistics
+    }
+
+    /// Returns `true` if there's some upload budget left in the current frame.
+    pub fn has_upload_budget(&self) -> bool {
+        self.upload_budget
+            .map_or(true, |budget| self.uploaded_bytes < budget)
+    }
+
+    /// Registers an upload of the given amount of bytes, that is not a creation of a new entry (for
+    /// example, an update of the content of an existing entry).
+    pub fn register_upload(&mut self, size: usize) {
+        self.uploaded_bytes += size;
+    }
+
+    fn try_reserve_upload(&mut self, size: usize) -> bool {
+        let fits = match self.upload_budget {
+            Some(budget) => self.uploaded_bytes == 0 || self.uploaded_bytes + size <= budget,
+            None => true,
+        };
+        if fits {
+            self.uploaded_bytes += size;
+        } else {
+            self.deferred_uploads += 1;
+        }
+        fits
+    }
+
+    fn insert(
+        &mut self,
+        index: &Arc<AtomicIndex>,
+        value: T,
+        time_to_live: TimeToLive,
+        size: usize,
+    ) -> &mut CacheEntry<T> {
+        let index = self.buffer.spawn(CacheEntry {
+            value,
+            time_to_live,
+            self_index: index.clone(),
+            size,
+            last_used: self.frame,
+        });
+        let entry = self.buffer.get_mut(&index).unwrap();
+        entry.self_index.set(index.get());
+        entry
+    }
+
     pub fn get_mut(&mut self, index: &AtomicIndex) -> Option<&mut CacheEntry<T>> {
         if let Some(entry) = self.buffer.get_mut(index) {
             entry.time_to_live = TimeToLive::default();
+            entry.last_used = self.frame;
             Some(entry)
         } else {
             None
@@ -122,18 +237,40 @@ impl<T> TemporaryCache<T> {
     {
         if let Some(entry) = self.buffer.get_mut(index) {
             entry.time_to_live = time_to_live;
+            entry.last_used = self.frame;
             Ok(self.buffer.get_mut(index).unwrap())
         } else {
             let value = func()?;
-            let index = self.buffer.spawn(CacheEntry {
-                value,
-                time_to_live,
-                self_index: index.clone(),
-            });
-            let entry = self.buffer.get_mut(&index).unwrap();
-            entry.self_index.set(index.get());
-            Ok(entry)
+            Ok(self.insert(index, value, time_to_live, 0))
+        }
+    }
+
+    /// Does the same as [`Self::get_entry_mut_or_insert_with`], but respects the upload budget (see
+    /// [`Self::set_upload_budget`]) when creating a new entry. `size` is the amount of bytes that
+    /// will be uploaded to GPU to create the entry. Returns `Ok(None)` if the creation of the
+    /// entry was postponed.
+    pub fn try_get_entry_mut_or_insert_with<F, E>(
+        &mut self,
+        index: &Arc<AtomicIndex>,
+        time_to_live: TimeToLive,
+        size: usize,
+        func: F,
+    ) -> Result<Option<&mut CacheEntry<T>>, E>
+    where
+        F: FnOnce() -> Result<T, E>,
+    {
+        if self.buffer.is_index_valid(index) {
+            return self
+                .get_entry_mut_or_insert_with(index, time_to_live, func)
+                .map(Some);
+        }
+
+        if !self.try_reserve_upload(size) {
+            return Ok(None);
         }
+
+        let value = func()?;
+        Ok(Some(self.insert(index, value, time_to_live, size)))
     }
 
     pub fn get_mut_or_insert_with<F, E>(
@@ -167,13 +304,52 @@ impl<T> TemporaryCache<T> {
             *entry.time_to_live -= dt;
         }
 
+        let mut memory_usage = 0;
         for i in 0..self.buffer.len() {
             if let Some(entry) = self.buffer.get_raw(i) {
                 if *entry.time_to_live <= 0.0 {
                     self.buffer.free_raw(i);
+                } else {
+                    memory_usage += entry.size;
                 }
             }
         }
+
+        let mut evicted_entries = 0;
+        if let Some(memory_budget) = self.memory_budget {
+            if memory_usage > memory_budget {
+                let mut candidates = (0..self.buffer.len())
+                    .filter_map(|i| {
+                        let entry = self.buffer.get_raw(i)?;
+                        (entry.time_to_live.is_finite() && entry.last_used < self.frame)
+                            .then_some((entry.last_used, i))
+                    })
+                    .collect::<Vec<_>>();
+                candidates.sort_unstable();
+
+                for (_, i) in candidates {
+                    if memory_usage <= memory_budget {
+                        break;
+                    }
+                    if let Some(entry) = self.buffer.free_raw(i) {
+                        memory_usage -= entry.size;
+                        evicted_entries += 1;
+                    }
+                }
+            }
+        }
+
+        self.statistics = CacheStatistics {
+            entry_count: self.buffer.filled(),
+            memory_usage,
+            uploaded_bytes: self.uploaded_bytes,
+            deferred_uploads: self.deferred_uploads,
+            evicted_entries,
+        };
+
+        self.frame += 1;
+        self.uploaded_bytes = 0;
+        self.deferred_uploads = 0;
     }
 
     pub fn clear(&mut self) {
@@ -184,3 +360,79 @@ impl<T> TemporaryCache<T> {
         self.buffer.free(index);
     }
 }
+
+#[cfg(test)]
+mod test {
+    use super::*;
+
+    fn insert(
+        cache: &mut TemporaryCache<u32>,
+        value: u32,
+        size: usize,
+    ) -> Option<Arc<AtomicIndex>> {
+        let index = Arc::new(AtomicIndex::unassigned());
+        cache
+            .try_get_entry_mut_or_insert_with(&index, TimeToLive::default(), size, || {
+                Ok::<_, ()>(value)
+            })
+            .unwrap()
+            .map(|_| index)
+    }
+
+    #[test]
+    fn test_upload_budget() {
+        let mut cache = TemporaryCache::default();
+        cache.set_upload_budget(Some(100));
+
+        // The first upload in a frame always passes, even if it exceeds the budget.
+        let a = insert(&mut cache, 1, 150).unwrap();
+        assert!(!cache.has_upload_budget());
+        assert!(insert(&mut cache, 2, 10).is_none());
+
+        // Existing entries are not affected by the budget.
+        assert!(cache
+            .try_get_entry_mut_or_insert_with(&a, TimeToLive::default(), 150, || Ok::<_, ()>(0))
+            .unwrap()
+            .is_some_and(|entry| entry.value == 1));
+
+        cache.update(0.0);
+        assert_eq!(cache.statistics().uploaded_bytes, 150);
+        assert_eq!(cache.statistics().deferred_uploads, 1);
+
+        assert!(insert(&mut cache, 2, 60).is_some());
+        assert!(insert(&mut cache, 3, 40).is_some());
+        assert!(insert(&mut cache, 4, 1).is_none());
+
+        cache.update(0.0);
+        assert_eq!(cache.statistics().entry_count, 3);
+        assert_eq!(cache.statistics().memory_usage, 250);
+    }
+
+    #[test]
+    fn test_memory_budget_eviction() {
+        let mut cache = TemporaryCache::default();
+        cache.set_memory_budget(Some(250));
+
+        let a = insert(&mut cache, 1, 100).unwrap();
+        cache.update(0.0);
+        let b = insert(&mut cache, 2, 100).unwrap();
+        cache.update(0.0);
+        let c = insert(&mut cache, 3, 100).unwrap();
+        // Touch the oldest entry, so the second one becomes least recently used.
+        assert!(cache.get_mut(&a).is_some());
+        cache.update(0.0);
+
+        assert_eq!(cache.statistics().evicted_entries, 1);
+        assert_eq!(cache.statistics().memory_usage, 200);
+        assert!(cache.buffer.is_index_valid(&a));
+        assert!(!cache.buffer.is_index_valid(&b));
+        assert!(cache.buffer.is_index_valid(&c));
+
+        // Entries used during last frame must stay, even if the budget is exceeded.
+        cache.set_memory_budget(Some(0));
+        assert!(cache.get_mut(&c).is_some());
+        cache.update(0.0);
+        assert!(!cache.buffer.is_index_valid(&a));
+        assert!(cache.buffer.is_index_valid(&c));
+    }
+}
@@ -5,7 +5,7 @@ use crate::{
         scope_profile,
     },
     renderer::{
-        cache::TemporaryCache,
+        cache::{CacheStatistics, TemporaryCache},
         framework::{
             error::FrameworkError,
             gpu_texture::{Coordinate, GpuTexture, PixelKind},
@@ -55,11 +55,17 @@ impl TextureCache {
     ) -> Result<(), FrameworkError> {
         let mut texture = texture.state();
         if let Some(texture) = texture.data() {
-            self.map.get_entry_mut_or_insert_with(
+            let size = texture.data().len();
+            let is_new = !self.map.buffer.is_index_valid(&texture.cache_index);
+            let entry = self.map.get_entry_mut_or_insert_with(
                 &texture.cache_index,
                 Default::default(),
                 || create_gpu_texture(state, texture),
             )?;
+            entry.size = size;
+            if is_new {
+                self.map.register_upload(size);
+            }
             Ok(())
         } else {
             Err(FrameworkError::Custom(
@@ -78,12 +84,26 @@ impl TextureCache {
         let mut texture_data_guard = texture_resource.state();
 
         if let Some(texture) = texture_data_guard.data() {
-            match self
+            // Updates of the content of existing textures are never postponed, but they're counted
+            // in the upload budget.
+            if self
                 .map
-                .get_mut_or_insert_with(&texture.cache_index, Default::default(), || {
-                    create_gpu_texture(state, texture)
-                }) {
-                Ok(entry) => {
+                .buffer
+                .get(&texture.cache_index)
+                .map_or(false, |entry| entry.data_hash != texture.data_hash())
+            {
+                self.map.register_upload(texture.data().len());
+            }
+
+            match self.map.try_get_entry_mut_or_insert_with(
+                &texture.cache_index,
+                Default::default(),
+                texture.data().len(),
+                || create_gpu_texture(state, texture),
+            ) {
+                // The upload was postponed, a caller should use a placeholder texture.
+                Ok(None) => (),
+                Ok(Some(entry)) => {
                     // Check if some value has changed in resource.
 
                     // Data might change from last frame, so we have to check it and upload new if so.
@@ -105,6 +125,7 @@ impl TextureCache {
                             )
                         } else {
                             entry.data_hash = data_hash;
+                            entry.size = texture.data().len();
                         }
                     }
 
@@ -162,6 +183,30 @@ impl TextureCache {
         None
     }
 
+    /// Sets the maximum amount of texture data (in bytes), that could be uploaded to GPU per frame.
+    /// Textures, that do not fit in the budget, are uploaded on next frames and [`Self::get`] returns
+    /// `None` for them, so the renderer uses fallback textures instead. See
+    /// [`TemporaryCache::set_upload_budget`] for more info.
+    pub fn set_upload_budget(&mut self, bytes_per_frame: Option<usize>) {
+        self.map.set_upload_budget(bytes_per_frame)
+    }
+
+    /// Sets the maximum amount of memory (in bytes), that could be used by textures. See
+    /// [`TemporaryCache::set_memory_budget`] for more info.
+    pub fn set_memory_budget(&mut self, bytes: Option<usize>) {
+        self.map.set_memory_budget(bytes)
+    }
+
+    /// Returns `true` if there's some upload budget left in the current frame.
+    pub fn has_upload_budget(&self) -> bool {
+        self.map.has_upload_budget()
+    }
+
+    /// Returns statistics of the cache.
+    pub fn statistics(&self) -> CacheStatistics {
+        self.map.statistics()
+    }
+
     pub fn update(&mut self, dt: f32) {
         self.map.update(dt)
     }
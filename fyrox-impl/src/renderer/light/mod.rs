@@ -7,6 +7,7 @@ use crate::{
     },
     graph::SceneGraph,
     renderer::{
+        bundle::RenderDataBundleStoragePool,
         cache::shader::ShaderCache,
         flat_shader::FlatShader,
         framework::{
@@ -133,6 +134,7 @@ pub(crate) struct DeferredRendererContext<'a> {
     pub black_dummy: Rc<RefCell<GpuTexture>>,
     pub volume_dummy: Rc<RefCell<GpuTexture>>,
     pub matrix_storage: &'a mut MatrixStorageCache,
+    pub bundle_storage_pool: &'a mut RenderDataBundleStoragePool,
 }
 
 impl DeferredLightRenderer {
@@ -313,6 +315,7 @@ impl DeferredLightRenderer {
             black_dummy,
             volume_dummy,
             matrix_storage,
+            bundle_storage_pool,
         } = args;
 
         let viewport = Rect::new(0, 0, gbuffer.width, gbuffer.height);
@@ -547,6 +550,7 @@ impl DeferredLightRenderer {
                         black_dummy.clone(),
                         volume_dummy.clone(),
                         matrix_storage,
+                        bundle_storage_pool,
                     )?;
 
                     light_stats.spot_shadow_maps_rendered += 1;
@@ -567,6 +571,7 @@ impl DeferredLightRenderer {
                                 black_dummy: black_dummy.clone(),
                                 volume_dummy: volume_dummy.clone(),
                                 matrix_storage,
+                                bundle_storage_pool,
                             })?;
 
                     light_stats.point_shadow_maps_rendered += 1;
@@ -585,6 +590,7 @@ impl DeferredLightRenderer {
                         black_dummy: black_dummy.clone(),
                         volume_dummy: volume_dummy.clone(),
                         matrix_storage,
+                        bundle_storage_pool,
                     })?;
 
                     light_stats.csm_rendered += 1;
@@ -55,7 +55,10 @@ use crate::{
     },
     renderer::{
         bloom::BloomRenderer,
-        bundle::{ObserverInfo, PersistentIdentifier, RenderDataBundleStorage},
+        bundle::{
+            BundleStorageStatistics, ObserverInfo, PersistentIdentifier, RenderDataBundleStorage,
+            RenderDataBundleStoragePool,
+        },
         cache::{geometry::GeometryCache, shader::ShaderCache, texture::TextureCache},
         debug_renderer::DebugRenderer,
         flat_shader::FlatShader,
@@ -131,6 +134,8 @@ pub struct Statistics {
     pub lighting: LightingStatistics,
     /// Shows how many draw calls was made and how many triangles were rendered.
     pub geometry: RenderPassStatistics,
+    /// Shows how many render data bundle storages and their buffers were allocated and reused.
+    pub bundle_storage: BundleStorageStatistics,
     /// Real time consumed to render frame. Time given in **seconds**.
     pub pure_frame_time: f32,
     /// Total time renderer took to process single frame, usually includes
@@ -153,13 +158,15 @@ impl Display for Statistics {
             Capped Frame Time: {:.2} ms\n\
             {}\n\
             {}\n\
+            {}\n\
             {}\n",
             self.frames_per_second,
             self.pure_frame_time * 1000.0,
             self.capped_frame_time * 1000.0,
             self.geometry,
             self.lighting,
-            self.pipeline
+            self.pipeline,
+            self.bundle_storage
         )
     }
 }
@@ -514,6 +521,7 @@ impl Default for Statistics {
             pipeline: Default::default(),
             lighting: Default::default(),
             geometry: Default::default(),
+            bundle_storage: Default::default(),
             pure_frame_time: 0.0,
             capped_frame_time: 0.0,
             frames_per_second: 0,
@@ -739,6 +747,7 @@ pub struct Renderer {
     texture_event_receiver: Receiver<ResourceEvent>,
     shader_event_receiver: Receiver<ResourceEvent>,
     matrix_storage: MatrixStorageCache,
+    bundle_storage_pool: RenderDataBundleStoragePool,
     // TextureId -> FrameBuffer mapping. This mapping is used for temporal frame buffers
     // like ones used to render UI instances.
     ui_frame_buffers: FxHashMap<usize, FrameBuffer>,
@@ -1353,6 +1362,7 @@ impl Renderer {
             shader_cache,
             scene_render_passes: Default::default(),
             matrix_storage: MatrixStorageCache::new(&state)?,
+            bundle_storage_pool: Default::default(),
             state,
         })
     }
@@ -1383,6 +1393,17 @@ impl Renderer {
         self.scene_render_passes.clear()
     }
 
+    /// Returns a reference to the cache of geometry buffers.
+    pub fn geometry_cache(&self) -> &GeometryCache {
+        &self.geometry_cache
+    }
+
+    /// Returns a reference to the cache of geometry buffers. It could be used to set upload and
+    /// memory budgets of the cache.
+    pub fn geometry_cache_mut(&mut self) -> &mut GeometryCache {
+        &mut self.geometry_cache
+    }
+
     /// Returns statistics for last frame.
     pub fn get_statistics(&self) -> Statistics {
         self.statistics
@@ -1532,8 +1553,14 @@ impl Renderer {
         // requests, so this is some kind of work load balancer.
         const THROUGHPUT: usize = 5;
 
+        // Update the cache first, it starts a new frame for the upload budget of the cache.
+        self.texture_cache.update(dt);
+
         let mut uploaded = 0;
-        while let Ok(event) = self.texture_event_receiver.try_recv() {
+        while self.texture_cache.has_upload_budget() {
+            let Ok(event) = self.texture_event_receiver.try_recv() else {
+                break;
+            };
             if let ResourceEvent::Loaded(resource) | ResourceEvent::Reloaded(resource) = event {
                 if let Some(texture) = resource.try_cast::<Texture>() {
                     match self.texture_cache.upload(&self.state, &texture) {
@@ -1553,8 +1580,6 @@ impl Renderer {
                 }
             }
         }
-
-        self.texture_cache.update(dt);
     }
 
     fn update_shader_cache(&mut self, dt: f32) {
@@ -1696,7 +1721,7 @@ impl Renderer {
             {
                 let viewport = camera.viewport_pixels(frame_size);
 
-                let bundle_storage = RenderDataBundleStorage::from_graph(
+                let bundle_storage = RenderDataBundleStorage::from_graph_pooled(
                     graph,
                     ObserverInfo {
                         observer_position: camera.global_position(),
@@ -1706,6 +1731,7 @@ impl Renderer {
                         projection_matrix: camera.projection_matrix(),
                     },
                     GBUFFER_PASS_NAME.clone(),
+                    &mut self.bundle_storage_pool,
                 );
 
                 state.set_polygon_fill_mode(
@@ -1765,6 +1791,7 @@ impl Renderer {
                             black_dummy: self.black_dummy.clone(),
                             volume_dummy: self.volume_dummy.clone(),
                             matrix_storage: &mut self.matrix_storage,
+                            bundle_storage_pool: &mut self.bundle_storage_pool,
                         })?;
 
                 self.statistics.lighting += light_stats;
@@ -1905,6 +1932,8 @@ impl Renderer {
                                 matrix_storage: &mut self.matrix_storage,
                             })?;
                 }
+
+                self.bundle_storage_pool.recycle(bundle_storage);
             }
 
             // Optionally render everything into back buffer.
@@ -1921,6 +1950,8 @@ impl Renderer {
             }
         }
 
+        self.statistics.bundle_storage = self.bundle_storage_pool.end_frame();
+
         self.pipeline_state()
             .set_polygon_fill_mode(PolygonFace::FrontAndBack, PolygonFillMode::Fill);
 
@@ -5,7 +5,7 @@ use crate::{
     },
     renderer::{
         apply_material,
-        bundle::{ObserverInfo, RenderDataBundleStorage},
+        bundle::{ObserverInfo, RenderDataBundleStorage, RenderDataBundleStoragePool},
         cache::{geometry::GeometryCache, shader::ShaderCache, texture::TextureCache},
         framework::{
             error::FrameworkError,
@@ -107,6 +107,7 @@ pub(crate) struct CsmRenderContext<'a, 'c> {
     pub black_dummy: Rc<RefCell<GpuTexture>>,
     pub volume_dummy: Rc<RefCell<GpuTexture>>,
     pub matrix_storage: &'a mut MatrixStorageCache,
+    pub bundle_storage_pool: &'a mut RenderDataBundleStoragePool,
 }
 
 impl CsmRenderer {
@@ -158,6 +159,7 @@ impl CsmRenderer {
             black_dummy,
             volume_dummy,
             matrix_storage,
+            bundle_storage_pool,
         } = ctx;
 
         let light_direction = -light
@@ -249,7 +251,7 @@ impl CsmRenderer {
             let framebuffer = &mut self.cascades[i].frame_buffer;
             framebuffer.clear(state, viewport, None, Some(1.0), None);
 
-            let bundle_storage = RenderDataBundleStorage::from_graph(
+            let bundle_storage = RenderDataBundleStorage::from_graph_pooled(
                 graph,
                 ObserverInfo {
                     observer_position,
@@ -259,6 +261,7 @@ impl CsmRenderer {
                     projection_matrix: cascade_projection_matrix,
                 },
                 DIRECTIONAL_SHADOW_PASS_NAME.clone(),
+                bundle_storage_pool,
             );
 
             for bundle in bundle_storage.bundles.iter() {
@@ -338,6 +341,8 @@ impl CsmRenderer {
                     )?;
                 }
             }
+
+            bundle_storage_pool.recycle(bundle_storage);
         }
 
         Ok(stats)
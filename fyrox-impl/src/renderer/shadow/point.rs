@@ -7,7 +7,7 @@ use crate::{
     },
     renderer::{
         apply_material,
-        bundle::{ObserverInfo, RenderDataBundleStorage},
+        bundle::{ObserverInfo, RenderDataBundleStorage, RenderDataBundleStoragePool},
         cache::{shader::ShaderCache, texture::TextureCache},
         framework::{
             error::FrameworkError,
@@ -55,6 +55,7 @@ pub(crate) struct PointShadowMapRenderContext<'a> {
     pub black_dummy: Rc<RefCell<GpuTexture>>,
     pub volume_dummy: Rc<RefCell<GpuTexture>>,
     pub matrix_storage: &'a mut MatrixStorageCache,
+    pub bundle_storage_pool: &'a mut RenderDataBundleStoragePool,
 }
 
 impl PointShadowMapRenderer {
@@ -208,6 +209,7 @@ impl PointShadowMapRenderer {
             black_dummy,
             volume_dummy,
             matrix_storage,
+            bundle_storage_pool,
         } = args;
 
         let framebuffer = &mut self.cascades[cascade];
@@ -241,7 +243,7 @@ impl PointShadowMapRenderer {
             let camera_up = inv_view.up();
             let camera_side = inv_view.side();
 
-            let bundle_storage = RenderDataBundleStorage::from_graph(
+            let bundle_storage = RenderDataBundleStorage::from_graph_pooled(
                 graph,
                 ObserverInfo {
                     observer_position: light_pos,
@@ -251,6 +253,7 @@ impl PointShadowMapRenderer {
                     projection_matrix: light_projection_matrix,
                 },
                 POINT_SHADOW_PASS_NAME.clone(),
+                bundle_storage_pool,
             );
 
             for bundle in bundle_storage.bundles.iter() {
@@ -319,6 +322,8 @@ impl PointShadowMapRenderer {
                     )?;
                 }
             }
+
+            bundle_storage_pool.recycle(bundle_storage);
         }
 
         Ok(statistics)
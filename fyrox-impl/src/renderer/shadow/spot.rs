@@ -7,7 +7,7 @@ use crate::{
     },
     renderer::{
         apply_material,
-        bundle::{ObserverInfo, RenderDataBundleStorage},
+        bundle::{ObserverInfo, RenderDataBundleStorage, RenderDataBundleStoragePool},
         cache::{shader::ShaderCache, texture::TextureCache},
         framework::{
             error::FrameworkError,
@@ -134,6 +134,7 @@ impl SpotShadowMapRenderer {
         black_dummy: Rc<RefCell<GpuTexture>>,
         volume_dummy: Rc<RefCell<GpuTexture>>,
         matrix_storage: &mut MatrixStorageCache,
+        bundle_storage_pool: &mut RenderDataBundleStoragePool,
     ) -> Result<RenderPassStatistics, FrameworkError> {
         scope_profile!();
 
@@ -147,7 +148,7 @@ impl SpotShadowMapRenderer {
         framebuffer.clear(state, viewport, None, Some(1.0), None);
 
         let light_view_projection = light_projection_matrix * light_view_matrix;
-        let bundle_storage = RenderDataBundleStorage::from_graph(
+        let bundle_storage = RenderDataBundleStorage::from_graph_pooled(
             graph,
             ObserverInfo {
                 observer_position: light_position,
@@ -157,6 +158,7 @@ impl SpotShadowMapRenderer {
                 projection_matrix: light_projection_matrix,
             },
             SPOT_SHADOW_PASS_NAME.clone(),
+            bundle_storage_pool,
         );
 
         let inv_view = light_view_matrix.try_inverse().unwrap();
@@ -237,6 +239,8 @@ impl SpotShadowMapRenderer {
             }
         }
 
+        bundle_storage_pool.recycle(bundle_storage);
+
         Ok(statistics)
     }
 }
@@ -1,234 +1,447 @@
-use crate::core::byteorder::{LittleEndian, ReadBytesExt};
 use crate::{
     core::pool::{Handle, Pool},
     resource::fbx::{
         document::{attribute::FbxAttribute, FbxDocument, FbxNode, FbxNodeContainer},
         error::FbxError,
+        FbxImportStage,
     },
+    utils::progress::{CancellationToken, ProgressIndicator},
 };
-use std::io::{Cursor, Read, Seek, SeekFrom};
+use rayon::prelude::*;
+use std::io::ErrorKind;
 
-fn read_attribute<R>(type_code: u8, file: &mut R) -> Result<FbxAttribute, FbxError>
-where
-    R: Read,
-{
+/// Reader over the entire content of a file. It does not copy any data, every read just advances
+/// the position in the slice.
+struct SliceReader<'a> {
+    data: &'a [u8],
+    position: usize,
+}
+
+impl<'a> SliceReader<'a> {
+    fn new(data: &'a [u8], position: usize) -> Self {
+        Self { data, position }
+    }
+
+    fn is_at_end(&self) -> bool {
+        self.position >= self.data.len()
+    }
+
+    fn read_bytes(&mut self, count: usize) -> Result<&'a [u8], FbxError> {
+        let bytes = self
+            .position
+            .checked_add(count)
+            .and_then(|end| self.data.get(self.position..end))
+            .ok_or_else(|| FbxError::Io(ErrorKind::UnexpectedEof.into()))?;
+        self.position += count;
+        Ok(bytes)
+    }
+
+    fn read_array<const N: usize>(&mut self) -> Result<[u8; N], FbxError> {
+        let mut array = [0; N];
+        array.copy_from_slice(self.read_bytes(N)?);
+        Ok(array)
+    }
+
+    fn read_u8(&mut self) -> Result<u8, FbxError> {
+        Ok(self.read_bytes(1)?[0])
+    }
+
+    fn read_i16(&mut self) -> Result<i16, FbxError> {
+        Ok(i16::from_le_bytes(self.read_array()?))
+    }
+
+    fn read_u32(&mut self) -> Result<u32, FbxError> {
+        Ok(u32::from_le_bytes(self.read_array()?))
+    }
+
+    fn read_i32(&mut self) -> Result<i32, FbxError> {
+        Ok(i32::from_le_bytes(self.read_array()?))
+    }
+
+    fn read_u64(&mut self) -> Result<u64, FbxError> {
+        Ok(u64::from_le_bytes(self.read_array()?))
+    }
+
+    fn read_i64(&mut self) -> Result<i64, FbxError> {
+        Ok(i64::from_le_bytes(self.read_array()?))
+    }
+
+    fn read_f32(&mut self) -> Result<f32, FbxError> {
+        Ok(f32::from_le_bytes(self.read_array()?))
+    }
+
+    fn read_f64(&mut self) -> Result<f64, FbxError> {
+        Ok(f64::from_le_bytes(self.read_array()?))
+    }
+
+    /// Reads either 32-bit or 64-bit value, depending on the version of the file.
+    fn read_offset(&mut self, version: i32) -> Result<u64, FbxError> {
+        if version < VERSION_7500 {
+            Ok(u64::from(self.read_u32()?))
+        } else {
+            self.read_u64()
+        }
+    }
+}
+
+fn read_attribute(type_code: u8, file: &mut SliceReader) -> Result<FbxAttribute, FbxError> {
     match type_code {
-        b'f' | b'F' => Ok(FbxAttribute::Float(file.read_f32::<LittleEndian>()?)),
-        b'd' | b'D' => Ok(FbxAttribute::Double(file.read_f64::<LittleEndian>()?)),
-        b'l' | b'L' => Ok(FbxAttribute::Long(file.read_i64::<LittleEndian>()?)),
-        b'i' | b'I' => Ok(FbxAttribute::Integer(file.read_i32::<LittleEndian>()?)),
-        b'Y' => Ok(FbxAttribute::Integer(i32::from(
-            file.read_i16::<LittleEndian>()?,
-        ))),
+        b'f' | b'F' => Ok(FbxAttribute::Float(file.read_f32()?)),
+        b'd' | b'D' => Ok(FbxAttribute::Double(file.read_f64()?)),
+        b'l' | b'L' => Ok(FbxAttribute::Long(file.read_i64()?)),
+        b'i' | b'I' => Ok(FbxAttribute::Integer(file.read_i32()?)),
+        b'Y' => Ok(FbxAttribute::Integer(i32::from(file.read_i16()?))),
         b'b' | b'C' => Ok(FbxAttribute::Bool(file.read_u8()? != 0)),
         _ => Err(FbxError::UnknownAttributeType(type_code)),
     }
 }
 
-fn read_array<R>(type_code: u8, file: &mut R) -> Result<Vec<FbxAttribute>, FbxError>
-where
-    R: Read,
-{
-    let length = file.read_u32::<LittleEndian>()? as usize;
-    let encoding = file.read_u32::<LittleEndian>()?;
-    let compressed_length = file.read_u32::<LittleEndian>()? as usize;
-    let mut array = Vec::new();
-
-    if encoding == 0 {
-        for _ in 0..length {
-            array.push(read_attribute(type_code, file)?);
-        }
-    } else {
-        let mut compressed = vec![Default::default(); compressed_length];
-        file.read_exact(compressed.as_mut_slice())?;
-        let decompressed = inflate::inflate_bytes_zlib(&compressed)?;
-        let mut cursor = Cursor::new(decompressed);
-        for _ in 0..length {
-            array.push(read_attribute(type_code, &mut cursor)?);
-        }
+fn read_array_elements(
+    type_code: u8,
+    length: usize,
+    file: &mut SliceReader,
+) -> Result<Vec<FbxAttribute>, FbxError> {
+    // Do not trust the length blindly, corrupted files could cause huge allocations otherwise.
+    let mut array = Vec::with_capacity(length.min(file.data.len()));
+    for _ in 0..length {
+        array.push(read_attribute(type_code, file)?);
     }
-
     Ok(array)
 }
 
-fn read_string<R>(file: &mut R) -> Result<FbxAttribute, FbxError>
-where
-    R: Read,
-{
-    let length = file.read_u32::<LittleEndian>()? as usize;
-    let mut raw_string = vec![Default::default(); length];
-    file.read_exact(raw_string.as_mut_slice())?;
+/// Compressed array, that will be decompressed after the entire document is parsed. Decompression is
+/// the most time-consuming part of parsing, so it is done in parallel for all arrays at once.
+struct DeferredArray<'a> {
+    node: Handle<FbxNode>,
+    type_code: u8,
+    length: usize,
+    compressed: &'a [u8],
+}
+
+impl<'a> DeferredArray<'a> {
+    fn decode(&self) -> Result<Vec<FbxAttribute>, FbxError> {
+        let decompressed = inflate::inflate_bytes_zlib(self.compressed)?;
+        read_array_elements(
+            self.type_code,
+            self.length,
+            &mut SliceReader::new(&decompressed, 0),
+        )
+    }
+}
+
+fn read_string(file: &mut SliceReader) -> Result<FbxAttribute, FbxError> {
+    let length = file.read_u32()? as usize;
+    let mut raw_string = file.read_bytes(length)?;
     // Find null terminator. It is required because for some reason some strings
     // have additional data after null terminator like this: Omni004\x0\x1Model, but
     // length still more than position of null terminator.
     if let Some(null_terminator_pos) = raw_string.iter().position(|c| *c == 0) {
-        raw_string.truncate(null_terminator_pos);
+        raw_string = &raw_string[..null_terminator_pos];
     }
-    let string = String::from_utf8(raw_string)?;
-    Ok(FbxAttribute::String(string))
+    let string = std::str::from_utf8(raw_string).map_err(|_| FbxError::InvalidString)?;
+    Ok(FbxAttribute::String(string.to_owned()))
 }
 
 const VERSION_7500: i32 = 7500;
 const VERSION_7500_NULLREC_SIZE: usize = 25; // in bytes
 const NORMAL_NULLREC_SIZE: usize = 13; // in bytes
 
-/// Read binary FBX DOM using this specification:
-/// https://code.blender.org/2013/08/fbx-binary-file-format-specification/
-/// In case of success returns Ok(valid_handle), in case if no more nodes
-/// are present returns Ok(none_handle), in case of error returns some FbxError.
-fn read_binary_node<R>(
-    file: &mut R,
-    pool: &mut Pool<FbxNode>,
+struct BinaryParser<'a, 'b> {
+    file: SliceReader<'a>,
+    pool: Pool<FbxNode>,
+    deferred: Vec<DeferredArray<'a>>,
     version: i32,
-) -> Result<Handle<FbxNode>, FbxError>
-where
-    R: Read + Seek,
-{
-    let end_offset = if version < VERSION_7500 {
-        u64::from(file.read_u32::<LittleEndian>()?)
-    } else {
-        file.read_u64::<LittleEndian>()?
-    };
-    if end_offset == 0 {
-        // Footer found. We're done.
-        return Ok(Handle::NONE);
-    }
+    cancellation_token: &'b CancellationToken,
+    progress_indicator: &'b ProgressIndicator<FbxImportStage>,
+}
 
-    let num_attrib = if version < VERSION_7500 {
-        file.read_u32::<LittleEndian>()? as usize
-    } else {
-        file.read_u64::<LittleEndian>()? as usize
-    };
+impl<'a, 'b> BinaryParser<'a, 'b> {
+    /// Read binary FBX DOM using this specification:
+    /// https://code.blender.org/2013/08/fbx-binary-file-format-specification/
+    /// In case of success returns Ok(valid_handle), in case if no more nodes
+    /// are present returns Ok(none_handle), in case of error returns some FbxError.
+    fn read_binary_node(&mut self) -> Result<Handle<FbxNode>, FbxError> {
+        let version = self.version;
+        let end_offset = self.file.read_offset(version)?;
+        if end_offset == 0 {
+            // Footer found. We're done.
+            return Ok(Handle::NONE);
+        }
 
-    let _attrib_list_len = if version < VERSION_7500 {
-        file.read_u32::<LittleEndian>()? as u64
-    } else {
-        file.read_u64::<LittleEndian>()?
-    };
+        let num_attrib = self.file.read_offset(version)? as usize;
+        let _attrib_list_len = self.file.read_offset(version)?;
 
-    // Read name.
-    let name_len = file.read_u8()? as usize;
-    let mut raw_name = vec![Default::default(); name_len];
-    file.read_exact(raw_name.as_mut_slice())?;
+        // Read name.
+        let name_len = self.file.read_u8()? as usize;
+        let name = std::str::from_utf8(self.file.read_bytes(name_len)?)
+            .map_err(|_| FbxError::InvalidString)?;
 
-    let node = FbxNode {
-        name: String::from_utf8(raw_name)?,
-        ..FbxNode::default()
-    };
+        let node_handle = self.pool.spawn(FbxNode {
+            name: name.to_owned(),
+            ..FbxNode::default()
+        });
 
-    let node_handle = pool.spawn(node);
+        // Read attributes.
+        for _ in 0..num_attrib {
+            let type_code = self.file.read_u8()?;
+            match type_code {
+                b'C' | b'Y' | b'I' | b'F' | b'D' | b'L' => {
+                    let attribute = read_attribute(type_code, &mut self.file)?;
+                    self.pool.borrow_mut(node_handle).attributes.push(attribute);
+                }
+                b'f' | b'd' | b'l' | b'i' | b'b' => {
+                    let length = self.file.read_u32()? as usize;
+                    let encoding = self.file.read_u32()?;
+                    let compressed_length = self.file.read_u32()? as usize;
 
-    // Read attributes.
-    for _ in 0..num_attrib {
-        let type_code = file.read_u8()?;
-        match type_code {
-            b'C' | b'Y' | b'I' | b'F' | b'D' | b'L' => {
-                let node = pool.borrow_mut(node_handle);
-                node.attributes.push(read_attribute(type_code, file)?);
-            }
-            b'f' | b'd' | b'l' | b'i' | b'b' => {
-                let a = FbxNode {
-                    name: String::from("a"),
-                    attributes: read_array(type_code, file)?,
-                    parent: node_handle,
-                    ..FbxNode::default()
-                };
-
-                let a_handle = pool.spawn(a);
-                let node = pool.borrow_mut(node_handle);
-                node.children.push(a_handle);
-            }
-            b'S' => pool
-                .borrow_mut(node_handle)
-                .attributes
-                .push(read_string(file)?),
-            b'R' => {
-                let length = i64::from(file.read_u32::<LittleEndian>()?);
-                let mut data = vec![0; length as usize];
-                file.read_exact(&mut data)?;
-                pool.borrow_mut(node_handle)
-                    .attributes
-                    .push(FbxAttribute::RawData(data));
-            }
-            _ => (),
-        }
-    }
+                    let attributes = if encoding == 0 {
+                        read_array_elements(type_code, length, &mut self.file)?
+                    } else {
+                        Vec::new()
+                    };
 
-    if file.stream_position()? < end_offset {
-        let nullrec_size = if version < VERSION_7500 {
-            NORMAL_NULLREC_SIZE
-        } else {
-            VERSION_7500_NULLREC_SIZE
-        };
-
-        let null_record_position = end_offset - nullrec_size as u64;
-        while file.stream_position()? < null_record_position {
-            let child_handle = read_binary_node(file, pool, version)?;
-            if child_handle.is_none() {
-                return Ok(child_handle);
+                    let a_handle = self.pool.spawn(FbxNode {
+                        name: String::from("a"),
+                        attributes,
+                        parent: node_handle,
+                        ..FbxNode::default()
+                    });
+                    self.pool.borrow_mut(node_handle).children.push(a_handle);
+
+                    if encoding != 0 {
+                        self.deferred.push(DeferredArray {
+                            node: a_handle,
+                            type_code,
+                            length,
+                            compressed: self.file.read_bytes(compressed_length)?,
+                        });
+                    }
+                }
+                b'S' => {
+                    let attribute = read_string(&mut self.file)?;
+                    self.pool.borrow_mut(node_handle).attributes.push(attribute);
+                }
+                b'R' => {
+                    let length = self.file.read_u32()? as usize;
+                    let data = self.file.read_bytes(length)?.to_vec();
+                    self.pool
+                        .borrow_mut(node_handle)
+                        .attributes
+                        .push(FbxAttribute::RawData(data));
+                }
+                _ => (),
             }
-            pool.borrow_mut(child_handle).parent = node_handle;
-            pool.borrow_mut(node_handle).children.push(child_handle);
         }
 
-        // Check if we have a null-record
-        if version < VERSION_7500 {
-            let mut null_record = [0; NORMAL_NULLREC_SIZE];
-            file.read_exact(&mut null_record)?;
-            if !null_record.iter().all(|i| *i == 0) {
-                return Err(FbxError::InvalidNullRecord);
+        if (self.file.position as u64) < end_offset {
+            let nullrec_size = if version < VERSION_7500 {
+                NORMAL_NULLREC_SIZE
+            } else {
+                VERSION_7500_NULLREC_SIZE
+            };
+
+            let null_record_position = end_offset
+                .checked_sub(nullrec_size as u64)
+                .ok_or(FbxError::InvalidNullRecord)?;
+            while (self.file.position as u64) < null_record_position {
+                let child_handle = self.read_binary_node()?;
+                if child_handle.is_none() {
+                    return Ok(child_handle);
+                }
+                self.pool.borrow_mut(child_handle).parent = node_handle;
+                self.pool
+                    .borrow_mut(node_handle)
+                    .children
+                    .push(child_handle);
             }
-        } else {
-            let mut null_record = [0; VERSION_7500_NULLREC_SIZE];
-            file.read_exact(&mut null_record)?;
+
+            // Check if we have a null-record
+            let null_record = self.file.read_bytes(nullrec_size)?;
             if !null_record.iter().all(|i| *i == 0) {
                 return Err(FbxError::InvalidNullRecord);
             }
         }
+
+        Ok(node_handle)
     }
 
-    Ok(node_handle)
+    fn decode_deferred_arrays(&mut self) -> Result<(), FbxError> {
+        self.progress_indicator
+            .set_stage(FbxImportStage::Decompression, self.deferred.len() as u32);
+
+        let cancellation_token = self.cancellation_token;
+        let progress_indicator = self.progress_indicator;
+        let arrays = self
+            .deferred
+            .par_iter()
+            .map(|array| {
+                if cancellation_token.is_cancelled() {
+                    return Err(FbxError::Cancelled);
+                }
+                let attributes = array.decode();
+                progress_indicator.advance_progress();
+                attributes
+            })
+            .collect::<Result<Vec<_>, _>>()?;
+
+        for (array, attributes) in self.deferred.iter().zip(arrays) {
+            self.pool.borrow_mut(array.node).attributes = attributes;
+        }
+
+        Ok(())
+    }
 }
 
-pub fn read_binary<R>(file: &mut R) -> Result<FbxDocument, FbxError>
-where
-    R: Read + Seek,
-{
-    let total_length = file.seek(SeekFrom::End(0))?;
-    file.rewind()?;
+pub fn read_binary(
+    data: &[u8],
+    cancellation_token: &CancellationToken,
+    progress_indicator: &ProgressIndicator<FbxImportStage>,
+) -> Result<FbxDocument, FbxError> {
+    let mut header = SliceReader::new(data, 0);
 
     // Ignore all stuff until version.
-    let mut temp = [0; 23];
-    file.read_exact(&mut temp)?;
+    header.read_bytes(23)?;
 
     // Verify version.
-    let version = file.read_u32::<LittleEndian>()? as i32;
+    let version = header.read_i32()?;
 
     // Anything else should be supported.
     if version < 7100 {
         return Err(FbxError::UnsupportedVersion(version));
     }
 
-    let mut nodes = Pool::new();
-    let root = FbxNode {
+    progress_indicator.set_stage(FbxImportStage::Parsing, 0);
+
+    let mut parser = BinaryParser {
+        file: header,
+        pool: Pool::new(),
+        deferred: Vec::new(),
+        version,
+        cancellation_token,
+        progress_indicator,
+    };
+
+    let root_handle = parser.pool.spawn(FbxNode {
         name: String::from("__ROOT__"),
         ..FbxNode::default()
-    };
-    let root_handle = nodes.spawn(root);
+    });
 
     // FBX document can have multiple root nodes, so we must read the file
     // until the end.
-    while file.stream_position()? < total_length {
-        let root_child = read_binary_node(file, &mut nodes, version)?;
+    while !parser.file.is_at_end() {
+        if cancellation_token.is_cancelled() {
+            return Err(FbxError::Cancelled);
+        }
+
+        let root_child = parser.read_binary_node()?;
         if root_child.is_none() {
             break;
         }
-        nodes.borrow_mut(root_child).parent = root_handle;
-        nodes.borrow_mut(root_handle).children.push(root_child);
+        parser.pool.borrow_mut(root_child).parent = root_handle;
+        parser
+            .pool
+            .borrow_mut(root_handle)
+            .children
+            .push(root_child);
     }
 
+    parser.decode_deferred_arrays()?;
+
     Ok(FbxDocument {
-        nodes: FbxNodeContainer { nodes },
+        nodes: FbxNodeContainer { nodes: parser.pool },
         root: root_handle,
     })
 }
+
+#[cfg(test)]
+mod test {
+    use super::*;
+
+    // Zlib stream with a single stored (uncompressed) block.
+    fn zlib_stored(data: &[u8]) -> Vec<u8> {
+        let mut out = vec![0x78, 0x01, 0x01];
+        out.extend_from_slice(&(data.len() as u16).to_le_bytes());
+        out.extend_from_slice(&(!(data.len() as u16)).to_le_bytes());
+        out.extend_from_slice(data);
+        let (mut a, mut b) = (1u32, 0u32);
+        for &byte in data {
+            a = (a + byte as u32) % 65521;
+            b = (b + a) % 65521;
+        }
+        out.extend_from_slice(&((b << 16) | a).to_be_bytes());
+        out
+    }
+
+    fn i32_bytes(values: &[i32]) -> Vec<u8> {
+        values.iter().flat_map(|v| v.to_le_bytes()).collect()
+    }
+
+    fn test_document() -> Vec<u8> {
+        let mut attributes = vec![b'S'];
+        attributes.extend_from_slice(&4u32.to_le_bytes());
+        attributes.extend_from_slice(b"Test");
+
+        let compressed = zlib_stored(&i32_bytes(&[1, 2, 3]));
+        attributes.push(b'i');
+        for v in [3, 1, compressed.len() as u32] {
+            attributes.extend_from_slice(&v.to_le_bytes());
+        }
+        attributes.extend_from_slice(&compressed);
+
+        attributes.push(b'i');
+        for v in [2u32, 0, 8] {
+            attributes.extend_from_slice(&v.to_le_bytes());
+        }
+        attributes.extend_from_slice(&i32_bytes(&[4, 5]));
+
+        let mut data = b"Kaydara FBX Binary  \0\x1a\0".to_vec();
+        data.extend_from_slice(&7400u32.to_le_bytes());
+        let name = b"Values";
+        let end_offset = data.len() + 13 + name.len() + attributes.len();
+        for v in [end_offset as u32, 3, attributes.len() as u32] {
+            data.extend_from_slice(&v.to_le_bytes());
+        }
+        data.push(name.len() as u8);
+        data.extend_from_slice(name);
+        data.extend_from_slice(&attributes);
+        data.extend_from_slice(&[0; NORMAL_NULLREC_SIZE]);
+        data
+    }
+
+    #[test]
+    fn test_read_binary() {
+        let data = test_document();
+        let document =
+            read_binary(&data, &CancellationToken::new(), &ProgressIndicator::new()).unwrap();
+        let nodes = document.nodes();
+        let values = nodes.get_by_name(document.root(), "Values").unwrap();
+        assert_eq!(values.get_attrib(0).unwrap().as_string(), "Test");
+        let arrays = values
+            .children()
+            .iter()
+            .map(|a| {
+                nodes
+                    .get(*a)
+                    .attributes()
+                    .iter()
+                    .map(|v| v.as_i32().unwrap())
+                    .collect::<Vec<_>>()
+            })
+            .collect::<Vec<_>>();
+        assert_eq!(arrays, vec![vec![1, 2, 3], vec![4, 5]]);
+
+        assert!(read_binary(
+            &data[..data.len() - 20],
+            &CancellationToken::new(),
+            &ProgressIndicator::new()
+        )
+        .is_err());
+
+        let cancellation_token = CancellationToken::new();
+        cancellation_token.cancel();
+        assert!(matches!(
+            read_binary(&data, &cancellation_token, &ProgressIndicator::new()),
+            Err(FbxError::Cancelled)
+        ));
+    }
+}
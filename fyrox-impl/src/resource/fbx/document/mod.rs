@@ -9,7 +9,8 @@ use crate::{
         algebra::Vector3,
         pool::{Handle, Pool},
     },
-    resource::fbx::{document::attribute::FbxAttribute, error::FbxError},
+    resource::fbx::{document::attribute::FbxAttribute, error::FbxError, FbxImportStage},
+    utils::progress::{CancellationToken, ProgressIndicator},
 };
 use std::{io::Cursor, path::Path};
 
@@ -125,15 +126,15 @@ impl FbxDocument {
     pub async fn new<P: AsRef<Path>>(
         path: P,
         io: &dyn ResourceIo,
+        cancellation_token: &CancellationToken,
+        progress_indicator: &ProgressIndicator<FbxImportStage>,
     ) -> Result<FbxDocument, FbxError> {
         let data = io.load_file(path.as_ref()).await?;
-        let is_bin = is_binary(&data);
-        let mut reader = Cursor::new(data);
 
-        if is_bin {
-            binary::read_binary(&mut reader)
+        if is_binary(&data) {
+            binary::read_binary(&data, cancellation_token, progress_indicator)
         } else {
-            ascii::read_ascii(&mut reader)
+            ascii::read_ascii(&mut Cursor::new(data))
         }
     }
 
@@ -47,6 +47,9 @@ pub enum FbxError {
 
     /// An error occurred during file loading.
     FileLoadError(FileLoadError),
+
+    /// Import was cancelled by user.
+    Cancelled,
 }
 
 impl Display for FbxError {
@@ -97,6 +100,9 @@ impl Display for FbxError {
             FbxError::FileLoadError(v) => {
                 write!(f, "FBX: File load error {v:?}.")
             }
+            FbxError::Cancelled => {
+                write!(f, "FBX: Import was cancelled.")
+            }
         }
     }
 }
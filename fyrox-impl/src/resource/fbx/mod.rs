@@ -56,12 +56,70 @@ use crate::{
         transform::TransformBuilder,
         Scene,
     },
-    utils::{self, raw_mesh::RawMeshBuilder},
+    utils::{
+        self,
+        progress::{CancellationToken, ProgressIndicator, TaskStage},
+        raw_mesh::RawMeshBuilder,
+    },
 };
 use fxhash::{FxHashMap, FxHashSet};
 use fyrox_resource::io::ResourceIo;
 use fyrox_resource::untyped::ResourceKind;
-use std::{cmp::Ordering, path::Path};
+use rayon::prelude::*;
+use std::{
+    cmp::Ordering,
+    fmt::{Display, Formatter},
+    path::Path,
+};
+
+/// FBX import stage.
+#[derive(Copy, Clone, Debug, Eq, PartialEq)]
+#[repr(u32)]
+pub enum FbxImportStage {
+    /// Parsing of the document structure.
+    Parsing = 0,
+    /// Decompression of compressed arrays of binary documents.
+    Decompression = 1,
+    /// Preparation of FBX scene from the document.
+    DomPreparation = 2,
+    /// Triangulation of meshes, generation of surfaces and tangents.
+    MeshConversion = 3,
+}
+
+impl Display for FbxImportStage {
+    fn fmt(&self, f: &mut Formatter<'_>) -> std::fmt::Result {
+        match self {
+            FbxImportStage::Parsing => {
+                write!(f, "Parsing")
+            }
+            FbxImportStage::Decompression => {
+                write!(f, "Decompressing Arrays")
+            }
+            FbxImportStage::DomPreparation => {
+                write!(f, "Preparing DOM")
+            }
+            FbxImportStage::MeshConversion => {
+                write!(f, "Converting Meshes")
+            }
+        }
+    }
+}
+
+impl TaskStage for FbxImportStage {
+    fn from_index(index: u32) -> Self {
+        match index {
+            0 => FbxImportStage::Parsing,
+            1 => FbxImportStage::Decompression,
+            2 => FbxImportStage::DomPreparation,
+            3 => FbxImportStage::MeshConversion,
+            _ => unreachable!(),
+        }
+    }
+
+    fn index(self) -> u32 {
+        self as u32
+    }
+}
 
 /// Input angles in degrees
 fn quat_from_euler(euler: Vector3<f32>) -> UnitQuaternion<f32> {
@@ -250,6 +308,20 @@ struct FbxSurfaceData {
     skin_data: Vec<VertexWeightSet>,
 }
 
+/// Surface with fully prepared geometry, it only lacks material.
+struct PreparedSurface {
+    data: SurfaceData,
+    skin_data: Vec<VertexWeightSet>,
+}
+
+/// Result of conversion of a single FBX geometry. Geometries are converted in parallel before the
+/// scene graph is built, because triangulation, vertex deduplication and tangents calculation are
+/// the most time-consuming parts of the import.
+struct PreparedGeometry {
+    surfaces: Vec<PreparedSurface>,
+    blend_shapes: Vec<BlendShape>,
+}
+
 fn make_blend_shapes_container(
     base_shape: &VertexBuffer,
     blend_shapes: Vec<InputBlendShapeData>,
@@ -263,7 +335,7 @@ fn make_blend_shapes_container(
 
 async fn create_surfaces(
     fbx_scene: &FbxScene,
-    data_set: Vec<FbxSurfaceData>,
+    data_set: Vec<PreparedSurface>,
     resource_manager: ResourceManager,
     model: &FbxModel,
     model_path: &Path,
@@ -275,19 +347,13 @@ async fn create_surfaces(
     if model.materials.is_empty() {
         assert_eq!(data_set.len(), 1);
         let data = data_set.into_iter().next().unwrap();
-        let mut surface_data = data.base_mesh_builder.build();
-        surface_data.blend_shapes_container =
-            make_blend_shapes_container(&surface_data.vertex_buffer, data.blend_shapes);
-        let mut surface = Surface::new(SurfaceSharedData::new(surface_data));
+        let mut surface = Surface::new(SurfaceSharedData::new(data.data));
         surface.vertex_weights = data.skin_data;
         surfaces.push(surface);
     } else {
         assert_eq!(data_set.len(), model.materials.len());
         for (&material_handle, data) in model.materials.iter().zip(data_set.into_iter()) {
-            let mut surface_data = data.base_mesh_builder.build();
-            surface_data.blend_shapes_container =
-                make_blend_shapes_container(&surface_data.vertex_buffer, data.blend_shapes);
-            let mut surface = Surface::new(SurfaceSharedData::new(surface_data));
+            let mut surface = Surface::new(SurfaceSharedData::new(data.data));
             surface.vertex_weights = data.skin_data;
             let material = fbx_scene.get(material_handle).as_material()?;
             if let Err(e) = surface.material().data_ref().set_property(
@@ -437,15 +503,11 @@ async fn create_surfaces(
     Ok(surfaces)
 }
 
-async fn convert_mesh(
-    base: BaseBuilder,
+fn prepare_geometry(
     fbx_scene: &FbxScene,
-    resource_manager: ResourceManager,
     model: &FbxModel,
-    graph: &mut Graph,
-    model_path: &Path,
-    model_import_options: &ModelImportOptions,
-) -> Result<Handle<Node>, FbxError> {
+    geom_handle: Handle<FbxComponent>,
+) -> Result<PreparedGeometry, FbxError> {
     let geometric_transform = Matrix4::new_translation(&model.geometric_translation)
         * quat_from_euler(model.geometric_rotation).to_homogeneous()
         * Matrix4::new_nonuniform_scaling(&model.geometric_scale);
@@ -457,136 +519,205 @@ async fn convert_mesh(
     // triangulated polygon.
     let mut face_triangles = Vec::new();
 
-    let mut mesh_surfaces = Vec::new();
-    let mut mesh_blend_shapes = Vec::new();
-
-    for &geom_handle in &model.geoms {
-        let geom = fbx_scene.get(geom_handle).as_mesh_geometry()?;
-        let skin_data = geom.get_skin_data(fbx_scene)?;
-        let blend_shapes = geom.collect_blend_shapes_refs(fbx_scene)?;
+    let geom = fbx_scene.get(geom_handle).as_mesh_geometry()?;
+    let skin_data = geom.get_skin_data(fbx_scene)?;
+    let blend_shapes = geom.collect_blend_shapes_refs(fbx_scene)?;
 
-        if !mesh_blend_shapes.is_empty() {
-            Log::warn("More than two geoms with blend shapes?");
-        }
-        mesh_blend_shapes = blend_shapes
-            .iter()
-            .map(|bs| BlendShape {
-                weight: bs.deform_percent,
-                name: bs.name.clone(),
-            })
-            .collect();
-
-        let mut data_set = vec![
-            FbxSurfaceData {
-                base_mesh_builder: if geom.deformers.is_empty() {
-                    FbxMeshBuilder::Static(RawMeshBuilder::new(1024, 1024))
-                } else {
-                    FbxMeshBuilder::Animated(RawMeshBuilder::new(1024, 1024))
-                },
-                blend_shapes: blend_shapes
-                    .iter()
-                    .map(|bs_channel| {
-                        InputBlendShapeData {
-                            name: bs_channel.name.clone(),
-                            default_weight: bs_channel.deform_percent,
-                            positions: Default::default(),
-                            normals: Default::default(),
-                            tangents: Default::default(),
-                        }
-                    })
-                    .collect(),
-                skin_data: Default::default(),
-            };
-            model.materials.len().max(1)
-        ];
-
-        let mut material_index = 0;
-        let mut n = 0;
-        while n < geom.indices.len() {
-            let origin = n;
-            n += prepare_next_face(
-                &geom.vertices,
-                &geom.indices[origin..],
-                &mut temp_vertices,
-                &mut triangles,
-                &mut face_triangles,
-            );
-            for (triangle, face_triangle) in triangles.iter().zip(face_triangles.iter()) {
-                for (&index, &face_vertex_index) in triangle.iter().zip(face_triangle.iter()) {
-                    let polygon_vertex_index = origin + face_vertex_index;
-                    let vertex = convert_vertex(
-                        geom,
-                        &geometric_transform,
-                        material_index,
-                        index,
-                        polygon_vertex_index,
-                        &skin_data,
-                    )?;
-                    let data = data_set.get_mut(vertex.surface_index).unwrap();
-                    let weights = vertex.weights;
-                    let final_index;
-                    let is_unique_vertex = match data.base_mesh_builder {
-                        FbxMeshBuilder::Static(ref mut builder) => {
-                            final_index = builder.vertex_count();
-                            builder.insert(vertex.clone().into())
-                        }
-                        FbxMeshBuilder::Animated(ref mut builder) => {
-                            final_index = builder.vertex_count();
-                            builder.insert(vertex.clone().into())
-                        }
-                    };
-                    if is_unique_vertex {
-                        if let Some(skin_data) = weights {
-                            data.skin_data.push(skin_data);
-                        }
+    let mut data_set = vec![
+        FbxSurfaceData {
+            base_mesh_builder: if geom.deformers.is_empty() {
+                FbxMeshBuilder::Static(RawMeshBuilder::new(1024, 1024))
+            } else {
+                FbxMeshBuilder::Animated(RawMeshBuilder::new(1024, 1024))
+            },
+            blend_shapes: blend_shapes
+                .iter()
+                .map(|bs_channel| {
+                    InputBlendShapeData {
+                        name: bs_channel.name.clone(),
+                        default_weight: bs_channel.deform_percent,
+                        positions: Default::default(),
+                        normals: Default::default(),
+                        tangents: Default::default(),
+                    }
+                })
+                .collect(),
+            skin_data: Default::default(),
+        };
+        model.materials.len().max(1)
+    ];
+
+    let mut material_index = 0;
+    let mut n = 0;
+    while n < geom.indices.len() {
+        let origin = n;
+        n += prepare_next_face(
+            &geom.vertices,
+            &geom.indices[origin..],
+            &mut temp_vertices,
+            &mut triangles,
+            &mut face_triangles,
+        );
+        for (triangle, face_triangle) in triangles.iter().zip(face_triangles.iter()) {
+            for (&index, &face_vertex_index) in triangle.iter().zip(face_triangle.iter()) {
+                let polygon_vertex_index = origin + face_vertex_index;
+                let vertex = convert_vertex(
+                    geom,
+                    &geometric_transform,
+                    material_index,
+                    index,
+                    polygon_vertex_index,
+                    &skin_data,
+                )?;
+                let data = data_set.get_mut(vertex.surface_index).unwrap();
+                let weights = vertex.weights;
+                let final_index;
+                let is_unique_vertex = match data.base_mesh_builder {
+                    FbxMeshBuilder::Static(ref mut builder) => {
+                        final_index = builder.vertex_count();
+                        builder.insert(vertex.clone().into())
+                    }
+                    FbxMeshBuilder::Animated(ref mut builder) => {
+                        final_index = builder.vertex_count();
+                        builder.insert(vertex.clone().into())
+                    }
+                };
+                if is_unique_vertex {
+                    if let Some(skin_data) = weights {
+                        data.skin_data.push(skin_data);
                     }
+                }
 
-                    // Fill each blend shape, but modify the vertex first using the "offsets" from blend shapes.
-                    assert_eq!(blend_shapes.len(), data.blend_shapes.len());
-                    for (fbx_blend_shape, blend_shape) in
-                        blend_shapes.iter().zip(data.blend_shapes.iter_mut())
+                // Fill each blend shape, but modify the vertex first using the "offsets" from blend shapes.
+                assert_eq!(blend_shapes.len(), data.blend_shapes.len());
+                for (fbx_blend_shape, blend_shape) in
+                    blend_shapes.iter().zip(data.blend_shapes.iter_mut())
+                {
+                    let blend_shape_geometry = fbx_scene
+                        .get(fbx_blend_shape.geometry)
+                        .as_shape_geometry()?;
+
+                    // Only certain vertices are affected by a blend shape, because FBX stores only changed
+                    // parts ("diff").
+                    if let Some(relative_index) = blend_shape_geometry.indices.get(&(index as i32))
                     {
-                        let blend_shape_geometry = fbx_scene
-                            .get(fbx_blend_shape.geometry)
-                            .as_shape_geometry()?;
-
-                        // Only certain vertices are affected by a blend shape, because FBX stores only changed
-                        // parts ("diff").
-                        if let Some(relative_index) =
-                            blend_shape_geometry.indices.get(&(index as i32))
-                        {
-                            blend_shape.positions.insert(
+                        blend_shape.positions.insert(
+                            final_index as u32,
+                            utils::vec3_f16_from_f32(
+                                blend_shape_geometry.vertices[*relative_index as usize],
+                            ),
+                        );
+                        if let Some(normals) = blend_shape_geometry.normals.as_ref() {
+                            blend_shape.normals.insert(
                                 final_index as u32,
-                                utils::vec3_f16_from_f32(
-                                    blend_shape_geometry.vertices[*relative_index as usize],
-                                ),
+                                utils::vec3_f16_from_f32(normals[*relative_index as usize]),
+                            );
+                        }
+                        if let Some(tangents) = blend_shape_geometry.tangents.as_ref() {
+                            blend_shape.normals.insert(
+                                final_index as u32,
+                                utils::vec3_f16_from_f32(tangents[*relative_index as usize]),
                             );
-                            if let Some(normals) = blend_shape_geometry.normals.as_ref() {
-                                blend_shape.normals.insert(
-                                    final_index as u32,
-                                    utils::vec3_f16_from_f32(normals[*relative_index as usize]),
-                                );
-                            }
-                            if let Some(tangents) = blend_shape_geometry.tangents.as_ref() {
-                                blend_shape.normals.insert(
-                                    final_index as u32,
-                                    utils::vec3_f16_from_f32(tangents[*relative_index as usize]),
-                                );
-                            }
                         }
                     }
                 }
             }
-            if let Some(materials) = geom.materials.as_ref() {
-                if materials.mapping == FbxMapping::ByPolygon {
-                    material_index += 1;
-                }
+        }
+        if let Some(materials) = geom.materials.as_ref() {
+            if materials.mapping == FbxMapping::ByPolygon {
+                material_index += 1;
             }
         }
+    }
+
+    let surfaces = data_set
+        .into_par_iter()
+        .map(|data| {
+            let mut surface_data = data.base_mesh_builder.build();
+            surface_data.blend_shapes_container =
+                make_blend_shapes_container(&surface_data.vertex_buffer, data.blend_shapes);
+            if geom.tangents.is_none() {
+                surface_data.calculate_tangents().unwrap();
+            }
+            PreparedSurface {
+                data: surface_data,
+                skin_data: data.skin_data,
+            }
+        })
+        .collect();
+
+    Ok(PreparedGeometry {
+        surfaces,
+        blend_shapes: blend_shapes
+            .iter()
+            .map(|bs| BlendShape {
+                weight: bs.deform_percent,
+                name: bs.name.clone(),
+            })
+            .collect(),
+    })
+}
+
+/// Converts every mesh geometry of the scene in parallel. Returns prepared geometries grouped by
+/// models, geometries of each model are stored in the same order as in the model.
+fn prepare_geometries(
+    fbx_scene: &FbxScene,
+    cancellation_token: &CancellationToken,
+    progress_indicator: &ProgressIndicator<FbxImportStage>,
+) -> Result<FxHashMap<Handle<FbxComponent>, Vec<PreparedGeometry>>, FbxError> {
+    let jobs = fbx_scene
+        .pair_iter()
+        .filter_map(|(handle, component)| match component {
+            FbxComponent::Model(model) => Some((handle, model.as_ref())),
+            _ => None,
+        })
+        .flat_map(|(handle, model)| model.geoms.iter().map(move |&geom| (handle, model, geom)))
+        .collect::<Vec<_>>();
+
+    progress_indicator.set_stage(FbxImportStage::MeshConversion, jobs.len() as u32);
+
+    let geometries = jobs
+        .par_iter()
+        .map(|&(_, model, geom_handle)| {
+            if cancellation_token.is_cancelled() {
+                return Err(FbxError::Cancelled);
+            }
+            let geometry = prepare_geometry(fbx_scene, model, geom_handle);
+            progress_indicator.advance_progress();
+            geometry
+        })
+        .collect::<Result<Vec<_>, _>>()?;
+
+    let mut prepared = FxHashMap::<_, Vec<_>>::default();
+    for (&(model_handle, _, _), geometry) in jobs.iter().zip(geometries) {
+        prepared.entry(model_handle).or_default().push(geometry);
+    }
+    Ok(prepared)
+}
 
-        let mut surfaces = create_surfaces(
+#[allow(clippy::too_many_arguments)]
+async fn convert_mesh(
+    base: BaseBuilder,
+    fbx_scene: &FbxScene,
+    resource_manager: ResourceManager,
+    model: &FbxModel,
+    geometries: Vec<PreparedGeometry>,
+    graph: &mut Graph,
+    model_path: &Path,
+    model_import_options: &ModelImportOptions,
+) -> Result<Handle<Node>, FbxError> {
+    let mut mesh_surfaces = Vec::new();
+    let mut mesh_blend_shapes = Vec::new();
+
+    for geometry in geometries {
+        if !mesh_blend_shapes.is_empty() {
+            Log::warn("More than two geoms with blend shapes?");
+        }
+        mesh_blend_shapes = geometry.blend_shapes;
+
+        let surfaces = create_surfaces(
             fbx_scene,
-            data_set,
+            geometry.surfaces,
             resource_manager.clone(),
             model,
             model_path,
@@ -594,15 +725,7 @@ async fn convert_mesh(
         )
         .await?;
 
-        if geom.tangents.is_none() {
-            for surface in surfaces.iter_mut() {
-                surface.data().lock().calculate_tangents().unwrap();
-            }
-        }
-
-        for surface in surfaces {
-            mesh_surfaces.push(surface);
-        }
+        mesh_surfaces.extend(surfaces);
     }
 
     Ok(MeshBuilder::new(base)
@@ -633,6 +756,7 @@ fn convert_model_to_base(model: &FbxModel) -> BaseBuilder {
 async fn convert_model(
     fbx_scene: &FbxScene,
     model: &FbxModel,
+    geometries: Vec<PreparedGeometry>,
     resource_manager: ResourceManager,
     graph: &mut Graph,
     animation: &mut Animation,
@@ -648,6 +772,7 @@ async fn convert_model(
             fbx_scene,
             resource_manager,
             model,
+            geometries,
             graph,
             model_path,
             model_import_options,
@@ -790,18 +915,30 @@ async fn convert(
     scene: &mut Scene,
     model_path: &Path,
     model_import_options: &ModelImportOptions,
+    cancellation_token: &CancellationToken,
+    progress_indicator: &ProgressIndicator<FbxImportStage>,
 ) -> Result<(), FbxError> {
     let root = scene.graph.get_root();
 
+    let mut prepared_geometries =
+        prepare_geometries(fbx_scene, cancellation_token, progress_indicator)?;
+
     let mut animation = Animation::default();
     animation.set_name("Animation");
 
     let mut fbx_model_to_node_map = FxHashMap::default();
     for (component_handle, component) in fbx_scene.pair_iter() {
         if let FbxComponent::Model(model) = component {
+            if cancellation_token.is_cancelled() {
+                return Err(FbxError::Cancelled);
+            }
+
             let node = convert_model(
                 fbx_scene,
                 model,
+                prepared_geometries
+                    .remove(&component_handle)
+                    .unwrap_or_default(),
                 resource_manager.clone(),
                 &mut scene.graph,
                 &mut animation,
@@ -897,6 +1034,30 @@ pub async fn load_to_scene<P: AsRef<Path>>(
     io: &dyn ResourceIo,
     path: P,
     model_import_options: &ModelImportOptions,
+) -> Result<(), FbxError> {
+    load_to_scene_with_progress(
+        scene,
+        resource_manager,
+        io,
+        path,
+        model_import_options,
+        CancellationToken::new(),
+        ProgressIndicator::new(),
+    )
+    .await
+}
+
+/// Same as [`load_to_scene`], but allows you to track the progress of the import and to cancel it.
+/// Parsing, decompression and mesh conversion run in parallel on the global thread pool of rayon,
+/// cancellation is checked between units of work, so it is not immediate.
+pub async fn load_to_scene_with_progress<P: AsRef<Path>>(
+    scene: &mut Scene,
+    resource_manager: ResourceManager,
+    io: &dyn ResourceIo,
+    path: P,
+    model_import_options: &ModelImportOptions,
+    cancellation_token: CancellationToken,
+    progress_indicator: ProgressIndicator<FbxImportStage>,
 ) -> Result<(), FbxError> {
     let start_time = Instant::now();
 
@@ -906,11 +1067,18 @@ pub async fn load_to_scene<P: AsRef<Path>>(
     );
 
     let now = Instant::now();
-    let fbx = FbxDocument::new(path.as_ref(), io).await?;
+    let fbx = FbxDocument::new(path.as_ref(), io, &cancellation_token, &progress_indicator).await?;
     let parsing_time = now.elapsed().as_millis();
 
+    if cancellation_token.is_cancelled() {
+        return Err(FbxError::Cancelled);
+    }
+
     let now = Instant::now();
+    progress_indicator.set_stage(FbxImportStage::DomPreparation, 0);
     let fbx_scene = FbxScene::new(&fbx)?;
+    // The document is not needed anymore, free memory as early as possible.
+    drop(fbx);
     let dom_prepare_time = now.elapsed().as_millis();
 
     let now = Instant::now();
@@ -920,6 +1088,8 @@ pub async fn load_to_scene<P: AsRef<Path>>(
         scene,
         path.as_ref(),
         model_import_options,
+        &cancellation_token,
+        &progress_indicator,
     )
     .await?;
     let conversion_time = now.elapsed().as_millis();
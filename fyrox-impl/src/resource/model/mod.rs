@@ -20,13 +20,16 @@
 
 use crate::{
     asset::{
-        io::ResourceIo, manager::ResourceManager, options::ImportOptions, untyped::ResourceKind,
+        io::ResourceIo,
+        manager::ResourceManager,
+        options::ImportOptions,
+        untyped::{ResourceKind, UntypedResource},
         Resource, ResourceData, MODEL_RESOURCE_UUID,
     },
     core::{
         algebra::{UnitQuaternion, Vector3},
         log::{Log, MessageKind},
-        pool::Handle,
+        pool::{Handle, Ticket},
         reflect::prelude::*,
         uuid::Uuid,
         uuid_provider,
@@ -39,19 +42,25 @@ use crate::{
     graph::{BaseSceneGraph, NodeHandleMap, NodeMapping, PrefabData, SceneGraph, SceneGraphNode},
     resource::fbx::{self, error::FbxError},
     scene::{
-        animation::Animation, base::SceneNodeId, graph::Graph, node::Node, transform::Transform,
+        animation::Animation,
+        base::SceneNodeId,
+        graph::{Graph, ReleasedTicket, SubGraph},
+        node::Node,
+        transform::Transform,
         Scene, SceneLoader,
     },
 };
 use fxhash::FxHashMap;
 use fyrox_ui::{UiNode, UserInterface};
+use rayon::prelude::*;
 use serde::{Deserialize, Serialize};
 use std::{
-    any::Any,
+    any::{Any, TypeId},
+    collections::VecDeque,
     error::Error,
     fmt::{Display, Formatter},
     path::{Path, PathBuf},
-    sync::Arc,
+    sync::{mpsc::Sender, Arc},
 };
 use strum_macros::{AsRefStr, EnumString, VariantNames};
 
@@ -176,6 +185,392 @@ impl<'a, 'b, 'c> InstantiationContext<'a, 'b, 'c> {
     }
 }
 
+// Sends the tickets of the reserved handles back to the graph they were reserved in, so the handles
+// will be vacant again after the next update of the graph.
+fn release_tickets(sender: &Sender<ReleasedTicket>, tickets: impl Iterator<Item = Ticket<Node>>) {
+    for ticket in tickets {
+        // The graph could be destroyed already, the ticket is leaked then.
+        let _ = sender.send(ReleasedTicket::new(ticket));
+    }
+}
+
+/// The first step of two-phase instantiation of a prefab, see
+/// [`ModelResourceExtension::reserve_instance`] for more info. It holds the handles reserved in a
+/// graph for the nodes of the future instance and the instantiation options.
+///
+/// The reservation must be prepared and then committed or cancelled. If it is dropped instead, the
+/// reserved handles will become vacant only on the next update of the graph.
+#[must_use]
+pub struct InstanceReservation {
+    model: ModelResource,
+    handles: Vec<(Ticket<Node>, Handle<Node>)>,
+    ticket_sender: Sender<ReleasedTicket>,
+    parent: Handle<Node>,
+    local_transform: Option<Transform>,
+    ids: Option<FxHashMap<Handle<Node>, SceneNodeId>>,
+    animation_sources: Vec<ModelResource>,
+}
+
+impl Drop for InstanceReservation {
+    fn drop(&mut self) {
+        if !self.handles.is_empty() {
+            Log::warn(format!(
+                "A reservation of an instance of {} was dropped without being prepared \
+                or cancelled!",
+                self.model.kind()
+            ));
+            release_tickets(
+                &self.ticket_sender,
+                self.handles.drain(..).map(|(ticket, _)| ticket),
+            );
+        }
+    }
+}
+
+impl InstanceReservation {
+    /// Sets the desired local rotation for the instance.
+    pub fn with_rotation(mut self, rotation: UnitQuaternion<f32>) -> Self {
+        self.local_transform
+            .get_or_insert_with(Default::default)
+            .set_rotation(rotation);
+        self
+    }
+
+    /// Sets the desired local position for the instance.
+    pub fn with_position(mut self, position: Vector3<f32>) -> Self {
+        self.local_transform
+            .get_or_insert_with(Default::default)
+            .set_position(position);
+        self
+    }
+
+    /// Sets the desired local scaling for the instance.
+    pub fn with_scale(mut self, scale: Vector3<f32>) -> Self {
+        self.local_transform
+            .get_or_insert_with(Default::default)
+            .set_scale(scale);
+        self
+    }
+
+    /// Sets the desired local transform for the instance.
+    pub fn with_transform(mut self, transform: Transform) -> Self {
+        self.local_transform = Some(transform);
+        self
+    }
+
+    /// Sets the desired parent node of the instance. By default, the instance is attached to the root
+    /// of the graph.
+    pub fn with_parent(mut self, parent: Handle<Node>) -> Self {
+        self.parent = parent;
+        self
+    }
+
+    /// Assigns the given set of ids to the respective instances, see [`InstantiationContext::with_ids`]
+    /// for more info.
+    pub fn with_ids(mut self, ids: FxHashMap<Handle<Node>, SceneNodeId>) -> Self {
+        self.ids = Some(ids);
+        self
+    }
+
+    /// Adds a model resource, animations of which will be retargeted to the first animation player
+    /// of the instance. See [`ModelResourceExtension::retarget_animations`] for more info.
+    pub fn with_animation_source(mut self, source: ModelResource) -> Self {
+        self.animation_sources.push(source);
+        self
+    }
+
+    /// Returns a handle that the root node of the instance will have after commit.
+    pub fn root(&self) -> Handle<Node> {
+        self.handles
+            .first()
+            .map(|(_, handle)| *handle)
+            .unwrap_or_default()
+    }
+
+    /// Performs the heavy part of the instantiation: copies the nodes of the prefab, remaps handles
+    /// and retargets animations. It does not need access to the graph, so it could be done on any
+    /// thread. The result must be committed to the graph, from which the handles were reserved.
+    pub fn prepare(mut self) -> PreparedInstance {
+        let model = self.model.clone();
+        let handles = std::mem::take(&mut self.handles);
+        let local_transform = self.local_transform.take();
+        let ids = self.ids.take();
+        let animation_sources = std::mem::take(&mut self.animation_sources);
+
+        // Copy the nodes of the prefab in pre-order, it is the same order that is used by the search
+        // methods of the graph, so the animation retargeting below finds the same nodes as it does in
+        // a graph. The resource is locked only for copying, so multiple instances of the same prefab
+        // could be prepared in parallel.
+        let (resource_root, mut originals) = {
+            let data = model.data_ref();
+            let prefab_graph = &data.scene.graph;
+            let resource_root = prefab_graph.get_root();
+
+            let mut originals = Vec::with_capacity(handles.len());
+            let mut stack = vec![resource_root];
+            while let Some(handle) = stack.pop() {
+                if let Some(node) = prefab_graph.try_get(handle) {
+                    originals.push((handle, node.clone_box()));
+                    stack.extend(node.children().iter().rev());
+                }
+            }
+
+            (resource_root, originals)
+        };
+
+        if originals.len() != handles.len() {
+            Log::warn(format!(
+                "Prefab {} was changed after an instance of it was reserved. \
+                The instance could be incomplete.",
+                model.kind()
+            ));
+            originals.truncate(handles.len());
+        }
+
+        let mut old_new_mapping = NodeHandleMap::default();
+        for ((original, _), (_, handle)) in originals.iter().zip(handles.iter()) {
+            old_new_mapping.insert(*original, *handle);
+        }
+
+        let mut nodes = Vec::with_capacity(handles.len());
+        let mut handles = handles.into_iter();
+        for ((original, mut node), (ticket, handle)) in originals.into_iter().zip(handles.by_ref())
+        {
+            node.parent = if original == resource_root {
+                Handle::NONE
+            } else {
+                old_new_mapping
+                    .inner()
+                    .get(&node.parent())
+                    .cloned()
+                    .unwrap_or_default()
+            };
+            node.children = node
+                .children()
+                .iter()
+                .filter_map(|child| old_new_mapping.inner().get(child).cloned())
+                .collect();
+            node.self_handle = handle;
+            node.hierarchy_dirty.set(true);
+
+            if original == resource_root {
+                if let Some(transform) = local_transform.clone() {
+                    *node.local_transform_mut() = transform;
+                }
+            }
+
+            if let Some(ids) = ids.as_ref() {
+                if let Some(id) = ids.get(&original) {
+                    node.instance_id = *id;
+                } else {
+                    Log::warn(format!(
+                        "No id specified for node {}! Random id will be used.",
+                        original
+                    ))
+                }
+            }
+
+            node.set_inheritance_data(original, model.clone());
+
+            old_new_mapping.remap_handles(&mut node, &[TypeId::of::<UntypedResource>()]);
+
+            nodes.push((ticket, node));
+        }
+
+        if !animation_sources.is_empty() {
+            let mut animations = Vec::new();
+            {
+                // The first node with a name wins, this matches `Graph::find_by_name`.
+                let mut names = FxHashMap::default();
+                for (_, node) in nodes.iter() {
+                    names.entry(node.name()).or_insert(node.self_handle);
+                }
+
+                for source in animation_sources {
+                    let mut header = source.state();
+                    let self_kind = header.kind().clone();
+                    if let Some(source_model) = header.data() {
+                        animations.extend(
+                            source_model.retarget_animations_with(self_kind, &mut |name| {
+                                names.get(name).cloned()
+                            }),
+                        );
+                    }
+                }
+            }
+
+            if let Some(dest_animations) = nodes.iter_mut().find_map(|(_, node)| {
+                node.component_mut::<InheritableVariable<AnimationContainer<Handle<Node>>>>()
+            }) {
+                for animation in animations {
+                    dest_animations.add(animation);
+                }
+            } else if !animations.is_empty() {
+                Log::warn(format!(
+                    "Unable to retarget animations to an instance of {}, because it does not \
+                    have an animation player.",
+                    model.kind()
+                ))
+            }
+        }
+
+        PreparedInstance {
+            model,
+            nodes,
+            unused_handles: handles.map(|(ticket, _)| ticket).collect(),
+            ticket_sender: self.ticket_sender.clone(),
+            parent: self.parent,
+        }
+    }
+
+    /// Prepares the given set of reservations in parallel. See [`Self::prepare`] for more info.
+    pub fn prepare_all(reservations: Vec<Self>) -> Vec<PreparedInstance> {
+        reservations
+            .into_par_iter()
+            .map(InstanceReservation::prepare)
+            .collect()
+    }
+
+    /// Cancels the instantiation and makes the reserved handles vacant again.
+    pub fn cancel(mut self, graph: &mut Graph) {
+        for (ticket, _) in self.handles.drain(..) {
+            graph.forget_reserved_handle(ticket);
+        }
+    }
+}
+
+/// An instance of a prefab that is ready to be added to a graph, see
+/// [`ModelResourceExtension::reserve_instance`] for more info. The instance must be committed or
+/// cancelled. If it is dropped instead, its handles will become vacant only on the next update of
+/// the graph.
+#[must_use]
+pub struct PreparedInstance {
+    model: ModelResource,
+    // The root node goes first.
+    nodes: Vec<(Ticket<Node>, Node)>,
+    unused_handles: Vec<Ticket<Node>>,
+    ticket_sender: Sender<ReleasedTicket>,
+    parent: Handle<Node>,
+}
+
+impl Drop for PreparedInstance {
+    fn drop(&mut self) {
+        if !self.nodes.is_empty() || !self.unused_handles.is_empty() {
+            Log::warn(format!(
+                "A prepared instance of {} was dropped without being committed or cancelled!",
+                self.model.kind()
+            ));
+            release_tickets(
+                &self.ticket_sender,
+                self.nodes
+                    .drain(..)
+                    .map(|(ticket, _)| ticket)
+                    .chain(self.unused_handles.drain(..)),
+            );
+        }
+    }
+}
+
+impl PreparedInstance {
+    /// Returns a handle that the root node of the instance will have after commit.
+    pub fn root(&self) -> Handle<Node> {
+        self.nodes
+            .first()
+            .map(|(_, node)| node.self_handle)
+            .unwrap_or_default()
+    }
+
+    /// Returns the amount of nodes in the instance.
+    pub fn node_count(&self) -> usize {
+        self.nodes.len()
+    }
+
+    /// Adds the instance to the graph, from which its handles were reserved. This is a cheap
+    /// operation, it just moves the nodes into the graph and updates their hierarchical data.
+    pub fn commit(mut self, graph: &mut Graph) -> Handle<Node> {
+        for ticket in self.unused_handles.drain(..) {
+            graph.forget_reserved_handle(ticket);
+        }
+
+        let mut nodes = std::mem::take(&mut self.nodes).into_iter();
+        let Some(root) = nodes.next() else {
+            return Handle::NONE;
+        };
+
+        let root = graph.put_new_sub_graph(SubGraph {
+            root,
+            descendants: nodes.collect(),
+            parent: self.parent,
+        });
+
+        graph.update_hierarchical_data_for_descendants(root);
+
+        // Explicitly mark as root node.
+        graph[root].is_resource_instance_root = true;
+
+        root
+    }
+
+    /// Cancels the instantiation and makes the reserved handles vacant again.
+    pub fn cancel(mut self, graph: &mut Graph) {
+        for (ticket, _) in self.nodes.drain(..) {
+            graph.forget_reserved_handle(ticket);
+        }
+        for ticket in self.unused_handles.drain(..) {
+            graph.forget_reserved_handle(ticket);
+        }
+    }
+}
+
+/// A queue of prepared instances, that amortizes their addition to a graph over multiple frames.
+/// It is useful when a lot of prefabs must be instantiated at once (for example, when streaming a
+/// part of a level), so the frame time does not spike.
+#[derive(Default)]
+pub struct InstanceCommitQueue {
+    queue: VecDeque<PreparedInstance>,
+}
+
+impl InstanceCommitQueue {
+    /// Adds a prepared instance to the end of the queue.
+    pub fn push(&mut self, instance: PreparedInstance) {
+        self.queue.push_back(instance);
+    }
+
+    /// Returns the amount of instances in the queue.
+    pub fn len(&self) -> usize {
+        self.queue.len()
+    }
+
+    /// Returns `true` if the queue is empty.
+    pub fn is_empty(&self) -> bool {
+        self.queue.is_empty()
+    }
+
+    /// Commits instances from the queue to the graph, until the total amount of committed nodes
+    /// reaches the given budget. At least one instance is committed per call (if the queue is not
+    /// empty), so large instances do not block the queue. Returns handles of the committed instances.
+    pub fn commit(&mut self, graph: &mut Graph, node_budget: usize) -> Vec<Handle<Node>> {
+        let mut committed = Vec::new();
+        let mut node_count = 0;
+        while let Some(instance) = self.queue.front() {
+            if !committed.is_empty() && node_count + instance.node_count() > node_budget {
+                break;
+            }
+            node_count += instance.node_count();
+            let instance = self.queue.pop_front().unwrap();
+            committed.push(instance.commit(graph));
+        }
+        committed
+    }
+
+    /// Cancels every instance in the queue.
+    pub fn cancel_all(&mut self, graph: &mut Graph) {
+        for instance in self.queue.drain(..) {
+            instance.cancel(graph);
+        }
+    }
+}
+
 /// Common trait that has animation retargetting methods.
 pub trait AnimationSource {
     /// Prefab type.
@@ -215,6 +610,22 @@ pub trait AnimationSource {
         graph: &Self::SceneGraph,
         self_kind: ResourceKind,
     ) -> Vec<fyrox_animation::Animation<Handle<Self::Node>>> {
+        self.retarget_animations_with(self_kind, &mut |name| {
+            graph.find_by_name(root, name).map(|(handle, _)| handle)
+        })
+    }
+
+    /// Does the same as [`Self::retarget_animations_directly`], but uses the given function to
+    /// find instance nodes by the names of the nodes of the source. It could be used to retarget
+    /// animations to a hierarchy of nodes that is not (yet) a part of any graph.
+    fn retarget_animations_with<F>(
+        &self,
+        self_kind: ResourceKind,
+        find_by_name: &mut F,
+    ) -> Vec<fyrox_animation::Animation<Handle<Self::Node>>>
+    where
+        F: FnMut(&str) -> Option<Handle<Self::Node>>,
+    {
         let mut retargetted_animations = Vec::new();
 
         let model_graph = self.inner_graph();
@@ -232,8 +643,8 @@ pub trait AnimationSource {
                         let ref_node = &model_graph.node(ref_track.target());
                         let track = &mut anim_copy.tracks_mut()[i];
                         // Find instantiated node that corresponds to node in resource
-                        match graph.find_by_name(root, ref_node.name()) {
-                            Some((instance_node, _)) => {
+                        match find_by_name(ref_node.name()) {
+                            Some(instance_node) => {
                                 // One-to-one track mapping so there is [i] indexing.
                                 track.set_target(instance_node);
                             }
@@ -339,6 +750,29 @@ pub trait ModelResourceExtension: Sized {
     /// Tries to instantiate model from given resource.
     fn instantiate(&self, dest_scene: &mut Scene) -> Handle<Node>;
 
+    /// Begins two-phase instantiation of the model. Regular instantiation does everything at once on
+    /// the main thread, which could take a lot of time for large prefabs. Two-phase instantiation
+    /// splits the process in three steps:
+    ///
+    /// 1) Reservation - this method reserves handles in the given graph for every node of the
+    /// future instance. It is very cheap and must be done on the main thread.
+    /// 2) Preparation - [`InstanceReservation::prepare`] copies the nodes, remaps handles and
+    /// retargets animations. It is the heaviest part and it could be done on any thread, because it
+    /// does not need the graph. Use [`InstanceReservation::prepare_all`] to prepare multiple
+    /// instances in parallel.
+    /// 3) Commit - [`PreparedInstance::commit`] moves the nodes into the graph. It is cheap and must
+    /// be done on the main thread. Use [`InstanceCommitQueue`] to spread the commits of multiple
+    /// instances over multiple frames.
+    ///
+    /// The result is the same as of [`Self::begin_instantiation`]. Reserved handles are invalid until
+    /// the instance is committed, every reservation must be either committed or cancelled before
+    /// the graph is saved or destroyed.
+    ///
+    /// # Panic
+    ///
+    /// Panics if the model is not loaded.
+    fn reserve_instance(&self, dest_graph: &mut Graph) -> InstanceReservation;
+
     /// Instantiates a prefab and places it at specified position and orientation in global coordinates.
     fn instantiate_at(
         &self,
@@ -461,6 +895,24 @@ impl ModelResourceExtension for ModelResource {
         self.begin_instantiation(dest_scene).finish()
     }
 
+    fn reserve_instance(&self, dest_graph: &mut Graph) -> InstanceReservation {
+        let node_count = {
+            let data = self.data_ref();
+            let graph = &data.scene.graph;
+            graph.traverse_handle_iter(graph.get_root()).count()
+        };
+
+        InstanceReservation {
+            model: self.clone(),
+            handles: dest_graph.reserve_handles(node_count),
+            ticket_sender: dest_graph.released_ticket_sender(),
+            parent: Handle::NONE,
+            local_transform: None,
+            ids: None,
+            animation_sources: Vec::new(),
+        }
+    }
+
     fn instantiate_at(
         &self,
         scene: &mut Scene,
@@ -0,0 +1,254 @@
+//! Persistent cache of imported textures. See [`TextureImportCache`] docs for more info.
+
+use crate::{
+    asset::io::ResourceIo,
+    core::{
+        log::Log,
+        visitor::{Visit, VisitResult, Visitor},
+    },
+    resource::texture::{data_hash, Texture, TextureImportOptions},
+};
+use fxhash::FxHasher;
+use std::{
+    hash::{Hash, Hasher},
+    path::{Path, PathBuf},
+    sync::{
+        atomic::{AtomicBool, Ordering},
+        Arc,
+    },
+};
+
+/// Directory of the texture import cache relative to a project root, see
+/// [`TextureImportCache::for_project`].
+pub const TEXTURE_IMPORT_CACHE_DIR: &str = ".cache/textures";
+
+/// Version of the cache entries, must be increased every time when the import process changes its
+/// output for the same input.
+const CACHE_VERSION: u32 = 1;
+
+const CACHE_EXTENSION: &str = "texcache";
+
+/// Identifies a cache entry. It depends on the content of the source file and only on the import
+/// options that affect the content of the imported texture. Sampler options (filters, wrap modes,
+/// anisotropy) are applied after loading, so changing them does not invalidate the cache.
+#[derive(Default, Clone, Debug, PartialEq, Eq)]
+pub(crate) struct TextureCacheKey {
+    source_length: u64,
+    source_hash: u64,
+    options_hash: u64,
+}
+
+impl TextureCacheKey {
+    pub(crate) fn new(source: &[u8], options: &TextureImportOptions) -> Self {
+        let mut hasher = FxHasher::default();
+        CACHE_VERSION.hash(&mut hasher);
+        options.flip_green_channel.hash(&mut hasher);
+        options
+            .minification_filter
+            .is_using_mip_mapping()
+            .hash(&mut hasher);
+        (options.compression as u32).hash(&mut hasher);
+        (options.mip_filter as u32).hash(&mut hasher);
+
+        Self {
+            source_length: source.len() as u64,
+            source_hash: data_hash(source),
+            options_hash: hasher.finish(),
+        }
+    }
+
+    fn visit(&mut self, visitor: &mut Visitor) -> VisitResult {
+        let mut region = visitor.enter_region("Key")?;
+        self.source_length.visit("SourceLength", &mut region)?;
+        self.source_hash.visit("SourceHash", &mut region)?;
+        self.options_hash.visit("OptionsHash", &mut region)
+    }
+}
+
+/// Persistent on-disk cache of imported textures. Import of a texture could be very slow: the source
+/// image must be decoded, mip levels must be generated and optionally compressed. The cache stores the
+/// final GPU-ready content of every imported texture (pixel kind, mip chain, compressed blocks), so the
+/// next import of the same file with the same options is just a single read of the cache entry.
+///
+/// Cache entries are identified by the hash of the source file content and the import options, so
+/// they're invalidated automatically when the source file or its import options are changed. Stale
+/// entries are never deleted automatically, the cache directory could be safely deleted at any time.
+///
+/// The cache uses [`ResourceIo`] to read and write its entries, if the IO does not support writing
+/// (see [`ResourceIo::write_file`]), the cache will never be filled. The first failed write disables
+/// writing for the cache (and all its clones), so read-only installations do not spam the log.
+///
+/// The cache is disabled by default, because the engine cannot know where a game is allowed to write.
+/// It could be enabled by setting [`crate::resource::texture::loader::TextureLoader::import_cache`]:
+///
+/// ```rust
+/// # use fyrox_impl::{
+/// #     asset::manager::ResourceManager,
+/// #     resource::texture::{import_cache::TextureImportCache, loader::TextureLoader},
+/// # };
+/// # use std::path::Path;
+/// fn enable_texture_import_cache(resource_manager: &ResourceManager, project_root: &Path) {
+///     if let Some(loader) = resource_manager
+///         .state()
+///         .loaders
+///         .find_mut::<TextureLoader>()
+///     {
+///         loader.import_cache = Some(TextureImportCache::for_project(project_root));
+///     }
+/// }
+/// ```
+#[derive(Clone, Debug)]
+pub struct TextureImportCache {
+    directory: PathBuf,
+    write_failed: Arc<AtomicBool>,
+}
+
+impl TextureImportCache {
+    /// Creates a new cache that stores its entries in the given directory. The directory should be
+    /// absolute, relative paths are resolved against the current working directory on every access.
+    pub fn new<P: Into<PathBuf>>(directory: P) -> Self {
+        Self {
+            directory: directory.into(),
+            write_failed: Default::default(),
+        }
+    }
+
+    /// Creates a new cache that stores its entries in [`TEXTURE_IMPORT_CACHE_DIR`] of the given
+    /// project root.
+    pub fn for_project<P: AsRef<Path>>(project_root: P) -> Self {
+        Self::new(project_root.as_ref().join(TEXTURE_IMPORT_CACHE_DIR))
+    }
+
+    /// Returns a directory in which the cache stores its entries.
+    pub fn directory(&self) -> &Path {
+        &self.directory
+    }
+
+    fn entry_path(&self, key: &TextureCacheKey) -> PathBuf {
+        self.directory.join(format!(
+            "{:016x}{:016x}.{}",
+            key.source_hash, key.options_hash, CACHE_EXTENSION
+        ))
+    }
+
+    /// Tries to load a texture from the cache. Returns `None` if there's no valid entry for the key.
+    pub(crate) async fn load(&self, key: &TextureCacheKey, io: &dyn ResourceIo) -> Option<Texture> {
+        let data = io.load_file(&self.entry_path(key)).await.ok()?;
+        let mut visitor = Visitor::load_from_vec(data).ok()?;
+
+        let mut version = 0u32;
+        version.visit("Version", &mut visitor).ok()?;
+        let mut stored_key = TextureCacheKey::default();
+        stored_key.visit(&mut visitor).ok()?;
+        if version != CACHE_VERSION || stored_key != *key {
+            return None;
+        }
+
+        let mut texture = Texture::default();
+        texture.visit("Texture", &mut visitor).ok()?;
+        texture.data_hash.visit("DataHash", &mut visitor).ok()?;
+        if texture.bytes.is_empty() {
+            return None;
+        }
+
+        Some(texture)
+    }
+
+    /// Writes the texture to the cache. Errors are not fatal, they're just logged.
+    pub(crate) async fn store(
+        &self,
+        key: &TextureCacheKey,
+        texture: &mut Texture,
+        io: &dyn ResourceIo,
+    ) {
+        if self.write_failed.load(Ordering::Relaxed) {
+            return;
+        }
+
+        let path = self.entry_path(key);
+
+        // Visitor is not `Send`, so it must be dropped before any `await`.
+        let result = {
+            let mut visitor = Visitor::new();
+            let mut version = CACHE_VERSION;
+            let mut key = key.clone();
+            version
+                .visit("Version", &mut visitor)
+                .and_then(|_| key.visit(&mut visitor))
+                .and_then(|_| texture.visit("Texture", &mut visitor))
+                .and_then(|_| texture.data_hash.visit("DataHash", &mut visitor))
+                .and_then(|_| visitor.save_binary_to_vec())
+        };
+
+        match result {
+            Ok(data) => {
+                if let Err(err) = io.write_file(&path, data).await {
+                    if !self.write_failed.swap(true, Ordering::Relaxed) {
+                        Log::warn(format!(
+                            "Unable to write texture import cache entry {}, the cache will not be \
+                            filled anymore. Reason: {:?}",
+                            path.display(),
+                            err
+                        ))
+                    }
+                }
+            }
+            Err(err) => Log::warn(format!(
+                "Unable to serialize texture import cache entry {}. Reason: {:?}",
+                path.display(),
+                err
+            )),
+        }
+    }
+}
+
+#[cfg(test)]
+mod test {
+    use super::*;
+    use crate::{
+        asset::io::FsResourceIo,
+        core::futures::executor::block_on,
+        resource::texture::{CompressionOptions, TextureMinificationFilter, TexturePixelKind},
+    };
+    use image::{ImageOutputFormat, Rgba, RgbaImage};
+    use std::io::Cursor;
+
+    #[test]
+    fn texture_import_cache_round_trip() {
+        let mut source = Vec::new();
+        RgbaImage::from_fn(16, 16, |x, y| Rgba([x as u8 * 16, y as u8 * 16, 0, 255]))
+            .write_to(&mut Cursor::new(&mut source), ImageOutputFormat::Png)
+            .unwrap();
+
+        let directory = std::env::temp_dir().join("fyrox_texture_import_cache_test");
+        let _ = std::fs::remove_dir_all(&directory);
+        let cache = TextureImportCache::new(&directory);
+        let io = FsResourceIo;
+
+        let options = TextureImportOptions::default().with_compression(CompressionOptions::Speed);
+        let key = TextureCacheKey::new(&source, &options);
+        assert!(block_on(cache.load(&key, &io)).is_none());
+
+        let mut imported = Texture::load_from_memory(&source, options.clone()).unwrap();
+        block_on(cache.store(&key, &mut imported, &io));
+
+        let cached = block_on(cache.load(&key, &io)).unwrap();
+        assert_eq!(cached.pixel_kind, TexturePixelKind::DXT1RGBA);
+        assert_eq!(cached.kind.rectangle_size(), imported.kind.rectangle_size());
+        assert_eq!(cached.mip_count, imported.mip_count);
+        assert_eq!(cached.data_hash, imported.data_hash);
+        assert_eq!(cached.bytes.as_slice(), imported.bytes.as_slice());
+
+        // Sampler options must not affect the key, but the content options must.
+        let sampler_options = options
+            .clone()
+            .with_minification_filter(TextureMinificationFilter::LinearMipMapNearest);
+        assert_eq!(TextureCacheKey::new(&source, &sampler_options), key);
+        let other_options = options.with_compression(CompressionOptions::NoCompression);
+        assert!(
+            block_on(cache.load(&TextureCacheKey::new(&source, &other_options), &io)).is_none()
+        );
+
+        let _ = std::fs::remove_dir_all(&directory);
+    }
+}
@@ -10,7 +10,7 @@ use crate::{
         state::LoadError,
     },
     core::{uuid::Uuid, TypeUuidProvider},
-    resource::texture::{Texture, TextureImportOptions},
+    resource::texture::{import_cache::TextureImportCache, Texture, TextureImportOptions},
 };
 use std::{path::PathBuf, sync::Arc};
 
@@ -18,6 +18,9 @@ use std::{path::PathBuf, sync::Arc};
 pub struct TextureLoader {
     /// Default import options for textures.
     pub default_import_options: TextureImportOptions,
+    /// Optional persistent cache of imported textures. It makes repeated imports of the same textures
+    /// much faster, see [`TextureImportCache`] docs for more info. It is disabled by default.
+    pub import_cache: Option<TextureImportCache>,
 }
 
 impl ResourceLoader for TextureLoader {
@@ -33,6 +36,7 @@ impl ResourceLoader for TextureLoader {
 
     fn load(&self, path: PathBuf, io: Arc<dyn ResourceIo>) -> BoxedLoaderFuture {
         let default_import_options = self.default_import_options.clone();
+        let import_cache = self.import_cache.clone();
         Box::pin(async move {
             let io = io.as_ref();
 
@@ -40,9 +44,10 @@ impl ResourceLoader for TextureLoader {
                 .await
                 .unwrap_or(default_import_options);
 
-            let raw_texture = Texture::load_from_file(&path, io, import_options)
-                .await
-                .map_err(LoadError::new)?;
+            let raw_texture =
+                Texture::load_from_file(&path, io, import_options, import_cache.as_ref())
+                    .await
+                    .map_err(LoadError::new)?;
 
             Ok(LoaderPayload::new(raw_texture))
         })
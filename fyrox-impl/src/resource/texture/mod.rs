@@ -28,7 +28,7 @@ use crate::{
         io::FileLoadError,
         reflect::prelude::*,
         uuid::Uuid,
-        visitor::{PodVecView, Visit, VisitError, VisitResult, Visitor},
+        visitor::{BlobCompression, PodVecView, Visit, VisitError, VisitResult, Visitor},
         TypeUuidProvider,
     },
 };
@@ -41,6 +41,7 @@ use fyrox_core::uuid_provider;
 use fyrox_resource::io::ResourceIo;
 use fyrox_resource::untyped::ResourceKind;
 use image::{ColorType, DynamicImage, ImageError, ImageFormat, Pixel};
+use import_cache::{TextureCacheKey, TextureImportCache};
 use lazy_static::lazy_static;
 use serde::{Deserialize, Serialize};
 use std::sync::Arc;
@@ -55,6 +56,7 @@ use std::{
 };
 use strum_macros::{AsRefStr, EnumString, VariantNames};
 
+pub mod import_cache;
 pub mod loader;
 
 /// Texture kind.
@@ -347,7 +349,10 @@ impl Visit for Texture {
         self.t_wrap_mode.visit("TWrapMode", &mut region)?;
         self.mip_count.visit("MipCount", &mut region)?;
         self.kind.visit("Kind", &mut region)?;
-        let mut bytes_view = PodVecView::from_pod_vec(&mut self.bytes);
+        // Only procedural textures (height maps, masks, lightmaps, etc.) are embedded, they usually
+        // have lots of repetitive data and compress well.
+        let mut bytes_view =
+            PodVecView::from_pod_vec(&mut self.bytes).with_compression(BlobCompression::Lz4);
         let _ = bytes_view.visit("Data", &mut region);
 
         Ok(())
@@ -1522,7 +1527,8 @@ impl Texture {
         }
     }
 
-    /// Tries to load a texture from a file.
+    /// Tries to load a texture from a file. If the import cache is specified, the imported texture
+    /// is taken from the cache (or put into it), see [`TextureImportCache`] for more info.
     ///
     /// # Notes
     ///
@@ -1532,9 +1538,33 @@ impl Texture {
         path: P,
         io: &dyn ResourceIo,
         import_options: TextureImportOptions,
+        import_cache: Option<&TextureImportCache>,
     ) -> Result<Self, TextureError> {
         let data = io.load_file(path.as_ref()).await?;
-        Self::load_from_memory(&data, import_options)
+
+        // DDS textures are loaded as is, there's nothing to cache.
+        match import_cache {
+            Some(import_cache) if !data.starts_with(b"DDS ") => {
+                let key = TextureCacheKey::new(&data, &import_options);
+                if let Some(mut texture) = import_cache.load(&key, io).await {
+                    texture.apply_sampler_options(&import_options);
+                    return Ok(texture);
+                }
+
+                let mut texture = Self::load_from_memory(&data, import_options)?;
+                import_cache.store(&key, &mut texture, io).await;
+                Ok(texture)
+            }
+            _ => Self::load_from_memory(&data, import_options),
+        }
+    }
+
+    fn apply_sampler_options(&mut self, import_options: &TextureImportOptions) {
+        self.minification_filter = import_options.minification_filter;
+        self.magnification_filter = import_options.magnification_filter;
+        self.s_wrap_mode = import_options.s_wrap_mode;
+        self.t_wrap_mode = import_options.t_wrap_mode;
+        self.anisotropy = import_options.anisotropy;
     }
 
     /// Creates new texture instance from given parameters.
@@ -3,11 +3,14 @@
 use crate::{
     core::{
         algebra::Vector3,
-        math::aabb::AxisAlignedBoundingBox,
+        math::{aabb::AxisAlignedBoundingBox, bvh::DynamicBvh, frustum::Frustum, ray::Ray},
         pool::{Handle, Pool},
     },
     graph::SceneGraph,
-    scene::{graph::Graph, node::Node},
+    scene::{
+        graph::{Graph, NodePool},
+        node::Node,
+    },
 };
 
 #[allow(dead_code)]
@@ -182,3 +185,201 @@ fn build_recursive(
         nodes.spawn(OctreeNode::Branch { leaves, bounds })
     }
 }
+
+#[derive(Copy, Clone, Debug, Default)]
+enum IndexSlot {
+    #[default]
+    Vacant,
+    Unbounded(Handle<Node>),
+    Bounded(Handle<Node>, u32),
+}
+
+/// Returns `true` if the given local bounding box of a node is empty, which means that the node has
+/// nothing to render. It is the default bounding box of [`crate::scene::base::Base`], that is used by
+/// pivots, cameras, lights, physical entities, etc.
+pub(crate) fn is_empty_bounds(aabb: &AxisAlignedBoundingBox) -> bool {
+    aabb.min
+        .iter()
+        .zip(aabb.max.iter())
+        .any(|(min, max)| min > max)
+}
+
+/// Returns `true` if the given bounding box could be put in a spatial index. Nodes without any
+/// bounds produce either invalid or infinitely large bounding boxes.
+pub(crate) fn is_indexable(aabb: &AxisAlignedBoundingBox) -> bool {
+    let size = aabb.max - aabb.min;
+    size.iter().all(|s| s.is_finite() && *s >= 0.0)
+        && aabb.min.iter().all(|c| c.is_finite())
+        && aabb.max.iter().all(|c| c.is_finite())
+}
+
+/// Persistent spatial index of scene nodes. It is a dynamic bounding volume hierarchy of world-space
+/// bounding boxes of scene nodes, which is maintained by the graph and refreshed at the end of each
+/// [`Graph::update`] call. Only nodes that have moved out of their "fat" bounding boxes are
+/// re-inserted in the hierarchy, so the cost of refreshing the index for static scenes is just a
+/// linear scan over the nodes.
+///
+/// Nodes with empty local bounding box (see [`crate::scene::base::Base::local_bounding_box`]) have
+/// nothing to render and they're not indexed at all. Nodes with unknown bounds (their world bounding
+/// box is invalid or infinite) are stored in a separate list of "unbounded" nodes, that must be
+/// visited by every spatial query that needs to find every potentially visible node.
+///
+/// The index becomes outdated when a node is added to or removed from the graph, in this case the
+/// graph does not provide access to the index until the next update.
+#[derive(Default, Debug)]
+pub struct SpatialIndex {
+    bvh: DynamicBvh<Handle<Node>>,
+    // Indexed by handle indices.
+    slots: Vec<IndexSlot>,
+    unbounded: Vec<Handle<Node>>,
+    lod_group_owners: Vec<Handle<Node>>,
+    up_to_date: bool,
+}
+
+impl SpatialIndex {
+    /// Returns `true` if the index matches the current state of the graph.
+    #[inline]
+    pub fn is_up_to_date(&self) -> bool {
+        self.up_to_date
+    }
+
+    /// Marks the index as outdated.
+    #[inline]
+    pub fn invalidate(&mut self) {
+        self.up_to_date = false;
+    }
+
+    /// Removes everything from the index and marks it as outdated.
+    pub fn clear(&mut self) {
+        self.bvh.clear();
+        self.slots.clear();
+        self.unbounded.clear();
+        self.lod_group_owners.clear();
+        self.up_to_date = false;
+    }
+
+    /// Synchronizes the index with the current world bounding boxes of the nodes.
+    pub fn refresh(&mut self, nodes: &NodePool) {
+        self.unbounded.clear();
+        self.lod_group_owners.clear();
+
+        let capacity = nodes.get_capacity() as usize;
+        for slot in self.slots.drain(capacity.min(self.slots.len())..) {
+            if let IndexSlot::Bounded(_, proxy) = slot {
+                self.bvh.remove(proxy);
+            }
+        }
+        self.slots.resize(capacity, IndexSlot::Vacant);
+
+        for (index, slot) in self.slots.iter_mut().enumerate() {
+            let handle = nodes.handle_from_index(index as u32);
+            let node = nodes.try_borrow(handle);
+
+            // Remove entries of the nodes that were freed since last refresh.
+            match *slot {
+                IndexSlot::Bounded(slot_handle, proxy)
+                    if slot_handle != handle || node.is_none() =>
+                {
+                    self.bvh.remove(proxy);
+                    *slot = IndexSlot::Vacant;
+                }
+                IndexSlot::Unbounded(_) => *slot = IndexSlot::Vacant,
+                _ => (),
+            }
+
+            let Some(node) = node else {
+                continue;
+            };
+
+            if node.lod_group().is_some() {
+                self.lod_group_owners.push(handle);
+            }
+
+            if is_empty_bounds(&node.local_bounding_box()) {
+                if let IndexSlot::Bounded(_, proxy) = *slot {
+                    self.bvh.remove(proxy);
+                }
+                *slot = IndexSlot::Vacant;
+                continue;
+            }
+
+            let aabb = node.world_bounding_box();
+            if is_indexable(&aabb) {
+                match *slot {
+                    IndexSlot::Bounded(_, proxy) => {
+                        self.bvh.move_proxy(proxy, aabb);
+                    }
+                    _ => *slot = IndexSlot::Bounded(handle, self.bvh.insert(aabb, handle)),
+                }
+            } else {
+                if let IndexSlot::Bounded(_, proxy) = *slot {
+                    self.bvh.remove(proxy);
+                }
+                *slot = IndexSlot::Unbounded(handle);
+                self.unbounded.push(handle);
+            }
+        }
+
+        self.up_to_date = true;
+    }
+
+    /// Returns a list of nodes that have no bounds.
+    #[inline]
+    pub fn unbounded(&self) -> &[Handle<Node>] {
+        &self.unbounded
+    }
+
+    /// Returns `true` if the given node is in the index (either bounded or not).
+    #[inline]
+    pub fn is_indexed(&self, handle: Handle<Node>) -> bool {
+        match self.slots.get(handle.index() as usize) {
+            Some(IndexSlot::Bounded(slot_handle, _)) | Some(IndexSlot::Unbounded(slot_handle)) => {
+                *slot_handle == handle
+            }
+            _ => false,
+        }
+    }
+
+    /// Returns a list of nodes that have LOD groups.
+    #[inline]
+    pub fn lod_group_owners(&self) -> &[Handle<Node>] {
+        &self.lod_group_owners
+    }
+
+    /// Returns a reference to the underlying bounding volume hierarchy.
+    #[inline]
+    pub fn bvh(&self) -> &DynamicBvh<Handle<Node>> {
+        &self.bvh
+    }
+
+    /// Visits every bounded node, which "fat" bounding box intersects the given frustum. Unbounded
+    /// nodes are not visited.
+    #[inline]
+    pub fn frustum_query(&self, frustum: &Frustum, mut func: impl FnMut(Handle<Node>)) {
+        self.bvh.frustum_query(frustum, |_, handle| func(*handle))
+    }
+
+    /// Visits every bounded node, which "fat" bounding box intersects the given bounding box.
+    #[inline]
+    pub fn aabb_query(&self, aabb: &AxisAlignedBoundingBox, mut func: impl FnMut(Handle<Node>)) {
+        self.bvh.aabb_query(aabb, |_, handle| func(*handle))
+    }
+
+    /// Visits every bounded node, which "fat" bounding box intersects the given sphere.
+    #[inline]
+    pub fn sphere_query(
+        &self,
+        position: Vector3<f32>,
+        radius: f32,
+        mut func: impl FnMut(Handle<Node>),
+    ) {
+        self.bvh
+            .sphere_query(position, radius, |_, handle| func(*handle))
+    }
+
+    /// Visits every bounded node, which "fat" bounding box is intersected by the given ray.
+    #[inline]
+    pub fn ray_query(&self, ray: &Ray, mut func: impl FnMut(Handle<Node>)) {
+        self.bvh.ray_query(ray, |_, handle| func(*handle))
+    }
+}
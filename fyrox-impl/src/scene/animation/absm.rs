@@ -195,6 +195,10 @@ pub struct AnimationBlendingStateMachine {
     base: Base,
     machine: InheritableVariable<Machine>,
     animation_player: InheritableVariable<Handle<Node>>,
+    // Set when the pose was already evaluated in parallel (see `evaluate_animations_in_parallel`).
+    #[reflect(hidden)]
+    #[visit(skip)]
+    evaluated: bool,
 }
 
 impl AnimationBlendingStateMachine {
@@ -224,6 +228,20 @@ impl AnimationBlendingStateMachine {
     pub fn animation_player(&self) -> Handle<Node> {
         *self.animation_player
     }
+
+    // Evaluates the pose of the machine, but postpones applying of the pose to the next update of
+    // the node.
+    pub(super) fn evaluate(&mut self, animation_player: &mut AnimationPlayer, dt: f32) {
+        animation_player.set_auto_apply(false);
+        self.machine
+            .get_value_mut_silent()
+            .evaluate_pose(animation_player.animations.get_value_mut_silent(), dt);
+        self.evaluated = true;
+    }
+
+    pub(super) fn discard_evaluation(&mut self) {
+        self.evaluated = false;
+    }
 }
 
 impl TypeUuidProvider for AnimationBlendingStateMachine {
@@ -265,11 +283,17 @@ impl NodeTrait for AnimationBlendingStateMachine {
     }
 
     fn update(&mut self, context: &mut UpdateContext) {
+        let evaluated = std::mem::take(&mut self.evaluated);
         if let Some(animation_player) = context
             .nodes
             .try_borrow_mut(*self.animation_player)
             .and_then(|n| n.query_component_mut::<AnimationPlayer>())
         {
+            if evaluated {
+                self.machine.pose().apply_internal(context.nodes);
+                return;
+            }
+
             // Prevent animation player to apply animation to scene nodes. The animation will
             // do than instead.
             animation_player.set_auto_apply(false);
@@ -336,6 +360,7 @@ impl AnimationBlendingStateMachineBuilder {
             base: self.base_builder.build_base(),
             machine: self.machine.into(),
             animation_player: self.animation_player.into(),
+            evaluated: false,
         })
     }
 
@@ -14,12 +14,15 @@ use crate::{
     },
     generic_animation::value::{BoundValueCollection, TrackValue, ValueBinding},
     scene::{
+        animation::absm::AnimationBlendingStateMachine,
         base::{Base, BaseBuilder},
         graph::{Graph, NodePool},
         node::{Node, NodeTrait, UpdateContext},
     },
 };
+use fxhash::FxHashMap;
 use fyrox_graph::BaseSceneGraph;
+use rayon::prelude::*;
 use std::ops::{Deref, DerefMut};
 
 pub mod absm;
@@ -86,7 +89,8 @@ pub trait AnimationPoseExt {
 
 impl AnimationPoseExt for AnimationPose {
     fn apply_internal(&self, nodes: &mut NodePool) {
-        for (node, local_pose) in self.poses() {
+        for local_pose in self.poses() {
+            let node = &local_pose.node;
             if node.is_none() {
                 Log::writeln(MessageKind::Error, "Invalid node handle found for animation pose, most likely it means that animation retargeting failed!");
             } else if let Some(node) = nodes.try_borrow_mut(*node) {
@@ -96,7 +100,8 @@ impl AnimationPoseExt for AnimationPose {
     }
 
     fn apply(&self, graph: &mut Graph) {
-        for (node, local_pose) in self.poses() {
+        for local_pose in self.poses() {
+            let node = &local_pose.node;
             if node.is_none() {
                 Log::writeln(MessageKind::Error, "Invalid node handle found for animation pose, most likely it means that animation retargeting failed!");
             } else if let Some(node) = graph.try_get_mut(*node) {
@@ -109,7 +114,8 @@ impl AnimationPoseExt for AnimationPose {
     where
         C: FnMut(&mut Node, Handle<Node>, &NodePose),
     {
-        for (node, local_pose) in self.poses() {
+        for local_pose in self.poses() {
+            let node = &local_pose.node;
             if node.is_none() {
                 Log::writeln(MessageKind::Error, "Invalid node handle found for animation pose, most likely it means that animation retargeting failed!");
             } else if let Some(node_ref) = graph.try_get_mut(*node) {
@@ -229,6 +235,11 @@ pub struct AnimationPlayer {
     base: Base,
     animations: InheritableVariable<AnimationContainer>,
     auto_apply: bool,
+    // Set when the animations were already updated in parallel (see `evaluate_animations_in_parallel`),
+    // holds a flag whether the poses must be applied or not.
+    #[reflect(hidden)]
+    #[visit(skip)]
+    pending_apply: Option<bool>,
 }
 
 impl Default for AnimationPlayer {
@@ -237,6 +248,7 @@ impl Default for AnimationPlayer {
             base: Default::default(),
             animations: Default::default(),
             auto_apply: true,
+            pending_apply: None,
         }
     }
 }
@@ -271,6 +283,20 @@ impl AnimationPlayer {
     pub fn set_animations(&mut self, animations: AnimationContainer) {
         self.animations.set_value_and_mark_modified(animations);
     }
+
+    // Updates every enabled animation, but postpones applying of their poses to the next update of
+    // the node.
+    fn evaluate(&mut self, dt: f32) {
+        for animation in self
+            .animations
+            .get_value_mut_silent()
+            .iter_mut()
+            .filter(|anim| anim.is_enabled())
+        {
+            animation.tick(dt);
+        }
+        self.pending_apply = Some(self.auto_apply);
+    }
 }
 
 impl TypeUuidProvider for AnimationPlayer {
@@ -312,11 +338,19 @@ impl NodeTrait for AnimationPlayer {
     }
 
     fn update(&mut self, context: &mut UpdateContext) {
-        self.animations.get_value_mut_silent().update_animations(
-            context.nodes,
-            self.auto_apply,
-            context.dt,
-        );
+        if let Some(apply) = self.pending_apply.take() {
+            if apply {
+                for animation in self.animations.iter().filter(|anim| anim.is_enabled()) {
+                    animation.pose().apply_internal(context.nodes);
+                }
+            }
+        } else {
+            self.animations.get_value_mut_silent().update_animations(
+                context.nodes,
+                self.auto_apply,
+                context.dt,
+            );
+        }
     }
 }
 
@@ -355,6 +389,7 @@ impl AnimationPlayerBuilder {
             base: self.base_builder.build_base(),
             animations: self.animations.into(),
             auto_apply: self.auto_apply,
+            pending_apply: None,
         })
     }
 
@@ -363,3 +398,102 @@ impl AnimationPlayerBuilder {
         graph.add_node(self.build_node())
     }
 }
+
+/// Minimal amount of animation players in a graph at which [`crate::scene::graph::Graph::update`]
+/// switches to parallel evaluation of animations. Smaller amounts are processed faster on a single
+/// thread.
+pub const PARALLEL_ANIMATION_THRESHOLD: usize = 8;
+
+// An animation player and every animation blending state machine that uses the player.
+struct AnimationJob<'a> {
+    player_handle: Handle<Node>,
+    player: &'a mut AnimationPlayer,
+    machines: Vec<(Handle<Node>, &'a mut AnimationBlendingStateMachine)>,
+}
+
+impl AnimationJob<'_> {
+    fn evaluate(&mut self, dt: f32) {
+        // Repeat the order of the serial update of the graph (by node index), machines modify the
+        // state of animations, so the order affects the result.
+        self.machines
+            .sort_unstable_by_key(|(handle, _)| handle.index());
+        let mut player_evaluated = false;
+        for (handle, machine) in self.machines.iter_mut() {
+            if !player_evaluated && self.player_handle.index() < handle.index() {
+                self.player.evaluate(dt);
+                player_evaluated = true;
+            }
+            machine.evaluate(self.player, dt);
+        }
+        if !player_evaluated {
+            self.player.evaluate(dt);
+        }
+    }
+}
+
+/// Evaluates animations of every enabled animation player and poses of every animation blending state
+/// machine in the given node pool in parallel. Every animation player with its machines is processed
+/// by a single thread, in the same order as the serial update does, so the result is exactly the same.
+/// Evaluated poses are applied on next update of respective nodes. Returns handles of the evaluated
+/// nodes, which must be passed to [`discard_pending_animations`] after the update.
+pub(crate) fn evaluate_animations_in_parallel(nodes: &mut NodePool, dt: f32) -> Vec<Handle<Node>> {
+    if rayon::current_num_threads() < 2 {
+        return Vec::new();
+    }
+
+    let mut jobs = Vec::new();
+    let mut job_indices = FxHashMap::default();
+    let mut machines = Vec::new();
+    for (handle, node) in nodes.pair_iter_mut() {
+        if !node.is_globally_enabled() {
+            continue;
+        }
+
+        if node.cast::<AnimationPlayer>().is_some() {
+            if let Some(player) = node.cast_mut::<AnimationPlayer>() {
+                job_indices.insert(handle, jobs.len());
+                jobs.push(AnimationJob {
+                    player_handle: handle,
+                    player,
+                    machines: Vec::new(),
+                });
+            }
+        } else if let Some(machine) = node.cast_mut::<AnimationBlendingStateMachine>() {
+            machines.push((handle, machine));
+        }
+    }
+
+    if jobs.len() < PARALLEL_ANIMATION_THRESHOLD {
+        return Vec::new();
+    }
+
+    // Machines with invalid animation players are left for the serial update.
+    for (handle, machine) in machines {
+        if let Some(&index) = job_indices.get(&machine.animation_player()) {
+            jobs[index].machines.push((handle, machine));
+        }
+    }
+
+    jobs.par_iter_mut().for_each(|job| job.evaluate(dt));
+
+    let mut evaluated = Vec::new();
+    for job in jobs {
+        evaluated.push(job.player_handle);
+        evaluated.extend(job.machines.into_iter().map(|(handle, _)| handle));
+    }
+    evaluated
+}
+
+/// Discards the results of [`evaluate_animations_in_parallel`] that were not applied by the update of
+/// the graph (for example, if a node was disabled during the update).
+pub(crate) fn discard_pending_animations(nodes: &mut NodePool, evaluated: &[Handle<Node>]) {
+    for &handle in evaluated {
+        if let Some(node) = nodes.try_borrow_mut(handle) {
+            if let Some(player) = node.cast_mut::<AnimationPlayer>() {
+                player.pending_apply = None;
+            } else if let Some(machine) = node.cast_mut::<AnimationBlendingStateMachine>() {
+                machine.discard_evaluation();
+            }
+        }
+    }
+}
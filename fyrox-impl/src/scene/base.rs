@@ -396,6 +396,11 @@ pub struct Base {
     #[reflect(hidden)]
     pub(crate) transform_modified: Cell<bool>,
 
+    // Set when the node must be re-processed by the next incremental hierarchical data update
+    // of the scene graph (for example, when the node was re-linked to some other parent).
+    #[reflect(hidden)]
+    pub(crate) hierarchy_dirty: Cell<bool>,
+
     // When `true` it means that this node is instance of `resource`.
     // More precisely - this node is root of whole descendant nodes
     // hierarchy which was instantiated from resource.
@@ -488,6 +493,7 @@ impl Base {
     #[inline]
     pub fn local_transform_mut(&mut self) -> &mut Transform {
         self.transform_modified.set(true);
+        self.hierarchy_dirty.set(true);
         &mut self.local_transform
     }
 
@@ -495,6 +501,7 @@ impl Base {
     #[inline]
     pub fn set_local_transform(&mut self, transform: Transform) {
         self.local_transform = transform;
+        self.hierarchy_dirty.set(true);
     }
 
     /// Tries to find properties by the name. The method returns an iterator because it possible
@@ -1305,6 +1312,7 @@ impl BaseBuilder {
             tag: self.tag.into(),
             properties: Default::default(),
             transform_modified: Cell::new(false),
+            hierarchy_dirty: Cell::new(true),
             frustum_culling: self.frustum_culling.into(),
             cast_shadows: self.cast_shadows.into(),
             scripts: self.scripts,
@@ -11,7 +11,7 @@ use crate::{
         arrayvec::ArrayVec,
         instant,
         log::{Log, MessageKind},
-        math::Matrix4Ext,
+        math::{m4x4_approx_eq, Matrix4Ext},
         parking_lot::Mutex,
         pool::Handle,
         reflect::prelude::*,
@@ -25,12 +25,16 @@ use crate::{
         debug::SceneDrawingContext,
         dim2::{self, collider::ColliderShape, joint::JointParams, rigidbody::ApplyAction},
         graph::{
-            physics::{FeatureId, IntegrationParameters, PhysicsPerformanceStatistics},
+            physics::{
+                FeatureId, IntegrationParameters, PhysicsPerformanceStatistics,
+                DEFAULT_FIXED_TIMESTEP,
+            },
             NodePool,
         },
         node::{Node, NodeTrait},
     },
 };
+use fxhash::FxHashMap;
 use fyrox_core::variable::InheritableVariable;
 use rapier2d::{
     dynamics::{
@@ -45,9 +49,10 @@ use rapier2d::{
     },
     pipeline::{DebugRenderPipeline, EventHandler, PhysicsPipeline, QueryPipeline},
 };
+use rayon::prelude::*;
 use std::num::NonZeroUsize;
 use std::{
-    cell::RefCell,
+    cell::{Cell, Ref, RefCell},
     cmp::Ordering,
     fmt::{Debug, Formatter},
     hash::Hash,
@@ -402,6 +407,32 @@ pub struct PhysicsWorld {
     #[visit(skip)]
     #[reflect(hidden)]
     query: RefCell<QueryPipeline>,
+    // A flag, that defines whether the query pipeline must be updated before the next scene query.
+    #[visit(skip)]
+    #[reflect(hidden)]
+    need_update_query: Cell<bool>,
+    // Rigid bodies and colliders, that were removed from the world, but still exist in the native
+    // sets in disabled state. Actual deletion is deferred until the next simulation step, so the
+    // query pipeline never refers to deleted entities and could be updated once per step.
+    #[visit(skip)]
+    #[reflect(hidden)]
+    removed_bodies: Vec<RigidBodyHandle>,
+    #[visit(skip)]
+    #[reflect(hidden)]
+    removed_colliders: Vec<ColliderHandle>,
+    // Time, that was accumulated in fixed time step mode, but not yet simulated.
+    #[visit(skip)]
+    #[reflect(hidden)]
+    accumulator: f32,
+    // Interpolation factor between previous and current poses of rigid bodies in fixed time step
+    // mode.
+    #[visit(skip)]
+    #[reflect(hidden)]
+    interpolation_alpha: f32,
+    // Poses of active dynamic rigid bodies before the last simulation step. Used for interpolation.
+    #[visit(skip)]
+    #[reflect(hidden)]
+    previous_poses: FxHashMap<RigidBodyHandle, Isometry2<f32>>,
     #[visit(skip)]
     #[reflect(hidden)]
     debug_render_pipeline: Mutex<DebugRenderPipeline>,
@@ -477,6 +508,145 @@ pub struct TOI {
     pub status: collider::TOIStatus,
 }
 
+/// A set of options for a single shape cast in a batch, see [`PhysicsWorld::cast_shapes`] for more
+/// info.
+pub struct ShapeCastOptions<'a> {
+    /// The shape to cast.
+    pub shape: &'a dyn Shape,
+    /// The initial position of the shape to cast.
+    pub shape_pos: Isometry2<f32>,
+    /// The constant velocity of the shape to cast (i.e. the cast direction).
+    pub shape_vel: Vector2<f32>,
+    /// The maximum time-of-impact that can be reported by this cast.
+    pub max_toi: f32,
+    /// If set to `false`, the cast won’t immediately stop if the shape is penetrating another shape
+    /// at its starting point **and** its trajectory is such that it’s on a path to exist that
+    /// penetration state.
+    pub stop_at_penetration: bool,
+    /// Flags indicating what particular type of colliders should be excluded from the scene query.
+    pub flags: collider::QueryFilterFlags,
+    /// If set, only colliders with collision groups compatible with this one will
+    /// be included in the scene query.
+    pub groups: Option<collider::InteractionGroups>,
+    /// If set, this collider will be excluded from the scene query.
+    pub exclude_collider: Option<Handle<Node>>,
+    /// If set, any collider attached to this rigid-body will be excluded from the scene query.
+    pub exclude_rigid_body: Option<Handle<Node>>,
+}
+
+// Minimal amount of scene queries processed by a single thread in batched mode, queries are quite
+// fast so there's no need to split a batch into too small tasks.
+const MIN_QUERIES_PER_TASK: usize = 16;
+
+fn is_collider_enabled(_: ColliderHandle, collider: &Collider) -> bool {
+    // Removed colliders are disabled until the next simulation step.
+    collider.is_enabled()
+}
+
+fn native_exclusions(
+    graph: &Graph,
+    exclude_collider: Option<Handle<Node>>,
+    exclude_rigid_body: Option<Handle<Node>>,
+) -> (Option<ColliderHandle>, Option<RigidBodyHandle>) {
+    (
+        exclude_collider
+            .and_then(|h| graph.try_get(h))
+            .and_then(|n| n.component_ref::<dim2::collider::Collider>())
+            .map(|c| c.native.get()),
+        exclude_rigid_body
+            .and_then(|h| graph.try_get(h))
+            .and_then(|n| n.component_ref::<dim2::rigidbody::RigidBody>())
+            .map(|c| c.native.get()),
+    )
+}
+
+fn cast_ray_native<S: QueryResultsStorage>(
+    query: &QueryPipeline,
+    bodies: &RigidBodySet,
+    colliders: &ColliderSet,
+    opts: &RayCastOptions,
+    query_buffer: &mut S,
+) {
+    query_buffer.clear();
+    let ray = Ray::new(
+        opts.ray_origin,
+        opts.ray_direction
+            .try_normalize(f32::EPSILON)
+            .unwrap_or_default(),
+    );
+    query.intersections_with_ray(
+        bodies,
+        colliders,
+        &ray,
+        opts.max_len,
+        true,
+        rapier2d::pipeline::QueryFilter::new()
+            .groups(InteractionGroups::new(
+                u32_to_group(opts.groups.memberships.0),
+                u32_to_group(opts.groups.filter.0),
+            ))
+            .predicate(&is_collider_enabled),
+        |handle, intersection| {
+            query_buffer.push(Intersection {
+                collider: Handle::decode_from_u128(colliders.get(handle).unwrap().user_data),
+                normal: intersection.normal,
+                position: ray.point_at(intersection.toi),
+                feature: intersection.feature.into(),
+                toi: intersection.toi,
+            })
+        },
+    );
+    if opts.sort_results {
+        query_buffer.sort_intersections_by(|a, b| {
+            if a.toi > b.toi {
+                Ordering::Greater
+            } else if a.toi < b.toi {
+                Ordering::Less
+            } else {
+                Ordering::Equal
+            }
+        })
+    }
+}
+
+#[allow(clippy::too_many_arguments)]
+fn cast_shape_native(
+    query: &QueryPipeline,
+    bodies: &RigidBodySet,
+    colliders: &ColliderSet,
+    shape: &dyn Shape,
+    shape_pos: &Isometry2<f32>,
+    shape_vel: &Vector2<f32>,
+    max_toi: f32,
+    stop_at_penetration: bool,
+    filter: rapier2d::pipeline::QueryFilter,
+) -> Option<(Handle<Node>, TOI)> {
+    query
+        .cast_shape(
+            bodies,
+            colliders,
+            shape_pos,
+            shape_vel,
+            shape,
+            max_toi,
+            stop_at_penetration,
+            filter,
+        )
+        .map(|(handle, toi)| {
+            (
+                Handle::decode_from_u128(colliders.get(handle).unwrap().user_data),
+                TOI {
+                    toi: toi.toi,
+                    witness1: toi.witness1,
+                    witness2: toi.witness2,
+                    normal1: toi.normal1,
+                    normal2: toi.normal2,
+                    status: toi.status.into(),
+                },
+            )
+        })
+}
+
 impl PhysicsWorld {
     /// Creates a new instance of the physics world.
     pub(crate) fn new() -> Self {
@@ -501,6 +671,12 @@ impl PhysicsWorld {
             },
             event_handler: Box::new(()),
             query: RefCell::new(Default::default()),
+            need_update_query: Cell::new(true),
+            removed_bodies: Default::default(),
+            removed_colliders: Default::default(),
+            accumulator: 0.0,
+            interpolation_alpha: 1.0,
+            previous_poses: Default::default(),
             performance_statistics: Default::default(),
             debug_render_pipeline: Default::default(),
         }
@@ -509,67 +685,155 @@ impl PhysicsWorld {
     pub(crate) fn update(&mut self, dt: f32) {
         let time = instant::Instant::now();
 
+        self.delete_removed_entities();
+
         if *self.enabled {
-            let integration_parameters = rapier2d::dynamics::IntegrationParameters {
-                dt: self.integration_parameters.dt.unwrap_or(dt),
-                min_ccd_dt: self.integration_parameters.min_ccd_dt,
-                erp: self.integration_parameters.erp,
-                damping_ratio: self.integration_parameters.damping_ratio,
-                joint_erp: self.integration_parameters.joint_erp,
-                joint_damping_ratio: self.integration_parameters.joint_damping_ratio,
-                allowed_linear_error: self.integration_parameters.allowed_linear_error,
-                max_penetration_correction: self.integration_parameters.max_penetration_correction,
-                prediction_distance: self.integration_parameters.prediction_distance,
-                num_solver_iterations: NonZeroUsize::new(
-                    self.integration_parameters.num_solver_iterations,
-                )
-                .unwrap(),
-                num_additional_friction_iterations: self
-                    .integration_parameters
-                    .num_additional_friction_iterations,
-                num_internal_pgs_iterations: self
+            if self.integration_parameters.fixed_timestep {
+                let step_dt = self
                     .integration_parameters
-                    .num_internal_pgs_iterations,
-                min_island_size: self.integration_parameters.min_island_size as usize,
-                max_ccd_substeps: self.integration_parameters.max_ccd_substeps as usize,
-            };
-
-            self.pipeline.step(
-                &self.gravity,
-                &integration_parameters,
+                    .dt
+                    .unwrap_or(DEFAULT_FIXED_TIMESTEP);
+                let max_steps = self.integration_parameters.max_steps_per_frame.max(1);
+
+                self.accumulator += dt;
+                let step_count = ((self.accumulator / step_dt) as u32).min(max_steps);
+                for i in 0..step_count {
+                    if i + 1 == step_count {
+                        self.store_previous_poses();
+                    }
+                    self.step(step_dt);
+                    self.accumulator -= step_dt;
+                }
+
+                // Drop the time that could not be simulated in this frame (if the amount of steps
+                // was clamped), so the simulation will slow down instead of accumulating lag.
+                if self.accumulator >= step_dt {
+                    self.accumulator %= step_dt;
+                }
+                self.accumulator = self.accumulator.max(0.0);
+                self.interpolation_alpha = (self.accumulator / step_dt).clamp(0.0, 1.0);
+            } else {
+                self.accumulator = 0.0;
+                self.interpolation_alpha = 1.0;
+                self.previous_poses.clear();
+                self.step(self.integration_parameters.dt.unwrap_or(dt));
+            }
+        }
+
+        self.query.get_mut().update(&self.bodies, &self.colliders);
+        self.need_update_query.set(false);
+
+        self.performance_statistics.step_time += instant::Instant::now() - time;
+    }
+
+    fn step(&mut self, dt: f32) {
+        let integration_parameters = rapier2d::dynamics::IntegrationParameters {
+            dt,
+            min_ccd_dt: self.integration_parameters.min_ccd_dt,
+            erp: self.integration_parameters.erp,
+            damping_ratio: self.integration_parameters.damping_ratio,
+            joint_erp: self.integration_parameters.joint_erp,
+            joint_damping_ratio: self.integration_parameters.joint_damping_ratio,
+            allowed_linear_error: self.integration_parameters.allowed_linear_error,
+            max_penetration_correction: self.integration_parameters.max_penetration_correction,
+            prediction_distance: self.integration_parameters.prediction_distance,
+            num_solver_iterations: NonZeroUsize::new(
+                self.integration_parameters.num_solver_iterations,
+            )
+            .unwrap(),
+            num_additional_friction_iterations: self
+                .integration_parameters
+                .num_additional_friction_iterations,
+            num_internal_pgs_iterations: self.integration_parameters.num_internal_pgs_iterations,
+            min_island_size: self.integration_parameters.min_island_size as usize,
+            max_ccd_substeps: self.integration_parameters.max_ccd_substeps as usize,
+        };
+
+        self.pipeline.step(
+            &self.gravity,
+            &integration_parameters,
+            &mut self.islands,
+            &mut self.broad_phase,
+            &mut self.narrow_phase,
+            &mut self.bodies,
+            &mut self.colliders,
+            &mut self.joints.set,
+            &mut self.multibody_joints.set,
+            &mut self.ccd_solver,
+            // In Rapier 0.17 passing query pipeline here sometimes causing panic in numeric overflow,
+            // so we keep updating it manually.
+            None,
+            &(),
+            &*self.event_handler,
+        );
+    }
+
+    fn store_previous_poses(&mut self) {
+        self.previous_poses.clear();
+        if self.integration_parameters.interpolation {
+            for &handle in self.islands.active_dynamic_bodies() {
+                if let Some(body) = self.bodies.get(handle) {
+                    self.previous_poses.insert(handle, *body.position());
+                }
+            }
+        }
+    }
+
+    /// Returns current interpolation factor between previous and current poses of rigid bodies in
+    /// fixed time step mode. It is in `[0; 1]` range, where `1.0` means the current pose. See
+    /// [`IntegrationParameters::interpolation`] for more info.
+    pub fn interpolation_alpha(&self) -> f32 {
+        self.interpolation_alpha
+    }
+
+    fn delete_removed_entities(&mut self) {
+        for handle in self.removed_colliders.drain(..) {
+            self.colliders
+                .remove(handle, &mut self.islands, &mut self.bodies, false);
+        }
+        for handle in self.removed_bodies.drain(..) {
+            self.bodies.remove(
+                handle,
                 &mut self.islands,
-                &mut self.broad_phase,
-                &mut self.narrow_phase,
-                &mut self.bodies,
                 &mut self.colliders,
                 &mut self.joints.set,
                 &mut self.multibody_joints.set,
-                &mut self.ccd_solver,
-                // In Rapier 0.17 passing query pipeline here sometimes causing panic in numeric overflow,
-                // so we keep updating it manually.
-                None,
-                &(),
-                &*self.event_handler,
+                true,
             );
         }
+    }
 
-        self.performance_statistics.step_time += instant::Instant::now() - time;
+    // Returns the query pipeline, that is updated only if the world has changed since the last
+    // simulation step.
+    fn updated_query(&self) -> Ref<QueryPipeline> {
+        if self.need_update_query.replace(false) {
+            self.query
+                .borrow_mut()
+                .update(&self.bodies, &self.colliders);
+        }
+        self.query.borrow()
     }
 
     pub(crate) fn add_body(&mut self, owner: Handle<Node>, mut body: RigidBody) -> RigidBodyHandle {
         body.user_data = owner.encode_to_u128();
+        self.need_update_query.set(true);
         self.bodies.insert(body)
     }
 
     pub(crate) fn remove_body(&mut self, handle: RigidBodyHandle) {
-        self.bodies.remove(
-            handle,
-            &mut self.islands,
-            &mut self.colliders,
-            &mut self.joints.set,
-            &mut self.multibody_joints.set,
-            true,
-        );
+        // The body is disabled and will be deleted on the next simulation step, see
+        // `delete_removed_entities`.
+        if let Some(body) = self.bodies.get_mut(handle) {
+            if body.is_enabled() {
+                body.set_enabled(false);
+                for collider in body.colliders() {
+                    if let Some(collider) = self.colliders.get_mut(*collider) {
+                        collider.set_enabled(false);
+                    }
+                }
+                self.removed_bodies.push(handle);
+            }
+        }
     }
 
     pub(crate) fn add_collider(
@@ -579,14 +843,22 @@ impl PhysicsWorld {
         mut collider: Collider,
     ) -> ColliderHandle {
         collider.user_data = owner.encode_to_u128();
+        self.need_update_query.set(true);
         self.colliders
             .insert_with_parent(collider, parent_body, &mut self.bodies)
     }
 
     pub(crate) fn remove_collider(&mut self, handle: ColliderHandle) -> bool {
-        self.colliders
-            .remove(handle, &mut self.islands, &mut self.bodies, false)
-            .is_some()
+        // The collider is disabled and will be deleted on the next simulation step, see
+        // `delete_removed_entities`.
+        match self.colliders.get_mut(handle) {
+            Some(collider) if collider.is_enabled() => {
+                collider.set_enabled(false);
+                self.removed_colliders.push(handle);
+                true
+            }
+            _ => false,
+        }
     }
 
     pub(crate) fn add_joint(
@@ -620,59 +892,46 @@ impl PhysicsWorld {
         );
     }
 
-    /// Casts a ray with given options.
+    /// Casts a ray with given options. The query pipeline is updated once per simulation step (or
+    /// lazily, if the world was changed since the last step), so it is fine to cast a lot of rays
+    /// per frame. Use [`Self::cast_rays`] to cast a large batch of rays in parallel.
     pub fn cast_ray<S: QueryResultsStorage>(&self, opts: RayCastOptions, query_buffer: &mut S) {
         let time = instant::Instant::now();
 
-        let mut query = self.query.borrow_mut();
-
-        // TODO: Ideally this must be called once per frame, but it seems to be impossible because
-        // a body can be deleted during the consecutive calls of this method which will most
-        // likely end up in panic because of invalid handle stored in internal acceleration
-        // structure. This could be fixed by delaying deleting of bodies/collider to the end
-        // of the frame.
-        query.update(&self.bodies, &self.colliders);
-
-        query_buffer.clear();
-        let ray = Ray::new(
-            opts.ray_origin,
-            opts.ray_direction
-                .try_normalize(f32::EPSILON)
-                .unwrap_or_default(),
-        );
-        query.intersections_with_ray(
-            &self.bodies,
-            &self.colliders,
-            &ray,
-            opts.max_len,
-            true,
-            rapier2d::pipeline::QueryFilter::new().groups(InteractionGroups::new(
-                u32_to_group(opts.groups.memberships.0),
-                u32_to_group(opts.groups.filter.0),
-            )),
-            |handle, intersection| {
-                query_buffer.push(Intersection {
-                    collider: Handle::decode_from_u128(
-                        self.colliders.get(handle).unwrap().user_data,
-                    ),
-                    normal: intersection.normal,
-                    position: ray.point_at(intersection.toi),
-                    feature: intersection.feature.into(),
-                    toi: intersection.toi,
-                })
-            },
+        let query = self.updated_query();
+        cast_ray_native(&query, &self.bodies, &self.colliders, &opts, query_buffer);
+
+        self.performance_statistics.total_ray_cast_time.set(
+            self.performance_statistics.total_ray_cast_time.get()
+                + (instant::Instant::now() - time),
         );
-        if opts.sort_results {
-            query_buffer.sort_intersections_by(|a, b| {
-                if a.toi > b.toi {
-                    Ordering::Greater
-                } else if a.toi < b.toi {
-                    Ordering::Less
-                } else {
-                    Ordering::Equal
-                }
-            })
-        }
+    }
+
+    /// Casts a batch of rays in parallel. Results of every ray are written in a respective storage
+    /// from `query_buffers`, which must have the same length as `rays`. The storages could be
+    /// reused between frames to avoid memory allocations.
+    ///
+    /// # Panics
+    ///
+    /// Panics if `rays` and `query_buffers` have different lengths.
+    pub fn cast_rays<S>(&self, rays: &[RayCastOptions], query_buffers: &mut [S])
+    where
+        S: QueryResultsStorage + Send,
+    {
+        assert_eq!(rays.len(), query_buffers.len());
+
+        let time = instant::Instant::now();
+
+        let query = self.updated_query();
+        let query = &*query;
+        let bodies = &self.bodies;
+        let colliders = &self.colliders;
+        rays.par_iter()
+            .zip(query_buffers.par_iter_mut())
+            .with_min_len(MIN_QUERIES_PER_TASK)
+            .for_each(|(opts, query_buffer)| {
+                cast_ray_native(query, bodies, colliders, opts, query_buffer)
+            });
 
         self.performance_statistics.total_ray_cast_time.set(
             self.performance_statistics.total_ray_cast_time.get()
@@ -709,9 +968,13 @@ impl PhysicsWorld {
         stop_at_penetration: bool,
         filter: QueryFilter,
     ) -> Option<(Handle<Node>, TOI)> {
-        let predicate = |handle: ColliderHandle, _: &Collider| -> bool {
+        let predicate = |_: ColliderHandle, collider: &Collider| -> bool {
+            if !collider.is_enabled() {
+                return false;
+            }
+
             if let Some(pred) = filter.predicate {
-                let h = Handle::decode_from_u128(self.colliders.get(handle).unwrap().user_data);
+                let h = Handle::decode_from_u128(collider.user_data);
                 pred(
                     h,
                     graph.node(h).component_ref::<collider::Collider>().unwrap(),
@@ -721,50 +984,103 @@ impl PhysicsWorld {
             }
         };
 
+        let (exclude_collider, exclude_rigid_body) =
+            native_exclusions(graph, filter.exclude_collider, filter.exclude_rigid_body);
         let filter = rapier2d::pipeline::QueryFilter {
             flags: rapier2d::pipeline::QueryFilterFlags::from_bits(filter.flags.bits()).unwrap(),
             groups: filter.groups.map(|g| {
                 InteractionGroups::new(u32_to_group(g.memberships.0), u32_to_group(g.filter.0))
             }),
-            exclude_collider: filter
-                .exclude_collider
-                .and_then(|h| graph.try_get(h))
-                .and_then(|n| n.component_ref::<dim2::collider::Collider>())
-                .map(|c| c.native.get()),
-            exclude_rigid_body: filter
-                .exclude_collider
-                .and_then(|h| graph.try_get(h))
-                .and_then(|n| n.component_ref::<dim2::rigidbody::RigidBody>())
-                .map(|c| c.native.get()),
+            exclude_collider,
+            exclude_rigid_body,
             predicate: Some(&predicate),
         };
 
-        let query = self.query.borrow_mut();
-
-        query
-            .cast_shape(
-                &self.bodies,
-                &self.colliders,
-                shape_pos,
-                shape_vel,
-                shape,
-                max_toi,
-                stop_at_penetration,
-                filter,
-            )
-            .map(|(handle, toi)| {
-                (
-                    Handle::decode_from_u128(self.colliders.get(handle).unwrap().user_data),
-                    TOI {
-                        toi: toi.toi,
-                        witness1: toi.witness1,
-                        witness2: toi.witness2,
-                        normal1: toi.normal1,
-                        normal2: toi.normal2,
-                        status: toi.status.into(),
-                    },
-                )
-            })
+        let query = self.updated_query();
+        cast_shape_native(
+            &query,
+            &self.bodies,
+            &self.colliders,
+            shape,
+            shape_pos,
+            shape_vel,
+            max_toi,
+            stop_at_penetration,
+            filter,
+        )
+    }
+
+    /// Casts a batch of shapes in parallel, see [`Self::cast_shape`] for more info about shape
+    /// casting. The result of every cast is written in a respective slot of `results`, which must
+    /// have the same length as `casts`. Custom predicates are not supported in batched mode, because
+    /// they could not be called from multiple threads.
+    ///
+    /// # Panics
+    ///
+    /// Panics if `casts` and `results` have different lengths.
+    pub fn cast_shapes(
+        &self,
+        graph: &Graph,
+        casts: &[ShapeCastOptions],
+        results: &mut [Option<(Handle<Node>, TOI)>],
+    ) {
+        assert_eq!(casts.len(), results.len());
+
+        // Graph cannot be shared across threads, so native handles must be fetched beforehand.
+        let exclusions = casts
+            .iter()
+            .map(|cast| native_exclusions(graph, cast.exclude_collider, cast.exclude_rigid_body))
+            .collect::<Vec<_>>();
+
+        let query = self.updated_query();
+        let query = &*query;
+        let bodies = &self.bodies;
+        let colliders = &self.colliders;
+        casts
+            .par_iter()
+            .zip(exclusions.par_iter())
+            .zip(results.par_iter_mut())
+            .with_min_len(MIN_QUERIES_PER_TASK)
+            .for_each(
+                |((cast, &(exclude_collider, exclude_rigid_body)), result)| {
+                    let filter = rapier2d::pipeline::QueryFilter {
+                        flags: rapier2d::pipeline::QueryFilterFlags::from_bits(cast.flags.bits())
+                            .unwrap(),
+                        groups: cast.groups.map(|g| {
+                            InteractionGroups::new(
+                                u32_to_group(g.memberships.0),
+                                u32_to_group(g.filter.0),
+                            )
+                        }),
+                        exclude_collider,
+                        exclude_rigid_body,
+                        predicate: Some(&is_collider_enabled),
+                    };
+
+                    *result = cast_shape_native(
+                        query,
+                        bodies,
+                        colliders,
+                        cast.shape,
+                        &cast.shape_pos,
+                        &cast.shape_vel,
+                        cast.max_toi,
+                        cast.stop_at_penetration,
+                        filter,
+                    );
+                },
+            );
+    }
+
+    // Returns a pose of the rigid body, that should be used for its scene node. It is either the
+    // current pose of the body or a pose interpolated between the last two simulation steps.
+    fn synced_pose(&self, handle: RigidBodyHandle, native: &RigidBody) -> Isometry2<f32> {
+        match self.previous_poses.get(&handle) {
+            Some(previous_pose) => {
+                previous_pose.lerp_slerp(native.position(), self.interpolation_alpha)
+            }
+            None => *native.position(),
+        }
     }
 
     pub(crate) fn set_rigid_body_position(
@@ -772,9 +1088,25 @@ impl PhysicsWorld {
         rigid_body: &scene::dim2::rigidbody::RigidBody,
         new_global_transform: &Matrix4<f32>,
     ) {
-        if let Some(native) = self.bodies.get_mut(rigid_body.native.get()) {
+        let handle = rigid_body.native.get();
+        let new_pose = isometry_from_global_transform(new_global_transform);
+        if let Some(native) = self.bodies.get(handle) {
+            // The node was moved by the physics itself (see `sync_rigid_body_node`), there's no need
+            // to push the same pose back. Only isometries are compared, because the global transform
+            // of the node could also contain scale of the node or its ancestors.
+            let pose = self.synced_pose(handle, native);
+            if m4x4_approx_eq(&isometry2_to_mat4(&new_pose), &isometry2_to_mat4(&pose)) {
+                return;
+            }
+        }
+
+        // The body was teleported, its pose must not be interpolated across the jump.
+        self.previous_poses.remove(&handle);
+
+        self.need_update_query.set(true);
+        if let Some(native) = self.bodies.get_mut(handle) {
             native.set_position(
-                isometry_from_global_transform(new_global_transform),
+                new_pose,
                 // Do not wake up body, it is too expensive and must be done **only** by explicit
                 // `wake_up` call!
                 false,
@@ -790,10 +1122,12 @@ impl PhysicsWorld {
         if *self.enabled {
             if let Some(native) = self.bodies.get(rigid_body.native.get()) {
                 if native.body_type() == RigidBodyType::Dynamic {
+                    let pose = self.synced_pose(rigid_body.native.get(), native);
+
                     let local_transform: Matrix4<f32> = parent_transform
                         .try_inverse()
                         .unwrap_or_else(Matrix4::identity)
-                        * isometry2_to_mat4(native.position());
+                        * isometry2_to_mat4(&pose);
 
                     let local_rotation = UnitQuaternion::from_matrix_eps(
                         &local_transform.basis(),
@@ -838,6 +1172,7 @@ impl PhysicsWorld {
         if rigid_body_node.native.get() != RigidBodyHandle::invalid() {
             let mut actions = rigid_body_node.actions.lock();
             if rigid_body_node.need_sync_model() || !actions.is_empty() {
+                self.need_update_query.set(true);
                 if let Some(native) = self.bodies.get_mut(rigid_body_node.native.get()) {
                     // Sync native rigid body's properties with scene node's in case if they
                     // were changed by user.
@@ -984,6 +1319,7 @@ impl PhysicsWorld {
         //    and a lot of other stuff, this is why we need `anything_changed` flag.
         if collider_node.native.get() != ColliderHandle::invalid() {
             if anything_changed {
+                self.need_update_query.set(true);
                 if let Some(native) = self.colliders.get_mut(collider_node.native.get()) {
                     if collider_node.transform_modified.get() {
                         native.set_position_wrt_parent(Isometry2 {
@@ -28,7 +28,7 @@ use crate::{
         algebra::{Matrix4, Rotation3, UnitQuaternion, Vector2, Vector3},
         instant,
         log::{Log, MessageKind},
-        math::{aabb::AxisAlignedBoundingBox, Matrix4Ext},
+        math::{aabb::AxisAlignedBoundingBox, ray::Ray, Matrix4Ext},
         pool::{ErasedHandle, Handle, MultiBorrowContext, Pool, Ticket},
         reflect::prelude::*,
         sstorage::ImmutableString,
@@ -38,6 +38,8 @@ use crate::{
     material::{shader::SamplerFallback, MaterialResource, PropertyValue},
     resource::model::{Model, ModelResource, ModelResourceExtension},
     scene::{
+        accel::{self, SpatialIndex},
+        animation,
         base::{NodeScriptMessage, SceneNodeId},
         camera::Camera,
         dim2::{self},
@@ -56,9 +58,11 @@ use crate::{
     utils::lightmap::{self, Lightmap},
 };
 use fxhash::{FxHashMap, FxHashSet};
+use rayon::prelude::*;
 use std::{
     any::{Any, TypeId},
     fmt::Debug,
+    mem::ManuallyDrop,
     ops::{Index, IndexMut},
     sync::mpsc::{channel, Receiver, Sender},
     time::Duration,
@@ -66,6 +70,7 @@ use std::{
 
 pub mod event;
 pub mod physics;
+mod shape_cache;
 
 /// Graph performance statistics. Allows you to find out "hot" parts of the scene graph, which
 /// parts takes the most time to update.
@@ -87,6 +92,11 @@ pub struct GraphPerformanceStatistics {
 
     /// A time which was required to render sounds.
     pub sound_update_time: Duration,
+
+    /// Amount of nodes, which global transform (visibility, enabled state) was recalculated during
+    /// the last hierarchical data update. It is calculated only in [`HierarchyUpdateMode::Incremental`]
+    /// mode, in full mode every node is updated.
+    pub hierarchical_nodes_updated: usize,
 }
 
 impl GraphPerformanceStatistics {
@@ -140,26 +150,53 @@ pub struct Graph {
     #[reflect(hidden)]
     pub(crate) script_message_receiver: Receiver<NodeScriptMessage>,
 
+    #[reflect(hidden)]
+    released_ticket_sender: Sender<ReleasedTicket>,
+    #[reflect(hidden)]
+    released_ticket_receiver: Receiver<ReleasedTicket>,
+
     instance_id_map: FxHashMap<SceneNodeId, Handle<Node>>,
+
+    #[reflect(hidden)]
+    spatial_index: SpatialIndex,
+}
+
+/// A ticket of a reserved handle (see [`Graph::reserve_handles`]), that was released without access
+/// to the graph. The graph makes the handle vacant on its next update. If the graph is already
+/// destroyed, the ticket is silently leaked instead of panicking on drop.
+#[derive(Debug)]
+pub(crate) struct ReleasedTicket(ManuallyDrop<Ticket<Node>>);
+
+impl ReleasedTicket {
+    pub(crate) fn new(ticket: Ticket<Node>) -> Self {
+        Self(ManuallyDrop::new(ticket))
+    }
 }
 
 impl Default for Graph {
     fn default() -> Self {
         let (tx, rx) = channel();
+        let (released_ticket_sender, released_ticket_receiver) = channel();
+
+        let mut pool = Pool::new();
+        pool.set_alive_index_enabled(true);
 
         Self {
             physics: PhysicsWorld::new(),
             physics2d: dim2::physics::PhysicsWorld::new(),
             root: Handle::NONE,
-            pool: Pool::new(),
+            pool,
             stack: Vec::new(),
             sound_context: Default::default(),
             performance_statistics: Default::default(),
             event_broadcaster: Default::default(),
             script_message_receiver: rx,
             script_message_sender: tx,
+            released_ticket_sender,
+            released_ticket_receiver,
             lightmap: None,
             instance_id_map: Default::default(),
+            spatial_index: Default::default(),
         }
     }
 }
@@ -222,6 +259,132 @@ fn clear_links(mut node: Node) -> Node {
     node
 }
 
+/// Defines a way of how hierarchical data (global transform, visibility, enabled state) of scene nodes
+/// is updated in [`Graph::update`].
+#[derive(Copy, Clone, Default, PartialEq, Eq, Debug)]
+pub enum HierarchyUpdateMode {
+    /// Hierarchical data of every node is recalculated on every frame. This is the most robust mode,
+    /// which also catches changes of the properties that bypass the setters of the nodes.
+    #[default]
+    Full,
+    /// Only the sub-trees whose root node changed its local transform, visibility, enabled state or
+    /// its parent are recalculated. Independent sub-trees are processed in parallel. This mode is
+    /// suitable for huge scenes with mostly static content. See
+    /// [`Graph::update_hierarchical_data_incremental`] for more info.
+    Incremental,
+}
+
+// Recalculated hierarchical data of a single node.
+struct HierarchicalData {
+    handle: Handle<Node>,
+    global_transform: Matrix4<f32>,
+    global_visibility: bool,
+    global_enabled: bool,
+}
+
+// Hierarchical data of a parent node, that is needed to calculate the data of its children.
+#[derive(Copy, Clone)]
+struct ParentHierarchicalData {
+    global_transform: Matrix4<f32>,
+    global_visibility: bool,
+    global_enabled: bool,
+}
+
+impl Default for ParentHierarchicalData {
+    fn default() -> Self {
+        Self {
+            global_transform: Matrix4::identity(),
+            global_visibility: true,
+            global_enabled: true,
+        }
+    }
+}
+
+impl ParentHierarchicalData {
+    // Returns `None` if the parent handle is valid, but the parent is taken out of the pool. In this
+    // case hierarchical data of its children cannot be calculated.
+    fn of_parent(nodes: &NodePool, node: &Node) -> Option<Self> {
+        match nodes.try_borrow(node.parent()) {
+            Some(parent) => Some(Self {
+                global_transform: parent.global_transform(),
+                global_visibility: parent.global_visibility(),
+                global_enabled: parent.is_globally_enabled(),
+            }),
+            None if node.parent().is_none() => Some(Self::default()),
+            None => None,
+        }
+    }
+
+    fn calculate(&self, handle: Handle<Node>, node: &Node) -> HierarchicalData {
+        HierarchicalData {
+            handle,
+            global_transform: self.global_transform * node.local_transform().matrix(),
+            global_visibility: self.global_visibility && node.visibility(),
+            global_enabled: self.global_enabled && node.is_enabled(),
+        }
+    }
+}
+
+impl HierarchicalData {
+    fn as_parent(&self) -> ParentHierarchicalData {
+        ParentHierarchicalData {
+            global_transform: self.global_transform,
+            global_visibility: self.global_visibility,
+            global_enabled: self.global_enabled,
+        }
+    }
+}
+
+// Checks whether the hierarchical data of the node is outdated. Visibility and enabled state are
+// checked by comparison, because they could be changed bypassing the setters (via inheritance, for
+// example).
+fn is_hierarchy_dirty(nodes: &NodePool, node: &Node) -> bool {
+    if node.hierarchy_dirty.get() || node.local_transform().is_hierarchy_dirty() {
+        return true;
+    }
+
+    match ParentHierarchicalData::of_parent(nodes, node) {
+        Some(parent) => {
+            node.global_visibility() != (parent.global_visibility && node.visibility())
+                || node.is_globally_enabled() != (parent.global_enabled && node.is_enabled())
+        }
+        None => false,
+    }
+}
+
+fn has_dirty_ancestor(nodes: &NodePool, node: &Node) -> bool {
+    let mut parent_handle = node.parent();
+    while let Some(parent) = nodes.try_borrow(parent_handle) {
+        if is_hierarchy_dirty(nodes, parent) {
+            return true;
+        }
+        parent_handle = parent.parent();
+    }
+    false
+}
+
+// Calculates hierarchical data of the entire sub-tree, starting from the given node. The output is
+// written in depth-first order.
+fn calculate_sub_tree_hierarchical_data(
+    nodes: &NodePool,
+    root: Handle<Node>,
+    root_parent: ParentHierarchicalData,
+    output: &mut Vec<HierarchicalData>,
+) {
+    let mut stack = vec![(root, root_parent)];
+    while let Some((handle, parent)) = stack.pop() {
+        if let Some(node) = nodes.try_borrow(handle) {
+            let data = parent.calculate(handle, node);
+            let as_parent = data.as_parent();
+            // Reverse order keeps the output in the same order as the recursive traversal.
+            for &child in node.children().iter().rev() {
+                stack.push((child, as_parent));
+            }
+            output.push(data);
+        }
+    }
+}
+
 /// A set of switches that allows you to disable a particular step of graph update pipeline.
 #[derive(Clone, PartialEq, Eq)]
 pub struct GraphUpdateSwitches {
@@ -237,6 +400,15 @@ pub struct GraphUpdateSwitches {
     /// Whether the graph update is paused or not. Paused graphs won't be updated and their sound content will be also paused
     /// so it won't emit any sounds.
     pub paused: bool,
+    /// Defines how hierarchical data of the nodes is updated. See [`HierarchyUpdateMode`] docs for more info.
+    pub hierarchy_update_mode: HierarchyUpdateMode,
+    /// Enables or disables maintenance of the spatial index of the graph. See [`Graph::spatial_index`]
+    /// docs for more info.
+    pub spatial_index: bool,
+    /// Enables or disables parallel evaluation of animation players and animation blending state
+    /// machines. The result is the same as for the serial evaluation, so this switch is mostly useful
+    /// for debugging and profiling. Parallel evaluation is never used with `node_overrides`.
+    pub parallel_animation: bool,
 }
 
 impl Default for GraphUpdateSwitches {
@@ -247,6 +419,9 @@ impl Default for GraphUpdateSwitches {
             node_overrides: Default::default(),
             delete_dead_nodes: true,
             paused: false,
+            hierarchy_update_mode: Default::default(),
+            spatial_index: true,
+            parallel_animation: true,
         }
     }
 }
@@ -256,6 +431,7 @@ impl Graph {
     #[inline]
     pub fn new() -> Self {
         let (tx, rx) = channel();
+        let (released_ticket_sender, released_ticket_receiver) = channel();
 
         // Create root node.
         let mut root_node = Pivot::default();
@@ -265,6 +441,7 @@ impl Graph {
 
         // Add it to the pool.
         let mut pool = Pool::new();
+        pool.set_alive_index_enabled(true);
         let root = pool.spawn(Node::new(root_node));
         pool[root].self_handle = root;
 
@@ -281,8 +458,11 @@ impl Graph {
             event_broadcaster: Default::default(),
             script_message_receiver: rx,
             script_message_sender: tx,
+            released_ticket_sender,
+            released_ticket_receiver,
             lightmap: None,
             instance_id_map,
+            spatial_index: Default::default(),
         }
     }
 
@@ -818,6 +998,8 @@ impl Graph {
         node.global_visibility
             .set(parent_visibility && node.visibility());
         node.global_enabled.set(parent_enabled && node.is_enabled());
+        node.hierarchy_dirty.set(false);
+        node.local_transform().reset_hierarchy_dirty();
 
         for &child in node.children() {
             Self::update_hierarchical_data_recursively(
@@ -903,6 +1085,91 @@ impl Graph {
         );
     }
 
+    /// Calculates local and global transform, global visibility for the nodes, that were changed since
+    /// the last update of hierarchical data, and for all their descendants. A node is considered changed
+    /// if its local transform, visibility or enabled state was modified, or if it was linked to some other
+    /// parent. Changed sub-trees are independent of each other, so they're processed in parallel, and
+    /// the results are then applied (including [`NodeTrait::sync_transform`] calls) on the current thread
+    /// in a deterministic order.
+    ///
+    /// # Performance
+    ///
+    /// The method still performs a linear scan over all the nodes to find the changed ones, but it is much
+    /// cheaper than full recalculation, which has to multiply matrices and sync native objects for every
+    /// node in the graph.
+    ///
+    /// # Important notes
+    ///
+    /// Changes, that are made bypassing the setters of [`crate::scene::transform::Transform`] won't be
+    /// detected. Use [`Self::update_hierarchical_data`] if you're not sure.
+    pub fn update_hierarchical_data_incremental(&mut self) {
+        let nodes = &self.pool;
+
+        // Find the top-most changed nodes.
+        let mut roots = Vec::new();
+        for (handle, node) in nodes.pair_iter() {
+            if is_hierarchy_dirty(nodes, node) && !has_dirty_ancestor(nodes, node) {
+                if let Some(parent) = ParentHierarchicalData::of_parent(nodes, node) {
+                    roots.push((handle, parent));
+                }
+            }
+        }
+
+        // A single changed sub-tree (for example when the root node has changed) cannot be processed
+        // in parallel, so split such sub-trees into smaller ones by processing a few top levels here.
+        let mut prefix = Vec::new();
+        let desired_task_count = rayon::current_num_threads() * 4;
+        for _ in 0..4 {
+            if roots.is_empty() || roots.len() >= desired_task_count {
+                break;
+            }
+            let mut next_roots = Vec::new();
+            for (handle, parent) in roots.drain(..) {
+                if let Some(node) = nodes.try_borrow(handle) {
+                    let data = parent.calculate(handle, node);
+                    let as_parent = data.as_parent();
+                    next_roots.extend(node.children().iter().map(|c| (*c, as_parent)));
+                    prefix.push(data);
+                }
+            }
+            roots = next_roots;
+        }
+
+        // Nodes are accessed from multiple threads here, which is fine because every
+        // node belongs to exactly one sub-tree and only the thread that processes this sub-tree touches
+        // its lazily-calculated (cell-based) data. Parents of the sub-tree roots are only read.
+        let sub_trees = roots
+            .par_iter()
+            .map(|(root, parent)| {
+                let mut output = Vec::new();
+                calculate_sub_tree_hierarchical_data(nodes, *root, *parent, &mut output);
+                output
+            })
+            .collect::<Vec<_>>();
+
+        let mut sync_context = SyncContext {
+            nodes,
+            physics: &mut self.physics,
+            physics2d: &mut self.physics2d,
+            sound_context: &mut self.sound_context,
+            switches: None,
+        };
+
+        let mut count = 0;
+        for data in prefix.iter().chain(sub_trees.iter().flatten()) {
+            let node = &nodes[data.handle];
+            node.sync_transform(&data.global_transform, &mut sync_context);
+            node.global_transform.set(data.global_transform);
+            node.global_visibility.set(data.global_visibility);
+            node.global_enabled.set(data.global_enabled);
+            node.hierarchy_dirty.set(false);
+            node.local_transform().reset_hierarchy_dirty();
+            count += 1;
+        }
+
+        self.performance_statistics.hierarchical_nodes_updated = count;
+    }
+
     fn sync_native(&mut self, switches: &GraphUpdateSwitches) {
         let mut sync_context = SyncContext {
             nodes: &self.pool,
@@ -964,6 +1231,8 @@ impl Graph {
     /// Update switches allows you to disable update for parts of the update pipeline, it could be useful for editors
     /// where you need to have preview mode to update only specific set of nodes, etc.
     pub fn update(&mut self, frame_size: Vector2<f32>, dt: f32, switches: GraphUpdateSwitches) {
+        self.forget_released_tickets();
+
         self.sound_context.state().pause(switches.paused);
 
         if switches.paused {
@@ -971,7 +1240,10 @@ impl Graph {
         }
 
         let last_time = instant::Instant::now();
-        self.update_hierarchical_data();
+        match switches.hierarchy_update_mode {
+            HierarchyUpdateMode::Full => self.update_hierarchical_data(),
+            HierarchyUpdateMode::Incremental => self.update_hierarchical_data_incremental(),
+        }
         self.performance_statistics.hierarchical_properties_time =
             instant::Instant::now() - last_time;
 
@@ -999,15 +1271,134 @@ impl Graph {
                 self.update_node(*handle, frame_size, dt, switches.delete_dead_nodes);
             }
         } else {
-            for i in 0..self.pool.get_capacity() {
-                self.update_node(
-                    self.pool.handle_from_index(i),
-                    frame_size,
-                    dt,
-                    switches.delete_dead_nodes,
-                );
+            // Nodes could be removed or added during the update, so the handles must be collected first.
+            // The pool has the alive index enabled, so it does not touch free records of the pool. The
+            // index is kept sorted to keep the update order stable, it is re-sorted only after
+            // structural changes.
+            self.pool.sort_alive_index();
+            let handles = self
+                .pool
+                .alive_pair_iter()
+                .map(|(handle, _)| handle)
+                .collect::<Vec<_>>();
+
+            let evaluated_animations = if switches.parallel_animation {
+                animation::evaluate_animations_in_parallel(&mut self.pool, dt)
+            } else {
+                Vec::new()
+            };
+
+            for handle in handles {
+                self.update_node(handle, frame_size, dt, switches.delete_dead_nodes);
             }
+
+            animation::discard_pending_animations(&mut self.pool, &evaluated_animations);
         }
+
+        if switches.spatial_index {
+            self.update_spatial_index();
+        } else if self.spatial_index.is_up_to_date() {
+            self.spatial_index.clear();
+        }
+    }
+
+    /// Synchronizes the spatial index of the graph (see [`Self::spatial_index`]) with the current
+    /// world bounding boxes of the nodes. It is called automatically at the end of [`Self::update`],
+    /// but could also be used to refresh the index manually, when the graph is not updated.
+    pub fn update_spatial_index(&mut self) {
+        self.spatial_index.refresh(&self.pool);
+    }
+
+    /// Returns spatial index of the graph if it is up-to-date. The index is refreshed at the end of
+    /// each [`Self::update`] call (if [`GraphUpdateSwitches::spatial_index`] is set) and becomes
+    /// outdated when a node is added to or removed from the graph. It allows you to find potentially
+    /// visible nodes without visiting every node in the graph.
+    #[inline]
+    pub fn spatial_index(&self) -> Option<&SpatialIndex> {
+        if self.spatial_index.is_up_to_date() {
+            Some(&self.spatial_index)
+        } else {
+            None
+        }
+    }
+
+    fn spatial_query<Q, F>(&self, buffer: &mut Vec<Handle<Node>>, query: Q, mut filter: F)
+    where
+        Q: FnOnce(&SpatialIndex, &mut dyn FnMut(Handle<Node>)),
+        F: FnMut(&AxisAlignedBoundingBox) -> bool,
+    {
+        buffer.clear();
+        if let Some(spatial_index) = self.spatial_index() {
+            query(spatial_index, &mut |handle| {
+                if let Some(node) = self.pool.try_borrow(handle) {
+                    if filter(&node.world_bounding_box()) {
+                        buffer.push(handle);
+                    }
+                }
+            });
+            // Keep the order independent of the structure of the index.
+            buffer.sort_unstable_by_key(|handle| handle.index());
+        } else {
+            for (handle, node) in self.pool.pair_iter() {
+                if accel::is_empty_bounds(&node.local_bounding_box()) {
+                    continue;
+                }
+                let aabb = node.world_bounding_box();
+                if accel::is_indexable(&aabb) && filter(&aabb) {
+                    buffer.push(handle);
+                }
+            }
+        }
+    }
+
+    /// Collects handles of every node whose world bounding box intersects the given bounding box.
+    /// Nodes without bounds are ignored. Uses the spatial index (see [`Self::spatial_index`]) if
+    /// it is up-to-date, otherwise checks every node in the graph.
+    pub fn aabb_query(&self, aabb: &AxisAlignedBoundingBox, buffer: &mut Vec<Handle<Node>>) {
+        self.spatial_query(
+            buffer,
+            |spatial_index, func| spatial_index.aabb_query(aabb, func),
+            |node_aabb| node_aabb.is_intersects_aabb(aabb),
+        )
+    }
+
+    /// Collects handles of every node whose world bounding box intersects the given sphere. Nodes
+    /// without bounds are ignored. Uses the spatial index (see [`Self::spatial_index`]) if it is
+    /// up-to-date, otherwise checks every node in the graph.
+    pub fn sphere_query(
+        &self,
+        position: Vector3<f32>,
+        radius: f32,
+        buffer: &mut Vec<Handle<Node>>,
+    ) {
+        self.spatial_query(
+            buffer,
+            |spatial_index, func| spatial_index.sphere_query(position, radius, func),
+            |node_aabb| node_aabb.is_intersects_sphere(position, radius),
+        )
+    }
+
+    /// Collects handles of every node whose world bounding box is intersected by the given ray and
+    /// sorts them by the distance to the point where the ray enters the bounding box, so the closest
+    /// node goes first. It could be used for picking without physics. Nodes without bounds are
+    /// ignored. Uses the spatial index (see [`Self::spatial_index`]) if it is up-to-date, otherwise
+    /// checks every node in the graph.
+    pub fn ray_query(&self, ray: &Ray, buffer: &mut Vec<Handle<Node>>) {
+        self.spatial_query(
+            buffer,
+            |spatial_index, func| spatial_index.ray_query(ray, func),
+            |node_aabb| ray.aabb_intersection(node_aabb).is_some(),
+        );
+
+        let mut intersections = buffer
+            .drain(..)
+            .filter_map(|handle| {
+                ray.aabb_intersection(&self.pool[handle].world_bounding_box())
+                    .map(|result| (handle, result.min.max(0.0)))
+            })
+            .collect::<Vec<_>>();
+        intersections.sort_by(|a, b| a.1.total_cmp(&b.1));
+        buffer.extend(intersections.into_iter().map(|(handle, _)| handle));
     }
 
     /// Returns capacity of internal pool. Can be used to iterate over all **potentially**
@@ -1084,6 +1475,7 @@ impl Graph {
 
     pub(crate) fn take_reserve_internal(&mut self, handle: Handle<Node>) -> (Ticket<Node>, Node) {
         let (ticket, mut node) = self.pool.take_reserve(handle);
+        self.spatial_index.invalidate();
         self.instance_id_map.remove(&node.instance_id);
         node.on_removed_from_graph(self);
         (ticket, node)
@@ -1099,8 +1491,21 @@ impl Graph {
 
     pub(crate) fn put_back_internal(&mut self, ticket: Ticket<Node>, node: Node) -> Handle<Node> {
         let instance_id = node.instance_id;
+        let script_count = node.scripts.len();
         let handle = self.pool.put_back(ticket, node);
+        self.spatial_index.invalidate();
         self.instance_id_map.insert(instance_id, handle);
+        // Notify the script processor that the scripts are back in the graph. Already initialized
+        // scripts won't be initialized twice.
+        for script_index in 0..script_count {
+            Log::verify(
+                self.script_message_sender
+                    .send(NodeScriptMessage::InitializeScript {
+                        handle,
+                        script_index,
+                    }),
+            );
+        }
         handle
     }
 
@@ -1141,7 +1546,7 @@ impl Graph {
     #[inline]
     pub fn put_sub_graph_back(&mut self, sub_graph: SubGraph) -> Handle<Node> {
         for (ticket, node) in sub_graph.descendants {
-            self.pool.put_back(ticket, node);
+            self.put_back_internal(ticket, node);
         }
 
         let (ticket, node) = sub_graph.root;
@@ -1162,6 +1567,83 @@ impl Graph {
         self.pool.forget_ticket(ticket);
     }
 
+    /// Reserves the given amount of handles for nodes, that will be added to the graph later using
+    /// [`Self::put_new_sub_graph`]. Reserved handles allow to build a hierarchy of new nodes outside
+    /// of the graph (for example, on other thread), with all the links between the nodes pointing to
+    /// their final handles. Every returned ticket must be either put in the graph or forgotten using
+    /// [`Self::forget_reserved_handle`].
+    #[inline]
+    pub fn reserve_handles(&mut self, count: usize) -> Vec<(Ticket<Node>, Handle<Node>)> {
+        self.forget_released_tickets();
+        (0..count).map(|_| self.pool.reserve_handle()).collect()
+    }
+
+    /// Makes a handle, reserved by [`Self::reserve_handles`], vacant again.
+    #[inline]
+    pub fn forget_reserved_handle(&mut self, ticket: Ticket<Node>) {
+        self.pool.forget_ticket(ticket);
+    }
+
+    /// Returns a sender, that could be used to release reserved handles without access to the graph.
+    pub(crate) fn released_ticket_sender(&self) -> Sender<ReleasedTicket> {
+        self.released_ticket_sender.clone()
+    }
+
+    fn forget_released_tickets(&mut self) {
+        while let Ok(ReleasedTicket(ticket)) = self.released_ticket_receiver.try_recv() {
+            self.pool.forget_ticket(ManuallyDrop::into_inner(ticket));
+        }
+    }
+
+    /// Adds a sub-graph of new nodes, that were built using reserved handles (see
+    /// [`Self::reserve_handles`]). Unlike [`Self::put_sub_graph_back`], the nodes are treated as new
+    /// ones: the graph initializes their scripts and broadcasts [`GraphEvent::Added`] for each of them.
+    /// Parent-child links between the nodes of the sub-graph must already be set, the root of the
+    /// sub-graph will be attached to [`SubGraph::parent`] or to the root of the graph, if the parent
+    /// handle is invalid.
+    #[inline]
+    pub fn put_new_sub_graph(&mut self, sub_graph: SubGraph) -> Handle<Node> {
+        let (root_ticket, mut root) = sub_graph.root;
+        root.parent = Handle::NONE;
+        let root_handle = self.put_new_node(root_ticket, root);
+        for (ticket, node) in sub_graph.descendants {
+            self.put_new_node(ticket, node);
+        }
+        self.spatial_index.invalidate();
+
+        if self.pool.is_valid_handle(sub_graph.parent) {
+            self.link_nodes(root_handle, sub_graph.parent);
+        } else if self.root.is_none() {
+            self.root = root_handle;
+        } else {
+            self.link_nodes(root_handle, self.root);
+        }
+
+        root_handle
+    }
+
+    fn put_new_node(&mut self, ticket: Ticket<Node>, mut node: Node) -> Handle<Node> {
+        let instance_id = node.instance_id;
+        let script_count = node.scripts.len();
+        node.script_message_sender = Some(self.script_message_sender.clone());
+        let handle = self.pool.put_back(ticket, node);
+        self.pool[handle].self_handle = handle;
+        self.instance_id_map.insert(instance_id, handle);
+
+        self.event_broadcaster.broadcast(GraphEvent::Added(handle));
+        for script_index in 0..script_count {
+            Log::verify(
+                self.script_message_sender
+                    .send(NodeScriptMessage::InitializeScript {
+                        handle,
+                        script_index,
+                    }),
+            );
+        }
+
+        handle
+    }
+
     /// Returns the number of nodes in the graph.
     #[inline]
     pub fn node_count(&self) -> u32 {
@@ -1525,6 +2007,7 @@ impl BaseSceneGraph for Graph {
         node.children.clear();
         let script_count = node.scripts.len();
         let handle = self.pool.spawn(node);
+        self.spatial_index.invalidate();
 
         if self.root.is_none() {
             self.root = handle;
@@ -1569,6 +2052,7 @@ impl BaseSceneGraph for Graph {
 
             // Remove associated entities.
             let mut node = self.pool.free(handle);
+            self.spatial_index.invalidate();
             self.instance_id_map.remove(&node.instance_id);
             node.on_removed_from_graph(self);
 
@@ -1580,7 +2064,9 @@ impl BaseSceneGraph for Graph {
     #[inline]
     fn link_nodes(&mut self, child: Handle<Self::Node>, parent: Handle<Self::Node>) {
         self.isolate_node(child);
-        self.pool[child].parent = parent;
+        let child_node = &mut self.pool[child];
+        child_node.parent = parent;
+        child_node.hierarchy_dirty.set(true);
         self.pool[parent].children.push(child);
     }
 
@@ -1641,21 +2127,27 @@ impl SceneGraph for Graph {
 #[cfg(test)]
 mod test {
     use crate::{
-        asset::{io::FsResourceIo, manager::ResourceManager},
+        asset::{io::FsResourceIo, manager::ResourceManager, untyped::ResourceKind},
         core::{
-            algebra::{Matrix4, Vector3},
+            algebra::{Matrix4, Vector2, Vector3},
             futures::executor::block_on,
+            math::{
+                aabb::AxisAlignedBoundingBox,
+                curve::{Curve, CurveKey, CurveKeyKind},
+                ray::Ray,
+            },
             pool::Handle,
             reflect::prelude::*,
             type_traits::prelude::*,
             visitor::prelude::*,
         },
         engine::{self, SerializationContext},
-        graph::{BaseSceneGraph, SceneGraph},
-        resource::model::{Model, ModelResourceExtension},
+        graph::{BaseSceneGraph, NodeMapping, SceneGraph},
+        resource::model::{InstanceCommitQueue, Model, ModelResource, ModelResourceExtension},
         scene::{
+            animation::{absm::prelude::*, prelude::*},
             base::BaseBuilder,
-            graph::Graph,
+            graph::{Graph, GraphUpdateSwitches},
             mesh::{
                 surface::{SurfaceBuilder, SurfaceData, SurfaceSharedData},
                 MeshBuilder,
@@ -1785,6 +2277,116 @@ mod test {
         assert_eq!(graph.pool.alive_count(), 1);
     }
 
+    #[test]
+    fn test_incremental_hierarchical_data_update() {
+        let mut graph = Graph::new();
+
+        let mut parents = Vec::new();
+        for i in 0..4 {
+            let parent = PivotBuilder::new(
+                BaseBuilder::new().with_local_transform(
+                    TransformBuilder::new()
+                        .with_local_position(Vector3::new(i as f32, 0.0, 0.0))
+                        .build(),
+                ),
+            )
+            .build(&mut graph);
+            for j in 0..3 {
+                let child = PivotBuilder::new(
+                    BaseBuilder::new().with_local_transform(
+                        TransformBuilder::new()
+                            .with_local_position(Vector3::new(0.0, j as f32, 0.0))
+                            .build(),
+                    ),
+                )
+                .build(&mut graph);
+                graph.link_nodes(child, parent);
+            }
+            parents.push(parent);
+        }
+
+        // Every node is new, so everything must be updated.
+        graph.update_hierarchical_data_incremental();
+        assert_eq!(graph.performance_statistics.hierarchical_nodes_updated, 17);
+
+        // Nothing has changed.
+        graph.update_hierarchical_data_incremental();
+        assert_eq!(graph.performance_statistics.hierarchical_nodes_updated, 0);
+
+        graph[parents[1]]
+            .local_transform_mut()
+            .set_position(Vector3::new(10.0, 20.0, 30.0));
+        graph[parents[2]].set_visibility(false);
+        graph.update_hierarchical_data_incremental();
+        assert_eq!(graph.performance_statistics.hierarchical_nodes_updated, 8);
+
+        let incremental = graph
+            .linear_iter()
+            .map(|n| (n.global_transform(), n.global_visibility()))
+            .collect::<Vec<_>>();
+        graph.update_hierarchical_data();
+        let full = graph
+            .linear_iter()
+            .map(|n| (n.global_transform(), n.global_visibility()))
+            .collect::<Vec<_>>();
+        assert_eq!(incremental, full);
+        assert!(!graph[graph[parents[2]].children()[0]].global_visibility());
+    }
+
+    #[test]
+    fn test_spatial_queries() {
+        let mut graph = Graph::new();
+
+        let surface = SurfaceSharedData::new(SurfaceData::make_cube(Matrix4::identity()));
+        let meshes = (0..10)
+            .map(|i| {
+                MeshBuilder::new(
+                    BaseBuilder::new().with_local_transform(
+                        TransformBuilder::new()
+                            .with_local_position(Vector3::new(i as f32 * 4.0, 0.0, 0.0))
+                            .build(),
+                    ),
+                )
+                .with_surfaces(vec![SurfaceBuilder::new(surface.clone()).build()])
+                .build(&mut graph)
+            })
+            .collect::<Vec<_>>();
+
+        graph.update_hierarchical_data();
+
+        let check = |graph: &Graph| {
+            let mut buffer = Vec::new();
+
+            graph.aabb_query(
+                &AxisAlignedBoundingBox::from_min_max(
+                    Vector3::new(3.0, -1.0, -1.0),
+                    Vector3::new(9.0, 1.0, 1.0),
+                ),
+                &mut buffer,
+            );
+            assert_eq!(buffer, vec![meshes[1], meshes[2]]);
+
+            graph.sphere_query(Vector3::new(20.0, 2.0, 0.0), 1.6, &mut buffer);
+            assert_eq!(buffer, vec![meshes[5]]);
+
+            // Closest node goes first.
+            graph.ray_query(
+                &Ray::from_two_points(Vector3::new(100.0, 0.0, 0.0), Vector3::new(22.0, 0.0, 0.0)),
+                &mut buffer,
+            );
+            assert_eq!(buffer, vec![meshes[9], meshes[8], meshes[7], meshes[6]]);
+        };
+
+        // Linear search.
+        assert!(graph.spatial_index().is_none());
+        check(&graph);
+
+        // Spatial index must give the same results.
+        graph.update_spatial_index();
+        assert!(graph.spatial_index().is_some());
+        check(&graph);
+    }
+
     #[test]
     fn graph_node_test() {
         let mut graph = Graph::new();
@@ -1845,6 +2447,80 @@ mod test {
         assert_eq!(result.1, "A");
     }
 
+    #[test]
+    fn test_two_phase_instantiation() {
+        let mut prefab = Scene::new();
+        let child =
+            PivotBuilder::new(BaseBuilder::new().with_name("Child")).build(&mut prefab.graph);
+        PivotBuilder::new(
+            BaseBuilder::new()
+                .with_name("Pivot")
+                .with_children(&[child]),
+        )
+        .build(&mut prefab.graph);
+        let model = ModelResource::new_ok(
+            ResourceKind::Embedded,
+            Model {
+                mapping: NodeMapping::UseNames,
+                scene: prefab,
+            },
+        );
+
+        let mut graph = Graph::new();
+        let reservation = model
+            .reserve_instance(&mut graph)
+            .with_position(Vector3::new(1.0, 2.0, 3.0));
+        let root = reservation.root();
+        assert!(graph.try_get(root).is_none());
+
+        // Reserved handles must not be used by new nodes.
+        let other = PivotBuilder::new(BaseBuilder::new()).build(&mut graph);
+        assert_ne!(other.index(), root.index());
+
+        let mut queue = InstanceCommitQueue::default();
+        queue.push(
+            std::thread::spawn(move || reservation.prepare())
+                .join()
+                .unwrap(),
+        );
+        assert_eq!(queue.commit(&mut graph, 0), vec![root]);
+        assert!(queue.is_empty());
+
+        let instance = &graph[root];
+        assert!(instance.is_resource_instance_root);
+        assert_eq!(instance.parent(), graph.get_root());
+        assert_eq!(instance.global_position(), Vector3::new(1.0, 2.0, 3.0));
+        let (_, child_instance) = graph.find_by_name(root, "Child").unwrap();
+        assert_eq!(child_instance.original_handle_in_resource(), child);
+        assert_eq!(
+            graph[child_instance.parent()].original_handle_in_resource(),
+            graph
+                .find_by_name(root, "Pivot")
+                .unwrap()
+                .1
+                .original_handle_in_resource()
+        );
+
+        // Cancelled instance must free its handles.
+        let count = graph.node_count();
+        let reservation = model.reserve_instance(&mut graph);
+        let root = reservation.root();
+        reservation.prepare().cancel(&mut graph);
+        assert_eq!(graph.node_count(), count);
+        assert!(graph.try_get(root).is_none());
+
+        // Dropped reservations and instances must not panic, their handles must be released by
+        // the graph.
+        drop(model.reserve_instance(&mut graph));
+        let capacity = graph.capacity();
+        drop(model.reserve_instance(&mut graph).prepare());
+        assert_eq!(graph.capacity(), capacity);
+        graph.update(Vector2::new(800.0, 600.0), 0.0, Default::default());
+        assert_eq!(graph.node_count(), count);
+        drop(model.reserve_instance(&mut graph));
+        assert_eq!(graph.capacity(), capacity);
+    }
+
     fn create_scene() -> Scene {
         let mut scene = Scene::new();
 
@@ -1979,4 +2655,81 @@ mod test {
                 .unwrap();
         }
     }
+
+    // Creates a graph with a set of animation players, every second player is controlled by an animation
+    // blending state machine. Returns the graph and the animated nodes.
+    fn make_animated_graph(count: usize) -> (Graph, Vec<Handle<Node>>) {
+        let mut graph = Graph::new();
+        let mut targets = Vec::new();
+
+        for i in 0..count {
+            let target = PivotBuilder::new(BaseBuilder::new()).build(&mut graph);
+
+            let mut container = TrackDataContainer::new(TrackValueKind::Vector3);
+            for (k, curve) in container.curves_mut().iter_mut().enumerate() {
+                *curve = Curve::from(vec![
+                    CurveKey::new(0.0, 0.0, CurveKeyKind::Linear),
+                    CurveKey::new(0.7, (i + k) as f32 * 0.37, CurveKeyKind::Linear),
+                    CurveKey::new(1.0, -(k as f32), CurveKeyKind::Constant),
+                ]);
+            }
+            let mut track = Track::new(container, ValueBinding::Position);
+            track.set_target(target);
+
+            let mut animation = Animation::default();
+            animation.add_track(track);
+            animation.set_time_slice(0.0..1.0);
+            animation.set_enabled(true);
+
+            let mut animations = AnimationContainer::new();
+            let animation = animations.add(animation);
+
+            let player = AnimationPlayerBuilder::new(BaseBuilder::new())
+                .with_animations(animations)
+                .build(&mut graph);
+
+            if i % 2 == 0 {
+                let mut layer = MachineLayer::new();
+                let node = layer.add_node(PoseNode::make_play_animation(animation));
+                let state = layer.add_state(State::new("Play", node));
+                layer.set_entry_state(state);
+                let mut machine = Machine::new();
+                machine.add_layer(layer);
+
+                AnimationBlendingStateMachineBuilder::new(BaseBuilder::new())
+                    .with_machine(machine)
+                    .with_animation_player(player)
+                    .build(&mut graph);
+            }
+
+            targets.push(target);
+        }
+
+        (graph, targets)
+    }
+
+    #[test]
+    fn test_parallel_animation_matches_serial() {
+        let count = 4 * crate::scene::animation::PARALLEL_ANIMATION_THRESHOLD;
+        let (mut serial, serial_targets) = make_animated_graph(count);
+        let (mut parallel, parallel_targets) = make_animated_graph(count);
+
+        for _ in 0..50 {
+            serial.update(
+                Vector2::new(100.0, 100.0),
+                1.0 / 60.0,
+                GraphUpdateSwitches {
+                    parallel_animation: false,
+                    ..Default::default()
+                },
+            );
+            parallel.update(Vector2::new(100.0, 100.0), 1.0 / 60.0, Default::default());
+
+            for (a, b) in serial_targets.iter().zip(parallel_targets.iter()) {
+                let a = **serial[*a].local_transform().position();
+                let b = **parallel[*b].local_transform().position();
+                assert_eq!(a.map(f32::to_bits), b.map(f32::to_bits));
+            }
+        }
+    }
 }
@@ -2,14 +2,11 @@
 
 use crate::{
     core::{
-        algebra::{
-            DMatrix, Dyn, Isometry3, Matrix4, Point3, Translation3, UnitQuaternion, VecStorage,
-            Vector2, Vector3,
-        },
+        algebra::{Isometry3, Matrix4, Point3, Translation3, UnitQuaternion, Vector2, Vector3},
         arrayvec::ArrayVec,
         instant,
         log::{Log, MessageKind},
-        math::Matrix4Ext,
+        math::{m4x4_approx_eq, Matrix4Ext},
         parking_lot::Mutex,
         pool::Handle,
         reflect::prelude::*,
@@ -21,18 +18,19 @@ use crate::{
         self,
         collider::{self, ColliderShape, GeometrySource},
         debug::SceneDrawingContext,
-        graph::{isometric_global_transform, NodePool},
-        joint::{JointLocalFrames, JointParams},
-        mesh::{
-            buffer::{VertexAttributeUsage, VertexReadTrait},
-            Mesh,
+        graph::{
+            isometric_global_transform,
+            shape_cache::{MeshShapeKind, ShapeCache},
+            NodePool,
         },
+        joint::{JointLocalFrames, JointParams},
+        mesh::Mesh,
         node::{Node, NodeTrait},
         rigidbody::ApplyAction,
         terrain::Terrain,
     },
-    utils::raw_mesh::{RawMeshBuilder, RawVertex},
 };
+use fxhash::FxHashMap;
 use fyrox_core::algebra::Translation;
 use fyrox_core::uuid_provider;
 use rapier2d::na::UnitVector3;
@@ -49,9 +47,10 @@ use rapier3d::{
     pipeline::{DebugRenderPipeline, EventHandler, PhysicsPipeline, QueryPipeline},
     prelude::JointAxis,
 };
+use rayon::prelude::*;
 use std::num::NonZeroUsize;
 use std::{
-    cell::{Cell, RefCell},
+    cell::{Cell, Ref, RefCell},
     cmp::Ordering,
     fmt::{Debug, Formatter},
     hash::Hash,
@@ -445,238 +444,39 @@ fn convert_joint_params(
     joint
 }
 
-/// Creates new trimesh collider shape from given mesh node. It also bakes scale into
-/// vertices of trimesh because rapier does not support collider scaling yet.
-fn make_trimesh(
-    owner_inv_transform: Matrix4<f32>,
-    owner: Handle<Node>,
-    sources: &[GeometrySource],
-    nodes: &NodePool,
-) -> SharedShape {
-    let mut mesh_builder = RawMeshBuilder::new(0, 0);
-
-    // Create inverse transform that will discard rotation and translation, but leave scaling and
-    // other parameters of global transform.
-    // When global transform of node is combined with this transform, we'll get relative transform
-    // with scale baked in. We need to do this because root's transform will be synced with body's
-    // but we don't want to bake entire transform including root's transform.
-    let root_inv_transform = owner_inv_transform;
-
-    for &source in sources {
-        if let Some(mesh) = nodes.try_borrow(source.0).and_then(|n| n.cast::<Mesh>()) {
-            let global_transform = root_inv_transform * mesh.global_transform();
-
-            for surface in mesh.surfaces() {
-                let shared_data = surface.data();
-                let shared_data = shared_data.lock();
-
-                let vertices = &shared_data.vertex_buffer;
-                for triangle in shared_data.geometry_buffer.iter() {
-                    let a = RawVertex::from(
-                        global_transform
-                            .transform_point(&Point3::from(
-                                vertices
-                                    .get(triangle[0] as usize)
-                                    .unwrap()
-                                    .read_3_f32(VertexAttributeUsage::Position)
-                                    .unwrap(),
-                            ))
-                            .coords,
-                    );
-                    let b = RawVertex::from(
-                        global_transform
-                            .transform_point(&Point3::from(
-                                vertices
-                                    .get(triangle[1] as usize)
-                                    .unwrap()
-                                    .read_3_f32(VertexAttributeUsage::Position)
-                                    .unwrap(),
-                            ))
-                            .coords,
-                    );
-                    let c = RawVertex::from(
-                        global_transform
-                            .transform_point(&Point3::from(
-                                vertices
-                                    .get(triangle[2] as usize)
-                                    .unwrap()
-                                    .read_3_f32(VertexAttributeUsage::Position)
-                                    .unwrap(),
-                            ))
-                            .coords,
-                    );
-
-                    mesh_builder.insert(a);
-                    mesh_builder.insert(b);
-                    mesh_builder.insert(c);
-                }
-            }
-        }
-    }
-
-    let raw_mesh = mesh_builder.build();
-
-    let vertices: Vec<Point3<f32>> = raw_mesh
-        .vertices
-        .into_iter()
-        .map(|v| Point3::new(v.x, v.y, v.z))
-        .collect();
-
-    let indices = raw_mesh
-        .triangles
-        .into_iter()
-        .map(|t| [t.0[0], t.0[1], t.0[2]])
-        .collect::<Vec<_>>();
-
-    if indices.is_empty() {
-        Log::writeln(
-            MessageKind::Warning,
-            format!(
-                "Failed to create triangle mesh collider for {}, it has no vertices!",
-                nodes[owner].name()
-            ),
-        );
-
-        SharedShape::trimesh(vec![Point3::new(0.0, 0.0, 0.0)], vec![[0, 0, 0]])
-    } else {
-        SharedShape::trimesh(vertices, indices)
-    }
-}
-
-/// Creates new convex polyhedron collider shape from given mesh node. It also bakes scale into
-/// vertices of trimesh because rapier does not support collider scaling yet.
-fn make_polyhedron_shape(owner_inv_transform: Matrix4<f32>, mesh: &Mesh) -> SharedShape {
-    let mut mesh_builder = RawMeshBuilder::new(0, 0);
-
-    // Create inverse transform that will discard rotation and translation, but leave scaling and
-    // other parameters of global transform.
-    // When global transform of node is combined with this transform, we'll get relative transform
-    // with scale baked in. We need to do this because root's transform will be synced with body's
-    // but we don't want to bake entire transform including root's transform.
-    let root_inv_transform = owner_inv_transform;
-
-    let global_transform = root_inv_transform * mesh.global_transform();
-
-    for surface in mesh.surfaces() {
-        let shared_data = surface.data();
-        let shared_data = shared_data.lock();
-
-        let vertices = &shared_data.vertex_buffer;
-        for triangle in shared_data.geometry_buffer.iter() {
-            let a = RawVertex::from(
-                global_transform
-                    .transform_point(&Point3::from(
-                        vertices
-                            .get(triangle[0] as usize)
-                            .unwrap()
-                            .read_3_f32(VertexAttributeUsage::Position)
-                            .unwrap(),
-                    ))
-                    .coords,
-            );
-            let b = RawVertex::from(
-                global_transform
-                    .transform_point(&Point3::from(
-                        vertices
-                            .get(triangle[1] as usize)
-                            .unwrap()
-                            .read_3_f32(VertexAttributeUsage::Position)
-                            .unwrap(),
-                    ))
-                    .coords,
-            );
-            let c = RawVertex::from(
-                global_transform
-                    .transform_point(&Point3::from(
-                        vertices
-                            .get(triangle[2] as usize)
-                            .unwrap()
-                            .read_3_f32(VertexAttributeUsage::Position)
-                            .unwrap(),
-                    ))
-                    .coords,
-            );
-
-            mesh_builder.insert(a);
-            mesh_builder.insert(b);
-            mesh_builder.insert(c);
-        }
-    }
-
-    let raw_mesh = mesh_builder.build();
-
-    let vertices: Vec<Point3<f32>> = raw_mesh
-        .vertices
-        .into_iter()
-        .map(|v| Point3::new(v.x, v.y, v.z))
-        .collect();
-
-    let indices = raw_mesh
-        .triangles
-        .into_iter()
-        .map(|t| [t.0[0], t.0[1], t.0[2]])
-        .collect::<Vec<_>>();
-
-    SharedShape::convex_decomposition(&vertices, &indices)
-}
-
-/// Creates height field shape from given terrain.
-fn make_heightfield(terrain: &Terrain) -> SharedShape {
-    assert!(!terrain.chunks_ref().is_empty());
-
-    // HACK: Temporary solution for https://github.com/FyroxEngine/Fyrox/issues/365
-    let scale = terrain.local_transform().scale();
-
-    // Count rows and columns.
-    let height_map_size = terrain.height_map_size();
-    let nrows = height_map_size.y * terrain.length_chunks().len() as u32;
-    let ncols = height_map_size.x * terrain.width_chunks().len() as u32;
-
-    // Combine height map of each chunk into bigger one.
-    let mut ox = 0;
-    let mut oz = 0;
-    let mut data = vec![0.0; (nrows * ncols) as usize];
-    for cz in 0..terrain.length_chunks().len() {
-        for cx in 0..terrain.width_chunks().len() {
-            let chunk = &terrain.chunks_ref()[cz * terrain.width_chunks().len() + cx];
-            let texture = chunk.heightmap().data_ref();
-            let height_map = texture.data_of_type::<f32>().unwrap();
-            for iy in 0..height_map_size.y {
-                for ix in 0..height_map_size.x {
-                    let value = height_map[(iy * height_map_size.x + ix) as usize] * scale.y;
-                    data[((ox + ix) * nrows + oz + iy) as usize] = value;
-                }
-            }
-
-            ox += height_map_size.x;
-        }
-
-        ox = 0;
-        oz += height_map_size.y;
-    }
-
-    SharedShape::heightfield(
-        DMatrix::from_data(VecStorage::new(
-            Dyn(nrows as usize),
-            Dyn(ncols as usize),
-            data,
-        )),
-        Vector3::new(
-            terrain.chunk_size().x * scale.x * terrain.width_chunks().len() as f32,
-            1.0,
-            terrain.chunk_size().y * scale.z * terrain.length_chunks().len() as f32,
-        ),
-    )
-}
-
-// Converts descriptor in a shared shape.
+// Converts descriptor in a shared shape. Geometry-based shapes are taken from the cache. If the
+// collider is specified, missing mesh-based shapes are built in background and `None` is returned,
+// the collider will get its shape later.
 fn collider_shape_into_native_shape(
     shape: &ColliderShape,
     owner_inv_global_transform: Matrix4<f32>,
     owner_collider: Handle<Node>,
     pool: &NodePool,
+    shape_cache: &mut ShapeCache,
+    background: Option<ColliderHandle>,
 ) -> Option<SharedShape> {
-    match shape {
+    let mesh_shape =
+        |shape_cache: &mut ShapeCache, kind: MeshShapeKind, sources: &[GeometrySource]| {
+            match background {
+                Some(collider) => shape_cache.request_mesh_shape(
+                    collider,
+                    kind,
+                    owner_collider,
+                    owner_inv_global_transform,
+                    sources,
+                    pool,
+                ),
+                None => Some(shape_cache.mesh_shape(
+                    kind,
+                    owner_collider,
+                    owner_inv_global_transform,
+                    sources,
+                    pool,
+                )),
+            }
+        };
+
+    let native_shape = match shape {
         ColliderShape::Ball(ball) => Some(SharedShape::ball(ball.radius)),
 
         ColliderShape::Cylinder(cylinder) => {
@@ -704,23 +504,36 @@ fn collider_shape_into_native_shape(
             if trimesh.sources.is_empty() {
                 None
             } else {
-                Some(make_trimesh(
-                    owner_inv_global_transform,
-                    owner_collider,
-                    &trimesh.sources,
-                    pool,
-                ))
+                return mesh_shape(shape_cache, MeshShapeKind::Trimesh, &trimesh.sources);
             }
         }
         ColliderShape::Heightfield(heightfield) => pool
             .try_borrow(heightfield.geometry_source.0)
             .and_then(|n| n.cast::<Terrain>())
-            .map(make_heightfield),
-        ColliderShape::Polyhedron(polyhedron) => pool
-            .try_borrow(polyhedron.geometry_source.0)
-            .and_then(|n| n.cast::<Mesh>())
-            .map(|mesh| make_polyhedron_shape(owner_inv_global_transform, mesh)),
+            .map(|terrain| shape_cache.heightfield_shape(heightfield.geometry_source.0, terrain)),
+        ColliderShape::Polyhedron(polyhedron) => {
+            if pool
+                .try_borrow(polyhedron.geometry_source.0)
+                .and_then(|n| n.cast::<Mesh>())
+                .is_some()
+            {
+                return mesh_shape(
+                    shape_cache,
+                    MeshShapeKind::Polyhedron,
+                    std::slice::from_ref(&polyhedron.geometry_source),
+                );
+            } else {
+                None
+            }
+        }
+    };
+
+    // The shape is ready, so the collider must not wait for a previously requested shape anymore.
+    if let (Some(collider), Some(_)) = (background, native_shape.as_ref()) {
+        shape_cache.forget(collider);
     }
+
+    native_shape
 }
 
 /// Parameters for a time-step of the physics engine.
@@ -849,8 +662,42 @@ pub struct IntegrationParameters {
         description = "Maximum number of substeps performed by the  solver (default: `4`)."
     )]
     pub max_ccd_substeps: u32,
+
+    /// Enables fixed time step mode (default: `false`). In this mode the simulation is always
+    /// advanced by steps of `dt` length (or [`DEFAULT_FIXED_TIMESTEP`] if `dt` is `None`): frame
+    /// time is accumulated and the simulation performs as many steps as fit in the accumulated
+    /// time. The results of the simulation do not depend on the frame rate, which makes it
+    /// deterministic for the same sequence of frame times.
+    #[reflect(
+        description = "Enables fixed time step mode (default: `false`). In this mode the \
+        simulation is always advanced by steps of `dt` length (or 1/60 s if `dt` is not set)."
+    )]
+    pub fixed_timestep: bool,
+
+    /// Maximum amount of simulation steps per frame in fixed time step mode (default: `5`). If a
+    /// frame takes too long, the rest of accumulated time is dropped, so the simulation slows
+    /// down instead of falling into a "spiral of death" (more steps - longer frames - more steps).
+    #[reflect(
+        min_value = 1.0,
+        description = "Maximum amount of simulation steps per frame in fixed time step mode \
+        (default: `5`)."
+    )]
+    pub max_steps_per_frame: u32,
+
+    /// Enables interpolation of transforms of dynamic rigid bodies between the last two simulation
+    /// steps in fixed time step mode (default: `true`). It removes jittering of rigid bodies when
+    /// the frame rate does not match the simulation rate. Interpolated transforms are visual
+    /// only and do not affect the simulation.
+    #[reflect(
+        description = "Enables interpolation of transforms of dynamic rigid bodies between \
+        the last two simulation steps in fixed time step mode (default: `true`)."
+    )]
+    pub interpolation: bool,
 }
 
+/// Time step of the simulation in fixed time step mode if [`IntegrationParameters::dt`] is not set.
+pub const DEFAULT_FIXED_TIMESTEP: f32 = 1.0 / 60.0;
+
 impl Default for IntegrationParameters {
     fn default() -> Self {
         Self {
@@ -868,6 +715,9 @@ impl Default for IntegrationParameters {
             num_solver_iterations: 4,
             min_island_size: 128,
             max_ccd_substeps: 4,
+            fixed_timestep: false,
+            max_steps_per_frame: 5,
+            interpolation: true,
         }
     }
 }
@@ -935,6 +785,36 @@ pub struct PhysicsWorld {
     #[visit(skip)]
     #[reflect(hidden)]
     query: RefCell<QueryPipeline>,
+    // A flag, that defines whether the query pipeline must be updated before the next scene query.
+    #[visit(skip)]
+    #[reflect(hidden)]
+    need_update_query: Cell<bool>,
+    // Rigid bodies and colliders, that were removed from the world, but still exist in the native
+    // sets in disabled state. Actual deletion is deferred until the next simulation step, so the
+    // query pipeline never refers to deleted entities and could be updated once per step.
+    #[visit(skip)]
+    #[reflect(hidden)]
+    removed_bodies: Vec<RigidBodyHandle>,
+    #[visit(skip)]
+    #[reflect(hidden)]
+    removed_colliders: Vec<ColliderHandle>,
+    // Time, that was accumulated in fixed time step mode, but not yet simulated.
+    #[visit(skip)]
+    #[reflect(hidden)]
+    accumulator: f32,
+    // Interpolation factor between previous and current poses of rigid bodies in fixed time step
+    // mode.
+    #[visit(skip)]
+    #[reflect(hidden)]
+    interpolation_alpha: f32,
+    // Poses of active dynamic rigid bodies before the last simulation step. Used for interpolation.
+    #[visit(skip)]
+    #[reflect(hidden)]
+    previous_poses: FxHashMap<RigidBodyHandle, Isometry3<f32>>,
+    // Shapes built from scene geometry, shared between colliders with identical geometry.
+    #[visit(skip)]
+    #[reflect(hidden)]
+    shape_cache: ShapeCache,
     #[visit(skip)]
     #[reflect(hidden)]
     debug_render_pipeline: Mutex<DebugRenderPipeline>,
@@ -1011,6 +891,145 @@ pub struct TOI {
     pub status: collider::TOIStatus,
 }
 
+/// A set of options for a single shape cast in a batch, see [`PhysicsWorld::cast_shapes`] for more
+/// info.
+pub struct ShapeCastOptions<'a> {
+    /// The shape to cast.
+    pub shape: &'a dyn Shape,
+    /// The initial position of the shape to cast.
+    pub shape_pos: Isometry3<f32>,
+    /// The constant velocity of the shape to cast (i.e. the cast direction).
+    pub shape_vel: Vector3<f32>,
+    /// The maximum time-of-impact that can be reported by this cast.
+    pub max_toi: f32,
+    /// If set to `false`, the cast won’t immediately stop if the shape is penetrating another shape
+    /// at its starting point **and** its trajectory is such that it’s on a path to exist that
+    /// penetration state.
+    pub stop_at_penetration: bool,
+    /// Flags indicating what particular type of colliders should be excluded from the scene query.
+    pub flags: collider::QueryFilterFlags,
+    /// If set, only colliders with collision groups compatible with this one will
+    /// be included in the scene query.
+    pub groups: Option<collider::InteractionGroups>,
+    /// If set, this collider will be excluded from the scene query.
+    pub exclude_collider: Option<Handle<Node>>,
+    /// If set, any collider attached to this rigid-body will be excluded from the scene query.
+    pub exclude_rigid_body: Option<Handle<Node>>,
+}
+
+// Minimal amount of scene queries processed by a single thread in batched mode, queries are quite
+// fast so there's no need to split a batch into too small tasks.
+const MIN_QUERIES_PER_TASK: usize = 16;
+
+fn is_collider_enabled(_: ColliderHandle, collider: &Collider) -> bool {
+    // Removed colliders are disabled until the next simulation step.
+    collider.is_enabled()
+}
+
+fn native_exclusions(
+    graph: &Graph,
+    exclude_collider: Option<Handle<Node>>,
+    exclude_rigid_body: Option<Handle<Node>>,
+) -> (Option<ColliderHandle>, Option<RigidBodyHandle>) {
+    (
+        exclude_collider
+            .and_then(|h| graph.try_get(h))
+            .and_then(|n| n.component_ref::<collider::Collider>())
+            .map(|c| c.native.get()),
+        exclude_rigid_body
+            .and_then(|h| graph.try_get(h))
+            .and_then(|n| n.component_ref::<rigidbody::RigidBody>())
+            .map(|c| c.native.get()),
+    )
+}
+
+fn cast_ray_native<S: QueryResultsStorage>(
+    query: &QueryPipeline,
+    bodies: &RigidBodySet,
+    colliders: &ColliderSet,
+    opts: &RayCastOptions,
+    query_buffer: &mut S,
+) {
+    query_buffer.clear();
+    let ray = Ray::new(
+        opts.ray_origin,
+        opts.ray_direction
+            .try_normalize(f32::EPSILON)
+            .unwrap_or_default(),
+    );
+    query.intersections_with_ray(
+        bodies,
+        colliders,
+        &ray,
+        opts.max_len,
+        true,
+        rapier3d::pipeline::QueryFilter::new()
+            .groups(InteractionGroups::new(
+                u32_to_group(opts.groups.memberships.0),
+                u32_to_group(opts.groups.filter.0),
+            ))
+            .predicate(&is_collider_enabled),
+        |handle, intersection| {
+            query_buffer.push(Intersection {
+                collider: Handle::decode_from_u128(colliders.get(handle).unwrap().user_data),
+                normal: intersection.normal,
+                position: ray.point_at(intersection.toi),
+                feature: intersection.feature.into(),
+                toi: intersection.toi,
+            })
+        },
+    );
+    if opts.sort_results {
+        query_buffer.sort_intersections_by(|a, b| {
+            if a.toi > b.toi {
+                Ordering::Greater
+            } else if a.toi < b.toi {
+                Ordering::Less
+            } else {
+                Ordering::Equal
+            }
+        })
+    }
+}
+
+#[allow(clippy::too_many_arguments)]
+fn cast_shape_native(
+    query: &QueryPipeline,
+    bodies: &RigidBodySet,
+    colliders: &ColliderSet,
+    shape: &dyn Shape,
+    shape_pos: &Isometry3<f32>,
+    shape_vel: &Vector3<f32>,
+    max_toi: f32,
+    stop_at_penetration: bool,
+    filter: rapier3d::pipeline::QueryFilter,
+) -> Option<(Handle<Node>, TOI)> {
+    query
+        .cast_shape(
+            bodies,
+            colliders,
+            shape_pos,
+            shape_vel,
+            shape,
+            max_toi,
+            stop_at_penetration,
+            filter,
+        )
+        .map(|(handle, toi)| {
+            (
+                Handle::decode_from_u128(colliders.get(handle).unwrap().user_data),
+                TOI {
+                    toi: toi.toi,
+                    witness1: toi.witness1,
+                    witness2: toi.witness2,
+                    normal1: toi.normal1,
+                    normal2: toi.normal2,
+                    status: toi.status.into(),
+                },
+            )
+        })
+}
+
 impl PhysicsWorld {
     /// Creates a new instance of the physics world.
     pub(super) fn new() -> Self {
@@ -1035,6 +1054,13 @@ impl PhysicsWorld {
             },
             event_handler: Box::new(()),
             query: RefCell::new(Default::default()),
+            need_update_query: Cell::new(true),
+            removed_bodies: Default::default(),
+            removed_colliders: Default::default(),
+            accumulator: 0.0,
+            interpolation_alpha: 1.0,
+            previous_poses: Default::default(),
+            shape_cache: Default::default(),
             performance_statistics: Default::default(),
             debug_render_pipeline: Default::default(),
         }
@@ -1043,67 +1069,169 @@ impl PhysicsWorld {
     pub(super) fn update(&mut self, dt: f32) {
         let time = instant::Instant::now();
 
+        self.delete_removed_entities();
+        self.sync_shape_cache();
+
         if *self.enabled {
-            let integration_parameters = rapier3d::dynamics::IntegrationParameters {
-                dt: self.integration_parameters.dt.unwrap_or(dt),
-                min_ccd_dt: self.integration_parameters.min_ccd_dt,
-                erp: self.integration_parameters.erp,
-                damping_ratio: self.integration_parameters.damping_ratio,
-                joint_erp: self.integration_parameters.joint_erp,
-                joint_damping_ratio: self.integration_parameters.joint_damping_ratio,
-                allowed_linear_error: self.integration_parameters.allowed_linear_error,
-                max_penetration_correction: self.integration_parameters.max_penetration_correction,
-                prediction_distance: self.integration_parameters.prediction_distance,
-                num_solver_iterations: NonZeroUsize::new(
-                    self.integration_parameters.num_solver_iterations,
-                )
-                .unwrap(),
-                num_additional_friction_iterations: self
-                    .integration_parameters
-                    .num_additional_friction_iterations,
-                num_internal_pgs_iterations: self
+            if self.integration_parameters.fixed_timestep {
+                let step_dt = self
                     .integration_parameters
-                    .num_internal_pgs_iterations,
-                min_island_size: self.integration_parameters.min_island_size as usize,
-                max_ccd_substeps: self.integration_parameters.max_ccd_substeps as usize,
-            };
-
-            self.pipeline.step(
-                &self.gravity,
-                &integration_parameters,
+                    .dt
+                    .unwrap_or(DEFAULT_FIXED_TIMESTEP);
+                let max_steps = self.integration_parameters.max_steps_per_frame.max(1);
+
+                self.accumulator += dt;
+                let step_count = ((self.accumulator / step_dt) as u32).min(max_steps);
+                for i in 0..step_count {
+                    if i + 1 == step_count {
+                        self.store_previous_poses();
+                    }
+                    self.step(step_dt);
+                    self.accumulator -= step_dt;
+                }
+
+                // Drop the time that could not be simulated in this frame (if the amount of steps
+                // was clamped), so the simulation will slow down instead of accumulating lag.
+                if self.accumulator >= step_dt {
+                    self.accumulator %= step_dt;
+                }
+                self.accumulator = self.accumulator.max(0.0);
+                self.interpolation_alpha = (self.accumulator / step_dt).clamp(0.0, 1.0);
+            } else {
+                self.accumulator = 0.0;
+                self.interpolation_alpha = 1.0;
+                self.previous_poses.clear();
+                self.step(self.integration_parameters.dt.unwrap_or(dt));
+            }
+        }
+
+        self.query.get_mut().update(&self.bodies, &self.colliders);
+        self.need_update_query.set(false);
+
+        self.performance_statistics.step_time += instant::Instant::now() - time;
+    }
+
+    fn step(&mut self, dt: f32) {
+        let integration_parameters = rapier3d::dynamics::IntegrationParameters {
+            dt,
+            min_ccd_dt: self.integration_parameters.min_ccd_dt,
+            erp: self.integration_parameters.erp,
+            damping_ratio: self.integration_parameters.damping_ratio,
+            joint_erp: self.integration_parameters.joint_erp,
+            joint_damping_ratio: self.integration_parameters.joint_damping_ratio,
+            allowed_linear_error: self.integration_parameters.allowed_linear_error,
+            max_penetration_correction: self.integration_parameters.max_penetration_correction,
+            prediction_distance: self.integration_parameters.prediction_distance,
+            num_solver_iterations: NonZeroUsize::new(
+                self.integration_parameters.num_solver_iterations,
+            )
+            .unwrap(),
+            num_additional_friction_iterations: self
+                .integration_parameters
+                .num_additional_friction_iterations,
+            num_internal_pgs_iterations: self.integration_parameters.num_internal_pgs_iterations,
+            min_island_size: self.integration_parameters.min_island_size as usize,
+            max_ccd_substeps: self.integration_parameters.max_ccd_substeps as usize,
+        };
+
+        self.pipeline.step(
+            &self.gravity,
+            &integration_parameters,
+            &mut self.islands,
+            &mut self.broad_phase,
+            &mut self.narrow_phase,
+            &mut self.bodies,
+            &mut self.colliders,
+            &mut self.joints.set,
+            &mut self.multibody_joints.set,
+            &mut self.ccd_solver,
+            // In Rapier 0.17 passing query pipeline here sometimes causing panic in numeric overflow,
+            // so we keep updating it manually.
+            None,
+            &(),
+            &*self.event_handler,
+        );
+    }
+
+    fn store_previous_poses(&mut self) {
+        self.previous_poses.clear();
+        if self.integration_parameters.interpolation {
+            for &handle in self.islands.active_dynamic_bodies() {
+                if let Some(body) = self.bodies.get(handle) {
+                    self.previous_poses.insert(handle, *body.position());
+                }
+            }
+        }
+    }
+
+    /// Returns current interpolation factor between previous and current poses of rigid bodies in
+    /// fixed time step mode. It is in `[0; 1]` range, where `1.0` means the current pose. See
+    /// [`IntegrationParameters::interpolation`] for more info.
+    pub fn interpolation_alpha(&self) -> f32 {
+        self.interpolation_alpha
+    }
+
+    fn delete_removed_entities(&mut self) {
+        for handle in self.removed_colliders.drain(..) {
+            self.shape_cache.forget(handle);
+            self.colliders
+                .remove(handle, &mut self.islands, &mut self.bodies, false);
+        }
+        for handle in self.removed_bodies.drain(..) {
+            self.bodies.remove(
+                handle,
                 &mut self.islands,
-                &mut self.broad_phase,
-                &mut self.narrow_phase,
-                &mut self.bodies,
                 &mut self.colliders,
                 &mut self.joints.set,
                 &mut self.multibody_joints.set,
-                &mut self.ccd_solver,
-                // In Rapier 0.17 passing query pipeline here sometimes causing panic in numeric overflow,
-                // so we keep updating it manually.
-                None,
-                &(),
-                &*self.event_handler,
+                true,
             );
         }
+    }
 
-        self.performance_statistics.step_time += instant::Instant::now() - time;
+    // Assigns shapes, that were built in background, to their colliders and removes unused shapes
+    // from the cache.
+    fn sync_shape_cache(&mut self) {
+        for (collider, shape) in self.shape_cache.take_finished() {
+            if let Some(native) = self.colliders.get_mut(collider) {
+                native.set_shape(shape);
+                self.need_update_query.set(true);
+            }
+        }
+        self.shape_cache.collect_garbage();
+    }
+
+    // Returns the query pipeline, that is updated only if the world has changed since the last
+    // simulation step.
+    fn updated_query(&self) -> Ref<QueryPipeline> {
+        if self.need_update_query.replace(false) {
+            self.query
+                .borrow_mut()
+                .update(&self.bodies, &self.colliders);
+        }
+        self.query.borrow()
     }
 
     pub(super) fn add_body(&mut self, owner: Handle<Node>, mut body: RigidBody) -> RigidBodyHandle {
         body.user_data = owner.encode_to_u128();
+        self.need_update_query.set(true);
         self.bodies.insert(body)
     }
 
     pub(crate) fn remove_body(&mut self, handle: RigidBodyHandle) {
-        self.bodies.remove(
-            handle,
-            &mut self.islands,
-            &mut self.colliders,
-            &mut self.joints.set,
-            &mut self.multibody_joints.set,
-            true,
-        );
+        // The body is disabled and will be deleted on the next simulation step, see
+        // `delete_removed_entities`.
+        if let Some(body) = self.bodies.get_mut(handle) {
+            if body.is_enabled() {
+                body.set_enabled(false);
+                for collider in body.colliders() {
+                    if let Some(collider) = self.colliders.get_mut(*collider) {
+                        collider.set_enabled(false);
+                    }
+                }
+                self.removed_bodies.push(handle);
+            }
+        }
     }
 
     pub(super) fn add_collider(
@@ -1113,14 +1241,22 @@ impl PhysicsWorld {
         mut collider: Collider,
     ) -> ColliderHandle {
         collider.user_data = owner.encode_to_u128();
+        self.need_update_query.set(true);
         self.colliders
             .insert_with_parent(collider, parent_body, &mut self.bodies)
     }
 
     pub(crate) fn remove_collider(&mut self, handle: ColliderHandle) -> bool {
-        self.colliders
-            .remove(handle, &mut self.islands, &mut self.bodies, false)
-            .is_some()
+        // The collider is disabled and will be deleted on the next simulation step, see
+        // `delete_removed_entities`.
+        match self.colliders.get_mut(handle) {
+            Some(collider) if collider.is_enabled() => {
+                collider.set_enabled(false);
+                self.removed_colliders.push(handle);
+                true
+            }
+            _ => false,
+        }
     }
 
     pub(super) fn add_joint(
@@ -1154,59 +1290,46 @@ impl PhysicsWorld {
         );
     }
 
-    /// Casts a ray with given options.
+    /// Casts a ray with given options. The query pipeline is updated once per simulation step (or
+    /// lazily, if the world was changed since the last step), so it is fine to cast a lot of rays
+    /// per frame. Use [`Self::cast_rays`] to cast a large batch of rays in parallel.
     pub fn cast_ray<S: QueryResultsStorage>(&self, opts: RayCastOptions, query_buffer: &mut S) {
         let time = instant::Instant::now();
 
-        let mut query = self.query.borrow_mut();
-
-        // TODO: Ideally this must be called once per frame, but it seems to be impossible because
-        // a body can be deleted during the consecutive calls of this method which will most
-        // likely end up in panic because of invalid handle stored in internal acceleration
-        // structure. This could be fixed by delaying deleting of bodies/collider to the end
-        // of the frame.
-        query.update(&self.bodies, &self.colliders);
-
-        query_buffer.clear();
-        let ray = Ray::new(
-            opts.ray_origin,
-            opts.ray_direction
-                .try_normalize(f32::EPSILON)
-                .unwrap_or_default(),
-        );
-        query.intersections_with_ray(
-            &self.bodies,
-            &self.colliders,
-            &ray,
-            opts.max_len,
-            true,
-            rapier3d::pipeline::QueryFilter::new().groups(InteractionGroups::new(
-                u32_to_group(opts.groups.memberships.0),
-                u32_to_group(opts.groups.filter.0),
-            )),
-            |handle, intersection| {
-                query_buffer.push(Intersection {
-                    collider: Handle::decode_from_u128(
-                        self.colliders.get(handle).unwrap().user_data,
-                    ),
-                    normal: intersection.normal,
-                    position: ray.point_at(intersection.toi),
-                    feature: intersection.feature.into(),
-                    toi: intersection.toi,
-                })
-            },
+        let query = self.updated_query();
+        cast_ray_native(&query, &self.bodies, &self.colliders, &opts, query_buffer);
+
+        self.performance_statistics.total_ray_cast_time.set(
+            self.performance_statistics.total_ray_cast_time.get()
+                + (instant::Instant::now() - time),
         );
-        if opts.sort_results {
-            query_buffer.sort_intersections_by(|a, b| {
-                if a.toi > b.toi {
-                    Ordering::Greater
-                } else if a.toi < b.toi {
-                    Ordering::Less
-                } else {
-                    Ordering::Equal
-                }
-            })
-        }
+    }
+
+    /// Casts a batch of rays in parallel. Results of every ray are written in a respective storage
+    /// from `query_buffers`, which must have the same length as `rays`. The storages could be
+    /// reused between frames to avoid memory allocations.
+    ///
+    /// # Panics
+    ///
+    /// Panics if `rays` and `query_buffers` have different lengths.
+    pub fn cast_rays<S>(&self, rays: &[RayCastOptions], query_buffers: &mut [S])
+    where
+        S: QueryResultsStorage + Send,
+    {
+        assert_eq!(rays.len(), query_buffers.len());
+
+        let time = instant::Instant::now();
+
+        let query = self.updated_query();
+        let query = &*query;
+        let bodies = &self.bodies;
+        let colliders = &self.colliders;
+        rays.par_iter()
+            .zip(query_buffers.par_iter_mut())
+            .with_min_len(MIN_QUERIES_PER_TASK)
+            .for_each(|(opts, query_buffer)| {
+                cast_ray_native(query, bodies, colliders, opts, query_buffer)
+            });
 
         self.performance_statistics.total_ray_cast_time.set(
             self.performance_statistics.total_ray_cast_time.get()
@@ -1243,9 +1366,13 @@ impl PhysicsWorld {
         stop_at_penetration: bool,
         filter: QueryFilter,
     ) -> Option<(Handle<Node>, TOI)> {
-        let predicate = |handle: ColliderHandle, _: &Collider| -> bool {
+        let predicate = |_: ColliderHandle, collider: &Collider| -> bool {
+            if !collider.is_enabled() {
+                return false;
+            }
+
             if let Some(pred) = filter.predicate {
-                let h = Handle::decode_from_u128(self.colliders.get(handle).unwrap().user_data);
+                let h = Handle::decode_from_u128(collider.user_data);
                 pred(
                     h,
                     graph.node(h).component_ref::<collider::Collider>().unwrap(),
@@ -1255,50 +1382,103 @@ impl PhysicsWorld {
             }
         };
 
+        let (exclude_collider, exclude_rigid_body) =
+            native_exclusions(graph, filter.exclude_collider, filter.exclude_rigid_body);
         let filter = rapier3d::pipeline::QueryFilter {
             flags: rapier3d::pipeline::QueryFilterFlags::from_bits(filter.flags.bits()).unwrap(),
             groups: filter.groups.map(|g| {
                 InteractionGroups::new(u32_to_group(g.memberships.0), u32_to_group(g.filter.0))
             }),
-            exclude_collider: filter
-                .exclude_collider
-                .and_then(|h| graph.try_get(h))
-                .and_then(|n| n.component_ref::<collider::Collider>())
-                .map(|c| c.native.get()),
-            exclude_rigid_body: filter
-                .exclude_collider
-                .and_then(|h| graph.try_get(h))
-                .and_then(|n| n.component_ref::<rigidbody::RigidBody>())
-                .map(|c| c.native.get()),
+            exclude_collider,
+            exclude_rigid_body,
             predicate: Some(&predicate),
         };
 
-        let query = self.query.borrow_mut();
-
-        query
-            .cast_shape(
-                &self.bodies,
-                &self.colliders,
-                shape_pos,
-                shape_vel,
-                shape,
-                max_toi,
-                stop_at_penetration,
-                filter,
-            )
-            .map(|(handle, toi)| {
-                (
-                    Handle::decode_from_u128(self.colliders.get(handle).unwrap().user_data),
-                    TOI {
-                        toi: toi.toi,
-                        witness1: toi.witness1,
-                        witness2: toi.witness2,
-                        normal1: toi.normal1,
-                        normal2: toi.normal2,
-                        status: toi.status.into(),
-                    },
-                )
-            })
+        let query = self.updated_query();
+        cast_shape_native(
+            &query,
+            &self.bodies,
+            &self.colliders,
+            shape,
+            shape_pos,
+            shape_vel,
+            max_toi,
+            stop_at_penetration,
+            filter,
+        )
+    }
+
+    /// Casts a batch of shapes in parallel, see [`Self::cast_shape`] for more info about shape
+    /// casting. The result of every cast is written in a respective slot of `results`, which must
+    /// have the same length as `casts`. Custom predicates are not supported in batched mode, because
+    /// they could not be called from multiple threads.
+    ///
+    /// # Panics
+    ///
+    /// Panics if `casts` and `results` have different lengths.
+    pub fn cast_shapes(
+        &self,
+        graph: &Graph,
+        casts: &[ShapeCastOptions],
+        results: &mut [Option<(Handle<Node>, TOI)>],
+    ) {
+        assert_eq!(casts.len(), results.len());
+
+        // Graph cannot be shared across threads, so native handles must be fetched beforehand.
+        let exclusions = casts
+            .iter()
+            .map(|cast| native_exclusions(graph, cast.exclude_collider, cast.exclude_rigid_body))
+            .collect::<Vec<_>>();
+
+        let query = self.updated_query();
+        let query = &*query;
+        let bodies = &self.bodies;
+        let colliders = &self.colliders;
+        casts
+            .par_iter()
+            .zip(exclusions.par_iter())
+            .zip(results.par_iter_mut())
+            .with_min_len(MIN_QUERIES_PER_TASK)
+            .for_each(
+                |((cast, &(exclude_collider, exclude_rigid_body)), result)| {
+                    let filter = rapier3d::pipeline::QueryFilter {
+                        flags: rapier3d::pipeline::QueryFilterFlags::from_bits(cast.flags.bits())
+                            .unwrap(),
+                        groups: cast.groups.map(|g| {
+                            InteractionGroups::new(
+                                u32_to_group(g.memberships.0),
+                                u32_to_group(g.filter.0),
+                            )
+                        }),
+                        exclude_collider,
+                        exclude_rigid_body,
+                        predicate: Some(&is_collider_enabled),
+                    };
+
+                    *result = cast_shape_native(
+                        query,
+                        bodies,
+                        colliders,
+                        cast.shape,
+                        &cast.shape_pos,
+                        &cast.shape_vel,
+                        cast.max_toi,
+                        cast.stop_at_penetration,
+                        filter,
+                    );
+                },
+            );
+    }
+
+    // Returns a pose of the rigid body, that should be used for its scene node. It is either the
+    // current pose of the body or a pose interpolated between the last two simulation steps.
+    fn synced_pose(&self, handle: RigidBodyHandle, native: &RigidBody) -> Isometry3<f32> {
+        match self.previous_poses.get(&handle) {
+            Some(previous_pose) => {
+                previous_pose.lerp_slerp(native.position(), self.interpolation_alpha)
+            }
+            None => *native.position(),
+        }
     }
 
     pub(crate) fn set_rigid_body_position(
@@ -1306,9 +1486,25 @@ impl PhysicsWorld {
         rigid_body: &scene::rigidbody::RigidBody,
         new_global_transform: &Matrix4<f32>,
     ) {
-        if let Some(native) = self.bodies.get_mut(rigid_body.native.get()) {
+        let handle = rigid_body.native.get();
+        let new_pose = isometry_from_global_transform(new_global_transform);
+        if let Some(native) = self.bodies.get(handle) {
+            // The node was moved by the physics itself (see `sync_rigid_body_node`), there's no need
+            // to push the same pose back. Only isometries are compared, because the global transform
+            // of the node could also contain scale of the node or its ancestors.
+            let pose = self.synced_pose(handle, native);
+            if m4x4_approx_eq(&new_pose.to_homogeneous(), &pose.to_homogeneous()) {
+                return;
+            }
+        }
+
+        // The body was teleported, its pose must not be interpolated across the jump.
+        self.previous_poses.remove(&handle);
+
+        self.need_update_query.set(true);
+        if let Some(native) = self.bodies.get_mut(handle) {
             native.set_position(
-                isometry_from_global_transform(new_global_transform),
+                new_pose,
                 // Do not wake up body, it is too expensive and must be done **only** by explicit
                 // `wake_up` call!
                 false,
@@ -1324,10 +1520,12 @@ impl PhysicsWorld {
         if *self.enabled {
             if let Some(native) = self.bodies.get(rigid_body.native.get()) {
                 if native.body_type() == RigidBodyType::Dynamic {
+                    let pose = self.synced_pose(rigid_body.native.get(), native);
+
                     let local_transform: Matrix4<f32> = parent_transform
                         .try_inverse()
                         .unwrap_or_else(Matrix4::identity)
-                        * native.position().to_homogeneous();
+                        * pose.to_homogeneous();
 
                     let local_rotation = UnitQuaternion::from_matrix_eps(
                         &local_transform.basis(),
@@ -1374,6 +1572,7 @@ impl PhysicsWorld {
         if rigid_body_node.native.get() != RigidBodyHandle::invalid() {
             let mut actions = rigid_body_node.actions.lock();
             if rigid_body_node.need_sync_model() || !actions.is_empty() {
+                self.need_update_query.set(true);
                 if let Some(native) = self.bodies.get_mut(rigid_body_node.native.get()) {
                     // Sync native rigid body's properties with scene node's in case if they
                     // were changed by user.
@@ -1532,14 +1731,33 @@ impl PhysicsWorld {
         let anything_changed =
             collider_node.transform_modified.get() || collider_node.needs_sync_model();
 
+        // Terrains could be edited at any time, the height field must reflect such changes.
+        let edited_terrain = match collider_node.shape() {
+            ColliderShape::Heightfield(heightfield) => nodes
+                .try_borrow(heightfield.geometry_source.0)
+                .and_then(|n| n.cast::<Terrain>())
+                .filter(|terrain| {
+                    self.shape_cache
+                        .is_heightfield_outdated(heightfield.geometry_source.0, terrain)
+                })
+                .map(|terrain| (heightfield.geometry_source.0, terrain)),
+            _ => None,
+        };
+
         // Important notes!
         // 1) The collider node may lack backing native physics collider in case if it
         //    is not attached to a rigid body.
         // 2) `get_mut` is **very** expensive because it forces physics engine to recalculate contacts
         //    and a lot of other stuff, this is why we need `anything_changed` flag.
         if collider_node.native.get() != ColliderHandle::invalid() {
-            if anything_changed {
+            if anything_changed || edited_terrain.is_some() {
+                self.need_update_query.set(true);
                 if let Some(native) = self.colliders.get_mut(collider_node.native.get()) {
+                    if let Some((terrain_handle, terrain)) = edited_terrain {
+                        native
+                            .set_shape(self.shape_cache.heightfield_shape(terrain_handle, terrain));
+                    }
+
                     if collider_node.transform_modified.get() {
                         native.set_position_wrt_parent(Isometry3 {
                             rotation: **collider_node.local_transform().rotation(),
@@ -1558,6 +1776,8 @@ impl PhysicsWorld {
                             inv_global_transform,
                             handle,
                             nodes,
+                            &mut self.shape_cache,
+                            Some(collider_node.native.get()),
                         ) {
                             native.set_shape(shape);
                         }
@@ -1605,6 +1825,8 @@ impl PhysicsWorld {
                     inv_global_transform,
                     handle,
                     nodes,
+                    &mut self.shape_cache,
+                    None,
                 ) {
                     let mut builder = ColliderBuilder::new(shape)
                         .position(Isometry3 {
@@ -1809,3 +2031,226 @@ impl Debug for PhysicsWorld {
         write!(f, "PhysicsWorld")
     }
 }
+
+#[cfg(test)]
+mod test {
+    use crate::core::pool::Handle;
+    use crate::{
+        core::algebra::{Matrix4, Point3, Vector2, Vector3},
+        scene::{
+            base::BaseBuilder,
+            collider::{ColliderBuilder, ColliderShape, GeometrySource},
+            graph::{
+                physics::{Intersection, RayCastOptions, DEFAULT_FIXED_TIMESTEP},
+                Graph,
+            },
+            mesh::{
+                surface::{SurfaceBuilder, SurfaceData, SurfaceSharedData},
+                MeshBuilder,
+            },
+            node::Node,
+            rigidbody::{RigidBodyBuilder, RigidBodyType},
+            transform::TransformBuilder,
+        },
+    };
+    use fyrox_graph::BaseSceneGraph;
+    use std::sync::Arc;
+
+    fn ray_down(x: f32) -> RayCastOptions {
+        RayCastOptions {
+            ray_origin: Point3::new(x, 10.0, 0.0),
+            ray_direction: Vector3::new(0.0, -1.0, 0.0),
+            max_len: 100.0,
+            groups: Default::default(),
+            sort_results: true,
+        }
+    }
+
+    #[test]
+    fn test_batched_ray_casts_and_deferred_removal() {
+        let mut graph = Graph::new();
+
+        let collider = ColliderBuilder::new(BaseBuilder::new())
+            .with_shape(ColliderShape::cuboid(1.0, 1.0, 1.0))
+            .build(&mut graph);
+        let body = RigidBodyBuilder::new(BaseBuilder::new().with_children(&[collider]))
+            .with_body_type(RigidBodyType::Static)
+            .build(&mut graph);
+
+        graph.update(Vector2::new(800.0, 600.0), 1.0, Default::default());
+
+        let rays = (0..64)
+            .map(|i| ray_down(-2.0 + i as f32 / 16.0))
+            .collect::<Vec<_>>();
+        let mut batched = vec![Vec::<Intersection>::new(); rays.len()];
+        graph.physics.cast_rays(&rays, &mut batched);
+
+        for (i, results) in batched.iter().enumerate() {
+            let mut single = Vec::new();
+            graph
+                .physics
+                .cast_ray(ray_down(-2.0 + i as f32 / 16.0), &mut single);
+            assert_eq!(results, &single);
+        }
+        assert_eq!(batched[32].len(), 1);
+        assert_eq!(batched[32][0].collider, collider);
+
+        // Removed bodies must not be reported by scene queries, even before the next step.
+        graph.remove_node(body);
+        let mut results = Vec::new();
+        graph.physics.cast_ray(ray_down(0.0), &mut results);
+        assert!(results.is_empty());
+
+        graph.update(Vector2::new(800.0, 600.0), 1.0, Default::default());
+        graph.physics.cast_rays(&rays, &mut batched);
+        assert!(batched.iter().all(|results| results.is_empty()));
+    }
+
+    fn falling_body_graph() -> (Graph, Handle<Node>) {
+        falling_scaled_body_graph(Vector3::repeat(1.0))
+    }
+
+    fn falling_scaled_body_graph(scale: Vector3<f32>) -> (Graph, Handle<Node>) {
+        let mut graph = Graph::new();
+        graph.physics.integration_parameters.fixed_timestep = true;
+
+        let collider = ColliderBuilder::new(BaseBuilder::new())
+            .with_shape(ColliderShape::ball(0.5))
+            .build(&mut graph);
+        let body = RigidBodyBuilder::new(
+            BaseBuilder::new()
+                .with_local_transform(TransformBuilder::new().with_local_scale(scale).build())
+                .with_children(&[collider]),
+        )
+        .with_body_type(RigidBodyType::Dynamic)
+        .build(&mut graph);
+
+        (graph, body)
+    }
+
+    fn native_position(graph: &Graph, body: Handle<Node>) -> Vector3<f32> {
+        let native = graph[body].as_rigid_body().native.get();
+        graph.physics.bodies[native].translation().clone_owned()
+    }
+
+    #[test]
+    fn test_fixed_timestep_does_not_depend_on_frame_rate() {
+        let frame_size = Vector2::new(800.0, 600.0);
+
+        let (mut graph_a, body_a) = falling_body_graph();
+        for _ in 0..60 {
+            graph_a.update(frame_size, DEFAULT_FIXED_TIMESTEP, Default::default());
+        }
+
+        let (mut graph_b, body_b) = falling_body_graph();
+        for _ in 0..30 {
+            graph_b.update(frame_size, DEFAULT_FIXED_TIMESTEP * 2.0, Default::default());
+        }
+
+        let position = native_position(&graph_a, body_a);
+        assert!(position.y < 0.0);
+        assert_eq!(position, native_position(&graph_b, body_b));
+
+        // Interpolated transform of the node must be between the previous and the current poses.
+        let (mut graph_c, body_c) = falling_body_graph();
+        graph_c.update(frame_size, DEFAULT_FIXED_TIMESTEP, Default::default());
+        graph_c.update(frame_size, DEFAULT_FIXED_TIMESTEP * 1.5, Default::default());
+        let alpha = graph_c.physics.interpolation_alpha();
+        assert!(alpha > 0.0 && alpha < 1.0);
+        // The body is a child of the root, so its local transform is the global one.
+        let node_y = graph_c[body_c].local_transform().position().y;
+        assert!(node_y > native_position(&graph_c, body_c).y);
+    }
+
+    #[test]
+    fn test_interpolated_pose_of_scaled_body_is_not_pushed_back() {
+        let frame_size = Vector2::new(800.0, 600.0);
+
+        let (mut graph, body) = falling_body_graph();
+        let (mut scaled_graph, scaled_body) = falling_scaled_body_graph(Vector3::repeat(2.0));
+        for _ in 0..60 {
+            // Fractional amount of steps per frame, so the nodes are always behind the simulation.
+            graph.update(frame_size, DEFAULT_FIXED_TIMESTEP * 1.5, Default::default());
+            scaled_graph.update(frame_size, DEFAULT_FIXED_TIMESTEP * 1.5, Default::default());
+        }
+
+        let position = native_position(&graph, body);
+        assert!(position.y < 0.0);
+        assert_eq!(position, native_position(&scaled_graph, scaled_body));
+
+        // Teleportation must not be blended with the pose before the jump.
+        scaled_graph[scaled_body]
+            .local_transform_mut()
+            .set_position(Vector3::new(0.0, 100.0, 0.0));
+        scaled_graph.update(frame_size, 0.0, Default::default());
+        let node_y = scaled_graph[scaled_body].local_transform().position().y;
+        assert!((node_y - 100.0).abs() < 0.001);
+    }
+
+    #[test]
+    fn test_fixed_timestep_limits_steps_per_frame() {
+        let (mut graph, body) = falling_body_graph();
+        graph.physics.integration_parameters.max_steps_per_frame = 2;
+
+        // A huge frame spike must not cause more than two steps.
+        graph.update(Vector2::new(800.0, 600.0), 1.0, Default::default());
+        assert!(graph.physics.accumulator < DEFAULT_FIXED_TIMESTEP);
+
+        let (mut reference, reference_body) = falling_body_graph();
+        for _ in 0..2 {
+            reference.update(
+                Vector2::new(800.0, 600.0),
+                DEFAULT_FIXED_TIMESTEP,
+                Default::default(),
+            );
+        }
+        assert_eq!(
+            native_position(&graph, body),
+            native_position(&reference, reference_body)
+        );
+    }
+
+    #[test]
+    fn test_identical_trimesh_colliders_share_shape() {
+        let mut graph = Graph::new();
+        let data = SurfaceSharedData::new(SurfaceData::make_cube(Matrix4::identity()));
+
+        let mut colliders = Vec::new();
+        for i in 0..3 {
+            let mesh = MeshBuilder::new(BaseBuilder::new())
+                .with_surfaces(vec![SurfaceBuilder::new(data.clone()).build()])
+                .build(&mut graph);
+            let collider = ColliderBuilder::new(BaseBuilder::new())
+                .with_shape(ColliderShape::trimesh(vec![GeometrySource(mesh)]))
+                .build(&mut graph);
+            RigidBodyBuilder::new(
+                BaseBuilder::new()
+                    .with_local_transform(
+                        TransformBuilder::new()
+                            .with_local_position(Vector3::new(i as f32 * 10.0, 0.0, 0.0))
+                            .build(),
+                    )
+                    .with_children(&[collider, mesh]),
+            )
+            .with_body_type(RigidBodyType::Static)
+            .build(&mut graph);
+            colliders.push(collider);
+        }
+
+        for _ in 0..2 {
+            graph.update(Vector2::new(800.0, 600.0), 1.0 / 60.0, Default::default());
+        }
+
+        let shapes = colliders
+            .iter()
+            .map(|collider| {
+                let native = graph[*collider].as_collider().native.get();
+                graph.physics.colliders[native].shared_shape().clone()
+            })
+            .collect::<Vec<_>>();
+        assert!(shapes[0].as_trimesh().is_some());
+        assert!(shapes
+            .iter()
+            .all(|shape| Arc::ptr_eq(&shape.0, &shapes[0].0)));
+    }
+}
@@ -0,0 +1,435 @@
+//! Cache of collision shapes, that are built from scene geometry. See [`ShapeCache`] docs for more
+//! info.
+
+use crate::{
+    core::{
+        algebra::{DMatrix, Dyn, Matrix4, Point3, VecStorage, Vector2, Vector3},
+        log::Log,
+        pool::Handle,
+    },
+    scene::{
+        collider::GeometrySource,
+        graph::NodePool,
+        mesh::{
+            buffer::{VertexAttributeUsage, VertexReadTrait},
+            Mesh,
+        },
+        node::Node,
+        terrain::Terrain,
+    },
+    utils::raw_mesh::{RawMeshBuilder, RawVertex},
+};
+use fxhash::{FxHashMap, FxHashSet, FxHasher};
+use rapier3d::geometry::{ColliderHandle, SharedShape};
+use std::{
+    hash::{Hash, Hasher},
+    sync::{
+        mpsc::{self, Receiver, Sender},
+        Arc,
+    },
+};
+
+// Transforms are quantized before hashing, otherwise tiny numerical errors (for example, after
+// multiplication by inverse transform of a collider) will produce different keys for identical
+// instances.
+const TRANSFORM_QUANTIZATION: f32 = 1.0e4;
+
+/// Kind of a shape, that is built from mesh surfaces.
+#[derive(Copy, Clone, Debug, Hash, PartialEq, Eq)]
+pub(super) enum MeshShapeKind {
+    /// Triangle mesh.
+    Trimesh,
+    /// Convex decomposition of a mesh.
+    Polyhedron,
+}
+
+// Triangle soup with all transforms baked in, three vertices per triangle.
+struct MeshGeometry {
+    kind: MeshShapeKind,
+    vertices: Vec<RawVertex>,
+}
+
+impl MeshGeometry {
+    fn gather(kind: MeshShapeKind, owner_inv_transform: Matrix4<f32>, meshes: &[&Mesh]) -> Self {
+        let mut vertices = Vec::new();
+
+        for mesh in meshes {
+            // Owner inverse transform discards rotation and translation of the owner, but leaves
+            // scaling and other parameters of global transform. We need to do this because owner's
+            // transform will be synced with body's, but we don't want to bake entire transform
+            // including owner's transform.
+            let global_transform = owner_inv_transform * mesh.global_transform();
+
+            for surface in mesh.surfaces() {
+                let shared_data = surface.data();
+                let shared_data = shared_data.lock();
+
+                let vertex_buffer = &shared_data.vertex_buffer;
+                vertices.reserve(shared_data.geometry_buffer.len() * 3);
+                for triangle in shared_data.geometry_buffer.iter() {
+                    for &index in triangle.0.iter() {
+                        let position = vertex_buffer
+                            .get(index as usize)
+                            .unwrap()
+                            .read_3_f32(VertexAttributeUsage::Position)
+                            .unwrap();
+                        vertices.push(RawVertex::from(
+                            global_transform
+                                .transform_point(&Point3::from(position))
+                                .coords,
+                        ));
+                    }
+                }
+            }
+        }
+
+        Self { kind, vertices }
+    }
+
+    fn build(self) -> SharedShape {
+        let mut mesh_builder = RawMeshBuilder::new(self.vertices.len(), self.vertices.len());
+        for vertex in self.vertices {
+            mesh_builder.insert(vertex);
+        }
+
+        let raw_mesh = mesh_builder.build();
+
+        let vertices: Vec<Point3<f32>> = raw_mesh
+            .vertices
+            .into_iter()
+            .map(|v| Point3::new(v.x, v.y, v.z))
+            .collect();
+
+        let indices = raw_mesh
+            .triangles
+            .into_iter()
+            .map(|t| [t.0[0], t.0[1], t.0[2]])
+            .collect::<Vec<_>>();
+
+        match self.kind {
+            MeshShapeKind::Trimesh => {
+                if indices.is_empty() {
+                    SharedShape::trimesh(vec![Point3::new(0.0, 0.0, 0.0)], vec![[0, 0, 0]])
+                } else {
+                    SharedShape::trimesh(vertices, indices)
+                }
+            }
+            MeshShapeKind::Polyhedron => SharedShape::convex_decomposition(&vertices, &indices),
+        }
+    }
+}
+
+fn mesh_shape_key(kind: MeshShapeKind, owner_inv_transform: Matrix4<f32>, meshes: &[&Mesh]) -> u64 {
+    let mut hasher = FxHasher::default();
+    kind.hash(&mut hasher);
+    for mesh in meshes {
+        let transform = owner_inv_transform * mesh.global_transform();
+        for value in transform.iter() {
+            ((value * TRANSFORM_QUANTIZATION).round() as i64).hash(&mut hasher);
+        }
+        for surface in mesh.surfaces() {
+            surface.data().lock().content_hash().hash(&mut hasher);
+        }
+    }
+    hasher.finish()
+}
+
+fn collect_meshes<'a>(sources: &[GeometrySource], nodes: &'a NodePool) -> Vec<&'a Mesh> {
+    sources
+        .iter()
+        .filter_map(|source| nodes.try_borrow(source.0).and_then(|n| n.cast::<Mesh>()))
+        .collect()
+}
+
+// Hash of everything except heights, that defines a height field built from a terrain.
+fn heightfield_layout(terrain: &Terrain) -> u64 {
+    let mut hasher = FxHasher::default();
+    let scale = terrain.local_transform().scale();
+    for value in scale.iter() {
+        value.to_bits().hash(&mut hasher);
+    }
+    terrain.height_map_size().hash(&mut hasher);
+    terrain.chunk_size().x.to_bits().hash(&mut hasher);
+    terrain.chunk_size().y.to_bits().hash(&mut hasher);
+    terrain.width_chunks().hash(&mut hasher);
+    terrain.length_chunks().hash(&mut hasher);
+    hasher.finish()
+}
+
+fn heightmap_hash(terrain: &Terrain, chunk_index: usize) -> u64 {
+    terrain.chunks_ref()[chunk_index]
+        .heightmap()
+        .data_ref()
+        .data_hash()
+}
+
+struct HeightfieldEntry {
+    layout: u64,
+    chunk_hashes: Vec<u64>,
+    heights: DMatrix<f32>,
+    shape: SharedShape,
+}
+
+impl HeightfieldEntry {
+    fn new(terrain: &Terrain) -> Self {
+        assert!(!terrain.chunks_ref().is_empty());
+
+        let height_map_size = terrain.height_map_size();
+        let nrows = height_map_size.y as usize * terrain.length_chunks().len();
+        let ncols = height_map_size.x as usize * terrain.width_chunks().len();
+
+        let mut entry = Self {
+            layout: heightfield_layout(terrain),
+            chunk_hashes: vec![0; terrain.chunks_ref().len()],
+            heights: DMatrix::from_data(VecStorage::new(
+                Dyn(nrows),
+                Dyn(ncols),
+                vec![0.0; nrows * ncols],
+            )),
+            shape: SharedShape::ball(0.0),
+        };
+        for chunk_index in 0..terrain.chunks_ref().len() {
+            entry.copy_chunk(terrain, chunk_index);
+        }
+        entry.rebuild_shape(terrain);
+        entry
+    }
+
+    fn is_outdated(&self, terrain: &Terrain) -> bool {
+        self.layout != heightfield_layout(terrain)
+            || self.chunk_hashes.len() != terrain.chunks_ref().len()
+            || self
+                .chunk_hashes
+                .iter()
+                .enumerate()
+                .any(|(chunk_index, hash)| *hash != heightmap_hash(terrain, chunk_index))
+    }
+
+    // Copies heights of the chunk into combined height map of the terrain.
+    fn copy_chunk(&mut self, terrain: &Terrain, chunk_index: usize) {
+        // HACK: Temporary solution for https://github.com/FyroxEngine/Fyrox/issues/365
+        let scale = terrain.local_transform().scale();
+        let height_map_size = terrain.height_map_size();
+        let width_chunks = terrain.width_chunks().len();
+        let offset = Vector2::new(
+            (chunk_index % width_chunks) as u32 * height_map_size.x,
+            (chunk_index / width_chunks) as u32 * height_map_size.y,
+        );
+
+        let texture = terrain.chunks_ref()[chunk_index].heightmap().data_ref();
+        let height_map = texture.data_of_type::<f32>().unwrap();
+        for iy in 0..height_map_size.y {
+            for ix in 0..height_map_size.x {
+                self.heights[((offset.y + iy) as usize, (offset.x + ix) as usize)] =
+                    height_map[(iy * height_map_size.x + ix) as usize] * scale.y;
+            }
+        }
+
+        self.chunk_hashes[chunk_index] = texture.data_hash();
+    }
+
+    fn rebuild_shape(&mut self, terrain: &Terrain) {
+        let scale = terrain.local_transform().scale();
+        self.shape = SharedShape::heightfield(
+            self.heights.clone(),
+            Vector3::new(
+                terrain.chunk_size().x * scale.x * terrain.width_chunks().len() as f32,
+                1.0,
+                terrain.chunk_size().y * scale.z * terrain.length_chunks().len() as f32,
+            ),
+        );
+    }
+
+    // Copies only modified chunks and rebuilds the shape. Returns `false` if the layout of the
+    // terrain has changed and the entry must be re-created.
+    fn patch(&mut self, terrain: &Terrain) -> bool {
+        if self.layout != heightfield_layout(terrain)
+            || self.chunk_hashes.len() != terrain.chunks_ref().len()
+        {
+            return false;
+        }
+
+        let mut modified = false;
+        for chunk_index in 0..terrain.chunks_ref().len() {
+            if self.chunk_hashes[chunk_index] != heightmap_hash(terrain, chunk_index) {
+                self.copy_chunk(terrain, chunk_index);
+                modified = true;
+            }
+        }
+        if modified {
+            self.rebuild_shape(terrain);
+        }
+        true
+    }
+}
+
+/// Cache of collision shapes, that are built from scene geometry (triangle meshes, convex
+/// polyhedrons and height fields). Building of such shapes is expensive: all vertices must be copied
+/// and welded, and acceleration structures must be built. The cache identifies mesh-based shapes by
+/// the content hash of their surfaces and the transform, that is baked into vertices, so colliders
+/// with identical geometry share a single shape. Height fields are cached per terrain and are
+/// patched in place when the terrain is edited: only modified chunks are copied again.
+///
+/// Mesh-based shapes of existing colliders could be rebuilt in background: the collider keeps its
+/// old shape until the new one is ready.
+pub(super) struct ShapeCache {
+    shapes: FxHashMap<u64, SharedShape>,
+    heightfields: FxHashMap<Handle<Node>, HeightfieldEntry>,
+    // Keys of the shapes, that are being built in background.
+    in_flight: FxHashSet<u64>,
+    // Colliders waiting for the shapes being built in background.
+    waiting: FxHashMap<ColliderHandle, u64>,
+    sender: Sender<(u64, SharedShape)>,
+    receiver: Receiver<(u64, SharedShape)>,
+}
+
+impl Default for ShapeCache {
+    fn default() -> Self {
+        let (sender, receiver) = mpsc::channel();
+        Self {
+            shapes: Default::default(),
+            heightfields: Default::default(),
+            in_flight: Default::default(),
+            waiting: Default::default(),
+            sender,
+            receiver,
+        }
+    }
+}
+
+impl ShapeCache {
+    /// Returns a shape built from the given mesh sources. The shape is built on the current thread
+    /// if there's no such shape in the cache.
+    pub(super) fn mesh_shape(
+        &mut self,
+        kind: MeshShapeKind,
+        owner: Handle<Node>,
+        owner_inv_transform: Matrix4<f32>,
+        sources: &[GeometrySource],
+        nodes: &NodePool,
+    ) -> SharedShape {
+        let meshes = collect_meshes(sources, nodes);
+        let key = mesh_shape_key(kind, owner_inv_transform, &meshes);
+        if let Some(shape) = self.shapes.get(&key) {
+            return shape.clone();
+        }
+
+        let geometry = MeshGeometry::gather(kind, owner_inv_transform, &meshes);
+        warn_if_empty(&geometry, owner, nodes);
+        let shape = geometry.build();
+        self.shapes.insert(key, shape.clone());
+        shape
+    }
+
+    /// Same as [`Self::mesh_shape`], but if there's no such shape in the cache, it will be built in
+    /// background and `None` is returned. The shape will be returned by [`Self::take_finished`]
+    /// for the given collider, once it is built.
+    pub(super) fn request_mesh_shape(
+        &mut self,
+        collider: ColliderHandle,
+        kind: MeshShapeKind,
+        owner: Handle<Node>,
+        owner_inv_transform: Matrix4<f32>,
+        sources: &[GeometrySource],
+        nodes: &NodePool,
+    ) -> Option<SharedShape> {
+        let meshes = collect_meshes(sources, nodes);
+        let key = mesh_shape_key(kind, owner_inv_transform, &meshes);
+        if let Some(shape) = self.shapes.get(&key) {
+            self.waiting.remove(&collider);
+            return Some(shape.clone());
+        }
+
+        self.waiting.insert(collider, key);
+
+        if self.in_flight.insert(key) {
+            // Geometry must be gathered right now, because it could be changed later.
+            let geometry = MeshGeometry::gather(kind, owner_inv_transform, &meshes);
+            warn_if_empty(&geometry, owner, nodes);
+            let sender = self.sender.clone();
+            let task = move || {
+                // The receiver could be dropped already, the result is not needed in this case.
+                let _ = sender.send((key, geometry.build()));
+            };
+
+            #[cfg(not(target_arch = "wasm32"))]
+            rayon::spawn(task);
+
+            #[cfg(target_arch = "wasm32")]
+            task();
+        }
+
+        None
+    }
+
+    /// Returns a height field shape built from the given terrain. Only modified chunks of the
+    /// terrain are copied if the terrain was used before.
+    pub(super) fn heightfield_shape(
+        &mut self,
+        terrain_handle: Handle<Node>,
+        terrain: &Terrain,
+    ) -> SharedShape {
+        if let Some(entry) = self.heightfields.get_mut(&terrain_handle) {
+            if entry.patch(terrain) {
+                return entry.shape.clone();
+            }
+        }
+
+        let entry = HeightfieldEntry::new(terrain);
+        let shape = entry.shape.clone();
+        self.heightfields.insert(terrain_handle, entry);
+        shape
+    }
+
+    /// Returns `true` if the height field of the given terrain was built by the cache and the
+    /// terrain was changed after that.
+    pub(super) fn is_heightfield_outdated(
+        &self,
+        terrain_handle: Handle<Node>,
+        terrain: &Terrain,
+    ) -> bool {
+        self.heightfields
+            .get(&terrain_handle)
+            .map_or(false, |entry| entry.is_outdated(terrain))
+    }
+
+    /// Cancels waiting for a background shape for the given collider.
+    pub(super) fn forget(&mut self, collider: ColliderHandle) {
+        self.waiting.remove(&collider);
+    }
+
+    /// Returns shapes, that were built in background, paired with the colliders waiting for them.
+    pub(super) fn take_finished(&mut self) -> Vec<(ColliderHandle, SharedShape)> {
+        let mut finished = Vec::new();
+        while let Ok((key, shape)) = self.receiver.try_recv() {
+            self.in_flight.remove(&key);
+            self.waiting.retain(|collider, waiting_key| {
+                if *waiting_key == key {
+                    finished.push((*collider, shape.clone()));
+                    false
+                } else {
+                    true
+                }
+            });
+            self.shapes.insert(key, shape);
+        }
+        finished
+    }
+
+    /// Removes shapes, that are not used by any collider.
+    pub(super) fn collect_garbage(&mut self) {
+        self.shapes
+            .retain(|_, shape| Arc::strong_count(&shape.0) > 1);
+        self.heightfields
+            .retain(|_, entry| Arc::strong_count(&entry.shape.0) > 1);
+    }
+}
+
+fn warn_if_empty(geometry: &MeshGeometry, owner: Handle<Node>, nodes: &NodePool) {
+    if geometry.kind == MeshShapeKind::Trimesh && geometry.vertices.is_empty() {
+        Log::warn(format!(
+            "Failed to create triangle mesh collider for {}, it has no vertices!",
+            nodes[owner].name()
+        ));
+    }
+}
@@ -1430,12 +1430,33 @@ impl<'a> VertexWriteTrait for VertexViewMut<'a> {
 }
 
 /// A buffer for data that defines connections between vertices.
-#[derive(Visit, Default, Clone, Debug)]
+#[derive(Default, Clone, Debug)]
 pub struct TriangleBuffer {
     triangles: Vec<TriangleDefinition>,
     modifications_counter: u64,
 }
 
+impl Visit for TriangleBuffer {
+    fn visit(&mut self, name: &str, visitor: &mut Visitor) -> VisitResult {
+        let mut region = visitor.enter_region(name)?;
+
+        // Triangles are stored as a single blob, older versions stored each triangle in a separate
+        // region with the same name.
+        let mut triangles_view = PodVecView::from_pod_vec(&mut self.triangles);
+        if let Err(err) = triangles_view.visit("Triangles", &mut region) {
+            if !region.is_reading() {
+                return Err(err);
+            }
+            self.triangles.visit("Triangles", &mut region)?;
+        }
+
+        self.modifications_counter
+            .visit("ModificationsCounter", &mut region)?;
+
+        Ok(())
+    }
+}
+
 fn calculate_triangle_buffer_hash(triangles: &[TriangleDefinition]) -> u64 {
     let mut hasher = FxHasher::default();
     triangles.hash(&mut hasher);
@@ -26,7 +26,7 @@ use crate::{
     scene::{
         base::{Base, BaseBuilder},
         debug::{Line, SceneDrawingContext},
-        graph::Graph,
+        graph::{Graph, NodePool},
         mesh::{
             buffer::{
                 BytesStorage, TriangleBuffer, TriangleBufferRefMut, VertexAttributeDescriptor,
@@ -35,7 +35,7 @@ use crate::{
             },
             surface::{BlendShape, Surface, SurfaceData, SurfaceSharedData},
         },
-        node::{Node, NodeTrait, RdcControlFlow, SyncContext},
+        node::{Node, NodeTrait, RdcControlFlow, SyncContext, UpdateContext},
     },
 };
 use fxhash::{FxHashMap, FxHasher};
@@ -126,45 +126,304 @@ pub enum BatchingMode {
     None,
     /// Static batching. Render data of all **descendant** nodes will be baked into a static buffer
     /// and it will be drawn. This mode "bakes" world transform of a node into vertices, thus making
-    /// them immovable.
+    /// them immovable. The baked data is split into spatial clusters (see [`Mesh::set_static_batch_cluster_size`]),
+    /// each cluster is culled independently and rebuilt only when its descendants change.
     Static,
     /// Dynamic batching. Render data of the mesh will be merged with the same meshes dynamically on
     /// each frame, thus allowing the meshes to be movable. This could be slow if used incorrectly!
     Dynamic,
 }
 
+/// Default size (in meters) of a cell of the uniform grid, that is used to split static batches into
+/// clusters. See [`Mesh::set_static_batch_cluster_size`] for more info.
+pub const DEFAULT_STATIC_BATCH_CLUSTER_SIZE: f32 = 32.0;
+
 #[derive(Debug, Clone)]
 struct Batch {
     data: SurfaceSharedData,
     material: MaterialResource,
 }
 
+/// Cell of a uniform grid, that defines a cluster of a static batch.
+type ClusterKey = Vector3<i32>;
+
+/// Spatially compact part of a static batch. Every cluster has its own bounds, so it can be culled
+/// independently of the other clusters.
 #[derive(Debug, Default, Clone)]
-struct BatchContainer {
+struct BatchCluster {
     batches: FxHashMap<u64, Batch>,
+    // World-space bounds of the batched geometry (vertices of static batches are in world space).
+    bounding_box: AxisAlignedBoundingBox,
+    sources: Vec<Handle<Node>>,
+    dirty: bool,
+}
+
+impl BatchCluster {
+    fn update_bounding_box(&mut self) {
+        let mut bounding_box = AxisAlignedBoundingBox::default();
+        for batch in self.batches.values() {
+            extend_aabb_from_vertex_buffer(&batch.data.lock().vertex_buffer, &mut bounding_box);
+        }
+        self.bounding_box = bounding_box;
+    }
+}
+
+/// A descendant node, which render data is baked into a static batch.
+#[derive(Debug, Clone)]
+struct BatchSource {
+    cluster: ClusterKey,
+    fingerprint: u64,
+    stamp: u32,
+}
+
+fn cluster_key(node: &Node, cluster_size: f32) -> ClusterKey {
+    let bounding_box = node.world_bounding_box();
+    let position = if bounding_box.is_valid() {
+        bounding_box.center()
+    } else {
+        node.global_position()
+    };
+    (position / cluster_size).map(|c| c.floor() as i32)
+}
+
+/// Calculates a hash of the properties of a node that affect its baked render data.
+fn batch_fingerprint(node: &Node) -> u64 {
+    let mut hasher = FxHasher::default();
+    let bounding_box = node.world_bounding_box();
+    for value in node
+        .global_transform()
+        .iter()
+        .chain(bounding_box.min.iter())
+        .chain(bounding_box.max.iter())
+    {
+        hasher.write_u32(value.to_bits());
+    }
+    node.global_visibility().hash(&mut hasher);
+    node.is_globally_enabled().hash(&mut hasher);
+    hasher.finish()
+}
+
+#[derive(Debug, Default, Clone)]
+struct BatchContainer {
+    clusters: FxHashMap<ClusterKey, BatchCluster>,
+    sources: FxHashMap<Handle<Node>, BatchSource>,
+    // Cluster that receives render data, that is currently being collected.
+    current_cluster: ClusterKey,
+    cluster_size: f32,
+    is_built: bool,
+    stamp: u32,
+    stack: Vec<Handle<Node>>,
 }
 
 impl BatchContainer {
-    fn fill(&mut self, from: Handle<Node>, ctx: &mut RenderContext) {
+    fn collect_from(&mut self, handle: Handle<Node>, cluster: ClusterKey, ctx: &RenderContext) {
+        let Some(node) = ctx.graph.try_get(handle) else {
+            return;
+        };
+
+        self.current_cluster = cluster;
+        node.collect_render_data(&mut RenderContext {
+            observer_position: ctx.observer_position,
+            z_near: ctx.z_near,
+            z_far: ctx.z_far,
+            view_matrix: ctx.view_matrix,
+            projection_matrix: ctx.projection_matrix,
+            frustum: None,
+            storage: self,
+            graph: ctx.graph,
+            render_pass_name: ctx.render_pass_name,
+        });
+    }
+
+    fn fill(&mut self, from: Handle<Node>, cluster_size: f32, ctx: &RenderContext) {
+        self.clusters.clear();
+        self.sources.clear();
+        self.cluster_size = cluster_size;
+
         for descendant_handle in ctx.graph.traverse_handle_iter(from) {
             if descendant_handle == from {
                 continue;
             }
 
             let descendant = &ctx.graph[descendant_handle];
-            descendant.collect_render_data(&mut RenderContext {
-                observer_position: ctx.observer_position,
-                z_near: ctx.z_near,
-                z_far: ctx.z_far,
-                view_matrix: ctx.view_matrix,
-                projection_matrix: ctx.projection_matrix,
-                frustum: None,
-                storage: self,
-                graph: ctx.graph,
-                render_pass_name: ctx.render_pass_name,
-            });
+            let cluster = cluster_key(descendant, cluster_size);
+            self.sources.insert(
+                descendant_handle,
+                BatchSource {
+                    cluster,
+                    fingerprint: batch_fingerprint(descendant),
+                    stamp: self.stamp,
+                },
+            );
+            self.clusters
+                .entry(cluster)
+                .or_default()
+                .sources
+                .push(descendant_handle);
+
+            self.collect_from(descendant_handle, cluster, ctx);
+        }
+
+        for cluster in self.clusters.values_mut() {
+            cluster.update_bounding_box();
+        }
+
+        self.is_built = true;
+    }
+
+    /// Re-collects render data only for the clusters, that were marked dirty by [`Self::validate`].
+    /// Returns `true` if at least one cluster was rebuilt.
+    fn rebuild_dirty(&mut self, ctx: &RenderContext) -> bool {
+        let dirty = self
+            .clusters
+            .iter()
+            .filter_map(|(key, cluster)| cluster.dirty.then_some(*key))
+            .collect::<Vec<_>>();
+
+        for &key in dirty.iter() {
+            let sources = {
+                let cluster = self.clusters.get_mut(&key).unwrap();
+                cluster.batches.clear();
+                cluster.dirty = false;
+                std::mem::take(&mut cluster.sources)
+            };
+
+            for &source in sources.iter() {
+                self.collect_from(source, key, ctx);
+            }
+
+            let cluster = self.clusters.get_mut(&key).unwrap();
+            cluster.sources = sources;
+            if cluster.sources.is_empty() {
+                self.clusters.remove(&key);
+            } else {
+                cluster.update_bounding_box();
+            }
+        }
+
+        !dirty.is_empty()
+    }
+
+    fn mark_dirty(&mut self, key: ClusterKey, removed: Option<Handle<Node>>) {
+        let cluster = self.clusters.entry(key).or_default();
+        cluster.dirty = true;
+        if let Some(removed) = removed {
+            if let Some(position) = cluster.sources.iter().position(|h| *h == removed) {
+                cluster.sources.swap_remove(position);
+            }
+        }
+    }
+
+    /// Compares current state of the descendants of a batch with the state, that was used to build
+    /// the batch. Clusters of changed, added or removed descendants are marked dirty, so only these
+    /// clusters will be rebuilt.
+    fn validate(&mut self, children: &[Handle<Node>], nodes: &NodePool) {
+        if !self.is_built {
+            return;
+        }
+
+        self.stamp = self.stamp.wrapping_add(1);
+        let stamp = self.stamp;
+        let mut visited = 0;
+
+        let mut stack = std::mem::take(&mut self.stack);
+        stack.clear();
+        stack.extend_from_slice(children);
+        while let Some(handle) = stack.pop() {
+            let Some(node) = nodes.try_borrow(handle) else {
+                continue;
+            };
+            stack.extend_from_slice(node.children());
+
+            let fingerprint = batch_fingerprint(node);
+            let key = cluster_key(node, self.cluster_size);
+            match self.sources.get_mut(&handle) {
+                Some(source) => {
+                    visited += 1;
+                    source.stamp = stamp;
+                    if source.fingerprint != fingerprint {
+                        let old_key = source.cluster;
+                        source.fingerprint = fingerprint;
+                        source.cluster = key;
+                        self.mark_dirty(old_key, Some(handle));
+                        let cluster = self.clusters.entry(key).or_default();
+                        cluster.dirty = true;
+                        cluster.sources.push(handle);
+                    }
+                }
+                None => {
+                    visited += 1;
+                    self.sources.insert(
+                        handle,
+                        BatchSource {
+                            cluster: key,
+                            fingerprint,
+                            stamp,
+                        },
+                    );
+                    let cluster = self.clusters.entry(key).or_default();
+                    cluster.dirty = true;
+                    cluster.sources.push(handle);
+                }
+            }
+        }
+        self.stack = stack;
+
+        // Some of the descendants were deleted or unlinked.
+        if visited < self.sources.len() {
+            let removed = self
+                .sources
+                .iter()
+                .filter(|(_, source)| source.stamp != stamp)
+                .map(|(handle, source)| (*handle, source.cluster))
+                .collect::<Vec<_>>();
+            for (handle, key) in removed {
+                self.sources.remove(&handle);
+                self.mark_dirty(key, Some(handle));
+            }
         }
     }
+
+    /// Returns `true` if the batch must be built or some of its clusters must be rebuilt.
+    fn needs_rebuild(&self) -> bool {
+        !self.is_built || self.clusters.values().any(|cluster| cluster.dirty)
+    }
+
+    fn bounding_box(&self) -> AxisAlignedBoundingBox {
+        // The batch is (re)built only when it is visited by the renderer, so the bounds must not
+        // prevent it from being visited.
+        if self.needs_rebuild() {
+            return AxisAlignedBoundingBox::from_min_max(
+                Vector3::repeat(f32::NEG_INFINITY),
+                Vector3::repeat(f32::INFINITY),
+            );
+        }
+
+        let mut bounding_box = AxisAlignedBoundingBox::default();
+        for cluster in self.clusters.values() {
+            if cluster.bounding_box.is_valid() {
+                bounding_box.add_box(cluster.bounding_box);
+            }
+        }
+        bounding_box
+    }
+
+    fn batch_mut(
+        &mut self,
+        batch_hash: u64,
+        material: &MaterialResource,
+        make_data: impl FnOnce() -> SurfaceData,
+    ) -> &mut Batch {
+        self.clusters
+            .entry(self.current_cluster)
+            .or_default()
+            .batches
+            .entry(batch_hash)
+            .or_insert_with(|| Batch {
+                data: SurfaceSharedData::new(make_data()),
+                material: material.clone(),
+            })
+    }
 }
 
 #[derive(Debug, Default)]
@@ -193,14 +452,13 @@ impl RenderDataBundleStorageTrait for BatchContainer {
         hasher.write_u64(material.key() as u64);
         let batch_hash = hasher.finish();
 
-        let batch = self.batches.entry(batch_hash).or_insert_with(|| Batch {
-            data: SurfaceSharedData::new(SurfaceData::new(
+        let batch = self.batch_mut(batch_hash, material, || {
+            SurfaceData::new(
                 VertexBuffer::new_with_layout(layout, 0, BytesStorage::with_capacity(4096))
                     .unwrap(),
                 TriangleBuffer::new(Vec::with_capacity(4096)),
                 false,
-            )),
-            material: material.clone(),
+            )
         });
 
         let mut batch_data_guard = batch.data.lock();
@@ -228,13 +486,12 @@ impl RenderDataBundleStorageTrait for BatchContainer {
         hasher.write_u64(material.key() as u64);
         let batch_hash = hasher.finish();
 
-        let batch = self.batches.entry(batch_hash).or_insert_with(|| Batch {
-            data: SurfaceSharedData::new(SurfaceData::new(
+        let batch = self.batch_mut(batch_hash, material, || {
+            SurfaceData::new(
                 src_data.vertex_buffer.clone_empty(4096),
                 TriangleBuffer::new(Vec::with_capacity(4096)),
                 false,
-            )),
-            material: material.clone(),
+            )
         });
 
         let mut batch_data_guard = batch.data.lock();
@@ -317,6 +574,15 @@ pub struct Mesh {
     )]
     batching_mode: InheritableVariable<BatchingMode>,
 
+    #[visit(optional)]
+    #[reflect(
+        setter = "set_static_batch_cluster_size",
+        min_value = 0.01,
+        description = "Size of a cell of the uniform grid, that is used to split static batch into \
+    clusters. Each cluster is culled independently."
+    )]
+    static_batch_cluster_size: InheritableVariable<f32>,
+
     #[visit(optional)]
     blend_shapes: InheritableVariable<Vec<BlendShape>>,
 
@@ -348,6 +614,9 @@ impl Default for Mesh {
             render_path: InheritableVariable::new_modified(RenderPath::Deferred),
             decal_layer_index: InheritableVariable::new_modified(0),
             batching_mode: Default::default(),
+            static_batch_cluster_size: InheritableVariable::new_modified(
+                DEFAULT_STATIC_BATCH_CLUSTER_SIZE,
+            ),
             blend_shapes: Default::default(),
             batch_container: Default::default(),
         }
@@ -389,7 +658,7 @@ impl Mesh {
     /// Returns mutable reference to array of surfaces.
     #[inline]
     pub fn surfaces_mut(&mut self) -> &mut [Surface] {
-        self.local_bounding_box_dirty.set(true);
+        self.invalidate_local_bounding_box();
         self.surfaces.get_value_mut_silent()
     }
 
@@ -397,7 +666,7 @@ impl Mesh {
     #[inline]
     pub fn clear_surfaces(&mut self) {
         self.surfaces.get_value_mut_and_mark_modified().clear();
-        self.local_bounding_box_dirty.set(true);
+        self.invalidate_local_bounding_box();
     }
 
     /// Adds new surface into mesh, can be used to procedurally generate meshes.
@@ -406,7 +675,14 @@ impl Mesh {
         self.surfaces
             .get_value_mut_and_mark_modified()
             .push(surface);
+        self.invalidate_local_bounding_box();
+    }
+
+    // The world bounding box depends on the local one, so the node must be synced again even if its
+    // transform is unchanged (the graph could skip unchanged nodes, see `HierarchyUpdateMode`).
+    fn invalidate_local_bounding_box(&self) {
         self.local_bounding_box_dirty.set(true);
+        self.hierarchy_dirty.set(true);
     }
 
     /// Returns a list of blend shapes.
@@ -429,6 +705,33 @@ impl Mesh {
         *self.render_path
     }
 
+    /// Returns `true` if at least one surface of the mesh is bound to a set of bones.
+    #[inline]
+    pub fn is_skinned(&self) -> bool {
+        self.surfaces.iter().any(|s| !s.bones.is_empty())
+    }
+
+    fn update_world_bounding_box(&self, global_transform: &Matrix4<f32>, nodes: &NodePool) {
+        if let BatchingMode::Static = *self.batching_mode {
+            // Vertices of static batches are already in world space.
+            self.world_bounding_box.set(self.local_bounding_box());
+            return;
+        }
+
+        let mut world_aabb = self.local_bounding_box().transform(global_transform);
+
+        // Special case for skinned meshes.
+        for surface in self.surfaces.iter() {
+            for &bone in surface.bones() {
+                if let Some(node) = nodes.try_borrow(bone) {
+                    world_aabb.add_point(node.global_position())
+                }
+            }
+        }
+
+        self.world_bounding_box.set(world_aabb)
+    }
+
     /// Calculate very accurate bounding box in *world coordinates* including influence of bones.
     /// This method is very heavy and not intended to use every frame!
     pub fn accurate_world_bounding_box(&self, graph: &Graph) -> AxisAlignedBoundingBox {
@@ -508,6 +811,7 @@ impl Mesh {
             std::mem::take(&mut self.batch_container);
         }
 
+        self.invalidate_local_bounding_box();
         self.batching_mode.set_value_and_mark_modified(mode)
     }
 
@@ -515,6 +819,25 @@ impl Mesh {
     pub fn batching_mode(&self) -> BatchingMode {
         *self.batching_mode
     }
+
+    /// Sets the size of a cell of the uniform grid, that is used to split static batch into
+    /// clusters (see [`BatchingMode::Static`]). Every cluster has its own bounds and it is culled
+    /// independently, so only visible parts of large static batches are drawn (both by cameras and
+    /// light sources). When a descendant node changes, only the clusters that contain it are rebuilt.
+    /// Smaller clusters give more precise culling at the cost of more draw calls.
+    pub fn set_static_batch_cluster_size(&mut self, size: f32) -> f32 {
+        // Force full rebuild.
+        std::mem::take(&mut self.batch_container);
+        self.invalidate_local_bounding_box();
+        self.static_batch_cluster_size
+            .set_value_and_mark_modified(size.max(0.01))
+    }
+
+    /// Returns current size of a cell of the uniform grid, that is used to split static batch into
+    /// clusters.
+    pub fn static_batch_cluster_size(&self) -> f32 {
+        *self.static_batch_cluster_size
+    }
 }
 
 fn extend_aabb_from_vertex_buffer(
@@ -540,11 +863,7 @@ impl NodeTrait for Mesh {
             let mut bounding_box = AxisAlignedBoundingBox::default();
 
             if let BatchingMode::Static = *self.batching_mode {
-                let container = self.batch_container.0.lock();
-                for batch in container.batches.values() {
-                    let data = batch.data.lock();
-                    extend_aabb_from_vertex_buffer(&data.vertex_buffer, &mut bounding_box);
-                }
+                bounding_box = self.batch_container.0.lock().bounding_box();
             } else {
                 for surface in self.surfaces.iter() {
                     let data = surface.data();
@@ -569,34 +888,37 @@ impl NodeTrait for Mesh {
         Self::type_uuid()
     }
 
-    fn sync_transform(&self, _new_global_transform: &Matrix4<f32>, context: &mut SyncContext) {
-        if self.surfaces.iter().any(|s| !s.bones.is_empty()) {
-            let mut world_aabb = self
-                .local_bounding_box()
-                .transform(&self.global_transform());
+    fn sync_transform(&self, new_global_transform: &Matrix4<f32>, context: &mut SyncContext) {
+        self.update_world_bounding_box(new_global_transform, context.nodes);
+    }
 
-            // Special case for skinned meshes.
-            for surface in self.surfaces.iter() {
-                for &bone in surface.bones() {
-                    if let Some(node) = context.nodes.try_borrow(bone) {
-                        world_aabb.add_point(node.global_position())
-                    }
-                }
+    fn update(&mut self, context: &mut UpdateContext) {
+        if let BatchingMode::Static = *self.batching_mode {
+            let mut container = self.batch_container.0.lock();
+            container.validate(self.children(), context.nodes);
+            if container.needs_rebuild() {
+                drop(container);
+                self.local_bounding_box_dirty.set(true);
+                self.world_bounding_box.set(self.local_bounding_box());
             }
+        }
 
-            self.world_bounding_box.set(world_aabb)
-        } else {
-            self.world_bounding_box.set(
-                self.local_bounding_box()
-                    .transform(&self.global_transform()),
-            );
+        // Bones of skinned meshes could move without any changes of the mesh itself, so its world
+        // bounding box must be refreshed every frame (the graph could skip `sync_transform` calls
+        // for unchanged nodes).
+        if self.is_skinned() {
+            self.update_world_bounding_box(&self.global_transform(), context.nodes);
         }
     }
 
     fn collect_render_data(&self, ctx: &mut RenderContext) -> RdcControlFlow {
-        if !self.global_visibility()
-            || !self.is_globally_enabled()
-            || !ctx
+        if !self.global_visibility() || !self.is_globally_enabled() {
+            return RdcControlFlow::Continue;
+        }
+
+        // Static batches are culled per-cluster.
+        if *self.batching_mode != BatchingMode::Static
+            && !ctx
                 .frustum
                 .map_or(true, |f| f.is_intersects_aabb(&self.world_bounding_box()))
         {
@@ -610,31 +932,50 @@ impl NodeTrait for Mesh {
         if let BatchingMode::Static = *self.batching_mode {
             let mut container = self.batch_container.0.lock();
 
-            if container.batches.is_empty() {
-                container.fill(self.self_handle, ctx);
+            let is_rebuilt = if container.is_built {
+                container.rebuild_dirty(ctx)
+            } else {
+                container.fill(self.self_handle, *self.static_batch_cluster_size, ctx);
+                true
+            };
+            if is_rebuilt {
+                self.local_bounding_box_dirty.set(true);
+                self.world_bounding_box.set(container.bounding_box());
             }
 
-            for (index, batch) in container.batches.values().enumerate() {
-                ctx.storage.push(
-                    &batch.data,
-                    &batch.material,
-                    self.render_path(),
-                    self.decal_layer_index(),
-                    batch.material.key() as u64,
-                    SurfaceInstanceData {
-                        world_transform: Matrix4::identity(),
-                        bone_matrices: Default::default(),
-                        depth_offset: self.depth_offset_factor(),
-                        blend_shapes_weights: Default::default(),
-                        element_range: ElementRange::Full,
-                        persistent_identifier: PersistentIdentifier::new_combined(
-                            &batch.data,
-                            self.self_handle,
-                            index,
-                        ),
-                        node_handle: self.self_handle,
-                    },
-                );
+            let mut index = 0;
+            for cluster in container.clusters.values() {
+                if !ctx
+                    .frustum
+                    .map_or(true, |f| f.is_intersects_aabb(&cluster.bounding_box))
+                {
+                    index += cluster.batches.len();
+                    continue;
+                }
+
+                for batch in cluster.batches.values() {
+                    ctx.storage.push(
+                        &batch.data,
+                        &batch.material,
+                        self.render_path(),
+                        self.decal_layer_index(),
+                        batch.material.key() as u64,
+                        SurfaceInstanceData {
+                            world_transform: Matrix4::identity(),
+                            bone_matrices: Default::default(),
+                            depth_offset: self.depth_offset_factor(),
+                            blend_shapes_weights: Default::default(),
+                            element_range: ElementRange::Full,
+                            persistent_identifier: PersistentIdentifier::new_combined(
+                                &batch.data,
+                                self.self_handle,
+                                index,
+                            ),
+                            node_handle: self.self_handle,
+                        },
+                    );
+                    index += 1;
+                }
             }
 
             RdcControlFlow::Break
@@ -666,6 +1007,26 @@ impl NodeTrait for Mesh {
 
                 match batching_mode {
                     BatchingMode::None => {
+                        let mut bone_matrices = Vec::new();
+                        if !surface.bones.is_empty() {
+                            bone_matrices = ctx.storage.bone_matrices_buffer();
+                            bone_matrices.extend(surface.bones.iter().map(|bone_handle| {
+                                if let Some(bone_node) = ctx.graph.try_get(*bone_handle) {
+                                    bone_node.global_transform()
+                                        * bone_node.inv_bind_pose_transform()
+                                } else {
+                                    Matrix4::identity()
+                                }
+                            }));
+                        }
+
+                        let mut blend_shapes_weights = Vec::new();
+                        if !self.blend_shapes().is_empty() {
+                            blend_shapes_weights = ctx.storage.blend_shapes_weights_buffer();
+                            blend_shapes_weights
+                                .extend(self.blend_shapes().iter().map(|bs| bs.weight / 100.0));
+                        }
+
                         ctx.storage.push(
                             surface.data_ref(),
                             surface.material(),
@@ -674,24 +1035,9 @@ impl NodeTrait for Mesh {
                             surface.material().key() as u64,
                             SurfaceInstanceData {
                                 world_transform: world,
-                                bone_matrices: surface
-                                    .bones
-                                    .iter()
-                                    .map(|bone_handle| {
-                                        if let Some(bone_node) = ctx.graph.try_get(*bone_handle) {
-                                            bone_node.global_transform()
-                                                * bone_node.inv_bind_pose_transform()
-                                        } else {
-                                            Matrix4::identity()
-                                        }
-                                    })
-                                    .collect::<Vec<_>>(),
+                                bone_matrices,
                                 depth_offset: self.depth_offset_factor(),
-                                blend_shapes_weights: self
-                                    .blend_shapes()
-                                    .iter()
-                                    .map(|bs| bs.weight / 100.0)
-                                    .collect(),
+                                blend_shapes_weights,
                                 element_range: ElementRange::Full,
                                 persistent_identifier: PersistentIdentifier::new_combined(
                                     surface.data_ref(),
@@ -804,6 +1150,7 @@ pub struct MeshBuilder {
     decal_layer_index: u8,
     blend_shapes: Vec<BlendShape>,
     batching_mode: BatchingMode,
+    static_batch_cluster_size: f32,
 }
 
 impl MeshBuilder {
@@ -816,6 +1163,7 @@ impl MeshBuilder {
             decal_layer_index: 0,
             blend_shapes: Default::default(),
             batching_mode: BatchingMode::None,
+            static_batch_cluster_size: DEFAULT_STATIC_BATCH_CLUSTER_SIZE,
         }
     }
 
@@ -851,6 +1199,13 @@ impl MeshBuilder {
         self
     }
 
+    /// Sets the desired size of static batch clusters. See [`Mesh::set_static_batch_cluster_size`]
+    /// for more info.
+    pub fn with_static_batch_cluster_size(mut self, size: f32) -> Self {
+        self.static_batch_cluster_size = size.max(0.01);
+        self
+    }
+
     /// Creates new mesh.
     pub fn build_node(self) -> Node {
         Node::new(Mesh {
@@ -863,6 +1218,7 @@ impl MeshBuilder {
             decal_layer_index: self.decal_layer_index.into(),
             world_bounding_box: Default::default(),
             batching_mode: self.batching_mode.into(),
+            static_batch_cluster_size: self.static_batch_cluster_size.into(),
             batch_container: Default::default(),
         })
     }
@@ -872,3 +1228,165 @@ impl MeshBuilder {
         graph.add_node(self.build_node())
     }
 }
+
+#[cfg(test)]
+mod test {
+    use super::*;
+    use crate::{
+        core::{algebra::Vector2, math::frustum::Frustum, sstorage::ImmutableString},
+        scene::{
+            graph::{GraphUpdateSwitches, HierarchyUpdateMode},
+            mesh::surface::SurfaceBuilder,
+            transform::TransformBuilder,
+        },
+    };
+
+    #[derive(Default)]
+    struct CountingStorage {
+        instances: usize,
+    }
+
+    impl RenderDataBundleStorageTrait for CountingStorage {
+        fn push_triangles(
+            &mut self,
+            _layout: &[VertexAttributeDescriptor],
+            _material: &MaterialResource,
+            _render_path: RenderPath,
+            _decal_layer_index: u8,
+            _sort_index: u64,
+            _is_skinned: bool,
+            _node_handle: Handle<Node>,
+            _func: &mut dyn FnMut(VertexBufferRefMut, TriangleBufferRefMut),
+        ) {
+        }
+
+        fn push(
+            &mut self,
+            _data: &SurfaceSharedData,
+            _material: &MaterialResource,
+            _render_path: RenderPath,
+            _decal_layer_index: u8,
+            _sort_index: u64,
+            _instance_data: SurfaceInstanceData,
+        ) {
+            self.instances += 1;
+        }
+    }
+
+    fn add_cube(graph: &mut Graph, position: Vector3<f32>) -> Handle<Node> {
+        MeshBuilder::new(
+            BaseBuilder::new().with_local_transform(
+                TransformBuilder::new()
+                    .with_local_position(position)
+                    .build(),
+            ),
+        )
+        .with_surfaces(vec![SurfaceBuilder::new(SurfaceSharedData::new(
+            SurfaceData::make_cube(Matrix4::identity()),
+        ))
+        .build()])
+        .build(graph)
+    }
+
+    fn collect(graph: &Graph, handle: Handle<Node>, frustum: Option<&Frustum>) -> usize {
+        let mut storage = CountingStorage::default();
+        graph[handle].collect_render_data(&mut RenderContext {
+            observer_position: &Vector3::default(),
+            z_near: 0.1,
+            z_far: 100.0,
+            view_matrix: &Matrix4::identity(),
+            projection_matrix: &Matrix4::identity(),
+            frustum,
+            storage: &mut storage,
+            graph,
+            render_pass_name: &ImmutableString::new("GBuffer"),
+        });
+        storage.instances
+    }
+
+    fn cluster_data(graph: &Graph, batch: Handle<Node>, key: ClusterKey) -> SurfaceSharedData {
+        let mesh = graph[batch].cast::<Mesh>().unwrap();
+        let container = mesh.batch_container.0.lock();
+        container.clusters[&key]
+            .batches
+            .values()
+            .next()
+            .unwrap()
+            .data
+            .clone()
+    }
+
+    #[test]
+    fn test_world_bounding_box_follows_surfaces() {
+        let mut graph = Graph::new();
+        let mesh = add_cube(&mut graph, Vector3::new(10.0, 0.0, 0.0));
+
+        let switches = GraphUpdateSwitches {
+            hierarchy_update_mode: HierarchyUpdateMode::Incremental,
+            ..Default::default()
+        };
+        graph.update(Vector2::new(800.0, 600.0), 0.0, switches.clone());
+        let aabb = graph[mesh].world_bounding_box();
+        assert_eq!(aabb.min, Vector3::new(9.5, -0.5, -0.5));
+        assert_eq!(aabb.max, Vector3::new(10.5, 0.5, 0.5));
+
+        // Surface changes must be reflected in world bounds, even though the transform is the same.
+        graph[mesh].as_mesh_mut().add_surface(
+            SurfaceBuilder::new(SurfaceSharedData::new(SurfaceData::make_cube(
+                Matrix4::new_scaling(4.0),
+            )))
+            .build(),
+        );
+        graph.update(Vector2::new(800.0, 600.0), 0.0, switches);
+        let aabb = graph[mesh].world_bounding_box();
+        assert_eq!(aabb.min, Vector3::new(8.0, -2.0, -2.0));
+        assert_eq!(aabb.max, Vector3::new(12.0, 2.0, 2.0));
+    }
+
+    #[test]
+    fn test_static_batch_clusters() {
+        let mut graph = Graph::new();
+        let near = add_cube(&mut graph, Vector3::new(0.5, 0.5, 0.5));
+        let far = add_cube(&mut graph, Vector3::new(100.5, 0.5, 0.5));
+        let batch = MeshBuilder::new(BaseBuilder::new().with_children(&[near, far]))
+            .with_batching_mode(BatchingMode::Static)
+            .with_static_batch_cluster_size(32.0)
+            .build(&mut graph);
+        graph.update_hierarchical_data();
+
+        assert_eq!(collect(&graph, batch, None), 2);
+
+        let frustum = Frustum::from_view_projection_matrix(Matrix4::new_orthographic(
+            -5.0, 5.0, -5.0, 5.0, -5.0, 5.0,
+        ))
+        .unwrap();
+        assert_eq!(collect(&graph, batch, Some(&frustum)), 1);
+
+        let near_key = Vector3::new(0, 0, 0);
+        let far_key = Vector3::new(3, 0, 0);
+        let near_data = cluster_data(&graph, batch, near_key);
+        let far_data = cluster_data(&graph, batch, far_key);
+
+        // Move the near cube within its cluster, only this cluster must be rebuilt.
+        graph[near]
+            .local_transform_mut()
+            .set_position(Vector3::new(1.5, 0.5, 0.5));
+        graph.update(
+            Vector2::new(1.0, 1.0),
+            1.0 / 60.0,
+            GraphUpdateSwitches::default(),
+        );
+        assert_eq!(collect(&graph, batch, None), 2);
+        assert_ne!(cluster_data(&graph, batch, near_key).key(), near_data.key());
+        assert_eq!(cluster_data(&graph, batch, far_key).key(), far_data.key());
+
+        // Removed descendants must disappear from the batch.
+        graph.remove_node(far);
+        graph.update(
+            Vector2::new(1.0, 1.0),
+            1.0 / 60.0,
+            GraphUpdateSwitches::default(),
+        );
+        assert_eq!(collect(&graph, batch, None), 1);
+    }
+}
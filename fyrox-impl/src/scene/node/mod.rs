@@ -222,6 +222,21 @@ pub trait NodeTrait: BaseNodeTrait + Reflect + Visit {
     /// Allows the node to emit a set of render data. This is a high-level rendering method which can only
     /// do culling and provide render data. Render data is just a surface (vertex + index buffers) and a
     /// material.
+    ///
+    /// # Thread safety
+    ///
+    /// The method could be called concurrently for different scene nodes (see
+    /// [`crate::renderer::bundle::RenderDataBundleStorage::from_graph_parallel`]), so it must not
+    /// modify the state of other scene nodes.
+    ///
+    /// # Culling
+    ///
+    /// When the spatial index of the graph is up-to-date (see [`Graph::spatial_index`]), the method is
+    /// called only for the nodes whose world bounding box (see [`Self::world_bounding_box`]) intersects
+    /// the frustum of the observer, for their ancestors and for the nodes with infinite bounds. Render
+    /// data must not be emitted outside of the world bounding box of the node. Nodes with empty local
+    /// bounding box (the default one) are considered to have nothing to render and the method is not
+    /// called for them at all.
     fn collect_render_data(
         &self,
         #[allow(unused_variables)] ctx: &mut RenderContext,
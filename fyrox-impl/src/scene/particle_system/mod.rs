@@ -5,8 +5,8 @@ use crate::scene::mesh::buffer::VertexTrait;
 use crate::scene::node::RdcControlFlow;
 use crate::{
     core::{
-        algebra::{Point3, Vector2, Vector3},
-        color_gradient::ColorGradient,
+        algebra::{Matrix4, Point3, Vector2, Vector3},
+        color_gradient::{ColorGradient, ColorGradientLut},
         log::Log,
         math::{aabb::AxisAlignedBoundingBox, TriangleDefinition},
         pool::Handle,
@@ -28,14 +28,14 @@ use crate::{
         particle_system::{
             draw::Vertex,
             emitter::{Emit, Emitter},
-            particle::Particle,
+            particle::{Particle, ParticleStorage},
         },
     },
 };
 use fyrox_core::value_as_u8_slice;
 use fyrox_graph::BaseSceneGraph;
 use std::{
-    cmp::Ordering,
+    cell::RefCell,
     fmt::Debug,
     ops::{Deref, DerefMut},
 };
@@ -133,6 +133,11 @@ impl Visit for ParticleSystemRng {
 /// enough, alternatively amount of particles can be defined by some coefficient based on
 /// graphics quality settings.
 ///
+/// Particles are stored in a structure-of-arrays form (see [`ParticleStorage`]) and the color over
+/// lifetime is sampled from a pre-calculated table. Bounding box of the particle system is calculated
+/// from its actual particles, so large effects are culled correctly. Particles are sorted back-to-front
+/// using radix sort and the sorted order is reused by every render pass of the same observer.
+///
 /// # Example
 ///
 /// Simple smoke effect can be create like so:
@@ -229,12 +234,131 @@ pub struct ParticleSystem {
     is_playing: InheritableVariable<bool>,
 
     #[reflect(hidden)]
-    particles: Vec<Particle>,
+    particles: ParticleStorage,
+
+    rng: ParticleSystemRng,
 
     #[reflect(hidden)]
-    free_particles: Vec<u32>,
+    color_over_lifetime_lut: ColorGradientLut,
 
-    rng: ParticleSystemRng,
+    // Bounding box of the particle positions and maximal size of the particles.
+    #[reflect(hidden)]
+    particle_bounds: Option<(AxisAlignedBoundingBox, f32)>,
+
+    // Incremented every time when the particles are changed.
+    #[reflect(hidden)]
+    revision: u64,
+
+    #[reflect(hidden)]
+    sort_cache: RefCell<SortCache>,
+}
+
+// Back-to-front order of the particles for the last observer.
+#[derive(Default, Debug, Clone)]
+struct SortCache {
+    observer_position: Vector3<f32>,
+    global_transform: Matrix4<f32>,
+    revision: Option<u64>,
+    // Indices of the particles sorted back-to-front.
+    order: Vec<u32>,
+    // World-space positions of the particles (in original order).
+    world_positions: Vec<Vector3<f32>>,
+    keys: Vec<u32>,
+    scratch_order: Vec<u32>,
+    scratch_keys: Vec<u32>,
+}
+
+impl SortCache {
+    fn update(
+        &mut self,
+        particles: &ParticleStorage,
+        revision: u64,
+        observer_position: Vector3<f32>,
+        global_transform: Matrix4<f32>,
+    ) {
+        if self.revision == Some(revision)
+            && self.observer_position == observer_position
+            && self.global_transform == global_transform
+        {
+            // Same state of the particles for the same observer (for example, another render pass
+            // of the same camera), reuse the previous order.
+            return;
+        }
+
+        self.revision = Some(revision);
+        self.observer_position = observer_position;
+        self.global_transform = global_transform;
+
+        self.world_positions.clear();
+        self.world_positions
+            .extend(particles.positions().iter().map(|position| {
+                global_transform
+                    .transform_point(&Point3::from(*position))
+                    .coords
+            }));
+
+        // Squared distances are non-negative, so their bit patterns have the same order as the values
+        // themselves. Inverted bits give back-to-front order with ascending sort.
+        self.keys.clear();
+        self.keys.extend(
+            self.world_positions
+                .iter()
+                .map(|position| !(observer_position - position).norm_squared().to_bits()),
+        );
+
+        self.order.clear();
+        self.order.extend(0..particles.len() as u32);
+
+        radix_sort(
+            &mut self.keys,
+            &mut self.order,
+            &mut self.scratch_keys,
+            &mut self.scratch_order,
+        );
+    }
+}
+
+// Stable least-significant-digit radix sort of the values by their keys. Passes where every key has
+// the same digit are skipped.
+fn radix_sort(
+    keys: &mut Vec<u32>,
+    values: &mut Vec<u32>,
+    scratch_keys: &mut Vec<u32>,
+    scratch_values: &mut Vec<u32>,
+) {
+    debug_assert_eq!(keys.len(), values.len());
+
+    let count = keys.len();
+    scratch_keys.resize(count, 0);
+    scratch_values.resize(count, 0);
+
+    for shift in [0u32, 8, 16, 24] {
+        let mut histogram = [0usize; 256];
+        for key in keys.iter() {
+            histogram[((key >> shift) & 0xFF) as usize] += 1;
+        }
+
+        if histogram.iter().any(|c| *c == count) {
+            continue;
+        }
+
+        let mut offset = 0;
+        for bucket in histogram.iter_mut() {
+            let bucket_count = *bucket;
+            *bucket = offset;
+            offset += bucket_count;
+        }
+
+        for (key, value) in keys.iter().zip(values.iter()) {
+            let bucket = &mut histogram[((key >> shift) & 0xFF) as usize];
+            scratch_keys[*bucket] = *key;
+            scratch_values[*bucket] = *value;
+            *bucket += 1;
+        }
+
+        std::mem::swap(keys, scratch_keys);
+        std::mem::swap(values, scratch_values);
+    }
 }
 
 impl Visit for ParticleSystem {
@@ -247,8 +371,9 @@ impl Visit for ParticleSystem {
         self.color_over_lifetime
             .visit("ColorGradient", &mut region)?;
         self.is_playing.visit("Enabled", &mut region)?;
-        self.particles.visit("Particles", &mut region)?;
-        self.free_particles.visit("FreeParticles", &mut region)?;
+        // Particles are saved as an array of structures to keep compatibility with older versions.
+        let mut particles = self.particles.iter().collect::<Vec<_>>();
+        particles.visit("Particles", &mut region)?;
         let _ = self.rng.visit("Rng", &mut region);
 
         // Backward compatibility.
@@ -265,6 +390,10 @@ impl Visit for ParticleSystem {
             self.material.visit("Material", &mut region)?;
         }
 
+        if region.is_reading() {
+            self.set_particles(particles);
+        }
+
         let mut soft_boundary_sharpness_factor = 100.0;
         if soft_boundary_sharpness_factor
             .visit("SoftBoundarySharpnessFactor", &mut region)
@@ -330,27 +459,33 @@ impl ParticleSystem {
     }
 
     /// Replaces the particles in the particle system with pre-generated set. It could be useful
-    /// to create procedural particle effects; when particles cannot be pre-made.
+    /// to create procedural particle effects; when particles cannot be pre-made. Dead particles
+    /// are ignored.
     pub fn set_particles(&mut self, particles: Vec<Particle>) {
-        self.free_particles.clear();
-        self.particles = particles;
+        self.particles = particles.into_iter().collect();
+        self.on_particles_changed();
     }
 
-    /// Returns a reference to a slice to the current set of particles, generated by the particle system.
-    pub fn particles(&self) -> &[Particle] {
+    /// Returns a reference to the current set of alive particles, generated by the particle system.
+    pub fn particles(&self) -> &ParticleStorage {
         &self.particles
     }
 
     /// Removes all generated particles.
     pub fn clear_particles(&mut self) {
         self.particles.clear();
-        self.free_particles.clear();
+        self.on_particles_changed();
         for emitter in self.emitters.get_value_mut_silent().iter_mut() {
             emitter.alive_particles = 0;
             emitter.spawned_particles = 0;
         }
     }
 
+    fn on_particles_changed(&mut self) {
+        self.particle_bounds = self.particles.bounds();
+        self.revision = self.revision.wrapping_add(1);
+    }
+
     /// Sets the new material for the particle system.
     pub fn set_material(&mut self, material: MaterialResource) -> MaterialResource {
         self.material.set_value_and_mark_modified(material)
@@ -379,44 +514,32 @@ impl ParticleSystem {
                 };
                 emitter.alive_particles += 1;
                 emitter.emit(&mut particle, &mut self.rng);
-                if let Some(free_index) = self.free_particles.pop() {
-                    self.particles[free_index as usize] = particle;
-                } else {
-                    self.particles.push(particle);
-                }
+                self.particles.push(&particle);
             }
         }
 
-        let acceleration_offset = self.acceleration.scale(dt * dt);
-
-        for (i, particle) in self.particles.iter_mut().enumerate() {
-            if particle.alive {
-                particle.lifetime += dt;
-                if particle.lifetime >= particle.initial_lifetime {
-                    self.free_particles.push(i as u32);
-                    if let Some(emitter) = self
-                        .emitters
-                        .get_value_mut_and_mark_modified()
-                        .get_mut(particle.emitter_index as usize)
-                    {
-                        emitter.alive_particles = emitter.alive_particles.saturating_sub(1);
-                    }
-                    particle.alive = false;
-                    particle.lifetime = particle.initial_lifetime;
-                } else {
-                    particle.velocity += acceleration_offset;
-                    particle.position += particle.velocity;
-                    particle.size += particle.size_modifier * dt;
-                    if particle.size < 0.0 {
-                        particle.size = 0.0;
-                    }
-                    particle.rotation += particle.rotation_speed * dt;
-
-                    let k = particle.lifetime / particle.initial_lifetime;
-                    particle.color = self.color_over_lifetime.get_color(k);
-                }
+        let emitters = &mut self.emitters;
+        self.particles.advance_lifetimes(dt, |emitter_index| {
+            if let Some(emitter) = emitters
+                .get_value_mut_and_mark_modified()
+                .get_mut(emitter_index as usize)
+            {
+                emitter.alive_particles = emitter.alive_particles.saturating_sub(1);
             }
+        });
+
+        if self.color_over_lifetime_lut.gradient() != &*self.color_over_lifetime {
+            self.color_over_lifetime_lut = ColorGradientLut::new(
+                &self.color_over_lifetime,
+                ColorGradientLut::DEFAULT_RESOLUTION,
+            );
         }
+
+        let acceleration_offset = self.acceleration.scale(dt * dt);
+        self.particles
+            .integrate(dt, acceleration_offset, &self.color_over_lifetime_lut);
+
+        self.on_particles_changed();
     }
 
     /// Simulates particle system for the given `time` with given time step (`dt`). `dt` is usually `1.0 / 60.0`.
@@ -444,12 +567,26 @@ impl NodeTrait for ParticleSystem {
     crate::impl_query_component!();
 
     fn local_bounding_box(&self) -> AxisAlignedBoundingBox {
-        AxisAlignedBoundingBox::unit()
+        match self.particle_bounds {
+            Some((mut aabb, max_size)) => {
+                // Particles are camera-facing quads, that could be rotated.
+                aabb.inflate(Vector3::repeat(2.0 * std::f32::consts::SQRT_2 * max_size));
+                aabb
+            }
+            None => AxisAlignedBoundingBox::collapsed(),
+        }
     }
 
     fn world_bounding_box(&self) -> AxisAlignedBoundingBox {
-        self.local_bounding_box()
-            .transform(&self.global_transform())
+        match self.particle_bounds {
+            Some((aabb, max_size)) => {
+                // Size of the particles does not depend on the scale of the particle system.
+                let mut aabb = aabb.transform(&self.global_transform());
+                aabb.inflate(Vector3::repeat(2.0 * std::f32::consts::SQRT_2 * max_size));
+                aabb
+            }
+            None => AxisAlignedBoundingBox::collapsed().transform(&self.global_transform()),
+        }
     }
 
     fn id(&self) -> Uuid {
@@ -478,34 +615,19 @@ impl NodeTrait for ParticleSystem {
             return RdcControlFlow::Continue;
         }
 
-        let mut sorted_particles = Vec::new();
-        for (i, particle) in self.particles.iter().enumerate() {
-            if particle.alive {
-                let actual_position = particle.position + self.base.global_position();
-                particle
-                    .sqr_distance_to_camera
-                    .set((*ctx.observer_position - actual_position).norm_squared());
-                sorted_particles.push(i as u32);
-            }
+        if self.particles.is_empty() {
+            return RdcControlFlow::Continue;
         }
 
-        let particles = &self.particles;
-
-        sorted_particles.sort_by(|a, b| {
-            let particle_a = particles.get(*a as usize).unwrap();
-            let particle_b = particles.get(*b as usize).unwrap();
-
-            // Reverse ordering because we want to sort back-to-front.
-            if particle_a.sqr_distance_to_camera < particle_b.sqr_distance_to_camera {
-                Ordering::Greater
-            } else if particle_a.sqr_distance_to_camera > particle_b.sqr_distance_to_camera {
-                Ordering::Less
-            } else {
-                Ordering::Equal
-            }
-        });
+        let mut sort_cache = self.sort_cache.borrow_mut();
+        sort_cache.update(
+            &self.particles,
+            self.revision,
+            *ctx.observer_position,
+            self.global_transform(),
+        );
+        let sort_cache = &*sort_cache;
 
-        let global_transform = self.global_transform();
         let sort_index = ctx.calculate_sorting_index(self.global_position());
 
         ctx.storage.push_triangles(
@@ -517,46 +639,50 @@ impl NodeTrait for ParticleSystem {
             false,
             self.self_handle,
             &mut move |mut vertex_buffer, mut triangle_buffer| {
-                let vertices = sorted_particles.iter().flat_map(move |particle_index| {
-                    let particle = self.particles.get(*particle_index as usize).unwrap();
+                let sizes = self.particles.sizes();
+                let rotations = self.particles.rotations();
+                let colors = self.particles.colors();
 
-                    let position = global_transform
-                        .transform_point(&Point3::from(particle.position))
-                        .coords;
+                let vertices = sort_cache.order.iter().flat_map(move |particle_index| {
+                    let i = *particle_index as usize;
+                    let position = sort_cache.world_positions[i];
+                    let size = sizes[i];
+                    let rotation = rotations[i];
+                    let color = colors[i];
 
                     [
                         Vertex {
                             position,
                             tex_coord: Vector2::default(),
-                            size: particle.size,
-                            rotation: particle.rotation,
-                            color: particle.color,
+                            size,
+                            rotation,
+                            color,
                         },
                         Vertex {
                             position,
                             tex_coord: Vector2::new(1.0, 0.0),
-                            size: particle.size,
-                            rotation: particle.rotation,
-                            color: particle.color,
+                            size,
+                            rotation,
+                            color,
                         },
                         Vertex {
                             position,
                             tex_coord: Vector2::new(1.0, 1.0),
-                            size: particle.size,
-                            rotation: particle.rotation,
-                            color: particle.color,
+                            size,
+                            rotation,
+                            color,
                         },
                         Vertex {
                             position,
                             tex_coord: Vector2::new(0.0, 1.0),
-                            size: particle.size,
-                            rotation: particle.rotation,
-                            color: particle.color,
+                            size,
+                            rotation,
+                            color,
                         },
                     ]
                 });
 
-                let triangles = (0..sorted_particles.len()).flat_map(|i| {
+                let triangles = (0..sort_cache.order.len()).flat_map(|i| {
                     let base_index = (i * 4) as u32;
 
                     [
@@ -656,16 +782,24 @@ impl ParticleSystemBuilder {
     }
 
     fn build_particle_system(self) -> ParticleSystem {
+        let particles = self.particles.into_iter().collect::<ParticleStorage>();
+        let color_over_lifetime_lut = ColorGradientLut::new(
+            &self.color_over_lifetime,
+            ColorGradientLut::DEFAULT_RESOLUTION,
+        );
         ParticleSystem {
             base: self.base_builder.build_base(),
-            particles: self.particles,
-            free_particles: Vec::new(),
+            particle_bounds: particles.bounds(),
+            particles,
             emitters: self.emitters.into(),
             material: self.material.into(),
             acceleration: self.acceleration.into(),
             color_over_lifetime: self.color_over_lifetime.into(),
             is_playing: self.is_playing.into(),
             rng: self.rng,
+            color_over_lifetime_lut,
+            revision: 0,
+            sort_cache: Default::default(),
         }
     }
 
@@ -679,3 +813,84 @@ impl ParticleSystemBuilder {
         graph.add_node(self.build_node())
     }
 }
+
+#[cfg(test)]
+mod test {
+    use crate::{
+        core::algebra::Vector3,
+        scene::{
+            base::BaseBuilder,
+            node::NodeTrait,
+            particle_system::{
+                emitter::{base::BaseEmitterBuilder, sphere::SphereEmitterBuilder},
+                particle::Particle,
+                radix_sort, ParticleSystemBuilder,
+            },
+        },
+    };
+
+    #[test]
+    fn test_radix_sort() {
+        let mut keys = vec![5, 0x0100_0000, 3, 5, 0, 0xFFFF_FFFF, 0x0001_0000];
+        let mut values = (0..keys.len() as u32).collect::<Vec<_>>();
+        radix_sort(&mut keys, &mut values, &mut Vec::new(), &mut Vec::new());
+        assert_eq!(keys, [0, 3, 5, 5, 0x0001_0000, 0x0100_0000, 0xFFFF_FFFF]);
+        // Sort must be stable.
+        assert_eq!(values, [4, 2, 0, 3, 6, 1, 5]);
+    }
+
+    #[test]
+    fn test_particle_system_bounds() {
+        let mut particle_system = ParticleSystemBuilder::new(BaseBuilder::new())
+            .with_acceleration(Vector3::default())
+            .with_particles(vec![
+                Particle::default()
+                    .with_position(Vector3::new(-10.0, 0.0, 0.0))
+                    .with_size(0.0)
+                    .with_initial_lifetime(100.0),
+                Particle::default()
+                    .with_position(Vector3::new(10.0, 2.0, 0.0))
+                    .with_velocity(Vector3::new(0.0, 1.0, 0.0))
+                    .with_size(0.0)
+                    .with_initial_lifetime(100.0),
+            ])
+            .build_particle_system();
+
+        let aabb = particle_system.local_bounding_box();
+        assert_eq!(aabb.min, Vector3::new(-10.0, 0.0, 0.0));
+        assert_eq!(aabb.max, Vector3::new(10.0, 2.0, 0.0));
+
+        particle_system.tick(0.1);
+        let aabb = particle_system.local_bounding_box();
+        assert_eq!(aabb.max, Vector3::new(10.0, 3.0, 0.0));
+
+        particle_system.clear_particles();
+        assert!(particle_system.particles().is_empty());
+        assert!(particle_system.local_bounding_box().is_degenerate());
+    }
+
+    #[test]
+    fn test_particle_system_lifetime() {
+        let mut particle_system = ParticleSystemBuilder::new(BaseBuilder::new())
+            .with_emitters(vec![SphereEmitterBuilder::new(
+                BaseEmitterBuilder::new()
+                    .with_max_particles(10)
+                    .with_spawn_rate(1000)
+                    .with_lifetime_range(0.5..0.6)
+                    .resurrect_particles(false),
+            )
+            .build()])
+            .build_particle_system();
+
+        particle_system.tick(0.1);
+        assert_eq!(particle_system.particles().len(), 10);
+        assert_eq!(particle_system.emitters[0].alive_particles, 10);
+
+        // Every particle must be dead after its lifetime.
+        for _ in 0..6 {
+            particle_system.tick(0.1);
+        }
+        assert_eq!(particle_system.emitters[0].alive_particles, 0);
+        assert!(particle_system.particles().is_empty());
+    }
+}
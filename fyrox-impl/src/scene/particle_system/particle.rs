@@ -1,8 +1,10 @@
 //! Particle is a quad with texture and various other parameters, such as
 //! position, velocity, size, lifetime, etc.
 
-use crate::core::{algebra::Vector3, color::Color, visitor::prelude::*};
-use std::cell::Cell;
+use crate::core::{
+    algebra::Vector3, color::Color, color_gradient::ColorGradientLut,
+    math::aabb::AxisAlignedBoundingBox, visitor::prelude::*,
+};
 
 /// See module docs.
 #[derive(Clone, Debug, Visit)]
@@ -31,8 +33,6 @@ pub struct Particle {
     /// Particle is alive if lifetime > 0
     #[visit(rename = "LifeTime")]
     pub(super) lifetime: f32,
-    #[visit(skip)]
-    pub(super) sqr_distance_to_camera: Cell<f32>,
 }
 
 impl Default for Particle {
@@ -49,7 +49,6 @@ impl Default for Particle {
             rotation: 0.0,
             emitter_index: 0,
             color: Color::WHITE,
-            sqr_distance_to_camera: Cell::new(0.0),
         }
     }
 }
@@ -103,3 +102,213 @@ impl Particle {
         self
     }
 }
+
+/// Structure-of-arrays storage of alive particles. Every property of the particles is stored in a
+/// separate array, which allows the particle system to update the particles using tight loops that
+/// could be easily vectorized by the compiler. Dead particles are removed immediately (by swapping
+/// with the last particle), so the arrays are always dense.
+#[derive(Clone, Debug, Default)]
+pub struct ParticleStorage {
+    positions: Vec<Vector3<f32>>,
+    velocities: Vec<Vector3<f32>>,
+    sizes: Vec<f32>,
+    size_modifiers: Vec<f32>,
+    lifetimes: Vec<f32>,
+    initial_lifetimes: Vec<f32>,
+    rotations: Vec<f32>,
+    rotation_speeds: Vec<f32>,
+    colors: Vec<Color>,
+    emitter_indices: Vec<u32>,
+}
+
+impl ParticleStorage {
+    /// Returns amount of alive particles.
+    #[inline]
+    pub fn len(&self) -> usize {
+        self.positions.len()
+    }
+
+    /// Returns `true` if there is no alive particles.
+    #[inline]
+    pub fn is_empty(&self) -> bool {
+        self.positions.is_empty()
+    }
+
+    /// Removes every particle from the storage.
+    pub fn clear(&mut self) {
+        self.positions.clear();
+        self.velocities.clear();
+        self.sizes.clear();
+        self.size_modifiers.clear();
+        self.lifetimes.clear();
+        self.initial_lifetimes.clear();
+        self.rotations.clear();
+        self.rotation_speeds.clear();
+        self.colors.clear();
+        self.emitter_indices.clear();
+    }
+
+    /// Adds a new particle to the storage. Dead particles are ignored.
+    pub fn push(&mut self, particle: &Particle) {
+        if !particle.alive {
+            return;
+        }
+
+        self.positions.push(particle.position);
+        self.velocities.push(particle.velocity);
+        self.sizes.push(particle.size);
+        self.size_modifiers.push(particle.size_modifier);
+        self.lifetimes.push(particle.lifetime);
+        self.initial_lifetimes.push(particle.initial_lifetime);
+        self.rotations.push(particle.rotation);
+        self.rotation_speeds.push(particle.rotation_speed);
+        self.colors.push(particle.color);
+        self.emitter_indices.push(particle.emitter_index);
+    }
+
+    /// Removes a particle at the given index. The last particle takes its place.
+    pub fn swap_remove(&mut self, index: usize) {
+        self.positions.swap_remove(index);
+        self.velocities.swap_remove(index);
+        self.sizes.swap_remove(index);
+        self.size_modifiers.swap_remove(index);
+        self.lifetimes.swap_remove(index);
+        self.initial_lifetimes.swap_remove(index);
+        self.rotations.swap_remove(index);
+        self.rotation_speeds.swap_remove(index);
+        self.colors.swap_remove(index);
+        self.emitter_indices.swap_remove(index);
+    }
+
+    /// Assembles a particle at the given index.
+    pub fn get(&self, index: usize) -> Option<Particle> {
+        Some(Particle {
+            position: *self.positions.get(index)?,
+            velocity: self.velocities[index],
+            size: self.sizes[index],
+            size_modifier: self.size_modifiers[index],
+            initial_lifetime: self.initial_lifetimes[index],
+            rotation_speed: self.rotation_speeds[index],
+            rotation: self.rotations[index],
+            color: self.colors[index],
+            alive: true,
+            emitter_index: self.emitter_indices[index],
+            lifetime: self.lifetimes[index],
+        })
+    }
+
+    /// Creates an iterator over the particles in the storage.
+    pub fn iter(&self) -> impl Iterator<Item = Particle> + '_ {
+        (0..self.len()).filter_map(|i| self.get(i))
+    }
+
+    /// Returns positions of the particles in local coordinates of the particle system.
+    #[inline]
+    pub fn positions(&self) -> &[Vector3<f32>] {
+        &self.positions
+    }
+
+    /// Returns velocities of the particles in local coordinates of the particle system.
+    #[inline]
+    pub fn velocities(&self) -> &[Vector3<f32>] {
+        &self.velocities
+    }
+
+    /// Returns sizes of the particles.
+    #[inline]
+    pub fn sizes(&self) -> &[f32] {
+        &self.sizes
+    }
+
+    /// Returns rotation angles (in radians) of the particles.
+    #[inline]
+    pub fn rotations(&self) -> &[f32] {
+        &self.rotations
+    }
+
+    /// Returns colors of the particles.
+    #[inline]
+    pub fn colors(&self) -> &[Color] {
+        &self.colors
+    }
+
+    /// Returns indices of the emitters, that have emitted the particles.
+    #[inline]
+    pub fn emitter_indices(&self) -> &[u32] {
+        &self.emitter_indices
+    }
+
+    /// Advances lifetime of every particle by `dt` and removes the particles, that have reached
+    /// the end of their life. `on_death` is called with an emitter index of each removed particle.
+    pub(super) fn advance_lifetimes(&mut self, dt: f32, mut on_death: impl FnMut(u32)) {
+        for lifetime in self.lifetimes.iter_mut() {
+            *lifetime += dt;
+        }
+
+        // Iterate backwards so every particle moved by swap removal was already checked.
+        for i in (0..self.len()).rev() {
+            if self.lifetimes[i] >= self.initial_lifetimes[i] {
+                on_death(self.emitter_indices[i]);
+                self.swap_remove(i);
+            }
+        }
+    }
+
+    /// Integrates motion of every particle. Each property is updated in a separate loop, so the
+    /// loops could be vectorized.
+    pub(super) fn integrate(
+        &mut self,
+        dt: f32,
+        acceleration_offset: Vector3<f32>,
+        color_over_lifetime: &ColorGradientLut,
+    ) {
+        for velocity in self.velocities.iter_mut() {
+            *velocity += acceleration_offset;
+        }
+
+        for (position, velocity) in self.positions.iter_mut().zip(self.velocities.iter()) {
+            *position += *velocity;
+        }
+
+        for (size, size_modifier) in self.sizes.iter_mut().zip(self.size_modifiers.iter()) {
+            *size = (*size + *size_modifier * dt).max(0.0);
+        }
+
+        for (rotation, rotation_speed) in self.rotations.iter_mut().zip(self.rotation_speeds.iter())
+        {
+            *rotation += *rotation_speed * dt;
+        }
+
+        for ((color, lifetime), initial_lifetime) in self
+            .colors
+            .iter_mut()
+            .zip(self.lifetimes.iter())
+            .zip(self.initial_lifetimes.iter())
+        {
+            *color = color_over_lifetime.get_color(*lifetime / *initial_lifetime);
+        }
+    }
+
+    /// Calculates local bounding box of the positions of the particles and the maximal size of
+    /// the particles. Returns `None` if there is no particles.
+    pub(super) fn bounds(&self) -> Option<(AxisAlignedBoundingBox, f32)> {
+        let first = *self.positions.first()?;
+        let mut aabb = AxisAlignedBoundingBox::from_point(first);
+        for position in self.positions.iter() {
+            aabb.min = aabb.min.inf(position);
+            aabb.max = aabb.max.sup(position);
+        }
+        let max_size = self.sizes.iter().fold(0.0f32, |acc, size| acc.max(*size));
+        Some((aabb, max_size))
+    }
+}
+
+impl FromIterator<Particle> for ParticleStorage {
+    fn from_iter<T: IntoIterator<Item = Particle>>(iter: T) -> Self {
+        let mut storage = Self::default();
+        for particle in iter {
+            storage.push(&particle);
+        }
+        storage
+    }
+}
@@ -11,7 +11,7 @@ use crate::{
 use fxhash::FxHashSet;
 use fyrox_sound::{
     bus::AudioBusGraph,
-    context::DistanceModel,
+    context::{DistanceModel, VoiceSettings},
     renderer::Renderer,
     source::{SoundSource, SoundSourceBuilder, Status},
 };
@@ -70,6 +70,26 @@ impl<'a> SoundContextGuard<'a> {
         self.guard.full_render_duration()
     }
 
+    /// Sets new voice settings. See [`VoiceSettings`] docs for more info.
+    pub fn set_voice_settings(&mut self, settings: VoiceSettings) -> VoiceSettings {
+        self.guard.set_voice_settings(settings)
+    }
+
+    /// Returns current voice settings.
+    pub fn voice_settings(&self) -> &VoiceSettings {
+        self.guard.voice_settings()
+    }
+
+    /// Returns amount of sounds, that were rendered during the last render call.
+    pub fn real_voice_count(&self) -> usize {
+        self.guard.real_voice_count()
+    }
+
+    /// Returns amount of sounds, that were virtualized during the last render call.
+    pub fn virtual_voice_count(&self) -> usize {
+        self.guard.virtual_voice_count()
+    }
+
     /// Returns current renderer.
     pub fn renderer(&self) -> Renderer {
         self.guard.renderer().clone()
@@ -215,6 +235,9 @@ impl SoundContext {
             sound.audio_bus.try_sync_model(|audio_bus| {
                 source.set_bus(audio_bus);
             });
+            sound.priority.try_sync_model(|v| {
+                source.set_priority(v);
+            });
         } else {
             match SoundSourceBuilder::new()
                 .with_gain(sound.gain())
@@ -229,6 +252,7 @@ impl SoundContext {
                 .with_max_distance(sound.max_distance())
                 .with_bus(sound.audio_bus())
                 .with_rolloff_factor(sound.rolloff_factor())
+                .with_priority(sound.priority())
                 .build()
             {
                 Ok(source) => {
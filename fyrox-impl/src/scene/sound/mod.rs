@@ -103,6 +103,13 @@ pub struct Sound {
     )]
     audio_bus: InheritableVariable<String>,
 
+    #[visit(optional)]
+    #[reflect(
+        setter = "set_priority",
+        description = "Priority of the sound. Sounds with higher priority are virtualized last."
+    )]
+    priority: InheritableVariable<i32>,
+
     #[reflect(hidden)]
     #[visit(skip)]
     pub(crate) native: Cell<Handle<SoundSource>>,
@@ -139,6 +146,7 @@ impl Default for Sound {
             playback_time: Default::default(),
             spatial_blend: InheritableVariable::new_modified(1.0),
             audio_bus: InheritableVariable::new_modified(AudioBusGraph::PRIMARY_BUS.to_string()),
+            priority: InheritableVariable::new_modified(0),
             native: Default::default(),
         }
     }
@@ -161,6 +169,7 @@ impl Clone for Sound {
             playback_time: self.playback_time.clone(),
             spatial_blend: self.spatial_blend.clone(),
             audio_bus: self.audio_bus.clone(),
+            priority: self.priority.clone(),
             // Do not copy. The copy will have its own native representation.
             native: Default::default(),
         }
@@ -363,6 +372,17 @@ impl Sound {
     pub fn audio_bus(&self) -> &str {
         &self.audio_bus
     }
+
+    /// Sets new priority of the sound. When the sound context is over its voice limit, sounds with
+    /// lower priority are virtualized first. See [`fyrox_sound::context::VoiceSettings`] for more info.
+    pub fn set_priority(&mut self, priority: i32) -> i32 {
+        self.priority.set_value_and_mark_modified(priority)
+    }
+
+    /// Returns current priority of the sound.
+    pub fn priority(&self) -> i32 {
+        *self.priority
+    }
 }
 
 impl NodeTrait for Sound {
@@ -452,6 +472,7 @@ pub struct SoundBuilder {
     playback_time: Duration,
     spatial_blend: f32,
     audio_bus: String,
+    priority: i32,
 }
 
 impl SoundBuilder {
@@ -472,6 +493,7 @@ impl SoundBuilder {
             spatial_blend: 1.0,
             playback_time: Default::default(),
             audio_bus: AudioBusGraph::PRIMARY_BUS.to_string(),
+            priority: 0,
         }
     }
 
@@ -540,6 +562,11 @@ impl SoundBuilder {
         fn with_audio_bus(audio_bus: String)
     );
 
+    define_with!(
+        /// Sets desired priority. See [`Sound::set_priority`] for more info.
+        fn with_priority(priority: i32)
+    );
+
     /// Creates a new [`Sound`] node.
     #[must_use]
     pub fn build_sound(self) -> Sound {
@@ -558,6 +585,7 @@ impl SoundBuilder {
             playback_time: self.playback_time.as_secs_f32().into(),
             spatial_blend: self.spatial_blend.into(),
             audio_bus: self.audio_bus.into(),
+            priority: self.priority.into(),
             native: Default::default(),
         }
     }
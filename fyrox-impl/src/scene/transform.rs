@@ -61,6 +61,12 @@ pub struct Transform {
     #[reflect(hidden)]
     dirty: Cell<bool>,
 
+    // Indicates that some property has changed since the last time the scene graph has
+    // recalculated global transform of the owner node. Unlike `dirty` it is not reset by
+    // `matrix()` calls, only by the scene graph.
+    #[reflect(hidden)]
+    hierarchy_dirty: Cell<bool>,
+
     #[reflect(
         description = "Local scale of the transform",
         setter = "set_scale_internal",
@@ -183,6 +189,7 @@ impl Transform {
     pub fn identity() -> Self {
         Self {
             dirty: Cell::new(true),
+            hierarchy_dirty: Cell::new(true),
             local_position: InheritableVariable::new_modified(Vector3::default()),
             local_scale: InheritableVariable::new_modified(Vector3::new(1.0, 1.0, 1.0)),
             local_rotation: InheritableVariable::new_modified(UnitQuaternion::identity()),
@@ -214,7 +221,7 @@ impl Transform {
 
     #[inline]
     fn set_position_internal(&mut self, local_position: Vector3<f32>) -> Vector3<f32> {
-        self.dirty.set(true);
+        self.invalidate();
         self.local_position
             .set_value_and_mark_modified(local_position)
     }
@@ -239,7 +246,7 @@ impl Transform {
         &mut self,
         local_rotation: UnitQuaternion<f32>,
     ) -> UnitQuaternion<f32> {
-        self.dirty.set(true);
+        self.invalidate();
         self.local_rotation
             .set_value_and_mark_modified(local_rotation)
     }
@@ -261,7 +268,7 @@ impl Transform {
 
     #[inline]
     fn set_scale_internal(&mut self, local_scale: Vector3<f32>) -> Vector3<f32> {
-        self.dirty.set(true);
+        self.invalidate();
         self.local_scale.set_value_and_mark_modified(local_scale)
     }
 
@@ -281,7 +288,7 @@ impl Transform {
         &mut self,
         pre_rotation: UnitQuaternion<f32>,
     ) -> UnitQuaternion<f32> {
-        self.dirty.set(true);
+        self.invalidate();
         self.pre_rotation.set_value_and_mark_modified(pre_rotation)
     }
 
@@ -308,7 +315,7 @@ impl Transform {
         post_rotation: UnitQuaternion<f32>,
     ) -> UnitQuaternion<f32> {
         self.post_rotation_matrix = build_post_rotation_matrix(post_rotation);
-        self.dirty.set(true);
+        self.invalidate();
         self.post_rotation
             .set_value_and_mark_modified(post_rotation)
     }
@@ -331,7 +338,7 @@ impl Transform {
 
     #[inline]
     fn set_rotation_offset_internal(&mut self, rotation_offset: Vector3<f32>) -> Vector3<f32> {
-        self.dirty.set(true);
+        self.invalidate();
         self.rotation_offset
             .set_value_and_mark_modified(rotation_offset)
     }
@@ -355,7 +362,7 @@ impl Transform {
 
     #[inline]
     fn set_rotation_pivot_internal(&mut self, rotation_pivot: Vector3<f32>) -> Vector3<f32> {
-        self.dirty.set(true);
+        self.invalidate();
         self.rotation_pivot
             .set_value_and_mark_modified(rotation_pivot)
     }
@@ -372,14 +379,14 @@ impl Transform {
     pub fn set_scaling_offset(&mut self, scaling_offset: Vector3<f32>) -> &mut Self {
         if self.dirty.get() || *self.scaling_offset != scaling_offset {
             self.set_scaling_offset_internal(scaling_offset);
-            self.dirty.set(true);
+            self.invalidate();
         }
         self
     }
 
     #[inline]
     fn set_scaling_offset_internal(&mut self, scaling_offset: Vector3<f32>) -> Vector3<f32> {
-        self.dirty.set(true);
+        self.invalidate();
         self.scaling_offset
             .set_value_and_mark_modified(scaling_offset)
     }
@@ -396,14 +403,14 @@ impl Transform {
     pub fn set_scaling_pivot(&mut self, scaling_pivot: Vector3<f32>) -> &mut Self {
         if self.dirty.get() || *self.scaling_pivot != scaling_pivot {
             self.set_scaling_pivot_internal(scaling_pivot);
-            self.dirty.set(true);
+            self.invalidate();
         }
         self
     }
 
     #[inline]
     fn set_scaling_pivot_internal(&mut self, scaling_pivot: Vector3<f32>) -> Vector3<f32> {
-        self.dirty.set(true);
+        self.invalidate();
         self.scaling_pivot
             .set_value_and_mark_modified(scaling_pivot)
     }
@@ -420,10 +427,28 @@ impl Transform {
     pub fn offset(&mut self, vec: Vector3<f32>) -> &mut Self {
         self.local_position
             .set_value_and_mark_modified(*self.local_position + vec);
-        self.dirty.set(true);
+        self.invalidate();
         self
     }
 
+    #[inline]
+    fn invalidate(&self) {
+        self.dirty.set(true);
+        self.hierarchy_dirty.set(true);
+    }
+
+    /// Returns `true` if the transform was changed since the last hierarchical data update of
+    /// the scene graph.
+    #[inline]
+    pub(crate) fn is_hierarchy_dirty(&self) -> bool {
+        self.hierarchy_dirty.get()
+    }
+
+    #[inline]
+    pub(crate) fn reset_hierarchy_dirty(&self) {
+        self.hierarchy_dirty.set(false);
+    }
+
     fn calculate_local_transform(&self) -> Matrix4<f32> {
         // Make shortcuts to remove visual clutter.
         let por = &self.post_rotation_matrix;
@@ -651,6 +676,7 @@ impl TransformBuilder {
     pub fn build(self) -> Transform {
         Transform {
             dirty: Cell::new(true),
+            hierarchy_dirty: Cell::new(true),
             local_scale: self.local_scale.into(),
             local_position: self.local_position.into(),
             local_rotation: self.local_rotation.into(),
@@ -7,7 +7,9 @@ use crate::scene::base::NodeScriptMessage;
 use crate::{
     asset::manager::ResourceManager,
     core::{
+        algebra::{Matrix4, Vector3},
         log::Log,
+        math::{aabb::AxisAlignedBoundingBox, Matrix4Ext},
         pool::Handle,
         reflect::{FieldInfo, Reflect, ReflectArray, ReflectList},
         type_traits::ComponentProvider,
@@ -18,7 +20,7 @@ use crate::{
     engine::{task::TaskPoolHandler, GraphicsContext, ScriptMessageDispatcher},
     event::Event,
     plugin::Plugin,
-    scene::{node::Node, Scene},
+    scene::{graph::Graph, node::Node, Scene},
 };
 use fyrox_ui::UserInterface;
 use std::{
@@ -514,6 +516,230 @@ impl<'a, 'b, 'c> UniversalScriptContext for ScriptDeinitContext<'a, 'b, 'c> {
     }
 }
 
+/// Declares what part of a scene a script touches in its update method. The engine uses this
+/// information to decide whether the script can be updated in parallel with the other scripts.
+/// See [`ScriptTrait::update_access`] for more info.
+#[derive(Copy, Clone, Debug, Default, PartialEq, Eq, Hash)]
+pub enum ScriptAccess {
+    /// The script needs full mutable access to the scene, the engine, plugins, etc. Such scripts
+    /// are updated one-by-one on the main thread by calling [`ScriptTrait::on_update`]. This is
+    /// the default.
+    #[default]
+    Exclusive,
+
+    /// The script only reads the scene graph. It is updated in parallel with the other scripts
+    /// by calling [`ScriptTrait::on_parallel_update`] and reads the scene via [`ParallelScriptContext::snapshot`].
+    /// Every modification of the scene must be deferred using [`ParallelScriptContext::commands`].
+    ReadOnly,
+
+    /// The script writes only to the node it is assigned to and does not read any other nodes.
+    /// It is updated in parallel with the other scripts by calling [`ScriptTrait::on_parallel_update`]
+    /// and has mutable access to its node via [`ParallelScriptContext::node_mut`]. Every other
+    /// modification of the scene must be deferred using [`ParallelScriptContext::commands`].
+    DisjointWrite,
+}
+
+/// A deferred command, that will be executed on the main thread with full access to the scene.
+pub type ScriptCommand = Box<dyn FnOnce(&mut ScriptContext) + Send>;
+
+/// A buffer of deferred commands of a script instance, that is being updated in parallel. The commands
+/// will be executed on the main thread right after the parallel update phase, in a deterministic order
+/// (read-only scripts first, each group in the order of the scripts in the scene graph). Use it for structural changes of the
+/// scene graph (spawning or removing nodes), access to plugins, sending messages, etc.
+#[derive(Default)]
+pub struct ScriptCommandBuffer {
+    commands: Vec<ScriptCommand>,
+}
+
+impl Debug for ScriptCommandBuffer {
+    fn fmt(&self, f: &mut Formatter<'_>) -> std::fmt::Result {
+        write!(f, "ScriptCommandBuffer({} commands)", self.commands.len())
+    }
+}
+
+impl ScriptCommandBuffer {
+    /// Adds a new command to the buffer. The context that will be passed to the command is the
+    /// same context that would be passed to [`ScriptTrait::on_update`] of the script, that issued
+    /// the command.
+    pub fn push<F>(&mut self, command: F)
+    where
+        F: FnOnce(&mut ScriptContext) + Send + 'static,
+    {
+        self.commands.push(Box::new(command))
+    }
+
+    /// Adds a command, that removes the given node (and its descendants) from the graph.
+    pub fn remove_node(&mut self, handle: Handle<Node>) {
+        self.push(move |ctx| {
+            if ctx.scene.graph.is_valid_handle(handle) {
+                ctx.scene.graph.remove_node(handle)
+            }
+        })
+    }
+
+    /// Returns total amount of commands in the buffer.
+    pub fn len(&self) -> usize {
+        self.commands.len()
+    }
+
+    /// Returns `true` if the buffer is empty, `false` - otherwise.
+    pub fn is_empty(&self) -> bool {
+        self.commands.is_empty()
+    }
+
+    pub(crate) fn drain(&mut self) -> std::vec::Drain<'_, ScriptCommand> {
+        self.commands.drain(..)
+    }
+}
+
+/// A copy of the spatial state of a scene node, see [`GraphSnapshot`] for more info.
+#[derive(Clone, Debug, PartialEq)]
+pub struct NodeSnapshot {
+    /// Handle of the parent node.
+    pub parent: Handle<Node>,
+    /// Global transform of the node, see [`crate::scene::base::Base::global_transform`].
+    pub global_transform: Matrix4<f32>,
+    /// World-space bounding box of the node, see [`crate::scene::node::NodeTrait::world_bounding_box`].
+    pub world_bounding_box: AxisAlignedBoundingBox,
+    /// Global visibility of the node, see [`crate::scene::base::Base::global_visibility`].
+    pub global_visibility: bool,
+    /// Whether the node and all its ancestors are enabled or not.
+    pub globally_enabled: bool,
+}
+
+impl NodeSnapshot {
+    /// Returns position of the node in world coordinates.
+    pub fn global_position(&self) -> Vector3<f32> {
+        self.global_transform.position()
+    }
+}
+
+/// A read-only copy of the spatial state of every node of a scene graph, captured right before the
+/// parallel update phase. Unlike the graph itself, the snapshot does not have any lazily calculated
+/// data, so it can be safely read from any amount of threads at the same time.
+#[derive(Default, Debug)]
+pub struct GraphSnapshot {
+    nodes: Vec<Option<(u32, NodeSnapshot)>>,
+}
+
+impl GraphSnapshot {
+    pub(crate) fn capture(&mut self, graph: &Graph) {
+        self.nodes.clear();
+        self.nodes.resize(graph.capacity() as usize, None);
+        for (handle, node) in graph.pair_iter() {
+            self.nodes[handle.index() as usize] = Some((
+                handle.generation(),
+                NodeSnapshot {
+                    parent: node.parent(),
+                    global_transform: node.global_transform(),
+                    world_bounding_box: node.world_bounding_box(),
+                    global_visibility: node.global_visibility(),
+                    globally_enabled: node.is_globally_enabled(),
+                },
+            ));
+        }
+    }
+
+    /// Returns a snapshot of the node with the given handle, if the node exists.
+    pub fn get(&self, handle: Handle<Node>) -> Option<&NodeSnapshot> {
+        match self.nodes.get(handle.index() as usize)? {
+            Some((generation, node)) if *generation == handle.generation() => Some(node),
+            _ => None,
+        }
+    }
+
+    /// Checks whether the given handle points to a node, that existed at the moment of capture.
+    pub fn is_valid_handle(&self, handle: Handle<Node>) -> bool {
+        self.get(handle).is_some()
+    }
+
+    /// Returns an iterator over every node of the snapshot with its handle.
+    pub fn pair_iter(&self) -> impl Iterator<Item = (Handle<Node>, &NodeSnapshot)> {
+        self.nodes.iter().enumerate().filter_map(|(index, entry)| {
+            entry
+                .as_ref()
+                .map(|(generation, node)| (Handle::new(index as u32, *generation), node))
+        })
+    }
+}
+
+pub(crate) enum ParallelSceneAccess<'a> {
+    ReadOnly {
+        snapshot: &'a GraphSnapshot,
+        graph: &'a Graph,
+    },
+    Node(&'a mut Node),
+}
+
+/// A set of data, that is passed to [`ScriptTrait::on_parallel_update`]. Unlike [`ScriptContext`], it
+/// does not provide mutable access to the scene, instead it gives access that was declared by the script
+/// in [`ScriptTrait::update_access`].
+pub struct ParallelScriptContext<'a> {
+    /// Amount of time that passed from last call.
+    pub dt: f32,
+
+    /// Amount of time (in seconds) that passed from creation of the engine. See [`ScriptContext::elapsed_time`]
+    /// for more info.
+    pub elapsed_time: f32,
+
+    /// Handle of a node to which the script instance belongs to.
+    pub handle: Handle<Node>,
+
+    /// Index of the script. Never save this index, it is only valid while this context exists!
+    pub script_index: usize,
+
+    /// A buffer for deferred commands, that will be executed after the parallel update phase.
+    pub commands: &'a mut ScriptCommandBuffer,
+
+    pub(crate) access: ParallelSceneAccess<'a>,
+}
+
+impl<'a> ParallelScriptContext<'a> {
+    /// Returns a snapshot of the scene graph, if the script declared [`ScriptAccess::ReadOnly`] access.
+    /// See [`GraphSnapshot`] docs for more info.
+    pub fn snapshot(&self) -> Option<&GraphSnapshot> {
+        match self.access {
+            ParallelSceneAccess::ReadOnly { snapshot, .. } => Some(snapshot),
+            ParallelSceneAccess::Node(_) => None,
+        }
+    }
+
+    /// Returns a reference to the scene graph, if the script declared [`ScriptAccess::ReadOnly`] access.
+    /// Prefer [`Self::snapshot`] whenever possible.
+    ///
+    /// # Safety
+    ///
+    /// Other scripts read the same graph from other threads at the same time. The caller must only
+    /// read plain data of nodes (names, properties, global transforms, etc.) and must never call
+    /// methods that lazily refresh internal caches of a node (for example, [`crate::scene::transform::Transform::matrix`]
+    /// or bounding boxes of meshes), because it is a data race.
+    pub unsafe fn graph(&self) -> Option<&Graph> {
+        match self.access {
+            ParallelSceneAccess::ReadOnly { graph, .. } => Some(graph),
+            ParallelSceneAccess::Node(_) => None,
+        }
+    }
+
+    /// Returns a reference to the node to which the script instance belongs to, if the script
+    /// declared [`ScriptAccess::DisjointWrite`] access. Read-only scripts should use [`Self::snapshot`]
+    /// instead.
+    pub fn node(&self) -> Option<&Node> {
+        match self.access {
+            ParallelSceneAccess::ReadOnly { .. } => None,
+            ParallelSceneAccess::Node(ref node) => Some(&**node),
+        }
+    }
+
+    /// Returns a mutable reference to the node to which the script instance belongs to, if the script
+    /// declared [`ScriptAccess::DisjointWrite`] access.
+    pub fn node_mut(&mut self) -> Option<&mut Node> {
+        match self.access {
+            ParallelSceneAccess::ReadOnly { .. } => None,
+            ParallelSceneAccess::Node(ref mut node) => Some(&mut **node),
+        }
+    }
+}
+
 /// Script is a set predefined methods that are called on various stages by the engine. It is used to add
 /// custom behaviour to game entities.
 pub trait ScriptTrait: BaseScript + ComponentProvider {
@@ -552,6 +778,22 @@ pub trait ScriptTrait: BaseScript + ComponentProvider {
     /// [`crate::engine::executor::Executor::set_desired_update_rate`] method.
     fn on_update(&mut self, #[allow(unused_variables)] ctx: &mut ScriptContext) {}
 
+    /// Defines what part of the scene the script accesses when it is updated. By default, every
+    /// script has [`ScriptAccess::Exclusive`] access and it is updated by [`ScriptTrait::on_update`].
+    /// Any other access kind makes the engine call [`ScriptTrait::on_parallel_update`] instead,
+    /// on a thread pool, together with all the other scripts that opted in. This is useful when there
+    /// are thousands of similar scripts (AI agents, projectiles, etc.). Parallel scripts are updated
+    /// before exclusive ones. The returned value must not change during script's lifetime.
+    fn update_access(&self) -> ScriptAccess {
+        ScriptAccess::Exclusive
+    }
+
+    /// Performs a single update tick of the script, that declared non-exclusive access in
+    /// [`ScriptTrait::update_access`]. The method is called instead of [`ScriptTrait::on_update`]
+    /// from one of the worker threads. Any changes to the scene that are not allowed by the
+    /// declared access must be deferred using [`ParallelScriptContext::commands`].
+    fn on_parallel_update(&mut self, #[allow(unused_variables)] ctx: &mut ParallelScriptContext) {}
+
     /// Allows you to react to certain script messages. It could be used for communication between scripts; to
     /// bypass borrowing issues. If you need to receive messages of a particular type, you must subscribe to a type
     /// explicitly. Usually it is done in [`ScriptTrait::on_start`] method:
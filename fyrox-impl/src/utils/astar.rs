@@ -11,6 +11,7 @@ use crate::core::{
     math::{self, PositionProvider},
     visitor::prelude::*,
 };
+use rayon::prelude::*;
 
 use std::{
     cmp::Ordering,
@@ -273,6 +274,119 @@ impl PartialPath {
     }
 }
 
+// A minimal amount of path queries, that will be processed by a single task in batched mode.
+const MIN_QUERIES_PER_TASK: usize = 4;
+
+#[derive(Copy, Clone, Debug, Default)]
+struct SearchNode {
+    // Search generation in which the rest of the fields were written. The node is considered
+    // unvisited if it does not match the current generation of the context.
+    generation: u32,
+    closed: bool,
+    g_score: f32,
+    came_from: u32,
+}
+
+#[derive(Copy, Clone, Debug)]
+struct OpenEntry {
+    f_score: f32,
+    h_score: f32,
+    index: u32,
+}
+
+impl Ord for OpenEntry {
+    // Same ordering as in `PartialPath`: lowest f-score first, then lowest heuristic.
+    fn cmp(&self, other: &Self) -> Ordering {
+        (self.f_score.total_cmp(&other.f_score))
+            .then(self.h_score.total_cmp(&other.h_score))
+            .reverse()
+    }
+}
+
+impl PartialOrd for OpenEntry {
+    fn partial_cmp(&self, other: &Self) -> Option<Ordering> {
+        Some(self.cmp(other))
+    }
+}
+
+impl PartialEq for OpenEntry {
+    fn eq(&self, other: &Self) -> bool {
+        self.cmp(other) == Ordering::Equal
+    }
+}
+
+impl Eq for OpenEntry {}
+
+/// Reusable state of the path search. It holds per-vertex search data and the open set, so
+/// subsequent searches (using [`Graph::build_indexed_path_with_context`]) do not allocate memory.
+/// Per-vertex data is stamped with the search generation, which means that there's no need to clear
+/// it between searches.
+///
+/// A context could be used with any graph, but it is most efficient when it is used with the same
+/// graph (or graphs of similar size) all the time.
+#[derive(Clone, Debug, Default)]
+pub struct PathSearchContext {
+    generation: u32,
+    nodes: Vec<SearchNode>,
+    open_set: BinaryHeap<OpenEntry>,
+}
+
+impl PathSearchContext {
+    /// Creates a new empty search context.
+    pub fn new() -> Self {
+        Self::default()
+    }
+
+    fn begin_search(&mut self, vertex_count: usize) {
+        if self.nodes.len() < vertex_count {
+            self.nodes.resize(vertex_count, Default::default());
+        }
+
+        self.generation = self.generation.wrapping_add(1);
+        if self.generation == 0 {
+            // Stamps of the nodes could match the generation after wrap around.
+            for node in self.nodes.iter_mut() {
+                node.generation = 0;
+            }
+            self.generation = 1;
+        }
+
+        self.open_set.clear();
+    }
+
+    fn node(&self, index: usize) -> Option<&SearchNode> {
+        self.nodes
+            .get(index)
+            .filter(|node| node.generation == self.generation)
+    }
+}
+
+/// A single path query for [`Graph::build_indexed_paths`].
+#[derive(Clone, Debug, Default)]
+pub struct PathQuery {
+    /// Index of the start vertex.
+    pub from: usize,
+    /// Index of the destination vertex.
+    pub to: usize,
+    /// Indices of vertices of the found path. It has the same layout as the path produced by
+    /// [`Graph::build_indexed_path`].
+    pub path: Vec<usize>,
+    /// Result of the query. It is `None` until the query is processed.
+    pub result: Option<Result<PathKind, PathError>>,
+}
+
+impl PathQuery {
+    /// Creates a new path query from one vertex to another.
+    pub fn new(from: usize, to: usize) -> Self {
+        Self {
+            from,
+            to,
+            path: Default::default(),
+            result: None,
+        }
+    }
+}
+
 impl<T: VertexDataProvider> Graph<T> {
     /// Creates new empty graph.
     pub fn new() -> Self {
@@ -414,6 +528,19 @@ impl<T: VertexDataProvider> Graph<T> {
         from: usize,
         to: usize,
         path: &mut Vec<usize>,
+    ) -> Result<PathKind, PathError> {
+        self.build_indexed_path_with_context(&mut PathSearchContext::new(), from, to, path)
+    }
+
+    /// Does the same as [`Self::build_indexed_path`], but uses the given search context to store
+    /// intermediate search data. It is the preferable way of searching multiple paths one after
+    /// another, because the context is reused and there's no memory allocations in this case.
+    pub fn build_indexed_path_with_context(
+        &self,
+        context: &mut PathSearchContext,
+        from: usize,
+        to: usize,
+        path: &mut Vec<usize>,
     ) -> Result<PathKind, PathError> {
         path.clear();
 
@@ -433,39 +560,59 @@ impl<T: VertexDataProvider> Graph<T> {
             return Ok(PathKind::Full);
         }
 
-        // keeps track of which vertices we've searched
-        let mut searched_vertices = vec![false; self.vertices.len()];
-
-        // creates heap for searching
-        let mut search_heap: BinaryHeap<PartialPath> = BinaryHeap::new();
-
-        // creates first partial path and adds it to heap
-        search_heap.push(PartialPath::new(from));
+        let start_pos = self
+            .vertices
+            .get(from)
+            .ok_or(PathError::InvalidIndex(from))?
+            .position;
 
-        // stores best path found
-        let mut best_path = PartialPath::default();
+        context.begin_search(self.vertices.len());
+
+        let start_h_score = heuristic(start_pos, end_pos);
+        context.nodes[from] = SearchNode {
+            generation: context.generation,
+            closed: false,
+            g_score: 0.0,
+            came_from: from as u32,
+        };
+        context.open_set.push(OpenEntry {
+            f_score: start_h_score,
+            h_score: start_h_score,
+            index: from as u32,
+        });
+
+        // stores the best vertex found (closest to the end)
+        let mut best = OpenEntry {
+            f_score: start_h_score,
+            h_score: start_h_score,
+            index: from as u32,
+        };
 
         // search loop
         let mut search_iteration = 0i32;
 
         while self.max_search_iterations < 0 || search_iteration < self.max_search_iterations {
-            // breakes loop if heap is empty
-            if search_heap.is_empty() {
+            // pops best vertex off the heap to use for this iteration, breaks loop if heap is empty
+            let Some(current) = context.open_set.pop() else {
                 break;
-            }
+            };
 
-            // pops best partial path off the heap to use for this iteration
-            let current_path = search_heap.pop().unwrap();
+            let current_index = current.index as usize;
+            let current_node = context.nodes[current_index];
+
+            // skips stale entries, the vertex was already reached with a better score
+            if current_node.closed {
+                continue;
+            }
 
-            let current_index = *current_path.vertices.last().unwrap();
             let current_vertex = self
                 .vertices
                 .get(current_index)
                 .ok_or(PathError::InvalidIndex(current_index))?;
 
-            // updates best path
-            if current_path > best_path {
-                best_path = current_path.clone();
+            // updates best vertex
+            if current >= best {
+                best = current;
 
                 // breaks if end is found
                 if current_index == to {
@@ -473,7 +620,7 @@ impl<T: VertexDataProvider> Graph<T> {
                 }
             }
 
-            // evaluates path scores one level deeper and adds the paths to the heap
+            // evaluates scores of neighbours and adds them to the heap
             for i in current_vertex.neighbours.iter() {
                 let neighbour_index = *i as usize;
 
@@ -483,38 +630,50 @@ impl<T: VertexDataProvider> Graph<T> {
                     return Err(PathError::CyclicReferenceFound(current_index));
                 }
 
-                // avoids going in circles
-                if searched_vertices[neighbour_index] {
-                    continue;
-                }
-
                 let neighbour = self
                     .vertices
                     .get(neighbour_index)
                     .ok_or(PathError::InvalidIndex(neighbour_index))?;
 
-                let neighbour_g_score = current_path.g_score
+                let neighbour_g_score = current_node.g_score
                     + ((current_vertex.position - neighbour.position).norm_squared()
                         * neighbour.g_penalty);
 
-                let neighbour_f_score = neighbour_g_score + heuristic(neighbour.position, end_pos);
+                // avoids going in circles and keeps only the best way to each vertex
+                if let Some(neighbour_node) = context.node(neighbour_index) {
+                    if neighbour_node.closed || neighbour_node.g_score <= neighbour_g_score {
+                        continue;
+                    }
+                }
 
-                search_heap.push(current_path.clone_and_add(
-                    neighbour_index,
-                    neighbour_g_score,
-                    neighbour_f_score,
-                ));
+                context.nodes[neighbour_index] = SearchNode {
+                    generation: context.generation,
+                    closed: false,
+                    g_score: neighbour_g_score,
+                    came_from: current_index as u32,
+                };
+
+                let neighbour_h_score = heuristic(neighbour.position, end_pos);
+                context.open_set.push(OpenEntry {
+                    f_score: neighbour_g_score + neighbour_h_score,
+                    h_score: neighbour_h_score,
+                    index: neighbour_index as u32,
+                });
             }
 
             // marks vertex as searched
-            searched_vertices[current_index] = true;
+            context.nodes[current_index].closed = true;
 
             search_iteration += 1;
         }
 
-        // sets path to the best path of indices
-        path.clone_from(&best_path.vertices);
-        path.reverse();
+        // sets path to the best path of indices, from the best vertex back to the start
+        let mut index = best.index as usize;
+        path.push(index);
+        while index != from {
+            index = context.nodes[index].came_from as usize;
+            path.push(index);
+        }
 
         if *path.first().unwrap() == to {
             Ok(PathKind::Full)
@@ -527,6 +686,27 @@ impl<T: VertexDataProvider> Graph<T> {
         }
     }
 
+    /// Builds paths for every given query in parallel. Results of each query are written to the
+    /// query itself, see [`PathQuery`] docs for more info. This method is much faster than building
+    /// the same paths one-by-one, because the search contexts are reused and the queries are spread
+    /// across all available threads.
+    pub fn build_indexed_paths(&self, queries: &mut [PathQuery])
+    where
+        T: Sync,
+    {
+        queries
+            .par_iter_mut()
+            .with_min_len(MIN_QUERIES_PER_TASK)
+            .for_each_init(PathSearchContext::new, |context, query| {
+                query.result = Some(self.build_indexed_path_with_context(
+                    context,
+                    query.from,
+                    query.to,
+                    &mut query.path,
+                ));
+            });
+    }
+
     /// Tries to build path of Vector3's from beginning point to endpoint. Returns path kind:
     ///
     /// - Full: Path vector is a direct path from beginning to end.
@@ -594,7 +774,7 @@ mod test {
     use crate::utils::astar::PathError;
     use crate::{
         core::{algebra::Vector3, rand},
-        utils::astar::{Graph, GraphVertex, PathKind},
+        utils::astar::{Graph, GraphVertex, PathKind, PathQuery, PathSearchContext},
     };
     use std::time::Instant;
 
@@ -678,6 +858,86 @@ mod test {
         assert!(paths_count > 0);
     }
 
+    fn make_grid(size: usize) -> Graph<GraphVertex> {
+        let mut pathfinder = Graph::new();
+
+        let mut vertices = Vec::new();
+        for y in 0..size {
+            for x in 0..size {
+                vertices.push(GraphVertex::new(Vector3::new(x as f32, y as f32, 0.0)));
+            }
+        }
+        pathfinder.set_vertices(vertices);
+
+        for y in 0..(size - 1) {
+            for x in 0..(size - 1) {
+                pathfinder.link_bidirect(y * size + x, y * size + x + 1);
+                pathfinder.link_bidirect(y * size + x, (y + 1) * size + x);
+            }
+        }
+
+        pathfinder
+    }
+
+    fn random_queries(size: usize, count: usize) -> Vec<PathQuery> {
+        (0..count)
+            .map(|_| {
+                let mut rng = rand::thread_rng();
+                PathQuery::new(
+                    rng.gen_range(0..(size - 1)) * size + rng.gen_range(0..(size - 1)),
+                    rng.gen_range(0..(size - 1)) * size + rng.gen_range(0..(size - 1)),
+                )
+            })
+            .collect()
+    }
+
+    #[test]
+    fn astar_context_reuse_and_batch() {
+        let size = 30;
+        let pathfinder = make_grid(size);
+
+        let mut queries = random_queries(size, 200);
+        pathfinder.build_indexed_paths(&mut queries);
+
+        let mut context = PathSearchContext::new();
+        let mut path = Vec::new();
+        for query in queries.iter() {
+            let result = pathfinder.build_indexed_path_with_context(
+                &mut context,
+                query.from,
+                query.to,
+                &mut path,
+            );
+            assert!(matches!(result, Ok(PathKind::Full)));
+            assert!(matches!(query.result, Some(Ok(PathKind::Full))));
+            assert_eq!(path, query.path);
+
+            assert_eq!(*path.first().unwrap(), query.to);
+            assert_eq!(*path.last().unwrap(), query.from);
+            for pair in path.windows(2) {
+                assert!(pathfinder
+                    .vertex(pair[0])
+                    .unwrap()
+                    .neighbours
+                    .contains(&(pair[1] as u32)));
+            }
+        }
+
+        // Isolated vertex must give a partial path, that consists of the start vertex only.
+        let mut pathfinder = pathfinder;
+        let isolated = pathfinder.add_vertex(GraphVertex::new(Vector3::new(-1.0, -1.0, 0.0)));
+        assert!(matches!(
+            pathfinder.build_indexed_path_with_context(
+                &mut context,
+                isolated as usize,
+                0,
+                &mut path
+            ),
+            Ok(PathKind::Partial)
+        ));
+        assert_eq!(path, vec![isolated as usize]);
+    }
+
     #[test]
     fn test_remove_vertex() {
         let mut pathfinder = Graph::<GraphVertex>::new();
@@ -973,4 +1233,40 @@ mod test {
         println!("paths found in: {:?}", setup_complete_time.elapsed());
         println!("Total time: {:?}\n", start_time.elapsed());
     }
+
+    #[ignore = "takes multiple seconds to run"]
+    #[test]
+    /// Compares A*'s speed of one-by-one searches, searches with reused context and batched searches
+    fn astar_batch_benchmark() {
+        let size = 300;
+        let pathfinder = make_grid(size);
+        let mut queries = random_queries(size, 2000);
+
+        println!();
+
+        let start_time = Instant::now();
+        let mut path = Vec::new();
+        for query in queries.iter() {
+            assert!(pathfinder
+                .build_indexed_path(query.from, query.to, &mut path)
+                .is_ok());
+        }
+        println!("one-by-one: {:?}", start_time.elapsed());
+
+        let start_time = Instant::now();
+        let mut context = PathSearchContext::new();
+        for query in queries.iter() {
+            assert!(pathfinder
+                .build_indexed_path_with_context(&mut context, query.from, query.to, &mut path)
+                .is_ok());
+        }
+        println!("reused context: {:?}", start_time.elapsed());
+
+        let start_time = Instant::now();
+        pathfinder.build_indexed_paths(&mut queries);
+        println!("batched: {:?}\n", start_time.elapsed());
+        assert!(queries
+            .iter()
+            .all(|query| matches!(query.result, Some(Ok(_)))));
+    }
 }
@@ -0,0 +1,1137 @@
+//! Crowd simulation for navmesh agents. See [`Crowd`] docs for more info.
+
+#![warn(missing_docs)]
+
+use crate::{
+    core::{
+        algebra::{Vector2, Vector3},
+        instant,
+        pool::{Handle, Pool},
+    },
+    utils::{
+        astar::{PathError, PathKind, PathQuery},
+        navmesh::{straighten_path, Navmesh, NavmeshAgent},
+    },
+};
+use fxhash::FxHashMap;
+use rayon::prelude::*;
+use std::{collections::VecDeque, time::Duration};
+
+// Amount of path requests, that will be processed by a single thread in one batch.
+const REQUESTS_PER_THREAD: usize = 8;
+
+// A minimal amount of agents, that will be processed by a single task.
+const MIN_AGENTS_PER_TASK: usize = 64;
+
+// Distance at which the last point of a path is considered reached.
+const ARRIVAL_DISTANCE: f32 = 0.05;
+
+/// An agent of a crowd. It is a wrapper over [`NavmeshAgent`], that moves the agent using velocity
+/// (which is adjusted to avoid collisions with other agents), instead of interpolation along the
+/// path.
+#[derive(Clone, Debug, Default)]
+pub struct CrowdAgent {
+    agent: NavmeshAgent,
+    velocity: Vector3<f32>,
+    triangle: Option<usize>,
+    path_result: Option<Result<PathKind, PathError>>,
+    path_requested: bool,
+}
+
+impl CrowdAgent {
+    /// Creates a new crowd agent from the given navmesh agent.
+    pub fn new(agent: NavmeshAgent) -> Self {
+        Self {
+            agent,
+            ..Default::default()
+        }
+    }
+
+    /// Returns a reference to the inner navmesh agent.
+    pub fn agent(&self) -> &NavmeshAgent {
+        &self.agent
+    }
+
+    /// Returns a reference to the inner navmesh agent. It could be used to change target, speed,
+    /// etc. Path will be recalculated by the crowd automatically if it is needed.
+    pub fn agent_mut(&mut self) -> &mut NavmeshAgent {
+        &mut self.agent
+    }
+
+    /// Returns current velocity of the agent.
+    pub fn velocity(&self) -> Vector3<f32> {
+        self.velocity
+    }
+
+    /// Returns the result of the last path calculation. It is `None` if the path wasn't calculated
+    /// yet.
+    pub fn path_result(&self) -> Option<&Result<PathKind, PathError>> {
+        self.path_result.as_ref()
+    }
+
+    /// Returns `true` if the agent waits for its path to be calculated. The agent continues to
+    /// follow its previous path (if any) in the meantime.
+    pub fn is_waiting_for_path(&self) -> bool {
+        self.path_requested
+    }
+}
+
+/// Settings of a crowd.
+#[derive(Clone, Debug, PartialEq)]
+pub struct CrowdSettings {
+    /// Maximum time, that could be spent on path requests in a single update. Requests that did
+    /// not fit in the budget will be processed in the next updates. At least one batch of requests
+    /// is processed on every update, even if it exceeds the budget.
+    pub path_time_budget: Duration,
+    /// Enables or disables local avoidance.
+    pub avoidance: bool,
+    /// Maximum distance (in meters) to other agents, that will be taken into account when
+    /// avoiding collisions.
+    pub neighbour_distance: f32,
+    /// Maximum amount of closest agents, that will be taken into account when avoiding collisions.
+    pub max_neighbours: usize,
+    /// Time (in seconds) in which the velocities of an agent are guaranteed to be safe with respect
+    /// to other agents. The larger the value, the sooner agents will respond to each other.
+    pub time_horizon: f32,
+}
+
+impl Default for CrowdSettings {
+    fn default() -> Self {
+        Self {
+            path_time_budget: Duration::from_millis(2),
+            avoidance: true,
+            neighbour_distance: 3.0,
+            max_neighbours: 10,
+            time_horizon: 2.0,
+        }
+    }
+}
+
+/// Statistics of the last update of a crowd.
+#[derive(Copy, Clone, Debug, Default, PartialEq, Eq)]
+pub struct CrowdStatistics {
+    /// Amount of path requests, that were processed.
+    pub processed_path_requests: usize,
+    /// Amount of path searches, that were performed.
+    pub path_searches: usize,
+    /// Amount of path requests, that reused a path found for another agent.
+    pub shared_paths: usize,
+    /// Amount of path requests, that were postponed to the next updates.
+    pub pending_path_requests: usize,
+}
+
+/// Crowd is a set of navmesh agents, that are updated together. It is designed for large amounts
+/// of agents (thousands) and does the following:
+///
+/// - Path requests of the agents are queued and processed in batches across worker threads. The
+///   time spent on path requests in a single update is limited by
+///   [`CrowdSettings::path_time_budget`].
+/// - Paths are shared between agents: triangle corridors found for one agent are reused for every
+///   other agent, that starts somewhere on the corridor and goes to the same destination triangle.
+/// - Agents avoid each other using ORCA (Optimal Reciprocal Collision Avoidance) in the horizontal
+///   (XZ) plane. Neighbour agents are found using a spatial hash, velocities of all agents are
+///   calculated in parallel.
+///
+/// ## Example
+///
+/// ```rust
+/// # use fyrox_impl::{
+/// #     core::{algebra::Vector3, pool::Handle},
+/// #     utils::{
+/// #         crowd::{Crowd, CrowdAgent},
+/// #         navmesh::{Navmesh, NavmeshAgentBuilder},
+/// #     },
+/// # };
+/// fn spawn_squad(crowd: &mut Crowd, target: Vector3<f32>) -> Vec<Handle<CrowdAgent>> {
+///     (0..10)
+///         .map(|i| {
+///             crowd.add_agent(CrowdAgent::new(
+///                 NavmeshAgentBuilder::new()
+///                     .with_position(Vector3::new(i as f32, 0.0, 0.0))
+///                     .with_target(target)
+///                     .build(),
+///             ))
+///         })
+///         .collect()
+/// }
+///
+/// fn update(crowd: &mut Crowd, navmesh: &Navmesh, dt: f32) {
+///     crowd.update(dt, navmesh);
+/// }
+/// ```
+#[derive(Default)]
+pub struct Crowd {
+    /// Settings of the crowd.
+    pub settings: CrowdSettings,
+    agents: Pool<CrowdAgent>,
+    path_requests: VecDeque<Handle<CrowdAgent>>,
+    states: Vec<AgentState>,
+    grid: FxHashMap<(i32, i32), Vec<u32>>,
+    statistics: CrowdStatistics,
+}
+
+#[derive(Copy, Clone, Debug)]
+struct PathRequest {
+    handle: Handle<CrowdAgent>,
+    from: Vector3<f32>,
+    to: Vector3<f32>,
+    triangle: Option<usize>,
+    radius: f32,
+}
+
+#[derive(Copy, Clone, Debug)]
+struct PathEndpoints {
+    src_point: Vector3<f32>,
+    src_triangle: usize,
+    dest_point: Vector3<f32>,
+    dest_triangle: usize,
+}
+
+// Triangle corridors found during a single update.
+#[derive(Default)]
+struct CorridorCache {
+    corridors: Vec<(Result<PathKind, PathError>, Vec<usize>)>,
+    // Maps (destination triangle, start triangle) pair to a corridor and an offset in it.
+    lookup: FxHashMap<(usize, usize), (usize, usize)>,
+}
+
+impl CorridorCache {
+    fn insert(&mut self, query: PathQuery) {
+        let index = self.corridors.len();
+        let result = query.result.unwrap_or(Err(PathError::Empty));
+        let mut corridor = query.path;
+        // Paths are built from end to start.
+        corridor.reverse();
+
+        if let Ok(PathKind::Full) = result {
+            // Every suffix of a full corridor is a path to the same destination.
+            for (offset, triangle) in corridor.iter().enumerate() {
+                self.lookup
+                    .entry((query.to, *triangle))
+                    .or_insert((index, offset));
+            }
+        } else {
+            self.lookup.insert((query.to, query.from), (index, 0));
+        }
+
+        self.corridors.push((result, corridor));
+    }
+
+    fn find(&self, from: usize, to: usize) -> Option<(&Result<PathKind, PathError>, &[usize])> {
+        let (index, offset) = self.lookup.get(&(to, from))?;
+        let (result, corridor) = &self.corridors[*index];
+        Some((result, &corridor[*offset..]))
+    }
+}
+
+#[derive(Copy, Clone, Debug)]
+struct AgentState {
+    handle: Handle<CrowdAgent>,
+    position: Vector3<f32>,
+    velocity: Vector2<f32>,
+    preferred_velocity: Vector2<f32>,
+    radius: f32,
+    max_speed: f32,
+    triangle: Option<usize>,
+}
+
+impl Crowd {
+    /// Creates a new empty crowd with the given settings.
+    pub fn new(settings: CrowdSettings) -> Self {
+        Self {
+            settings,
+            ..Default::default()
+        }
+    }
+
+    /// Adds a new agent to the crowd.
+    pub fn add_agent(&mut self, agent: CrowdAgent) -> Handle<CrowdAgent> {
+        self.agents.spawn(agent)
+    }
+
+    /// Removes the agent from the crowd.
+    pub fn remove_agent(&mut self, handle: Handle<CrowdAgent>) -> Option<CrowdAgent> {
+        self.agents.try_free(handle)
+    }
+
+    /// Returns a reference to the agent.
+    pub fn agent(&self, handle: Handle<CrowdAgent>) -> Option<&CrowdAgent> {
+        self.agents.try_borrow(handle)
+    }
+
+    /// Returns a reference to the agent.
+    pub fn agent_mut(&mut self, handle: Handle<CrowdAgent>) -> Option<&mut CrowdAgent> {
+        self.agents.try_borrow_mut(handle)
+    }
+
+    /// Returns an iterator over all agents of the crowd.
+    pub fn agents(&self) -> impl Iterator<Item = (Handle<CrowdAgent>, &CrowdAgent)> {
+        self.agents.pair_iter()
+    }
+
+    /// Returns statistics of the last update.
+    pub fn statistics(&self) -> CrowdStatistics {
+        self.statistics
+    }
+
+    /// Updates the crowd: processes path requests and moves agents along their paths.
+    pub fn update(&mut self, dt: f32, navmesh: &Navmesh) {
+        self.statistics = Default::default();
+
+        self.queue_path_requests();
+        self.process_path_requests(navmesh);
+        self.move_agents(dt, navmesh);
+
+        self.statistics.pending_path_requests = self.path_requests.len();
+    }
+
+    fn queue_path_requests(&mut self) {
+        for (handle, agent) in self.agents.pair_iter_mut() {
+            if agent.agent.is_path_dirty() && !agent.path_requested {
+                agent.path_requested = true;
+                self.path_requests.push_back(handle);
+            }
+        }
+    }
+
+    fn process_path_requests(&mut self, navmesh: &Navmesh) {
+        let start_time = instant::Instant::now();
+        let batch_size = rayon::current_num_threads() * REQUESTS_PER_THREAD;
+        let mut corridors = CorridorCache::default();
+        let mut batch = Vec::with_capacity(batch_size);
+
+        while !self.path_requests.is_empty()
+            && (self.statistics.processed_path_requests == 0
+                || start_time.elapsed() < self.settings.path_time_budget)
+        {
+            batch.clear();
+            while batch.len() < batch_size {
+                let Some(handle) = self.path_requests.pop_front() else {
+                    break;
+                };
+
+                // The agent could be removed while it was waiting for its path.
+                if let Some(agent) = self.agents.try_borrow(handle) {
+                    if agent.path_requested {
+                        batch.push(PathRequest {
+                            handle,
+                            from: agent.agent.position(),
+                            to: agent.agent.target(),
+                            triangle: agent.triangle,
+                            radius: agent.agent.radius(),
+                        });
+                    }
+                }
+            }
+
+            self.process_batch(navmesh, &batch, &mut corridors);
+        }
+    }
+
+    fn process_batch(
+        &mut self,
+        navmesh: &Navmesh,
+        batch: &[PathRequest],
+        corridors: &mut CorridorCache,
+    ) {
+        // Agents of a crowd usually share the same targets, so find each target on the navmesh
+        // only once.
+        let mut target_indices = FxHashMap::default();
+        let mut targets = Vec::new();
+        let request_targets = batch
+            .iter()
+            .map(|request| {
+                let key = request.to.map(|v| v.to_bits());
+                *target_indices.entry(key).or_insert_with(|| {
+                    targets.push(request.to);
+                    targets.len() - 1
+                })
+            })
+            .collect::<Vec<_>>();
+
+        let targets = targets
+            .par_iter()
+            .map(|target| navmesh.query_closest(*target))
+            .collect::<Vec<_>>();
+
+        let endpoints = batch
+            .par_iter()
+            .zip(request_targets.par_iter())
+            .map(|(request, target)| {
+                let (src_point, src_triangle) =
+                    query_closest(navmesh, request.from, request.triangle)?;
+                let (dest_point, dest_triangle) = targets[*target]?;
+                Some(PathEndpoints {
+                    src_point,
+                    src_triangle,
+                    dest_point,
+                    dest_triangle,
+                })
+            })
+            .collect::<Vec<_>>();
+
+        // Search only for the corridors, that cannot be taken from the cache.
+        let mut queries = Vec::new();
+        let mut query_indices = FxHashMap::default();
+        let mut corridor_requests = 0;
+        for endpoints in endpoints.iter().flatten() {
+            if endpoints.src_triangle != endpoints.dest_triangle {
+                corridor_requests += 1;
+                if corridors
+                    .find(endpoints.src_triangle, endpoints.dest_triangle)
+                    .is_none()
+                {
+                    query_indices
+                        .entry((endpoints.src_triangle, endpoints.dest_triangle))
+                        .or_insert_with(|| {
+                            queries.push(PathQuery::new(
+                                endpoints.src_triangle,
+                                endpoints.dest_triangle,
+                            ));
+                        });
+                }
+            }
+        }
+
+        navmesh.build_indexed_paths(&mut queries);
+        self.statistics.path_searches += queries.len();
+        self.statistics.shared_paths += corridor_requests - queries.len();
+        for query in queries {
+            corridors.insert(query);
+        }
+
+        let paths = batch
+            .par_iter()
+            .zip(endpoints.par_iter())
+            .map(|(request, endpoints)| {
+                let mut path = Vec::new();
+
+                let Some(endpoints) = endpoints else {
+                    return (Err(PathError::Empty), path);
+                };
+
+                if endpoints.src_triangle == endpoints.dest_triangle {
+                    path.push(endpoints.src_point);
+                    path.push(endpoints.dest_point);
+                    return (Ok(PathKind::Full), path);
+                }
+
+                match corridors.find(endpoints.src_triangle, endpoints.dest_triangle) {
+                    Some((Ok(kind), corridor)) => {
+                        straighten_path(
+                            navmesh,
+                            request.radius,
+                            endpoints.src_point,
+                            endpoints.dest_point,
+                            corridor,
+                            &mut path,
+                        );
+                        (Ok(*kind), path)
+                    }
+                    Some((Err(err), _)) => (Err(err.clone()), path),
+                    None => (Err(PathError::Empty), path),
+                }
+            })
+            .collect::<Vec<_>>();
+
+        for ((request, endpoints), (result, mut path)) in batch.iter().zip(endpoints).zip(paths) {
+            if let Some(agent) = self.agents.try_borrow_mut(request.handle) {
+                agent.agent.swap_path(&mut path);
+                agent.path_result = Some(result);
+                agent.path_requested = false;
+                agent.triangle = endpoints.map(|endpoints| endpoints.src_triangle);
+                self.statistics.processed_path_requests += 1;
+            }
+        }
+    }
+
+    fn move_agents(&mut self, dt: f32, navmesh: &Navmesh) {
+        if dt <= 0.0 {
+            return;
+        }
+
+        self.states.clear();
+        for (handle, agent) in self.agents.pair_iter_mut() {
+            self.states.push(AgentState {
+                handle,
+                position: agent.agent.position(),
+                velocity: agent.velocity.xz(),
+                preferred_velocity: preferred_velocity(&mut agent.agent, dt),
+                radius: agent.agent.radius(),
+                max_speed: agent.agent.speed(),
+                triangle: agent.triangle,
+            });
+        }
+
+        let cell_size = self.settings.neighbour_distance.max(f32::EPSILON);
+        for cell in self.grid.values_mut() {
+            cell.clear();
+        }
+        for (index, state) in self.states.iter().enumerate() {
+            self.grid
+                .entry(grid_cell(state.position, cell_size))
+                .or_default()
+                .push(index as u32);
+        }
+        self.grid.retain(|_, cell| !cell.is_empty());
+
+        let states = &self.states;
+        let grid = &self.grid;
+        let settings = &self.settings;
+        let results = (0..states.len())
+            .into_par_iter()
+            .with_min_len(MIN_AGENTS_PER_TASK)
+            .map_init(OrcaContext::default, |context, index| {
+                let state = &states[index];
+
+                let velocity = if settings.avoidance {
+                    context.compute_velocity(index, states, grid, cell_size, settings, dt)
+                } else {
+                    state.preferred_velocity
+                };
+
+                let new_position =
+                    state.position + Vector3::new(velocity.x, 0.0, velocity.y).scale(dt);
+                // Keep the agent on the navmesh.
+                query_closest(navmesh, new_position, state.triangle)
+                    .map_or((new_position, None), |(position, triangle)| {
+                        (position, Some(triangle))
+                    })
+            })
+            .collect::<Vec<_>>();
+
+        for (state, (position, triangle)) in self.states.iter().zip(results) {
+            if let Some(agent) = self.agents.try_borrow_mut(state.handle) {
+                let displacement = position - state.position;
+                agent.velocity = Vector3::new(displacement.x, 0.0, displacement.z).scale(1.0 / dt);
+                agent.triangle = triangle;
+                agent.agent.move_along_path(position);
+            }
+        }
+    }
+}
+
+// Finds the closest point on the navmesh near the last known triangle of an agent (if any). Local
+// search fails if the triangle does not exist anymore (the navmesh has changed, for example), the
+// whole navmesh is searched in this case.
+fn query_closest(
+    navmesh: &Navmesh,
+    position: Vector3<f32>,
+    triangle: Option<usize>,
+) -> Option<(Vector3<f32>, usize)> {
+    triangle
+        .and_then(|triangle| navmesh.query_closest_local(position, triangle))
+        .or_else(|| navmesh.query_closest(position))
+}
+
+fn grid_cell(position: Vector3<f32>, cell_size: f32) -> (i32, i32) {
+    (
+        (position.x / cell_size).floor() as i32,
+        (position.z / cell_size).floor() as i32,
+    )
+}
+
+// Skips reached points of the path and returns the velocity, that leads to the next point.
+fn preferred_velocity(agent: &mut NavmeshAgent, dt: f32) -> Vector2<f32> {
+    let position = agent.position().xz();
+    let path = agent.path();
+
+    let mut current = agent.path_index();
+    while let Some(point) = path.get(current + 1) {
+        let reach_distance = if current + 2 == path.len() {
+            ARRIVAL_DISTANCE
+        } else {
+            agent.radius().max(agent.speed() * dt)
+        };
+
+        if point.xz().metric_distance(&position) <= reach_distance {
+            current += 1;
+        } else {
+            break;
+        }
+    }
+
+    let velocity = match path.get(current + 1) {
+        Some(point) => {
+            let delta = point.xz() - position;
+            let distance = delta.norm();
+            if distance > f32::EPSILON {
+                delta.scale(agent.speed().min(distance / dt) / distance)
+            } else {
+                Vector2::default()
+            }
+        }
+        None => Vector2::default(),
+    };
+
+    agent.set_path_index(current);
+
+    velocity
+}
+
+// A directed line, that defines a half-plane of permitted velocities (to the left of the line).
+#[derive(Copy, Clone, Debug, Default)]
+struct Line {
+    point: Vector2<f32>,
+    direction: Vector2<f32>,
+}
+
+fn det(a: Vector2<f32>, b: Vector2<f32>) -> f32 {
+    a.x * b.y - a.y * b.x
+}
+
+// Scratch buffers for velocity calculation, reused between agents processed by the same task.
+#[derive(Default)]
+struct OrcaContext {
+    neighbours: Vec<(f32, u32)>,
+    lines: Vec<Line>,
+    projected_lines: Vec<Line>,
+}
+
+impl OrcaContext {
+    fn compute_velocity(
+        &mut self,
+        index: usize,
+        states: &[AgentState],
+        grid: &FxHashMap<(i32, i32), Vec<u32>>,
+        cell_size: f32,
+        settings: &CrowdSettings,
+        dt: f32,
+    ) -> Vector2<f32> {
+        let state = &states[index];
+        let position = state.position.xz();
+
+        self.neighbours.clear();
+        let max_distance_sqr = settings.neighbour_distance * settings.neighbour_distance;
+        let (cell_x, cell_z) = grid_cell(state.position, cell_size);
+        for z in (cell_z - 1)..=(cell_z + 1) {
+            for x in (cell_x - 1)..=(cell_x + 1) {
+                let Some(cell) = grid.get(&(x, z)) else {
+                    continue;
+                };
+                for &other in cell {
+                    if other as usize != index {
+                        let distance_sqr =
+                            (states[other as usize].position.xz() - position).norm_squared();
+                        if distance_sqr < max_distance_sqr {
+                            self.neighbours.push((distance_sqr, other));
+                        }
+                    }
+                }
+            }
+        }
+        if self.neighbours.len() > settings.max_neighbours {
+            self.neighbours
+                .select_nth_unstable_by(settings.max_neighbours, |a, b| a.0.total_cmp(&b.0));
+            self.neighbours.truncate(settings.max_neighbours);
+        }
+
+        self.lines.clear();
+        let inv_time_horizon = 1.0 / settings.time_horizon.max(f32::EPSILON);
+        for &(distance_sqr, other) in self.neighbours.iter() {
+            let other = &states[other as usize];
+            let relative_position = other.position.xz() - position;
+            let relative_velocity = state.velocity - other.velocity;
+            let combined_radius = state.radius + other.radius;
+            let combined_radius_sqr = combined_radius * combined_radius;
+
+            let (direction, u) = if distance_sqr > combined_radius_sqr {
+                // No collision.
+                let w = relative_velocity - relative_position.scale(inv_time_horizon);
+                let w_length_sqr = w.norm_squared();
+                let dot_product = w.dot(&relative_position);
+
+                if dot_product < 0.0
+                    && dot_product * dot_product > combined_radius_sqr * w_length_sqr
+                {
+                    // Project on cut-off circle.
+                    let w_length = w_length_sqr.sqrt();
+                    let unit_w = w.scale(1.0 / w_length);
+                    (
+                        Vector2::new(unit_w.y, -unit_w.x),
+                        unit_w.scale(combined_radius * inv_time_horizon - w_length),
+                    )
+                } else {
+                    // Project on legs.
+                    let leg = (distance_sqr - combined_radius_sqr).sqrt();
+                    let direction = if det(relative_position, w) > 0.0 {
+                        Vector2::new(
+                            relative_position.x * leg - relative_position.y * combined_radius,
+                            relative_position.x * combined_radius + relative_position.y * leg,
+                        )
+                    } else {
+                        -Vector2::new(
+                            relative_position.x * leg + relative_position.y * combined_radius,
+                            -relative_position.x * combined_radius + relative_position.y * leg,
+                        )
+                    }
+                    .scale(1.0 / distance_sqr);
+                    (
+                        direction,
+                        direction.scale(relative_velocity.dot(&direction)) - relative_velocity,
+                    )
+                }
+            } else {
+                // Collision, project on cut-off circle of the time step.
+                let inv_time_step = 1.0 / dt;
+                let w = relative_velocity - relative_position.scale(inv_time_step);
+                let w_length = w.norm();
+                let unit_w = if w_length > f32::EPSILON {
+                    w.scale(1.0 / w_length)
+                } else {
+                    // Agents are at the same position, separate them in arbitrary direction.
+                    Vector2::new(1.0, 0.0)
+                };
+                (
+                    Vector2::new(unit_w.y, -unit_w.x),
+                    unit_w.scale(combined_radius * inv_time_step - w_length),
+                )
+            };
+
+            self.lines.push(Line {
+                point: state.velocity + u.scale(0.5),
+                direction,
+            });
+        }
+
+        let mut velocity = Vector2::default();
+        let fail_line = linear_program2(
+            &self.lines,
+            state.max_speed,
+            state.preferred_velocity,
+            false,
+            &mut velocity,
+        );
+        if fail_line < self.lines.len() {
+            linear_program3(
+                &self.lines,
+                fail_line,
+                state.max_speed,
+                &mut velocity,
+                &mut self.projected_lines,
+            );
+        }
+
+        velocity
+    }
+}
+
+// Solves a one-dimensional linear program on the specified line subject to linear constraints
+// defined by lines and a circular constraint.
+fn linear_program1(
+    lines: &[Line],
+    line_index: usize,
+    radius: f32,
+    optimization_velocity: Vector2<f32>,
+    optimize_direction: bool,
+    result: &mut Vector2<f32>,
+) -> bool {
+    let line = lines[line_index];
+    let dot_product = line.point.dot(&line.direction);
+    let discriminant = dot_product * dot_product + radius * radius - line.point.norm_squared();
+
+    if discriminant < 0.0 {
+        // Max speed circle fully invalidates the line.
+        return false;
+    }
+
+    let sqrt_discriminant = discriminant.sqrt();
+    let mut t_left = -dot_product - sqrt_discriminant;
+    let mut t_right = -dot_product + sqrt_discriminant;
+
+    for other in lines[..line_index].iter() {
+        let denominator = det(line.direction, other.direction);
+        let numerator = det(other.direction, line.point - other.point);
+
+        if denominator.abs() <= f32::EPSILON {
+            // Lines are (almost) parallel.
+            if numerator < 0.0 {
+                return false;
+            }
+            continue;
+        }
+
+        let t = numerator / denominator;
+        if denominator >= 0.0 {
+            t_right = t_right.min(t);
+        } else {
+            t_left = t_left.max(t);
+        }
+
+        if t_left > t_right {
+            return false;
+        }
+    }
+
+    let t = if optimize_direction {
+        if optimization_velocity.dot(&line.direction) > 0.0 {
+            t_right
+        } else {
+            t_left
+        }
+    } else {
+        line.direction
+            .dot(&(optimization_velocity - line.point))
+            .clamp(t_left, t_right)
+    };
+
+    *result = line.point + line.direction.scale(t);
+
+    true
+}
+
+// Solves a two-dimensional linear program subject to linear constraints defined by lines and a
+// circular constraint. Returns the index of the line on which it fails or the amount of lines on
+// success.
+fn linear_program2(
+    lines: &[Line],
+    radius: f32,
+    optimization_velocity: Vector2<f32>,
+    optimize_direction: bool,
+    result: &mut Vector2<f32>,
+) -> usize {
+    *result = if optimize_direction {
+        // Optimization velocity is a unit vector in this case.
+        optimization_velocity.scale(radius)
+    } else if optimization_velocity.norm_squared() > radius * radius {
+        optimization_velocity.normalize().scale(radius)
+    } else {
+        optimization_velocity
+    };
+
+    for (i, line) in lines.iter().enumerate() {
+        if det(line.direction, line.point - *result) > 0.0 {
+            // Result does not satisfy the constraint, compute new optimal result.
+            let previous_result = *result;
+            if !linear_program1(
+                lines,
+                i,
+                radius,
+                optimization_velocity,
+                optimize_direction,
+                result,
+            ) {
+                *result = previous_result;
+                return i;
+            }
+        }
+    }
+
+    lines.len()
+}
+
+// Solves a two-dimensional linear program when the constraints cannot be satisfied, it finds the
+// velocity, that minimizes the maximum penetration of the constraints.
+fn linear_program3(
+    lines: &[Line],
+    begin_line: usize,
+    radius: f32,
+    result: &mut Vector2<f32>,
+    projected_lines: &mut Vec<Line>,
+) {
+    let mut distance = 0.0;
+
+    for (i, line) in lines.iter().enumerate().skip(begin_line) {
+        if det(line.direction, line.point - *result) > distance {
+            // Result does not satisfy the constraint of this line.
+            projected_lines.clear();
+            for other in lines[..i].iter() {
+                let determinant = det(line.direction, other.direction);
+
+                let point = if determinant.abs() <= f32::EPSILON {
+                    // Lines are parallel.
+                    if line.direction.dot(&other.direction) > 0.0 {
+                        // Lines are in the same direction.
+                        continue;
+                    }
+                    (line.point + other.point).scale(0.5)
+                } else {
+                    line.point
+                        + line
+                            .direction
+                            .scale(det(other.direction, line.point - other.point) / determinant)
+                };
+
+                projected_lines.push(Line {
+                    point,
+                    direction: (other.direction - line.direction).normalize(),
+                });
+            }
+
+            let previous_result = *result;
+            if linear_program2(
+                projected_lines,
+                radius,
+                Vector2::new(-line.direction.y, line.direction.x),
+                true,
+                result,
+            ) < projected_lines.len()
+            {
+                // This should in principle not happen, the result is by definition already in the
+                // feasible region of this linear program. If it fails, it is due to small
+                // floating point error, and the current result is kept.
+                *result = previous_result;
+            }
+
+            distance = det(line.direction, line.point - *result);
+        }
+    }
+}
+
+#[cfg(test)]
+mod test {
+    use crate::{
+        core::{algebra::Vector3, math::TriangleDefinition},
+        utils::{
+            crowd::{Crowd, CrowdAgent, CrowdSettings, REQUESTS_PER_THREAD},
+            navmesh::{Navmesh, NavmeshAgentBuilder},
+        },
+    };
+    use std::time::Duration;
+
+    fn make_strip() -> Navmesh {
+        Navmesh::new(
+            vec![
+                TriangleDefinition([0, 1, 3]),
+                TriangleDefinition([1, 2, 3]),
+                TriangleDefinition([2, 5, 3]),
+                TriangleDefinition([2, 4, 5]),
+                TriangleDefinition([4, 7, 5]),
+                TriangleDefinition([4, 6, 7]),
+            ],
+            vec![
+                Vector3::new(0.0, 0.0, 0.0),
+                Vector3::new(0.0, 0.0, 1.0),
+                Vector3::new(1.0, 0.0, 1.0),
+                Vector3::new(1.0, 0.0, 0.0),
+                Vector3::new(2.0, 0.0, 1.0),
+                Vector3::new(2.0, 0.0, 0.0),
+                Vector3::new(3.0, 0.0, 1.0),
+                Vector3::new(3.0, 0.0, 0.0),
+            ],
+        )
+    }
+
+    #[test]
+    fn test_crowd_shares_paths() {
+        let navmesh = make_strip();
+        let mut crowd = Crowd::new(CrowdSettings {
+            avoidance: false,
+            ..Default::default()
+        });
+
+        let target = Vector3::new(2.9, 0.0, 0.5);
+        let agents = [0.1, 0.2, 0.3]
+            .iter()
+            .map(|z| {
+                crowd.add_agent(CrowdAgent::new(
+                    NavmeshAgentBuilder::new()
+                        .with_position(Vector3::new(0.1, 0.0, *z))
+                        .with_target(target)
+                        .build(),
+                ))
+            })
+            .collect::<Vec<_>>();
+
+        crowd.update(1.0 / 60.0, &navmesh);
+
+        let statistics = crowd.statistics();
+        assert_eq!(statistics.processed_path_requests, 3);
+        assert_eq!(statistics.path_searches, 1);
+        assert_eq!(statistics.shared_paths, 2);
+        assert_eq!(statistics.pending_path_requests, 0);
+
+        for handle in agents.iter() {
+            let agent = crowd.agent(*handle).unwrap();
+            assert!(agent.path_result().unwrap().is_ok());
+            assert!(!agent.is_waiting_for_path());
+            assert!(
+                agent
+                    .agent()
+                    .path()
+                    .last()
+                    .unwrap()
+                    .metric_distance(&target)
+                    < 1.0e-4
+            );
+        }
+
+        // Paths must not be recalculated while the agents are moving.
+        for _ in 0..600 {
+            crowd.update(1.0 / 60.0, &navmesh);
+            assert_eq!(crowd.statistics().processed_path_requests, 0);
+        }
+        for handle in agents.iter() {
+            let position = crowd.agent(*handle).unwrap().agent().position();
+            assert!(position.metric_distance(&target) < 0.1);
+        }
+    }
+
+    fn add_agents(crowd: &mut Crowd, position: Vector3<f32>, target: Vector3<f32>, count: usize) {
+        for _ in 0..count {
+            crowd.add_agent(CrowdAgent::new(
+                NavmeshAgentBuilder::new()
+                    .with_position(position)
+                    .with_target(target)
+                    .build(),
+            ));
+        }
+    }
+
+    #[test]
+    fn test_crowd_shares_corridor_suffixes() {
+        let navmesh = make_strip();
+        let mut crowd = Crowd::new(CrowdSettings {
+            avoidance: false,
+            path_time_budget: Duration::from_secs(60),
+            ..Default::default()
+        });
+
+        // The first batch starts in the first triangle of the strip, the last agent starts in the
+        // middle of the strip and must reuse a part of the corridor found for the first batch.
+        let batch_size = rayon::current_num_threads() * REQUESTS_PER_THREAD;
+        let target = Vector3::new(2.9, 0.0, 0.5);
+        add_agents(&mut crowd, Vector3::new(0.1, 0.0, 0.1), target, batch_size);
+        add_agents(&mut crowd, Vector3::new(1.2, 0.0, 0.2), target, 1);
+
+        crowd.update(1.0 / 60.0, &navmesh);
+
+        let statistics = crowd.statistics();
+        assert_eq!(statistics.processed_path_requests, batch_size + 1);
+        assert_eq!(statistics.path_searches, 1);
+        assert_eq!(statistics.shared_paths, batch_size);
+        assert_eq!(statistics.pending_path_requests, 0);
+
+        for (_, agent) in crowd.agents() {
+            assert!(agent.path_result().unwrap().is_ok());
+            assert!(
+                agent
+                    .agent()
+                    .path()
+                    .last()
+                    .unwrap()
+                    .metric_distance(&target)
+                    < 1.0e-4
+            );
+        }
+    }
+
+    #[test]
+    fn test_crowd_defers_path_requests() {
+        let navmesh = make_strip();
+        let mut crowd = Crowd::new(CrowdSettings {
+            avoidance: false,
+            path_time_budget: Duration::ZERO,
+            ..Default::default()
+        });
+
+        // Only one batch fits in the budget.
+        let batch_size = rayon::current_num_threads() * REQUESTS_PER_THREAD;
+        let target = Vector3::new(2.9, 0.0, 0.5);
+        add_agents(
+            &mut crowd,
+            Vector3::new(0.1, 0.0, 0.1),
+            target,
+            batch_size * 2 + 1,
+        );
+
+        crowd.update(1.0 / 60.0, &navmesh);
+        let statistics = crowd.statistics();
+        assert_eq!(statistics.processed_path_requests, batch_size);
+        assert_eq!(statistics.pending_path_requests, batch_size + 1);
+        assert_eq!(
+            crowd
+                .agents()
+                .filter(|(_, agent)| agent.is_waiting_for_path())
+                .count(),
+            batch_size + 1
+        );
+
+        crowd.update(1.0 / 60.0, &navmesh);
+        let statistics = crowd.statistics();
+        assert_eq!(statistics.processed_path_requests, batch_size);
+        assert_eq!(statistics.pending_path_requests, 1);
+
+        crowd.update(1.0 / 60.0, &navmesh);
+        let statistics = crowd.statistics();
+        assert_eq!(statistics.processed_path_requests, 1);
+        assert_eq!(statistics.pending_path_requests, 0);
+        assert!(crowd
+            .agents()
+            .all(|(_, agent)| !agent.is_waiting_for_path() && agent.path_result().is_some()));
+    }
+
+    #[test]
+    fn test_crowd_recalculates_path_of_pushed_agent() {
+        let navmesh = make_strip();
+        let mut crowd = Crowd::new(CrowdSettings {
+            avoidance: false,
+            ..Default::default()
+        });
+
+        let target = Vector3::new(2.9, 0.0, 0.5);
+        let handle = crowd.add_agent(CrowdAgent::new(
+            NavmeshAgentBuilder::new()
+                .with_position(Vector3::new(0.1, 0.0, 0.5))
+                .with_target(target)
+                .build(),
+        ));
+        crowd.update(1.0 / 60.0, &navmesh);
+        assert_eq!(crowd.statistics().processed_path_requests, 1);
+
+        // Small deviations from the path are fine.
+        let agent = crowd.agent_mut(handle).unwrap().agent_mut();
+        agent.move_along_path(agent.position() + Vector3::new(0.0, 0.0, 0.1));
+        assert!(!agent.is_path_dirty());
+
+        // But an agent, that was pushed far away from its path, must find a new one.
+        agent.move_along_path(Vector3::new(0.5, 0.0, 0.95));
+        assert!(agent.is_path_dirty());
+        crowd.update(1.0 / 60.0, &navmesh);
+        assert_eq!(crowd.statistics().processed_path_requests, 1);
+    }
+
+    #[test]
+    fn test_crowd_avoidance() {
+        let navmesh = Navmesh::new(
+            vec![TriangleDefinition([0, 1, 2]), TriangleDefinition([0, 2, 3])],
+            vec![
+                Vector3::new(-5.0, 0.0, -5.0),
+                Vector3::new(-5.0, 0.0, 5.0),
+                Vector3::new(5.0, 0.0, 5.0),
+                Vector3::new(5.0, 0.0, -5.0),
+            ],
+        );
+        let mut crowd = Crowd::default();
+
+        let a_target = Vector3::new(3.0, 0.0, 0.0);
+        let b_target = Vector3::new(-3.0, 0.0, 0.0);
+        let a = crowd.add_agent(CrowdAgent::new(
+            NavmeshAgentBuilder::new()
+                .with_position(b_target)
+                .with_target(a_target)
+                .build(),
+        ));
+        let b = crowd.add_agent(CrowdAgent::new(
+            NavmeshAgentBuilder::new()
+                .with_position(a_target)
+                .with_target(b_target)
+                .build(),
+        ));
+
+        let min_distance =
+            crowd.agent(a).unwrap().agent().radius() + crowd.agent(b).unwrap().agent().radius();
+        for _ in 0..600 {
+            crowd.update(1.0 / 60.0, &navmesh);
+
+            let a_position = crowd.agent(a).unwrap().agent().position();
+            let b_position = crowd.agent(b).unwrap().agent().position();
+            assert!(a_position.metric_distance(&b_position) >= min_distance * 0.95);
+        }
+
+        let a_position = crowd.agent(a).unwrap().agent().position();
+        let b_position = crowd.agent(b).unwrap().agent().position();
+        assert!(a_position.metric_distance(&a_target) < 0.5);
+        assert!(b_position.metric_distance(&b_target) < 0.5);
+    }
+}
@@ -32,7 +32,11 @@ use crate::{
         node::Node,
         Scene,
     },
-    utils::{uvgen, uvgen::SurfaceDataPatch},
+    utils::{
+        progress::{self, TaskStage},
+        uvgen,
+        uvgen::SurfaceDataPatch,
+    },
 };
 use fxhash::FxHashMap;
 use lightmap::light::{
@@ -41,14 +45,12 @@ use lightmap::light::{
 use rayon::prelude::*;
 use std::{
     fmt::{Display, Formatter},
-    ops::Deref,
     path::Path,
-    sync::{
-        atomic::{self, AtomicBool, AtomicU32},
-        Arc,
-    },
+    sync::Arc,
 };
 
+pub use crate::utils::progress::CancellationToken;
+
 /// Applies surface data patch to a surface data.
 pub fn apply_surface_data_patch(data: &mut SurfaceData, patch: &SurfaceDataPatch) {
     if !data
@@ -159,27 +161,6 @@ struct Instance {
     transform: Matrix4<f32>,
 }
 
-/// Small helper that allows you stop lightmap generation in any time.
-#[derive(Clone, Default)]
-pub struct CancellationToken(pub Arc<AtomicBool>);
-
-impl CancellationToken {
-    /// Creates new cancellation token.
-    pub fn new() -> Self {
-        Self::default()
-    }
-
-    /// Checks if generation was cancelled.
-    pub fn is_cancelled(&self) -> bool {
-        self.0.load(atomic::Ordering::SeqCst)
-    }
-
-    /// Raises cancellation flag, actual cancellation is not immediate!
-    pub fn cancel(&self) {
-        self.0.store(true, atomic::Ordering::SeqCst)
-    }
-}
-
 /// Lightmap generation stage.
 #[derive(Copy, Clone, PartialOrd, PartialEq, Ord, Eq)]
 #[repr(u32)]
@@ -213,29 +194,9 @@ impl Display for ProgressStage {
     }
 }
 
-/// Progress internals.
-#[derive(Default)]
-pub struct ProgressData {
-    stage: AtomicU32,
-    // Range is [0; max_iterations]
-    progress: AtomicU32,
-    max_iterations: AtomicU32,
-}
-
-impl ProgressData {
-    /// Returns progress percentage in [0; 100] range.
-    pub fn progress_percent(&self) -> u32 {
-        let iterations = self.max_iterations.load(atomic::Ordering::SeqCst);
-        if iterations > 0 {
-            self.progress.load(atomic::Ordering::SeqCst) * 100 / iterations
-        } else {
-            0
-        }
-    }
-
-    /// Returns current stage.
-    pub fn stage(&self) -> ProgressStage {
-        match self.stage.load(atomic::Ordering::SeqCst) {
+impl TaskStage for ProgressStage {
+    fn from_index(index: u32) -> Self {
+        match index {
             0 => ProgressStage::LightsCaching,
             1 => ProgressStage::UvGeneration,
             2 => ProgressStage::GeometryCaching,
@@ -244,38 +205,16 @@ impl ProgressData {
         }
     }
 
-    /// Sets new stage with max iterations per stage.
-    fn set_stage(&self, stage: ProgressStage, max_iterations: u32) {
-        self.max_iterations
-            .store(max_iterations, atomic::Ordering::SeqCst);
-        self.progress.store(0, atomic::Ordering::SeqCst);
-        self.stage.store(stage as u32, atomic::Ordering::SeqCst);
-    }
-
-    /// Advances progress.
-    fn advance_progress(&self) {
-        self.progress.fetch_add(1, atomic::Ordering::SeqCst);
+    fn index(self) -> u32 {
+        self as u32
     }
 }
 
-/// Small helper that allows you to track progress of lightmap generation.
-#[derive(Clone, Default)]
-pub struct ProgressIndicator(pub Arc<ProgressData>);
+/// Progress internals of lightmap generation.
+pub type ProgressData = progress::ProgressData<ProgressStage>;
 
-impl ProgressIndicator {
-    /// Creates new progress indicator.
-    pub fn new() -> Self {
-        Self::default()
-    }
-}
-
-impl Deref for ProgressIndicator {
-    type Target = ProgressData;
-
-    fn deref(&self) -> &Self::Target {
-        &self.0
-    }
-}
+/// Small helper that allows you to track progress of lightmap generation.
+pub type ProgressIndicator = progress::ProgressIndicator<ProgressStage>;
 
 /// An error that may occur during ligthmap generation.
 #[derive(Debug)]
@@ -4,8 +4,10 @@
 
 pub mod astar;
 pub mod behavior;
+pub mod crowd;
 pub mod lightmap;
 pub mod navmesh;
+pub mod progress;
 pub mod raw_mesh;
 pub mod uvgen;
 
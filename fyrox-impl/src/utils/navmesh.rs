@@ -18,7 +18,9 @@ use crate::{
         Mesh,
     },
     utils::{
-        astar::{Graph, GraphVertex, PathError, PathKind, VertexData, VertexDataProvider},
+        astar::{
+            Graph, GraphVertex, PathError, PathKind, PathQuery, VertexData, VertexDataProvider,
+        },
         raw_mesh::{RawMeshBuilder, RawVertex},
     },
 };
@@ -569,6 +571,39 @@ impl Navmesh {
         self.graph.build_positional_path(from, to, path)
     }
 
+    /// Builds paths (as triangle indices) for every given query in parallel. See
+    /// [`Graph::build_indexed_paths`] for more info.
+    pub fn build_indexed_paths(&self, queries: &mut [PathQuery]) {
+        self.graph.build_indexed_paths(queries)
+    }
+
+    /// Does the same as [`Self::query_closest`], but checks only the given triangle and its direct
+    /// neighbours. It should be used when the query point is known to be close to the triangle, for
+    /// example when tracking a moving object.
+    ///
+    /// ## Complexity
+    ///
+    /// This method has `O(1)` complexity.
+    pub fn query_closest_local(
+        &self,
+        query_point: Vector3<f32>,
+        triangle: usize,
+    ) -> Option<(Vector3<f32>, usize)> {
+        let vertex = self.graph.vertex(triangle)?;
+
+        let mut closest = None;
+        let mut closest_distance = f32::MAX;
+
+        self.query_closest_internal(
+            &mut closest,
+            &mut closest_distance,
+            std::iter::once(triangle).chain(vertex.neighbours.iter().map(|n| *n as usize)),
+            query_point,
+        );
+
+        closest
+    }
+
     /// Tries to pick a triangle by given ray. Returns closest result.
     pub fn ray_cast(&self, ray: Ray) -> Option<(Vector3<f32>, usize)> {
         let mut buffer = ArrayVec::<usize, 128>::new();
@@ -629,6 +664,91 @@ impl Navmesh {
     }
 }
 
+// Builds the shortest path through the given corridor of triangles using "string pulling" (funnel)
+// algorithm. Portals are shrunk by the given radius, so the path keeps that distance from corners.
+pub(crate) fn straighten_path(
+    navmesh: &Navmesh,
+    radius: f32,
+    src_position: Vector3<f32>,
+    dest_position: Vector3<f32>,
+    path_triangles: &[usize],
+    path: &mut Vec<Vector3<f32>>,
+) {
+    path.push(src_position);
+
+    if path_triangles.len() > 1 {
+        let mut funnel_apex = src_position;
+        let mut funnel_vertices = [funnel_apex; 2];
+        let mut side_indices = [0; 2];
+        let side_signs = [1.0, -1.0];
+
+        let mut i = 0;
+        while i < path_triangles.len() {
+            let portal_vertices = if i + 1 < path_triangles.len() {
+                let portal = navmesh
+                    .portal_between(path_triangles[i], path_triangles[i + 1])
+                    .unwrap();
+
+                let mut left = navmesh.vertices[portal.left];
+                let mut right = navmesh.vertices[portal.right];
+
+                if radius > 0.0 {
+                    let delta = right - left;
+                    let len = delta.norm();
+                    let offset = delta.scale(radius.min(len * 0.5) / len);
+
+                    left += offset;
+                    right -= offset;
+                }
+
+                [left, right]
+            } else {
+                [dest_position, dest_position]
+            };
+
+            for current in 0..2 {
+                let opposite = 1 - current;
+                let side_sign = side_signs[current];
+                if side_sign
+                    * triangle_area_2d(
+                        funnel_apex,
+                        funnel_vertices[current],
+                        portal_vertices[current],
+                    )
+                    >= 0.0
+                {
+                    if funnel_apex == funnel_vertices[current]
+                        || side_sign
+                            * triangle_area_2d(
+                                funnel_apex,
+                                funnel_vertices[opposite],
+                                portal_vertices[current],
+                            )
+                            < 0.0
+                    {
+                        funnel_vertices[current] = portal_vertices[current];
+                        side_indices[current] = i;
+                    } else {
+                        funnel_apex = funnel_vertices[opposite];
+                        funnel_vertices = [funnel_apex; 2];
+
+                        path.push(funnel_apex);
+
+                        i = side_indices[opposite];
+                        side_indices[current] = i;
+
+                        break;
+                    }
+                }
+            }
+
+            i += 1;
+        }
+    }
+
+    path.push(dest_position);
+}
+
 /// Navmesh agent is a "pathfinding unit" that performs navigation on a mesh. It is designed to
 /// cover most of simple use cases when you need to build and follow some path from point A to point B.
 #[derive(Visit, Clone, Debug)]
@@ -751,11 +871,13 @@ impl NavmeshAgent {
 
                 path_triangle_indices.reverse();
 
-                self.straighten_path(
+                straighten_path(
                     navmesh,
+                    self.radius,
                     src_point_on_navmesh,
                     dest_point_on_navmesh,
                     &path_triangle_indices,
+                    &mut self.path,
                 );
 
                 return Ok(path_kind);
@@ -765,88 +887,6 @@ impl NavmeshAgent {
         Err(PathError::Empty)
     }
 
-    fn straighten_path(
-        &mut self,
-        navmesh: &Navmesh,
-        src_position: Vector3<f32>,
-        dest_position: Vector3<f32>,
-        path_triangles: &[usize],
-    ) {
-        self.path.push(src_position);
-
-        if path_triangles.len() > 1 {
-            let mut funnel_apex = src_position;
-            let mut funnel_vertices = [funnel_apex; 2];
-            let mut side_indices = [0; 2];
-            let side_signs = [1.0, -1.0];
-
-            let mut i = 0;
-            while i < path_triangles.len() {
-                let portal_vertices = if i + 1 < path_triangles.len() {
-                    let portal = navmesh
-                        .portal_between(path_triangles[i], path_triangles[i + 1])
-                        .unwrap();
-
-                    let mut left = navmesh.vertices[portal.left];
-                    let mut right = navmesh.vertices[portal.right];
-
-                    if self.radius > 0.0 {
-                        let delta = right - left;
-                        let len = delta.norm();
-                        let offset = delta.scale(self.radius.min(len * 0.5) / len);
-
-                        left += offset;
-                        right -= offset;
-                    }
-
-                    [left, right]
-                } else {
-                    [dest_position, dest_position]
-                };
-
-                for current in 0..2 {
-                    let opposite = 1 - current;
-                    let side_sign = side_signs[current];
-                    if side_sign
-                        * triangle_area_2d(
-                            funnel_apex,
-                            funnel_vertices[current],
-                            portal_vertices[current],
-                        )
-                        >= 0.0
-                    {
-                        if funnel_apex == funnel_vertices[current]
-                            || side_sign
-                                * triangle_area_2d(
-                                    funnel_apex,
-                                    funnel_vertices[opposite],
-                                    portal_vertices[current],
-                                )
-                                < 0.0
-                        {
-                            funnel_vertices[current] = portal_vertices[current];
-                            side_indices[current] = i;
-                        } else {
-                            funnel_apex = funnel_vertices[opposite];
-                            funnel_vertices = [funnel_apex; 2];
-
-                            self.path.push(funnel_apex);
-
-                            i = side_indices[opposite];
-                            side_indices[current] = i;
-
-                            break;
-                        }
-                    }
-                }
-
-                i += 1;
-            }
-        }
-
-        self.path.push(dest_position);
-    }
-
     /// Performs single update tick that moves agent to the target along the path (which is automatically
     /// recalculated if target's position has changed).
     pub fn update(&mut self, dt: f32, navmesh: &Navmesh) -> Result<PathKind, PathError> {
@@ -906,6 +946,54 @@ impl NavmeshAgent {
 
         self.position = new_position;
     }
+
+    pub(crate) fn is_path_dirty(&self) -> bool {
+        self.path_dirty
+    }
+
+    // Replaces the current path with the given one (the given vector will contain the old path).
+    pub(crate) fn swap_path(&mut self, path: &mut Vec<Vector3<f32>>) {
+        std::mem::swap(&mut self.path, path);
+        self.current = 0;
+        self.interpolator = 0.0;
+        self.path_dirty = false;
+        self.last_warp_position = self.position;
+    }
+
+    pub(crate) fn path_index(&self) -> usize {
+        self.current as usize
+    }
+
+    pub(crate) fn set_path_index(&mut self, index: usize) {
+        self.current = index as u32;
+    }
+
+    // Moves the agent along its path, unlike `set_position` it does not cause path recalculation,
+    // unless the agent was pushed away (by other agents, for example) from its current path segment
+    // further than the recalculation threshold.
+    pub(crate) fn move_along_path(&mut self, new_position: Vector3<f32>) {
+        self.position = new_position;
+
+        let Some(&begin) = self.path.get(self.current as usize) else {
+            return;
+        };
+        let end = self
+            .path
+            .get(self.current as usize + 1)
+            .cloned()
+            .unwrap_or(begin);
+        let segment = end - begin;
+        let length_sqr = segment.norm_squared();
+        let t = if length_sqr > f32::EPSILON {
+            ((new_position - begin).dot(&segment) / length_sqr).clamp(0.0, 1.0)
+        } else {
+            0.0
+        };
+        let closest = begin + segment.scale(t);
+        if new_position.metric_distance(&closest) >= self.recalculation_threshold {
+            self.path_dirty = true;
+        }
+    }
 }
 
 /// Allows you to build agent in declarative manner.
@@ -0,0 +1,124 @@
+//! Progress tracking and cancellation of long-running tasks, such as lightmap generation or model
+//! import. See [`ProgressIndicator`] and [`CancellationToken`] docs for more info.
+
+use std::{
+    fmt::Display,
+    marker::PhantomData,
+    ops::Deref,
+    sync::{
+        atomic::{self, AtomicBool, AtomicU32},
+        Arc,
+    },
+};
+
+/// Small helper that allows you to stop a long-running task at any time.
+#[derive(Clone, Default)]
+pub struct CancellationToken(pub Arc<AtomicBool>);
+
+impl CancellationToken {
+    /// Creates new cancellation token.
+    pub fn new() -> Self {
+        Self::default()
+    }
+
+    /// Checks if the task was cancelled.
+    pub fn is_cancelled(&self) -> bool {
+        self.0.load(atomic::Ordering::SeqCst)
+    }
+
+    /// Raises cancellation flag, actual cancellation is not immediate!
+    pub fn cancel(&self) {
+        self.0.store(true, atomic::Ordering::SeqCst)
+    }
+}
+
+/// A stage of a long-running task. Every task defines its own set of stages, usually as a fieldless
+/// enum.
+pub trait TaskStage: Copy + Display {
+    /// Returns a stage by its index, see [`Self::index`].
+    fn from_index(index: u32) -> Self;
+
+    /// Returns an index of the stage.
+    fn index(self) -> u32;
+}
+
+/// Progress internals.
+pub struct ProgressData<S> {
+    stage: AtomicU32,
+    // Range is [0; max_iterations]
+    progress: AtomicU32,
+    max_iterations: AtomicU32,
+    phantom: PhantomData<fn() -> S>,
+}
+
+impl<S> Default for ProgressData<S> {
+    fn default() -> Self {
+        Self {
+            stage: Default::default(),
+            progress: Default::default(),
+            max_iterations: Default::default(),
+            phantom: PhantomData,
+        }
+    }
+}
+
+impl<S: TaskStage> ProgressData<S> {
+    /// Returns progress percentage of current stage in [0; 100] range. Stages without known amount
+    /// of work always report zero.
+    pub fn progress_percent(&self) -> u32 {
+        let iterations = self.max_iterations.load(atomic::Ordering::SeqCst);
+        if iterations > 0 {
+            self.progress.load(atomic::Ordering::SeqCst) * 100 / iterations
+        } else {
+            0
+        }
+    }
+
+    /// Returns current stage.
+    pub fn stage(&self) -> S {
+        S::from_index(self.stage.load(atomic::Ordering::SeqCst))
+    }
+
+    /// Sets new stage with max iterations per stage.
+    pub(crate) fn set_stage(&self, stage: S, max_iterations: u32) {
+        self.max_iterations
+            .store(max_iterations, atomic::Ordering::SeqCst);
+        self.progress.store(0, atomic::Ordering::SeqCst);
+        self.stage.store(stage.index(), atomic::Ordering::SeqCst);
+    }
+
+    /// Advances progress.
+    pub(crate) fn advance_progress(&self) {
+        self.progress.fetch_add(1, atomic::Ordering::SeqCst);
+    }
+}
+
+/// Small helper that allows you to track progress of a long-running task.
+pub struct ProgressIndicator<S>(pub Arc<ProgressData<S>>);
+
+impl<S> Clone for ProgressIndicator<S> {
+    fn clone(&self) -> Self {
+        Self(self.0.clone())
+    }
+}
+
+impl<S> Default for ProgressIndicator<S> {
+    fn default() -> Self {
+        Self(Default::default())
+    }
+}
+
+impl<S> ProgressIndicator<S> {
+    /// Creates new progress indicator.
+    pub fn new() -> Self {
+        Self::default()
+    }
+}
+
+impl<S> Deref for ProgressIndicator<S> {
+    type Target = ProgressData<S>;
+
+    fn deref(&self) -> &Self::Target {
+        &self.0
+    }
+}
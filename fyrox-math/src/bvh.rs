@@ -0,0 +1,603 @@
+//! Dynamic bounding volume hierarchy (BVH) - an incrementally updated binary tree of axis-aligned
+//! bounding boxes. Unlike [`crate::octree::Octree`], it does not need to be rebuilt when objects are
+//! added, removed or moved, which makes it suitable for scenes with lots of moving objects.
+//!
+//! Every leaf stores a "fat" bounding box - a tight bounding box of an object inflated by some margin.
+//! Small movements of an object that keep its tight bounding box inside the fat one do not require
+//! any changes in the tree. The tree is kept balanced using tree rotations.
+
+use crate::{aabb::AxisAlignedBoundingBox, frustum::Frustum, ray::Ray};
+use nalgebra::Vector3;
+
+const NULL: u32 = u32::MAX;
+
+/// Relative margin (in fractions of the size of a tight bounding box) that is used to inflate tight
+/// bounding boxes of objects.
+pub const DEFAULT_RELATIVE_MARGIN: f32 = 0.1;
+
+/// Absolute margin (in world units) that is used to inflate tight bounding boxes of objects.
+pub const DEFAULT_ABSOLUTE_MARGIN: f32 = 0.1;
+
+#[derive(Clone, Debug)]
+struct BvhNode<T> {
+    aabb: AxisAlignedBoundingBox,
+    parent: u32,
+    child1: u32,
+    child2: u32,
+    // Leaves have zero height, free nodes have negative height.
+    height: i32,
+    data: Option<T>,
+}
+
+impl<T> BvhNode<T> {
+    fn is_leaf(&self) -> bool {
+        self.child1 == NULL
+    }
+}
+
+/// Dynamic bounding volume hierarchy, see module docs for more info. Every object in the tree is
+/// identified by a proxy id, that remains the same until the object is removed from the tree.
+#[derive(Clone, Debug)]
+pub struct DynamicBvh<T> {
+    nodes: Vec<BvhNode<T>>,
+    root: u32,
+    free_list: u32,
+    proxy_count: usize,
+    relative_margin: f32,
+    absolute_margin: f32,
+}
+
+impl<T> Default for DynamicBvh<T> {
+    fn default() -> Self {
+        Self::new()
+    }
+}
+
+#[inline]
+fn merge(a: &AxisAlignedBoundingBox, b: &AxisAlignedBoundingBox) -> AxisAlignedBoundingBox {
+    AxisAlignedBoundingBox {
+        min: a.min.inf(&b.min),
+        max: a.max.sup(&b.max),
+    }
+}
+
+#[inline]
+fn area(aabb: &AxisAlignedBoundingBox) -> f32 {
+    let d = aabb.max - aabb.min;
+    2.0 * (d.x * d.y + d.y * d.z + d.z * d.x)
+}
+
+#[inline]
+fn contains(outer: &AxisAlignedBoundingBox, inner: &AxisAlignedBoundingBox) -> bool {
+    outer.min.x <= inner.min.x
+        && outer.min.y <= inner.min.y
+        && outer.min.z <= inner.min.z
+        && outer.max.x >= inner.max.x
+        && outer.max.y >= inner.max.y
+        && outer.max.z >= inner.max.z
+}
+
+impl<T> DynamicBvh<T> {
+    /// Creates new empty tree with default margins.
+    pub fn new() -> Self {
+        Self::with_margins(DEFAULT_RELATIVE_MARGIN, DEFAULT_ABSOLUTE_MARGIN)
+    }
+
+    /// Creates new empty tree with the given margins, that will be used to inflate tight bounding
+    /// boxes of objects. Larger margins means less tree updates for moving objects, but less
+    /// precise queries.
+    pub fn with_margins(relative_margin: f32, absolute_margin: f32) -> Self {
+        Self {
+            nodes: Default::default(),
+            root: NULL,
+            free_list: NULL,
+            proxy_count: 0,
+            relative_margin,
+            absolute_margin,
+        }
+    }
+
+    /// Returns total amount of objects in the tree.
+    pub fn len(&self) -> usize {
+        self.proxy_count
+    }
+
+    /// Returns `true` if the tree has no objects.
+    pub fn is_empty(&self) -> bool {
+        self.proxy_count == 0
+    }
+
+    /// Returns height of the tree. Could be used to check the quality of the tree.
+    pub fn height(&self) -> i32 {
+        if self.root == NULL {
+            0
+        } else {
+            self.nodes[self.root as usize].height
+        }
+    }
+
+    /// Removes every object from the tree.
+    pub fn clear(&mut self) {
+        self.nodes.clear();
+        self.root = NULL;
+        self.free_list = NULL;
+        self.proxy_count = 0;
+    }
+
+    /// Returns a reference to the user data associated with the given proxy.
+    pub fn data(&self, proxy: u32) -> Option<&T> {
+        self.nodes
+            .get(proxy as usize)
+            .and_then(|node| node.data.as_ref())
+    }
+
+    /// Returns fat bounding box of the given proxy.
+    pub fn fat_aabb(&self, proxy: u32) -> Option<&AxisAlignedBoundingBox> {
+        self.nodes
+            .get(proxy as usize)
+            .filter(|node| node.data.is_some())
+            .map(|node| &node.aabb)
+    }
+
+    fn fatten(&self, aabb: &AxisAlignedBoundingBox) -> AxisAlignedBoundingBox {
+        let size = aabb.max - aabb.min;
+        let margin = size
+            .scale(self.relative_margin)
+            .add_scalar(self.absolute_margin);
+        AxisAlignedBoundingBox {
+            min: aabb.min - margin,
+            max: aabb.max + margin,
+        }
+    }
+
+    fn allocate_node(&mut self) -> u32 {
+        let node = BvhNode {
+            aabb: Default::default(),
+            parent: NULL,
+            child1: NULL,
+            child2: NULL,
+            height: 0,
+            data: None,
+        };
+
+        if self.free_list == NULL {
+            self.nodes.push(node);
+            (self.nodes.len() - 1) as u32
+        } else {
+            let index = self.free_list;
+            let slot = &mut self.nodes[index as usize];
+            // Free nodes use parent index as a link to the next free node.
+            self.free_list = slot.parent;
+            *slot = node;
+            index
+        }
+    }
+
+    fn free_node(&mut self, index: u32) {
+        let node = &mut self.nodes[index as usize];
+        node.parent = self.free_list;
+        node.child1 = NULL;
+        node.child2 = NULL;
+        node.height = -1;
+        node.data = None;
+        self.free_list = index;
+    }
+
+    /// Adds a new object with the given tight bounding box to the tree. Returns a proxy id that can
+    /// be used to move or remove the object.
+    pub fn insert(&mut self, aabb: AxisAlignedBoundingBox, data: T) -> u32 {
+        let proxy = self.allocate_node();
+        let fat_aabb = self.fatten(&aabb);
+        let node = &mut self.nodes[proxy as usize];
+        node.aabb = fat_aabb;
+        node.data = Some(data);
+        self.insert_leaf(proxy);
+        self.proxy_count += 1;
+        proxy
+    }
+
+    /// Removes the given proxy from the tree and returns its user data.
+    pub fn remove(&mut self, proxy: u32) -> Option<T> {
+        let node = self.nodes.get_mut(proxy as usize)?;
+        let data = node.data.take()?;
+        self.remove_leaf(proxy);
+        self.free_node(proxy);
+        self.proxy_count -= 1;
+        Some(data)
+    }
+
+    /// Updates tight bounding box of the given proxy. The tree is modified only if the new bounding
+    /// box is not fully inside the fat bounding box of the proxy. Returns `true` if the tree was
+    /// modified.
+    pub fn move_proxy(&mut self, proxy: u32, aabb: AxisAlignedBoundingBox) -> bool {
+        match self.nodes.get(proxy as usize) {
+            Some(node) if node.data.is_some() => {
+                if contains(&node.aabb, &aabb) {
+                    return false;
+                }
+            }
+            _ => return false,
+        }
+
+        self.remove_leaf(proxy);
+        self.nodes[proxy as usize].aabb = self.fatten(&aabb);
+        self.insert_leaf(proxy);
+        true
+    }
+
+    /// Visits every object whose fat bounding box passes the given test. The test is also used to
+    /// discard whole branches of the tree.
+    pub fn query<F, V>(&self, mut test: F, mut visitor: V)
+    where
+        F: FnMut(&AxisAlignedBoundingBox) -> bool,
+        V: FnMut(u32, &T),
+    {
+        if self.root == NULL {
+            return;
+        }
+
+        let mut stack = Vec::with_capacity(64);
+        stack.push(self.root);
+        while let Some(index) = stack.pop() {
+            let node = &self.nodes[index as usize];
+            if test(&node.aabb) {
+                if node.is_leaf() {
+                    if let Some(data) = node.data.as_ref() {
+                        visitor(index, data);
+                    }
+                } else {
+                    stack.push(node.child1);
+                    stack.push(node.child2);
+                }
+            }
+        }
+    }
+
+    /// Visits every object whose fat bounding box intersects the given bounding box.
+    pub fn aabb_query<V>(&self, aabb: &AxisAlignedBoundingBox, visitor: V)
+    where
+        V: FnMut(u32, &T),
+    {
+        self.query(|node_aabb| node_aabb.is_intersects_aabb(aabb), visitor)
+    }
+
+    /// Visits every object whose fat bounding box intersects the given sphere.
+    pub fn sphere_query<V>(&self, position: Vector3<f32>, radius: f32, visitor: V)
+    where
+        V: FnMut(u32, &T),
+    {
+        self.query(
+            |node_aabb| node_aabb.is_intersects_sphere(position, radius),
+            visitor,
+        )
+    }
+
+    /// Visits every object whose fat bounding box intersects the given frustum.
+    pub fn frustum_query<V>(&self, frustum: &Frustum, visitor: V)
+    where
+        V: FnMut(u32, &T),
+    {
+        self.query(|node_aabb| frustum.is_intersects_aabb(node_aabb), visitor)
+    }
+
+    /// Visits every object whose fat bounding box is intersected by the given ray.
+    pub fn ray_query<V>(&self, ray: &Ray, visitor: V)
+    where
+        V: FnMut(u32, &T),
+    {
+        self.query(
+            |node_aabb| ray.aabb_intersection(node_aabb).is_some(),
+            visitor,
+        )
+    }
+
+    fn insert_leaf(&mut self, leaf: u32) {
+        if self.root == NULL {
+            self.root = leaf;
+            self.nodes[leaf as usize].parent = NULL;
+            return;
+        }
+
+        // Find the best sibling for the leaf using surface area heuristic.
+        let leaf_aabb = self.nodes[leaf as usize].aabb;
+        let mut index = self.root;
+        while !self.nodes[index as usize].is_leaf() {
+            let node = &self.nodes[index as usize];
+            let child1 = node.child1;
+            let child2 = node.child2;
+
+            let node_area = area(&node.aabb);
+            let combined_area = area(&merge(&node.aabb, &leaf_aabb));
+
+            // Cost of creating a new parent for this node and the new leaf.
+            let cost = 2.0 * combined_area;
+
+            // Minimum cost of pushing the leaf further down the tree.
+            let inheritance_cost = 2.0 * (combined_area - node_area);
+
+            let child_cost = |child: u32| {
+                let child = &self.nodes[child as usize];
+                let merged_area = area(&merge(&leaf_aabb, &child.aabb));
+                if child.is_leaf() {
+                    merged_area + inheritance_cost
+                } else {
+                    merged_area - area(&child.aabb) + inheritance_cost
+                }
+            };
+
+            let cost1 = child_cost(child1);
+            let cost2 = child_cost(child2);
+
+            if cost < cost1 && cost < cost2 {
+                break;
+            }
+
+            index = if cost1 < cost2 { child1 } else { child2 };
+        }
+
+        let sibling = index;
+
+        // Create a new parent.
+        let old_parent = self.nodes[sibling as usize].parent;
+        let new_parent = self.allocate_node();
+        {
+            let sibling_node = &self.nodes[sibling as usize];
+            let aabb = merge(&leaf_aabb, &sibling_node.aabb);
+            let height = sibling_node.height + 1;
+            let new_parent_node = &mut self.nodes[new_parent as usize];
+            new_parent_node.parent = old_parent;
+            new_parent_node.aabb = aabb;
+            new_parent_node.height = height;
+            new_parent_node.child1 = sibling;
+            new_parent_node.child2 = leaf;
+        }
+        self.nodes[sibling as usize].parent = new_parent;
+        self.nodes[leaf as usize].parent = new_parent;
+
+        if old_parent == NULL {
+            self.root = new_parent;
+        } else {
+            self.replace_child(old_parent, sibling, new_parent);
+        }
+
+        self.refit(self.nodes[leaf as usize].parent);
+    }
+
+    fn remove_leaf(&mut self, leaf: u32) {
+        if leaf == self.root {
+            self.root = NULL;
+            return;
+        }
+
+        let parent = self.nodes[leaf as usize].parent;
+        let grand_parent = self.nodes[parent as usize].parent;
+        let sibling = if self.nodes[parent as usize].child1 == leaf {
+            self.nodes[parent as usize].child2
+        } else {
+            self.nodes[parent as usize].child1
+        };
+
+        if grand_parent == NULL {
+            self.root = sibling;
+            self.nodes[sibling as usize].parent = NULL;
+            self.free_node(parent);
+        } else {
+            self.replace_child(grand_parent, parent, sibling);
+            self.nodes[sibling as usize].parent = grand_parent;
+            self.free_node(parent);
+            self.refit(grand_parent);
+        }
+    }
+
+    fn replace_child(&mut self, parent: u32, old_child: u32, new_child: u32) {
+        let parent = &mut self.nodes[parent as usize];
+        if parent.child1 == old_child {
+            parent.child1 = new_child;
+        } else {
+            parent.child2 = new_child;
+        }
+    }
+
+    // Walks up the tree from the given node, balancing the tree and fixing heights and bounding boxes.
+    fn refit(&mut self, mut index: u32) {
+        while index != NULL {
+            index = self.balance(index);
+
+            let node = &self.nodes[index as usize];
+            let child1 = &self.nodes[node.child1 as usize];
+            let child2 = &self.nodes[node.child2 as usize];
+            let height = 1 + child1.height.max(child2.height);
+            let aabb = merge(&child1.aabb, &child2.aabb);
+
+            let node = &mut self.nodes[index as usize];
+            node.height = height;
+            node.aabb = aabb;
+
+            index = node.parent;
+        }
+    }
+
+    fn set_parent_link(&mut self, node: u32, old_child: u32) {
+        let parent = self.nodes[node as usize].parent;
+        if parent == NULL {
+            self.root = node;
+        } else {
+            self.replace_child(parent, old_child, node);
+        }
+    }
+
+    // Performs a left or right rotation if the node `a` is imbalanced. Returns the new root of the
+    // sub-tree.
+    fn balance(&mut self, a: u32) -> u32 {
+        let (b, c) = {
+            let node_a = &self.nodes[a as usize];
+            if node_a.is_leaf() || node_a.height < 2 {
+                return a;
+            }
+            (node_a.child1, node_a.child2)
+        };
+
+        let balance = self.nodes[c as usize].height - self.nodes[b as usize].height;
+
+        if balance > 1 {
+            // Rotate C up.
+            let f = self.nodes[c as usize].child1;
+            let g = self.nodes[c as usize].child2;
+
+            self.nodes[c as usize].child1 = a;
+            self.nodes[c as usize].parent = self.nodes[a as usize].parent;
+            self.nodes[a as usize].parent = c;
+            self.set_parent_link(c, a);
+
+            let (keep, give) = if self.nodes[f as usize].height > self.nodes[g as usize].height {
+                (f, g)
+            } else {
+                (g, f)
+            };
+
+            self.nodes[c as usize].child2 = keep;
+            self.nodes[a as usize].child2 = give;
+            self.nodes[give as usize].parent = a;
+
+            self.nodes[a as usize].aabb = merge(
+                &self.nodes[b as usize].aabb,
+                &self.nodes[give as usize].aabb,
+            );
+            self.nodes[c as usize].aabb = merge(
+                &self.nodes[a as usize].aabb,
+                &self.nodes[keep as usize].aabb,
+            );
+            self.nodes[a as usize].height = 1 + self.nodes[b as usize]
+                .height
+                .max(self.nodes[give as usize].height);
+            self.nodes[c as usize].height = 1 + self.nodes[a as usize]
+                .height
+                .max(self.nodes[keep as usize].height);
+
+            return c;
+        }
+
+        if balance < -1 {
+            // Rotate B up.
+            let d = self.nodes[b as usize].child1;
+            let e = self.nodes[b as usize].child2;
+
+            self.nodes[b as usize].child1 = a;
+            self.nodes[b as usize].parent = self.nodes[a as usize].parent;
+            self.nodes[a as usize].parent = b;
+            self.set_parent_link(b, a);
+
+            let (keep, give) = if self.nodes[d as usize].height > self.nodes[e as usize].height {
+                (d, e)
+            } else {
+                (e, d)
+            };
+
+            self.nodes[b as usize].child2 = keep;
+            self.nodes[a as usize].child1 = give;
+            self.nodes[give as usize].parent = a;
+
+            self.nodes[a as usize].aabb = merge(
+                &self.nodes[c as usize].aabb,
+                &self.nodes[give as usize].aabb,
+            );
+            self.nodes[b as usize].aabb = merge(
+                &self.nodes[a as usize].aabb,
+                &self.nodes[keep as usize].aabb,
+            );
+            self.nodes[a as usize].height = 1 + self.nodes[c as usize]
+                .height
+                .max(self.nodes[give as usize].height);
+            self.nodes[b as usize].height = 1 + self.nodes[a as usize]
+                .height
+                .max(self.nodes[keep as usize].height);
+
+            return b;
+        }
+
+        a
+    }
+}
+
+#[cfg(test)]
+mod test {
+    use super::*;
+
+    fn cube(position: Vector3<f32>) -> AxisAlignedBoundingBox {
+        AxisAlignedBoundingBox::from_min_max(
+            position - Vector3::repeat(0.5),
+            position + Vector3::repeat(0.5),
+        )
+    }
+
+    fn collect(bvh: &DynamicBvh<usize>, aabb: &AxisAlignedBoundingBox) -> Vec<usize> {
+        let mut result = Vec::new();
+        bvh.aabb_query(aabb, |_, data| result.push(*data));
+        result.sort_unstable();
+        result
+    }
+
+    #[test]
+    fn test_bvh_insert_query_remove() {
+        let mut bvh = DynamicBvh::new();
+        let proxies = (0..100)
+            .map(|i| bvh.insert(cube(Vector3::new(i as f32 * 2.0, 0.0, 0.0)), i))
+            .collect::<Vec<_>>();
+        assert_eq!(bvh.len(), 100);
+        // The tree must be balanced.
+        assert!(bvh.height() <= 14);
+
+        let everything =
+            AxisAlignedBoundingBox::from_min_max(Vector3::repeat(-1000.0), Vector3::repeat(1000.0));
+        assert_eq!(collect(&bvh, &everything), (0..100).collect::<Vec<_>>());
+
+        let region = AxisAlignedBoundingBox::from_min_max(
+            Vector3::new(9.0, -1.0, -1.0),
+            Vector3::new(13.0, 1.0, 1.0),
+        );
+        assert_eq!(collect(&bvh, &region), vec![5, 6]);
+
+        for (i, proxy) in proxies.iter().enumerate() {
+            if i % 2 == 0 {
+                assert_eq!(bvh.remove(*proxy), Some(i));
+            }
+        }
+        assert_eq!(bvh.len(), 50);
+        assert_eq!(bvh.remove(proxies[0]), None);
+        assert_eq!(collect(&bvh, &region), vec![5]);
+        assert_eq!(
+            collect(&bvh, &everything),
+            (0..100).filter(|i| i % 2 != 0).collect::<Vec<_>>()
+        );
+    }
+
+    #[test]
+    fn test_bvh_move() {
+        let mut bvh = DynamicBvh::new();
+        let a = bvh.insert(cube(Vector3::default()), 0);
+        let _ = bvh.insert(cube(Vector3::new(10.0, 0.0, 0.0)), 1);
+
+        // Small movement stays inside the fat bounding box.
+        assert!(!bvh.move_proxy(a, cube(Vector3::new(0.01, 0.0, 0.0))));
+
+        assert!(bvh.move_proxy(a, cube(Vector3::new(20.0, 0.0, 0.0))));
+        assert_eq!(
+            collect(&bvh, &cube(Vector3::default())),
+            Vec::<usize>::new()
+        );
+        assert_eq!(collect(&bvh, &cube(Vector3::new(20.0, 0.0, 0.0))), vec![0]);
+
+        let mut hits = Vec::new();
+        bvh.ray_query(
+            &Ray::from_two_points(Vector3::new(-5.0, 0.0, 0.0), Vector3::new(15.0, 0.0, 0.0)),
+            |_, data| hits.push(*data),
+        );
+        assert_eq!(hits, vec![1]);
+
+        let mut hits = Vec::new();
+        bvh.sphere_query(Vector3::new(21.0, 0.0, 0.0), 1.0, |_, data| {
+            hits.push(*data)
+        });
+        assert_eq!(hits, vec![0]);
+    }
+}
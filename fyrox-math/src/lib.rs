@@ -2,6 +2,7 @@
 #![allow(clippy::many_single_char_names)]
 
 pub mod aabb;
+pub mod bvh;
 pub mod curve;
 pub mod frustum;
 pub mod octree;
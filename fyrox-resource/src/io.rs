@@ -33,6 +33,19 @@ pub trait ResourceIo: Send + Sync + 'static {
         dest: &'a Path,
     ) -> ResourceIoFuture<'a, Result<(), FileLoadError>>;
 
+    /// Attempts to write the given data to a file at the given path, creating all missing parent
+    /// directories. Not every IO provider is writable (archives, web, etc.), so the default
+    /// implementation returns an error.
+    fn write_file<'a>(
+        &'a self,
+        #[allow(unused)] path: &'a Path,
+        #[allow(unused)] data: Vec<u8>,
+    ) -> ResourceIoFuture<'a, Result<(), FileLoadError>> {
+        Box::pin(ready(Err(FileLoadError::Custom(
+            "Writing is not supported!".to_string(),
+        ))))
+    }
+
     /// Tries to convert the path to its canonical form (normalize it in other terms). This method
     /// should guarantee correct behaviour for relative paths. Symlinks aren't mandatory to
     /// follow.
@@ -131,6 +144,20 @@ impl ResourceIo for FsResourceIo {
         })
     }
 
+    fn write_file<'a>(
+        &'a self,
+        path: &'a Path,
+        data: Vec<u8>,
+    ) -> ResourceIoFuture<'a, Result<(), FileLoadError>> {
+        Box::pin(async move {
+            if let Some(parent) = path.parent() {
+                std::fs::create_dir_all(parent)?;
+            }
+            std::fs::write(path, data)?;
+            Ok(())
+        })
+    }
+
     fn canonicalize_path<'a>(
         &'a self,
         path: &'a Path,
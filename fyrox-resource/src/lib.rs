@@ -41,6 +41,7 @@ pub mod io;
 pub mod loader;
 pub mod manager;
 pub mod options;
+pub mod registry;
 pub mod state;
 pub mod untyped;
 
@@ -20,6 +20,7 @@ use crate::{
     io::{FsResourceIo, ResourceIo},
     loader::{ResourceLoader, ResourceLoadersContainer},
     options::OPTIONS_EXTENSION,
+    registry::ResourceRegistry,
     state::{LoadError, ResourceState},
     Resource, ResourceData, TypedResourceData, UntypedResource,
 };
@@ -28,6 +29,7 @@ use rayon::prelude::*;
 use std::{
     fmt::{Debug, Display, Formatter},
     marker::PhantomData,
+    ops::Deref,
     path::{Path, PathBuf},
     sync::Arc,
 };
@@ -53,6 +55,58 @@ impl ResourceWaitContext {
     }
 }
 
+/// A set of built-in resources of a resource manager. Built-in resources take precedence over any
+/// other resources with the same path. The set could be read as a regular hash map, but could be
+/// changed only using its own methods, so the resource manager could find registered resources
+/// without locking its state and still respect the precedence.
+pub struct BuiltInResources {
+    resources: FxHashMap<PathBuf, UntypedResource>,
+    registry: Arc<ResourceRegistry>,
+}
+
+impl Deref for BuiltInResources {
+    type Target = FxHashMap<PathBuf, UntypedResource>;
+
+    fn deref(&self) -> &Self::Target {
+        &self.resources
+    }
+}
+
+impl BuiltInResources {
+    fn new(registry: Arc<ResourceRegistry>) -> Self {
+        Self {
+            resources: Default::default(),
+            registry,
+        }
+    }
+
+    fn sync_registry(&self) {
+        self.registry
+            .set_built_in_paths(self.resources.keys().cloned());
+    }
+
+    /// Adds a new built-in resource with the given path. Returns the previous resource with the same
+    /// path, if any.
+    pub fn insert(&mut self, path: PathBuf, resource: UntypedResource) -> Option<UntypedResource> {
+        let previous = self.resources.insert(path, resource);
+        self.sync_registry();
+        previous
+    }
+
+    /// Removes a built-in resource with the given path.
+    pub fn remove(&mut self, path: &Path) -> Option<UntypedResource> {
+        let resource = self.resources.remove(path);
+        self.sync_registry();
+        resource
+    }
+
+    /// Removes all built-in resources.
+    pub fn clear(&mut self) {
+        self.resources.clear();
+        self.sync_registry();
+    }
+}
+
 /// See module docs.
 pub struct ResourceManagerState {
     /// A set of resource loaders. Use this field to register your own resource loader.
@@ -62,11 +116,12 @@ pub struct ResourceManagerState {
     /// A container for resource constructors.
     pub constructors_container: ResourceConstructorContainer,
     /// A set of built-in resources, that will be used to resolve references on deserialization.
-    pub built_in_resources: FxHashMap<PathBuf, UntypedResource>,
+    pub built_in_resources: BuiltInResources,
     /// The resource acccess interface
     pub resource_io: Arc<dyn ResourceIo>,
 
     resources: Vec<TimedEntry<UntypedResource>>,
+    registry: Arc<ResourceRegistry>,
     task_pool: Arc<TaskPool>,
     watcher: Option<FileSystemWatcher>,
 }
@@ -75,6 +130,8 @@ pub struct ResourceManagerState {
 #[derive(Clone)]
 pub struct ResourceManager {
     state: Arc<Mutex<ResourceManagerState>>,
+    // Shared with the state, allows finding registered resources without locking the state.
+    registry: Arc<ResourceRegistry>,
 }
 
 /// An error that may occur during texture registration.
@@ -107,8 +164,10 @@ impl Display for ResourceRegistrationError {
 impl ResourceManager {
     /// Creates a resource manager with default settings and loaders.
     pub fn new(task_pool: Arc<TaskPool>) -> Self {
+        let state = ResourceManagerState::new(task_pool);
         Self {
-            state: Arc::new(Mutex::new(ResourceManagerState::new(task_pool))),
+            registry: state.registry.clone(),
+            state: Arc::new(Mutex::new(state)),
         }
     }
 
@@ -158,7 +217,7 @@ impl ResourceManager {
     where
         T: TypedResourceData,
     {
-        let untyped = self.state().request(path);
+        let untyped = self.request_untyped(path);
         let actual_type_uuid = untyped.type_uuid();
         assert_eq!(actual_type_uuid, <T as TypeUuidProvider>::type_uuid());
         Resource {
@@ -177,7 +236,7 @@ impl ResourceManager {
     where
         T: TypedResourceData,
     {
-        let untyped = self.state().request(path);
+        let untyped = self.request_untyped(path);
         let actual_type_uuid = untyped.type_uuid();
         if actual_type_uuid == <T as TypeUuidProvider>::type_uuid() {
             Some(Resource {
@@ -194,6 +253,15 @@ impl ResourceManager {
     where
         P: AsRef<Path>,
     {
+        // Fast path for already registered resources, it does not lock the state, so concurrent
+        // requests (for example from loading tasks) do not block each other. Built-in resources take
+        // precedence, they're handled by the state.
+        if !self.registry.is_built_in(path.as_ref()) {
+            if let Some(resource) = self.registry.find(path.as_ref()) {
+                return resource;
+            }
+        }
+
         self.state().request(path)
     }
 
@@ -349,14 +417,16 @@ impl ResourceManager {
 
 impl ResourceManagerState {
     pub(crate) fn new(task_pool: Arc<TaskPool>) -> Self {
+        let registry = ResourceRegistry::new_shared();
         Self {
             resources: Default::default(),
+            built_in_resources: BuiltInResources::new(registry.clone()),
+            registry,
             task_pool,
             loaders: Default::default(),
             event_broadcaster: Default::default(),
             constructors_container: Default::default(),
             watcher: None,
-            built_in_resources: Default::default(),
             // Use the file system resource io by default
             resource_io: Arc::new(FsResourceIo),
         }
@@ -409,6 +479,17 @@ impl ResourceManagerState {
             if resource.value.use_count() <= 1 {
                 resource.time_to_live -= dt;
                 if resource.time_to_live <= 0.0 {
+                    self.registry.remove(&resource.value);
+
+                    // The resource could be shared again by the lock-free path of
+                    // `ResourceManager::request` right before it was removed from the registry.
+                    // Any such request is finished at this point, so the check is reliable.
+                    if resource.value.use_count() > 1 {
+                        self.registry.insert(&resource.value);
+                        resource.time_to_live = DEFAULT_RESOURCE_LIFETIME;
+                        return true;
+                    }
+
                     if let Some(path) = resource.0.lock().kind.path_owned() {
                         Log::info(format!(
                             "Resource {} destroyed because it is not used anymore!",
@@ -458,6 +539,8 @@ impl ResourceManagerState {
         self.event_broadcaster
             .broadcast(ResourceEvent::Added(resource.clone()));
 
+        self.registry.insert(&resource);
+
         self.resources.push(TimedEntry {
             value: resource,
             time_to_live: DEFAULT_RESOURCE_LIFETIME,
@@ -468,16 +551,26 @@ impl ResourceManagerState {
     ///
     /// # Complexity
     ///
-    /// O(n)
-    pub fn find<P: AsRef<Path>>(&self, path: P) -> Option<&UntypedResource> {
-        for resource in self.resources.iter() {
-            if let Some(resource_path) = resource.0.lock().kind.path() {
-                if resource_path == path.as_ref() {
-                    return Some(&resource.value);
-                }
+    /// O(1), the search is done using [`ResourceRegistry`]. It could be O(n) if the registry is
+    /// outdated (a path of some resource was changed) and must be rebuilt.
+    pub fn find<P: AsRef<Path>>(&self, path: P) -> Option<UntypedResource> {
+        if !self.registry.is_up_to_date() {
+            self.rebuild_registry();
+        }
+        match self.registry.find(path.as_ref()) {
+            Some(resource) => Some(resource),
+            None if !self.registry.is_up_to_date() => {
+                // Found a stale entry, rebuild the registry and try again.
+                self.rebuild_registry();
+                self.registry.find(path.as_ref())
             }
+            None => None,
         }
-        None
+    }
+
+    fn rebuild_registry(&self) {
+        self.registry
+            .rebuild(self.resources.iter().map(|entry| &entry.value));
     }
 
     /// Returns total amount of resources in the container.
@@ -497,8 +590,14 @@ impl ResourceManagerState {
 
     /// Immediately destroys all resources in the manager that are not used anywhere else.
     pub fn destroy_unused_resources(&mut self) {
-        self.resources
-            .retain(|resource| resource.value.use_count() > 1);
+        self.resources.retain(|resource| {
+            if resource.value.use_count() > 1 {
+                true
+            } else {
+                self.registry.remove(&resource.value);
+                false
+            }
+        });
     }
 
     /// Returns total amount of resources that still loading.
@@ -538,7 +637,7 @@ impl ResourceManagerState {
         }
 
         match self.find(path.as_ref()) {
-            Some(existing) => existing.clone(),
+            Some(existing) => existing,
             None => {
                 let path = path.as_ref().to_owned();
                 let kind = ResourceKind::External(path.clone());
@@ -661,7 +760,7 @@ impl ResourceManagerState {
 
     /// Tries to reload a resource at the given path.
     pub fn try_reload_resource_from_path(&mut self, path: &Path) -> bool {
-        if let Some(resource) = self.find(path).cloned() {
+        if let Some(resource) = self.find(path) {
             self.reload_resource(resource);
             true
         } else {
@@ -677,7 +776,8 @@ impl ResourceManagerState {
             .iter()
             .position(|r| r.kind().path() == Some(path))
         {
-            self.resources.remove(position);
+            let entry = self.resources.remove(position);
+            self.registry.remove(&entry.value);
         }
     }
 }
@@ -843,7 +943,7 @@ mod test {
         let resource = UntypedResource::new_pending(path.clone().into(), type_uuid);
         state.push(resource.clone());
 
-        assert_eq!(state.find(path), Some(&resource));
+        assert_eq!(state.find(path), Some(resource));
     }
 
     #[test]
@@ -981,6 +1081,30 @@ mod test {
         assert_eq!(res, resource);
     }
 
+    #[test]
+    fn resource_manager_request_built_in_precedence() {
+        let manager = ResourceManager::new(Arc::new(Default::default()));
+        let resource = UntypedResource::new_ok(Default::default(), Stub {});
+        let res = manager.register(resource.clone(), PathBuf::from("foo.txt"), |_, __| true);
+        assert!(res.is_ok());
+        assert_eq!(manager.request_untyped(Path::new("foo.txt")), resource);
+
+        // Built-in resources take precedence over registered ones, regardless of the registry.
+        let built_in = UntypedResource::new_ok(PathBuf::from("foo.txt").into(), Stub {});
+        manager
+            .state()
+            .built_in_resources
+            .insert(PathBuf::from("foo.txt"), built_in.clone());
+        assert_eq!(manager.request_untyped(Path::new("foo.txt")), built_in);
+        assert_eq!(manager.state().request(Path::new("foo.txt")), built_in);
+
+        manager
+            .state()
+            .built_in_resources
+            .remove(Path::new("foo.txt"));
+        assert_eq!(manager.request_untyped(Path::new("foo.txt")), resource);
+    }
+
     #[test]
     fn display_for_resource_registration_error() {
         assert_eq!(
@@ -0,0 +1,270 @@
+//! Hash index of registered resources. See [`ResourceRegistry`] docs for more info.
+
+use crate::{
+    core::parking_lot::{const_mutex, Mutex, RwLock},
+    untyped::{ResourceHeader, ResourceKind, UntypedResource},
+};
+use fxhash::{FxHashMap, FxHashSet, FxHasher};
+use std::{
+    hash::{Hash, Hasher},
+    path::{Path, PathBuf},
+    sync::{
+        atomic::{AtomicBool, AtomicUsize, Ordering},
+        Arc, Weak,
+    },
+};
+
+/// Amount of independently locked parts of the registry.
+const SHARD_COUNT: usize = 16;
+
+// Registries of all resource managers. Only the registries that contain a resource are updated when
+// its path is changed via `UntypedResource::set_kind`.
+static REGISTRIES: Mutex<Vec<Weak<ResourceRegistry>>> = const_mutex(Vec::new());
+
+/// Updates the registries that contain the given resource, must be called when a path of a resource
+/// is changed.
+pub(crate) fn notify_kind_changed(resource: &UntypedResource, old_kind: &ResourceKind) {
+    let registries = REGISTRIES
+        .lock()
+        .iter()
+        .filter_map(|registry| registry.upgrade())
+        .collect::<Vec<_>>();
+    for registry in registries {
+        registry.on_kind_changed(resource, old_kind.path());
+    }
+}
+
+type Shard = RwLock<FxHashMap<PathBuf, Weak<Mutex<ResourceHeader>>>>;
+
+/// Path-to-resource hash index of the resources registered in a resource manager. It makes the search
+/// of already registered resources `O(1)` instead of `O(n)`. The index is split into a number of
+/// shards with their own locks, so concurrent requests of different resources do not block each
+/// other and do not need to lock the entire resource manager state.
+///
+/// The registry holds weak references, so it does not affect the lifetime of resources. Paths of
+/// resources could be changed via [`UntypedResource::set_kind`], such changes are applied to every
+/// shared registry (see [`Self::new_shared`]) that contains the resource. Every search also checks
+/// that the found resource still has the requested path, so stale entries are never returned.
+///
+/// The registry also keeps the paths of built-in resources of the resource manager, so the searches
+/// that bypass the resource manager could respect their precedence.
+pub struct ResourceRegistry {
+    shards: Box<[Shard]>,
+    // Keys of all registered resources, including the ones without a path and duplicates.
+    members: Mutex<FxHashSet<usize>>,
+    built_in_paths: RwLock<FxHashSet<PathBuf>>,
+    outdated: AtomicBool,
+    // Amount of registered resources that have the same path as some other resource.
+    duplicates: AtomicUsize,
+}
+
+impl Default for ResourceRegistry {
+    fn default() -> Self {
+        Self {
+            shards: (0..SHARD_COUNT).map(|_| Default::default()).collect(),
+            members: Default::default(),
+            built_in_paths: Default::default(),
+            outdated: AtomicBool::new(false),
+            duplicates: AtomicUsize::new(0),
+        }
+    }
+}
+
+fn path_of(header: &Mutex<ResourceHeader>) -> Option<PathBuf> {
+    header.lock().kind.path_owned()
+}
+
+impl ResourceRegistry {
+    fn shard(&self, path: &Path) -> &Shard {
+        let mut hasher = FxHasher::default();
+        path.hash(&mut hasher);
+        &self.shards[hasher.finish() as usize % SHARD_COUNT]
+    }
+
+    /// Creates a new registry, that will be kept up-to-date when a path of any of its resources is
+    /// changed via [`UntypedResource::set_kind`].
+    pub fn new_shared() -> Arc<Self> {
+        let registry = Arc::new(Self::default());
+        let mut registries = REGISTRIES.lock();
+        registries.retain(|registry| registry.strong_count() > 0);
+        registries.push(Arc::downgrade(&registry));
+        registry
+    }
+
+    /// Returns `true` if the registry contains every registered resource.
+    pub fn is_up_to_date(&self) -> bool {
+        !self.outdated.load(Ordering::Relaxed)
+    }
+
+    /// Returns `true` if the given path is a path of a built-in resource.
+    pub fn is_built_in(&self, path: &Path) -> bool {
+        self.built_in_paths.read().contains(path)
+    }
+
+    pub(crate) fn set_built_in_paths(&self, paths: impl Iterator<Item = PathBuf>) {
+        let mut built_in_paths = self.built_in_paths.write();
+        built_in_paths.clear();
+        built_in_paths.extend(paths);
+    }
+
+    /// Tries to find a resource by its path.
+    ///
+    /// # Complexity
+    ///
+    /// O(1)
+    pub fn find(&self, path: &Path) -> Option<UntypedResource> {
+        let header = self.shard(path).read().get(path)?.upgrade()?;
+        if path_of(&header).as_deref() == Some(path) {
+            Some(UntypedResource(header))
+        } else {
+            // The path was changed bypassing `UntypedResource::set_kind`.
+            self.outdated.store(true, Ordering::Relaxed);
+            None
+        }
+    }
+
+    pub(crate) fn insert(&self, resource: &UntypedResource) {
+        self.members.lock().insert(resource.key());
+        self.index(resource);
+    }
+
+    fn index(&self, resource: &UntypedResource) {
+        let Some(path) = resource.kind().into_path() else {
+            return;
+        };
+        let mut shard = self.shard(&path).write();
+        let existing = shard.get(&path).and_then(|existing| existing.upgrade());
+        match existing {
+            Some(existing) if Arc::ptr_eq(&existing, &resource.0) => (),
+            // The first registered resource wins, this matches the order of the linear search.
+            Some(existing) if path_of(&existing).as_deref() == Some(path.as_path()) => {
+                self.duplicates.fetch_add(1, Ordering::Relaxed);
+            }
+            _ => {
+                shard.insert(path, Arc::downgrade(&resource.0));
+            }
+        }
+    }
+
+    pub(crate) fn remove(&self, resource: &UntypedResource) {
+        self.members.lock().remove(&resource.key());
+        if let Some(path) = resource.kind().path() {
+            self.unindex(path, resource);
+        }
+    }
+
+    fn unindex(&self, path: &Path, resource: &UntypedResource) {
+        let mut shard = self.shard(path).write();
+        if shard.get(path).map_or(false, |existing| {
+            existing.as_ptr() == Arc::as_ptr(&resource.0)
+        }) {
+            shard.remove(path);
+            // Other resource with the same path must be found by a full rebuild.
+            if self.duplicates.load(Ordering::Relaxed) > 0 {
+                self.outdated.store(true, Ordering::Relaxed);
+            }
+        }
+    }
+
+    fn on_kind_changed(&self, resource: &UntypedResource, old_path: Option<&Path>) {
+        if !self.members.lock().contains(&resource.key()) {
+            return;
+        }
+        if let Some(old_path) = old_path {
+            self.unindex(old_path, resource);
+        }
+        self.index(resource);
+    }
+
+    pub(crate) fn rebuild<'a>(&self, resources: impl Iterator<Item = &'a UntypedResource>) {
+        // Reset the flag first, so any concurrent invalidation will cause another rebuild.
+        self.outdated.store(false, Ordering::Relaxed);
+        self.clear();
+        for resource in resources {
+            self.insert(resource);
+        }
+    }
+
+    pub(crate) fn clear(&self) {
+        self.members.lock().clear();
+        for shard in self.shards.iter() {
+            shard.write().clear();
+        }
+        self.duplicates.store(0, Ordering::Relaxed);
+    }
+}
+
+#[cfg(test)]
+mod test {
+    use super::*;
+    use crate::core::uuid::Uuid;
+    use crate::untyped::ResourceKind;
+
+    fn resource(path: &str) -> UntypedResource {
+        UntypedResource::new_pending(PathBuf::from(path).into(), Uuid::default())
+    }
+
+    #[test]
+    fn resource_registry_find() {
+        let registry = ResourceRegistry::default();
+        let a = resource("a.txt");
+        let b = resource("b.txt");
+        let duplicate = resource("a.txt");
+        registry.insert(&a);
+        registry.insert(&b);
+        registry.insert(&duplicate);
+        registry.insert(&UntypedResource::new_pending(
+            ResourceKind::Embedded,
+            Uuid::default(),
+        ));
+
+        assert_eq!(registry.find(Path::new("a.txt")), Some(a.clone()));
+        assert_eq!(registry.find(Path::new("b.txt")), Some(b.clone()));
+        assert_eq!(registry.find(Path::new("c.txt")), None);
+
+        // Registry must not keep resources alive.
+        assert_eq!(b.use_count(), 1);
+        drop(b);
+        assert_eq!(registry.find(Path::new("b.txt")), None);
+
+        registry.remove(&a);
+        assert_eq!(registry.find(Path::new("a.txt")), None);
+        assert!(!registry.is_up_to_date());
+        registry.rebuild([&duplicate].into_iter());
+        assert_eq!(registry.find(Path::new("a.txt")), Some(duplicate.clone()));
+
+        // The registry is not shared, so it is not notified about the path change.
+        duplicate.set_kind(PathBuf::from("d.txt").into());
+        assert_eq!(registry.find(Path::new("a.txt")), None);
+        assert!(!registry.is_up_to_date());
+        registry.rebuild([&duplicate].into_iter());
+        assert_eq!(registry.find(Path::new("d.txt")), Some(duplicate));
+    }
+
+    #[test]
+    fn resource_registry_kind_change() {
+        let registry = ResourceRegistry::new_shared();
+        let other_registry = ResourceRegistry::new_shared();
+        let a = resource("a.txt");
+        let b = resource("b.txt");
+        let embedded = UntypedResource::new_pending(ResourceKind::Embedded, Uuid::default());
+        registry.insert(&a);
+        registry.insert(&embedded);
+        other_registry.insert(&b);
+
+        // Only the registry that contains the resource is updated, no rebuild is needed.
+        a.set_kind(PathBuf::from("c.txt").into());
+        embedded.set_kind(PathBuf::from("e.txt").into());
+        assert!(registry.is_up_to_date());
+        assert!(other_registry.is_up_to_date());
+        assert_eq!(registry.find(Path::new("a.txt")), None);
+        assert_eq!(registry.find(Path::new("c.txt")), Some(a.clone()));
+        assert_eq!(registry.find(Path::new("e.txt")), Some(embedded));
+        assert_eq!(other_registry.find(Path::new("c.txt")), None);
+        assert_eq!(other_registry.find(Path::new("b.txt")), Some(b));
+
+        registry.remove(&a);
+        a.set_kind(PathBuf::from("f.txt").into());
+        assert_eq!(registry.find(Path::new("f.txt")), None);
+    }
+}
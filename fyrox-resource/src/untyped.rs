@@ -7,6 +7,7 @@ use crate::{
         parking_lot::Mutex, reflect::prelude::*, uuid::Uuid, visitor::prelude::*, TypeUuidProvider,
     },
     manager::ResourceManager,
+    registry,
     state::{LoadError, ResourceState},
     Resource, ResourceData, ResourceLoadError, TypedResourceData, CURVE_RESOURCE_UUID,
     MODEL_RESOURCE_UUID, SHADER_RESOURCE_UUID, SOUND_BUFFER_RESOURCE_UUID, TEXTURE_RESOURCE_UUID,
@@ -366,7 +367,8 @@ impl UntypedResource {
 
     /// Set a new path for the untyped resource.
     pub fn set_kind(&self, new_kind: ResourceKind) {
-        self.0.lock().kind = new_kind;
+        let old_kind = std::mem::replace(&mut self.0.lock().kind, new_kind);
+        registry::notify_kind_changed(self, &old_kind);
     }
 
     /// Tries to cast untyped resource to a particular type.
@@ -1,7 +1,10 @@
 //! Everything related to audio buses and audio bus graphs. See docs of [`AudioBus`] and [`AudioBusGraph`]
 //! for more info and examples
 
-use crate::effects::{Effect, EffectRenderTrait};
+use crate::{
+    effects::{Effect, EffectRenderTrait},
+    renderer::mix_with_gain,
+};
 use fyrox_core::{
     pool::{Handle, Pool, Ticket},
     reflect::prelude::*,
@@ -347,14 +350,33 @@ impl AudioBusGraph {
         self.buses[parent].child_buses.push(child);
     }
 
-    pub(crate) fn try_get_bus_input_buffer(&mut self, name: &str) -> Option<&mut [(f32, f32)]> {
-        self.buses.iter_mut().find_map(|bus| {
-            if bus.name == name {
-                Some(bus.input_buffer())
-            } else {
-                None
-            }
-        })
+    /// Searches for an audio bus with the given name. The `cached` handle is checked first, so if
+    /// the handle is the result of a previous search, the search is just a single name comparison.
+    pub(crate) fn find_bus(
+        &self,
+        name: &str,
+        cached: Handle<AudioBus>,
+    ) -> Option<Handle<AudioBus>> {
+        if self
+            .buses
+            .try_borrow(cached)
+            .map_or(false, |bus| bus.name == name)
+        {
+            return Some(cached);
+        }
+
+        self.buses
+            .pair_iter()
+            .find_map(|(handle, bus)| if bus.name == name { Some(handle) } else { None })
+    }
+
+    pub(crate) fn try_get_bus_input_buffer(
+        &mut self,
+        handle: Handle<AudioBus>,
+    ) -> Option<&mut [(f32, f32)]> {
+        self.buses
+            .try_borrow_mut(handle)
+            .map(|bus| bus.input_buffer())
     }
 
     /// Removes an audio bus at the given handle.
@@ -483,12 +505,7 @@ impl AudioBusGraph {
                     .map(|parent| parent.ping_pong_buffer.input_mut())
                     // Special case for the root bus - it writes directly to the output device buffer.
                     .unwrap_or(&mut *output_device_buffer);
-                for ((input_left, input_right), (output_left, output_right)) in
-                    input_buffer.iter().zip(output_buffer)
-                {
-                    *output_left += *input_left * leaf_gain;
-                    *output_right += *input_right * leaf_gain;
-                }
+                mix_with_gain(output_buffer, input_buffer, leaf_gain, leaf_gain);
 
                 leaf = leaf_ref.parent_bus;
             }
@@ -10,11 +10,11 @@
 //! once the level is loaded you just set master gain of main menu context and it will no longer produce any
 //! sounds, only your level will do.
 
-use crate::bus::AudioBusGraph;
+use crate::bus::{AudioBus, AudioBusGraph};
 use crate::{
     listener::Listener,
     pool::Ticket,
-    renderer::{render_source_default, Renderer},
+    renderer::{hrtf::HrtfRenderer, mix_with_gain, render_source_default, Renderer},
     source::{SoundSource, Status},
 };
 use fyrox_core::{
@@ -23,7 +23,9 @@ use fyrox_core::{
     uuid_provider,
     visitor::prelude::*,
 };
+use rayon::{prelude::*, ThreadPool};
 use std::{
+    fmt::{Debug, Formatter},
     sync::{Arc, Mutex, MutexGuard},
     time::Duration,
 };
@@ -108,6 +110,66 @@ pub struct SerializationOptions {
     pub skip_bus_graph: bool,
 }
 
+/// A set of parameters of the voice manager of a sound context. Each playing sound source is a voice.
+/// There are two kinds of voices: real and virtual. Real voices are fully rendered, while virtual ones
+/// are not rendered at all - only their playback position is advanced. Every frame, the playing sources
+/// are ranked by their priority (see [`SoundSource::set_priority`]) and audibility (which is defined by
+/// gain and distance attenuation), then the first [`Self::max_real_voices`] audible sources are rendered
+/// and the rest is virtualized. A virtual voice becomes real again as soon as it ranks high enough.
+#[derive(Clone, Debug, PartialEq, Reflect, Visit)]
+pub struct VoiceSettings {
+    /// Maximum amount of real (rendered) voices. Default is [`usize::MAX`] (unlimited).
+    pub max_real_voices: usize,
+    /// Audibility threshold below which a voice is virtualized regardless of the voice limit.
+    /// Audibility is a product of the gain and the distance gain of a sound source. Default is
+    /// [`VoiceSettings::DEFAULT_VIRTUALIZATION_THRESHOLD`].
+    #[reflect(min_value = 0.0)]
+    pub virtualization_threshold: f32,
+}
+
+impl VoiceSettings {
+    /// Default audibility threshold, it is roughly -80 dB, which is inaudible.
+    pub const DEFAULT_VIRTUALIZATION_THRESHOLD: f32 = 1.0e-4;
+}
+
+impl Default for VoiceSettings {
+    fn default() -> Self {
+        Self {
+            max_real_voices: usize::MAX,
+            virtualization_threshold: Self::DEFAULT_VIRTUALIZATION_THRESHOLD,
+        }
+    }
+}
+
+/// Minimal amount of playing sound sources at which a context starts rendering them on multiple threads.
+/// Rendering of a few sources on a single thread is faster, because of synchronization overhead.
+pub const PARALLEL_RENDERING_THRESHOLD: usize = 32;
+
+/// Minimal amount of sound sources rendered by a single worker thread.
+const MIN_SOURCES_PER_WORKER: usize = 8;
+
+/// A set of per-bus buffers, that is used by a worker thread to mix its share of the sound sources.
+#[derive(Default, Clone)]
+struct PartialMix {
+    buffers: Vec<Vec<(f32, f32)>>,
+}
+
+impl Debug for PartialMix {
+    fn fmt(&self, f: &mut Formatter<'_>) -> std::fmt::Result {
+        write!(f, "PartialMix({} buffers)", self.buffers.len())
+    }
+}
+
+impl PartialMix {
+    fn prepare(&mut self, bus_count: usize, buffer_len: usize) {
+        self.buffers.resize_with(bus_count, Default::default);
+        for buffer in self.buffers.iter_mut() {
+            buffer.clear();
+            buffer.resize(buffer_len, (0.0, 0.0));
+        }
+    }
+}
+
 /// Internal state of context.
 #[derive(Default, Debug, Clone, Reflect)]
 pub struct State {
@@ -122,6 +184,15 @@ pub struct State {
     /// serialization of a sound context.
     #[reflect(hidden)]
     pub serialization_options: SerializationOptions,
+    #[reflect(hidden)]
+    parallel_rendering: bool,
+    #[reflect(hidden)]
+    partial_mixes: Vec<PartialMix>,
+    voice_settings: VoiceSettings,
+    #[reflect(hidden)]
+    real_voice_count: usize,
+    #[reflect(hidden)]
+    virtual_voice_count: usize,
 }
 
 impl State {
@@ -174,6 +245,39 @@ impl State {
         f / SAMPLE_RATE as f32
     }
 
+    /// Enables or disables parallel rendering of sound sources (disabled by default). When enabled,
+    /// the sources are rendered on a small thread pool owned by the sound engine, if there's at least
+    /// [`PARALLEL_RENDERING_THRESHOLD`] playing sources. Each thread mixes its share of the sources
+    /// into its own set of buffers, which are then summed into respective audio buses.
+    pub fn set_parallel_rendering(&mut self, enabled: bool) {
+        self.parallel_rendering = enabled;
+    }
+
+    /// Returns `true` if parallel rendering of sound sources is enabled, `false` - otherwise.
+    pub fn is_parallel_rendering_enabled(&self) -> bool {
+        self.parallel_rendering
+    }
+
+    /// Sets new voice settings. See [`VoiceSettings`] docs for more info.
+    pub fn set_voice_settings(&mut self, settings: VoiceSettings) -> VoiceSettings {
+        std::mem::replace(&mut self.voice_settings, settings)
+    }
+
+    /// Returns current voice settings.
+    pub fn voice_settings(&self) -> &VoiceSettings {
+        &self.voice_settings
+    }
+
+    /// Returns amount of playing sound sources, that were rendered during the last render call.
+    pub fn real_voice_count(&self) -> usize {
+        self.real_voice_count
+    }
+
+    /// Returns amount of playing sound sources, that were virtualized during the last render call.
+    pub fn virtual_voice_count(&self) -> usize {
+        self.virtual_voice_count
+    }
+
     /// Returns amount of time context spent on rendering all sound sources.
     pub fn full_render_duration(&self) -> Duration {
         self.render_duration
@@ -254,7 +358,11 @@ impl State {
         &mut self.bus_graph
     }
 
-    pub(crate) fn render(&mut self, output_device_buffer: &mut [(f32, f32)]) {
+    pub(crate) fn render(
+        &mut self,
+        output_device_buffer: &mut [(f32, f32)],
+        thread_pool: Option<&ThreadPool>,
+    ) {
         let last_time = fyrox_core::instant::Instant::now();
 
         if !self.paused {
@@ -263,36 +371,67 @@ impl State {
                 !done
             });
 
-            self.bus_graph.begin_render(output_device_buffer.len());
+            let buffer_len = output_device_buffer.len();
 
-            // Render sounds to respective audio buses.
+            self.bus_graph.begin_render(buffer_len);
+
+            // Find output audio buses first, cached bus handles make this very cheap.
+            let mut playing_sources = Vec::new();
             for source in self
                 .sources
                 .iter_mut()
                 .filter(|s| s.status() == Status::Playing)
             {
-                if let Some(bus_input_buffer) = self.bus_graph.try_get_bus_input_buffer(&source.bus)
-                {
-                    source.render(output_device_buffer.len());
-
-                    match self.renderer {
-                        Renderer::Default => {
-                            // Simple rendering path. Much faster (4-5 times) than HRTF path.
-                            render_source_default(
-                                source,
-                                &self.listener,
-                                self.distance_model,
-                                bus_input_buffer,
-                            );
-                        }
-                        Renderer::HrtfRenderer(ref mut hrtf_renderer) => {
-                            hrtf_renderer.render_source(
-                                source,
-                                &self.listener,
-                                self.distance_model,
-                                bus_input_buffer,
-                            );
-                        }
+                if let Some(bus) = self.bus_graph.find_bus(&source.bus, source.bus_handle) {
+                    source.bus_handle = bus;
+                    playing_sources.push(source);
+                }
+            }
+
+            let total_voice_count = playing_sources.len();
+            let playing_sources = select_real_voices(
+                playing_sources,
+                &self.listener,
+                self.distance_model,
+                &self.voice_settings,
+                buffer_len,
+            );
+            self.real_voice_count = playing_sources.len();
+            self.virtual_voice_count = total_voice_count - playing_sources.len();
+
+            // Render sounds to respective audio buses.
+            // The work is never sent to the global thread pool, it could be busy with anything else
+            // and the audio thread must not wait for it.
+            let thread_pool = thread_pool.filter(|thread_pool| {
+                self.parallel_rendering
+                    && playing_sources.len() >= PARALLEL_RENDERING_THRESHOLD
+                    && thread_pool.current_num_threads() > 1
+            });
+            if let Some(thread_pool) = thread_pool {
+                thread_pool.install(|| {
+                    render_sources_parallel(
+                        playing_sources,
+                        &mut self.renderer,
+                        &self.listener,
+                        self.distance_model,
+                        &mut self.bus_graph,
+                        &mut self.partial_mixes,
+                        buffer_len,
+                    )
+                });
+            } else {
+                for source in playing_sources {
+                    if let Some(bus_input_buffer) =
+                        self.bus_graph.try_get_bus_input_buffer(source.bus_handle)
+                    {
+                        source.render(buffer_len);
+
+                        self.renderer.render_source(
+                            source,
+                            &self.listener,
+                            self.distance_model,
+                            bus_input_buffer,
+                        );
                     }
                 }
             }
@@ -304,6 +443,133 @@ impl State {
     }
 }
 
+/// Ranks the given playing sources and returns the ones that should be rendered. The rest is virtualized
+/// and their playback position is advanced by the given amount of samples.
+fn select_real_voices<'a>(
+    sources: Vec<&'a mut SoundSource>,
+    listener: &Listener,
+    distance_model: DistanceModel,
+    settings: &VoiceSettings,
+    buffer_len: usize,
+) -> Vec<&'a mut SoundSource> {
+    let mut ranked = sources
+        .into_iter()
+        .map(|source| {
+            (
+                source.calculate_audibility(listener, distance_model),
+                source,
+            )
+        })
+        .collect::<Vec<_>>();
+
+    // Ranking is needed only if there's more voices than the limit.
+    if ranked.len() > settings.max_real_voices {
+        ranked.sort_by(|(a_audibility, a), (b_audibility, b)| {
+            b.priority()
+                .cmp(&a.priority())
+                .then(b_audibility.total_cmp(a_audibility))
+        });
+    }
+
+    let mut real_voices = Vec::with_capacity(ranked.len().min(settings.max_real_voices));
+    for (audibility, source) in ranked {
+        if audibility >= settings.virtualization_threshold
+            && real_voices.len() < settings.max_real_voices
+        {
+            source.devirtualize();
+            real_voices.push(source);
+        } else {
+            source.virtualize();
+            source.advance_virtual(buffer_len);
+        }
+    }
+    real_voices
+}
+
+fn render_sources_parallel(
+    sources: Vec<&mut SoundSource>,
+    renderer: &mut Renderer,
+    listener: &Listener,
+    distance_model: DistanceModel,
+    bus_graph: &mut AudioBusGraph,
+    partial_mixes: &mut Vec<PartialMix>,
+    buffer_len: usize,
+) {
+    // Map each used audio bus to a dense index of a buffer in partial mixes.
+    let mut buses: Vec<Handle<AudioBus>> = Vec::new();
+    let mut jobs = sources
+        .into_iter()
+        .map(|source| {
+            let bus_index = match buses.iter().position(|bus| *bus == source.bus_handle) {
+                Some(index) => index,
+                None => {
+                    buses.push(source.bus_handle);
+                    buses.len() - 1
+                }
+            };
+            (source, bus_index)
+        })
+        .collect::<Vec<_>>();
+
+    let worker_count = rayon::current_num_threads()
+        .min(jobs.len() / MIN_SOURCES_PER_WORKER)
+        .max(1);
+    let chunk_size = (jobs.len() + worker_count - 1) / worker_count;
+    let worker_count = (jobs.len() + chunk_size - 1) / chunk_size;
+
+    if partial_mixes.len() < worker_count {
+        partial_mixes.resize_with(worker_count, Default::default);
+    }
+    let partial_mixes = &mut partial_mixes[..worker_count];
+    for partial_mix in partial_mixes.iter_mut() {
+        partial_mix.prepare(buses.len(), buffer_len);
+    }
+
+    // HRTF processors have internal scratch buffers, so each worker needs its own processor.
+    let is_hrtf = matches!(renderer, Renderer::HrtfRenderer(_));
+    let mut processors = match renderer {
+        Renderer::Default => Vec::new(),
+        Renderer::HrtfRenderer(hrtf_renderer) => hrtf_renderer
+            .worker_processors(worker_count)
+            .iter_mut()
+            .map(Some)
+            .collect::<Vec<_>>(),
+    };
+    processors.resize_with(worker_count, || None);
+
+    jobs.par_chunks_mut(chunk_size)
+        .zip(partial_mixes.par_iter_mut())
+        .zip(processors.par_iter_mut())
+        .for_each(|((jobs, partial_mix), processor)| {
+            for (source, bus_index) in jobs.iter_mut() {
+                let mix_buffer = &mut partial_mix.buffers[*bus_index];
+
+                source.render(buffer_len);
+
+                if is_hrtf {
+                    HrtfRenderer::render_source_with(
+                        processor.as_deref_mut(),
+                        source,
+                        listener,
+                        distance_model,
+                        mix_buffer,
+                    );
+                } else {
+                    render_source_default(source, listener, distance_model, mix_buffer);
+                }
+            }
+        });
+
+    // Sum partial mixes in a fixed order, so the result does not depend on thread scheduling.
+    for partial_mix in partial_mixes.iter() {
+        for (bus, buffer) in buses.iter().zip(partial_mix.buffers.iter()) {
+            if let Some(bus_input_buffer) = bus_graph.try_get_bus_input_buffer(*bus) {
+                mix_with_gain(bus_input_buffer, buffer, 1.0, 1.0);
+            }
+        }
+    }
+}
+
 impl SoundContext {
     /// TODO: This is magic constant that gives 1024 + 1 number when summed with
     ///       HRTF length for faster FFT calculations. Find a better way of selecting this.
@@ -328,6 +594,11 @@ impl SoundContext {
                 distance_model: DistanceModel::InverseDistance,
                 paused: false,
                 serialization_options: Default::default(),
+                serial_rendering: false,
+                partial_mixes: Default::default(),
+                voice_settings: Default::default(),
+                real_voice_count: 0,
+                virtual_voice_count: 0,
             }))),
         }
     }
@@ -385,7 +656,115 @@ impl Visit for State {
         self.renderer.visit("Renderer", &mut region)?;
         self.paused.visit("Paused", &mut region)?;
         self.distance_model.visit("DistanceModel", &mut region)?;
+        let _ = self.voice_settings.visit("VoiceSettings", &mut region);
 
         Ok(())
     }
 }
+
+#[cfg(test)]
+mod test {
+    use crate::{
+        buffer::{DataSource, SoundBufferResource, SoundBufferResourceExtension},
+        context::{SoundContext, VoiceSettings, PARALLEL_RENDERING_THRESHOLD, SAMPLE_RATE},
+        engine::create_render_thread_pool,
+        source::{SoundSourceBuilder, Status},
+    };
+    use fyrox_core::algebra::Vector3;
+
+    fn make_context(source_count: usize, parallel: bool) -> SoundContext {
+        let context = SoundContext::new();
+        let mut state = context.state();
+        state.set_parallel_rendering(parallel);
+
+        let buffer = SoundBufferResource::new_generic(DataSource::Raw {
+            sample_rate: SAMPLE_RATE as usize,
+            channel_count: 1,
+            samples: (0..SAMPLE_RATE).map(|i| (i as f32 * 0.05).sin()).collect(),
+        })
+        .unwrap();
+
+        for i in 0..source_count {
+            state.add_source(
+                SoundSourceBuilder::new()
+                    .with_buffer(buffer.clone())
+                    .with_status(Status::Playing)
+                    .with_looping(true)
+                    .with_position(Vector3::new(i as f32, 0.0, (i % 7) as f32))
+                    .build()
+                    .unwrap(),
+            );
+        }
+
+        drop(state);
+        context
+    }
+
+    #[test]
+    fn test_parallel_rendering_matches_serial() {
+        // Parallel rendering is opt-in.
+        assert!(!SoundContext::new().state().is_parallel_rendering_enabled());
+
+        let source_count = PARALLEL_RENDERING_THRESHOLD * 4;
+        let serial = make_context(source_count, false);
+        let parallel = make_context(source_count, true);
+        let thread_pool = create_render_thread_pool();
+
+        for _ in 0..3 {
+            let mut serial_buffer = vec![(0.0, 0.0); SoundContext::SAMPLES_PER_CHANNEL];
+            serial
+                .state()
+                .render(&mut serial_buffer, thread_pool.as_ref());
+
+            let mut parallel_buffer = vec![(0.0, 0.0); SoundContext::SAMPLES_PER_CHANNEL];
+            parallel
+                .state()
+                .render(&mut parallel_buffer, thread_pool.as_ref());
+
+            for ((serial_left, serial_right), (parallel_left, parallel_right)) in
+                serial_buffer.into_iter().zip(parallel_buffer)
+            {
+                assert!((serial_left - parallel_left).abs() < 1.0e-3);
+                assert!((serial_right - parallel_right).abs() < 1.0e-3);
+            }
+        }
+    }
+
+    #[test]
+    fn test_voice_virtualization() {
+        let context = make_context(16, false);
+        let mut state = context.state();
+        state.set_voice_settings(VoiceSettings {
+            max_real_voices: 4,
+            ..Default::default()
+        });
+
+        let handles = state
+            .sources()
+            .pair_iter()
+            .map(|(h, _)| h)
+            .collect::<Vec<_>>();
+        let important = handles[15];
+        state.source_mut(important).set_priority(1);
+
+        let mut buffer = vec![(0.0, 0.0); SoundContext::SAMPLES_PER_CHANNEL];
+        state.render(&mut buffer, None);
+
+        assert_eq!(state.real_voice_count(), 4);
+        assert_eq!(state.virtual_voice_count(), 12);
+        assert!(!state.source(important).is_virtual());
+
+        // Virtual voices must keep their playback position in sync with the real ones.
+        for handle in handles {
+            let time = state.source(handle).playback_time().as_secs_f32();
+            let reference = state.source(important).playback_time().as_secs_f32();
+            assert!((time - reference).abs() < 1.0e-3);
+        }
+
+        // Lifting the limit must turn every voice back to real.
+        state.set_voice_settings(Default::default());
+        state.render(&mut buffer, None);
+        assert_eq!(state.real_voice_count(), 16);
+        assert_eq!(state.virtual_voice_count(), 0);
+    }
+}
@@ -5,9 +5,17 @@
 //! Sound engine manages contexts, feeds output device with data.
 
 use crate::context::{SoundContext, SAMPLE_RATE};
-use fyrox_core::visitor::{Visit, VisitResult, Visitor};
+use fyrox_core::{
+    log::Log,
+    visitor::{Visit, VisitResult, Visitor},
+};
+use rayon::{ThreadPool, ThreadPoolBuilder};
 use std::error::Error;
-use std::sync::{Arc, Mutex, MutexGuard};
+use std::sync::{Arc, Mutex, MutexGuard, OnceLock};
+
+/// Maximum amount of threads, that are used to render sound sources in parallel. See
+/// [`crate::context::State::set_parallel_rendering`] for more info.
+pub const MAX_RENDER_THREADS: usize = 4;
 
 /// Sound engine manages contexts, feeds output device with data. Sound engine instance can be cloned,
 /// however this is always a "shallow" clone, because actual sound engine data is wrapped in Arc.
@@ -24,6 +32,28 @@ impl Default for SoundEngine {
 pub struct State {
     contexts: Vec<SoundContext>,
     output_device: Option<Box<dyn tinyaudio::BaseAudioOutputDevice>>,
+    // Created on demand, when a context with parallel rendering is rendered for the first time.
+    thread_pool: OnceLock<Option<ThreadPool>>,
+}
+
+pub(crate) fn create_render_thread_pool() -> Option<ThreadPool> {
+    let thread_count = std::thread::available_parallelism()
+        .map_or(1, |count| count.get() / 2)
+        .clamp(1, MAX_RENDER_THREADS);
+    match ThreadPoolBuilder::new()
+        .num_threads(thread_count)
+        .thread_name(|index| format!("fyrox-sound-worker-{index}"))
+        .build()
+    {
+        Ok(thread_pool) => Some(thread_pool),
+        Err(err) => {
+            Log::err(format!(
+                "Unable to create a thread pool for sound rendering, sound sources will be \
+                rendered on a single thread. Reason: {err}"
+            ));
+            None
+        }
+    }
 }
 
 impl SoundEngine {
@@ -43,6 +73,7 @@ impl SoundEngine {
         Self(Arc::new(Mutex::new(State {
             contexts: Default::default(),
             output_device: None,
+            thread_pool: Default::default(),
         })))
     }
 
@@ -138,7 +169,15 @@ impl State {
 
     fn render_inner(&mut self, buf: &mut [(f32, f32)]) {
         for context in self.contexts.iter_mut() {
-            context.state().render(buf);
+            let mut state = context.state();
+            let thread_pool = if state.is_parallel_rendering_enabled() {
+                self.thread_pool
+                    .get_or_init(create_render_thread_pool)
+                    .as_ref()
+            } else {
+                None
+            };
+            state.render(buf, thread_pool);
         }
     }
 }
@@ -156,3 +195,64 @@ impl Visit for State {
         Ok(())
     }
 }
+
+#[cfg(test)]
+mod test {
+    use crate::{
+        buffer::{DataSource, SoundBufferResource, SoundBufferResourceExtension},
+        context::{SoundContext, SAMPLE_RATE},
+        engine::{SoundEngine, State},
+        source::{SoundSourceBuilder, Status},
+    };
+    use fyrox_core::{algebra::Vector3, instant::Instant};
+
+    #[ignore = "takes multiple seconds to run"]
+    #[test]
+    fn benchmark_render() {
+        let buffer = SoundBufferResource::new_generic(DataSource::Raw {
+            sample_rate: SAMPLE_RATE as usize,
+            channel_count: 1,
+            samples: (0..SAMPLE_RATE).map(|i| (i as f32 * 0.05).sin()).collect(),
+        })
+        .unwrap();
+
+        let block_count = 100;
+
+        for source_count in [16, 64, 256, 1024] {
+            for parallel in [false, true] {
+                let engine = SoundEngine::without_device();
+                let context = SoundContext::new();
+                engine.state().add_context(context.clone());
+
+                {
+                    let mut state = context.state();
+                    state.set_parallel_rendering(parallel);
+                    for i in 0..source_count {
+                        state.add_source(
+                            SoundSourceBuilder::new()
+                                .with_buffer(buffer.clone())
+                                .with_status(Status::Playing)
+                                .with_looping(true)
+                                .with_position(Vector3::new(i as f32, 0.0, 1.0))
+                                .build()
+                                .unwrap(),
+                        );
+                    }
+                }
+
+                let mut output = vec![(0.0, 0.0); State::render_buffer_len()];
+
+                let start = Instant::now();
+                for _ in 0..block_count {
+                    engine.state().render(&mut output);
+                }
+                let elapsed = start.elapsed();
+
+                println!(
+                    "{source_count} sources, parallel: {parallel} - {:?} per block",
+                    elapsed / block_count
+                );
+            }
+        }
+    }
+}
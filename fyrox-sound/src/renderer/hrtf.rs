@@ -83,6 +83,9 @@ pub struct HrtfRenderer {
     hrir_resource: Option<HrirSphereResource>,
     #[reflect(hidden)]
     processor: Option<hrtf::HrtfProcessor>,
+    // Copies of the main processor, that are used by worker threads when rendering sources in parallel.
+    #[reflect(hidden)]
+    worker_processors: Vec<hrtf::HrtfProcessor>,
 }
 
 impl Visit for HrtfRenderer {
@@ -108,6 +111,7 @@ impl HrtfRenderer {
                 SoundContext::HRTF_BLOCK_LEN,
             )),
             hrir_resource: Some(hrir_sphere_resource),
+            worker_processors: Default::default(),
         }
     }
 
@@ -116,6 +120,7 @@ impl HrtfRenderer {
     pub fn set_hrir_sphere_resource(&mut self, resource: Option<HrirSphereResource>) {
         self.hrir_resource = resource;
         self.processor = None;
+        self.worker_processors.clear();
     }
 
     /// Returns current HRIR sphere resource (if any).
@@ -123,13 +128,7 @@ impl HrtfRenderer {
         self.hrir_resource.clone()
     }
 
-    pub(crate) fn render_source(
-        &mut self,
-        source: &mut SoundSource,
-        listener: &Listener,
-        distance_model: DistanceModel,
-        out_buf: &mut [(f32, f32)],
-    ) {
+    fn ensure_processor(&mut self) {
         // Re-create HRTF processor on the fly only when a respective HRIR sphere resource is fully loaded.
         // This is a poor-man's async support for crippled OSes such as WebAssembly.
         if self.processor.is_none() {
@@ -144,7 +143,48 @@ impl HrtfRenderer {
                 }
             }
         }
+    }
+
+    /// Returns a set of processors for the given amount of worker threads. The set will be empty if
+    /// the HRIR sphere is not loaded yet.
+    pub(crate) fn worker_processors(&mut self, count: usize) -> &mut [hrtf::HrtfProcessor] {
+        self.ensure_processor();
+
+        if let Some(processor) = self.processor.as_ref() {
+            while self.worker_processors.len() < count {
+                self.worker_processors.push(processor.clone());
+            }
+            &mut self.worker_processors[..count]
+        } else {
+            &mut []
+        }
+    }
+
+    pub(crate) fn render_source(
+        &mut self,
+        source: &mut SoundSource,
+        listener: &Listener,
+        distance_model: DistanceModel,
+        out_buf: &mut [(f32, f32)],
+    ) {
+        self.ensure_processor();
 
+        Self::render_source_with(
+            self.processor.as_mut(),
+            source,
+            listener,
+            distance_model,
+            out_buf,
+        )
+    }
+
+    pub(crate) fn render_source_with(
+        processor: Option<&mut hrtf::HrtfProcessor>,
+        source: &mut SoundSource,
+        listener: &Listener,
+        distance_model: DistanceModel,
+        out_buf: &mut [(f32, f32)],
+    ) {
         // Render as 2D first with k = (1.0 - spatial_blend).
         render_source_2d_only(source, out_buf);
 
@@ -154,7 +194,7 @@ impl HrtfRenderer {
             * source.calculate_distance_gain(listener, distance_model);
         let new_sampling_vector = source.calculate_sampling_vector(listener);
 
-        if let Some(processor) = self.processor.as_mut() {
+        if let Some(processor) = processor {
             processor.process_samples(hrtf::HrtfContext {
                 source: &source.frame_samples,
                 output: out_buf,
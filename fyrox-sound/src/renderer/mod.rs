@@ -8,8 +8,7 @@
 #![allow(clippy::float_cmp)]
 
 use crate::{
-    context::DistanceModel, listener::Listener, math, renderer::hrtf::HrtfRenderer,
-    source::SoundSource,
+    context::DistanceModel, listener::Listener, renderer::hrtf::HrtfRenderer, source::SoundSource,
 };
 use fyrox_core::math::lerpf;
 use fyrox_core::{
@@ -43,6 +42,63 @@ impl Default for Renderer {
     }
 }
 
+impl Renderer {
+    pub(crate) fn render_source(
+        &mut self,
+        source: &mut SoundSource,
+        listener: &Listener,
+        distance_model: DistanceModel,
+        mix_buffer: &mut [(f32, f32)],
+    ) {
+        match self {
+            Renderer::Default => {
+                // Simple rendering path. Much faster (4-5 times) than HRTF path.
+                render_source_default(source, listener, distance_model, mix_buffer);
+            }
+            Renderer::HrtfRenderer(ref mut hrtf_renderer) => {
+                hrtf_renderer.render_source(source, listener, distance_model, mix_buffer);
+            }
+        }
+    }
+}
+
+/// Adds `src` samples multiplied by the given per-channel gains to `out`. The loop is intentionally
+/// kept branchless and without loop-carried dependencies, so the compiler can vectorize it.
+#[inline]
+pub(crate) fn mix_with_gain(
+    out: &mut [(f32, f32)],
+    src: &[(f32, f32)],
+    left_gain: f32,
+    right_gain: f32,
+) {
+    for ((out_left, out_right), &(raw_left, raw_right)) in out.iter_mut().zip(src) {
+        *out_left += left_gain * raw_left;
+        *out_right += right_gain * raw_right;
+    }
+}
+
+/// Adds `src` samples to `out` while linearly interpolating per-channel gains from `from` to `to`
+/// over the length of `out`. Gain at each sample is computed from its index (instead of accumulating
+/// an interpolation factor), this removes the loop-carried dependency and lets the compiler vectorize
+/// the loop.
+#[inline]
+pub(crate) fn mix_with_gain_ramp(
+    out: &mut [(f32, f32)],
+    src: &[(f32, f32)],
+    from: (f32, f32),
+    to: (f32, f32),
+) {
+    let step = 1.0 / out.len() as f32;
+    let left_delta = (to.0 - from.0) * step;
+    let right_delta = (to.1 - from.1) * step;
+    for (i, ((out_left, out_right), &(raw_left, raw_right))) in out.iter_mut().zip(src).enumerate()
+    {
+        let k = i as f32;
+        *out_left += (from.0 + left_delta * k) * raw_left;
+        *out_right += (from.1 + right_delta * k) * raw_right;
+    }
+}
+
 fn render_with_params(
     source: &mut SoundSource,
     left_gain: f32,
@@ -53,26 +109,17 @@ fn render_with_params(
     let last_right_gain = *source.last_right_gain.get_or_insert(right_gain);
 
     if last_left_gain != left_gain || last_right_gain != right_gain {
-        let step = 1.0 / mix_buffer.len() as f32;
-        let mut t = 0.0;
-        for ((out_left, out_right), &(raw_left, raw_right)) in
-            mix_buffer.iter_mut().zip(source.frame_samples())
-        {
-            // Interpolation of gain is very important to remove clicks which appears
-            // when gain changes by significant value between frames.
-            *out_left += math::lerpf(last_left_gain, left_gain, t) * raw_left;
-            *out_right += math::lerpf(last_right_gain, right_gain, t) * raw_right;
-
-            t += step;
-        }
+        // Interpolation of gain is very important to remove clicks which appears
+        // when gain changes by significant value between frames.
+        mix_with_gain_ramp(
+            mix_buffer,
+            source.frame_samples(),
+            (last_left_gain, last_right_gain),
+            (left_gain, right_gain),
+        );
     } else {
-        for ((out_left, out_right), &(raw_left, raw_right)) in
-            mix_buffer.iter_mut().zip(source.frame_samples())
-        {
-            // Optimize the common case when the gain did not change since the last call.
-            *out_left += left_gain * raw_left;
-            *out_right += right_gain * raw_right;
-        }
+        // Optimize the common case when the gain did not change since the last call.
+        mix_with_gain(mix_buffer, source.frame_samples(), left_gain, right_gain);
     }
 }
 
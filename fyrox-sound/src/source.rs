@@ -30,13 +30,14 @@
 
 use crate::{
     buffer::{streaming::StreamingBuffer, SoundBuffer, SoundBufferResource},
-    bus::AudioBusGraph,
+    bus::{AudioBus, AudioBusGraph},
     context::DistanceModel,
     error::SoundError,
     listener::Listener,
 };
 use fyrox_core::{
     algebra::Vector3,
+    pool::Handle,
     reflect::prelude::*,
     uuid_provider,
     visitor::{Visit, VisitResult, Visitor},
@@ -98,6 +99,17 @@ pub struct SoundSource {
     status: Status,
     #[visit(optional)]
     pub(crate) bus: String,
+    // Handle of the audio bus the source was rendered to last time. It is used to avoid searching for
+    // the bus by its name on every render call.
+    #[reflect(hidden)]
+    #[visit(skip)]
+    pub(crate) bus_handle: Handle<AudioBus>,
+    #[visit(optional)]
+    priority: i32,
+    // Virtual sources are not rendered, only their playback position is advanced.
+    #[reflect(hidden)]
+    #[visit(skip)]
+    is_virtual: bool,
     play_once: bool,
     // Here we use Option because when source is just created it has no info about it
     // previous left and right channel gains. We can't set it to 1.0 for example
@@ -155,6 +167,9 @@ impl Default for SoundSource {
             resampling_multiplier: 1.0,
             status: Status::Stopped,
             bus: "Master".to_string(),
+            bus_handle: Default::default(),
+            priority: 0,
+            is_virtual: false,
             play_once: false,
             last_left_gain: None,
             last_right_gain: None,
@@ -405,6 +420,109 @@ impl SoundSource {
         &self.bus
     }
 
+    /// Sets new priority of the sound source. When there's more playing sound sources than the voice
+    /// limit of a context allows (see [`crate::context::VoiceSettings`]), the sources with higher
+    /// priority are rendered first, the rest is virtualized. Sources with the same priority are ranked
+    /// by their audibility. Default is 0.
+    pub fn set_priority(&mut self, priority: i32) -> &mut Self {
+        self.priority = priority;
+        self
+    }
+
+    /// Returns current priority of the sound source.
+    pub fn priority(&self) -> i32 {
+        self.priority
+    }
+
+    /// Returns `true` if the sound source is virtual, `false` - otherwise. Virtual source is a playing
+    /// source that is not rendered, because it is inaudible or because of the voice limit of the context.
+    /// Its playback position is still advanced, so it continues playing from the right place when it
+    /// becomes audible again.
+    pub fn is_virtual(&self) -> bool {
+        self.is_virtual
+    }
+
+    /// Returns approximate loudness of the source for the given listener, in `[0; gain]` range.
+    pub(crate) fn calculate_audibility(
+        &self,
+        listener: &Listener,
+        distance_model: DistanceModel,
+    ) -> f32 {
+        let distance_gain = self.calculate_distance_gain(listener, distance_model);
+        self.gain * (1.0 + (distance_gain - 1.0) * self.spatial_blend)
+    }
+
+    pub(crate) fn virtualize(&mut self) {
+        self.is_virtual = true;
+    }
+
+    /// Makes the source real again. Its buffer is moved to the current playback position and the
+    /// gain will be faded in, to prevent clicks.
+    pub(crate) fn devirtualize(&mut self) {
+        if !self.is_virtual {
+            return;
+        }
+
+        self.is_virtual = false;
+
+        if let Some(buffer) = self.buffer.clone() {
+            if let Some(buffer) = buffer.state().data() {
+                match buffer {
+                    SoundBuffer::Generic(_) => {
+                        self.buf_read_pos = self.playback_pos;
+                    }
+                    SoundBuffer::Streaming(streaming) => {
+                        // Streaming buffers are not decoded while the source is virtual, so the
+                        // decoder must be moved to the actual position.
+                        streaming.time_seek(Duration::from_secs_f64(
+                            self.playback_pos / streaming.sample_rate() as f64,
+                        ));
+                        streaming.read_next_block();
+                        self.buf_read_pos = 0.0;
+                    }
+                }
+            }
+        }
+
+        self.last_left_gain = Some(0.0);
+        self.last_right_gain = Some(0.0);
+        self.prev_distance_gain = Some(0.0);
+        self.prev_left_samples.clear();
+        self.prev_right_samples.clear();
+    }
+
+    /// Advances playback position of a virtual source by the given amount of samples, without decoding
+    /// and rendering anything.
+    pub(crate) fn advance_virtual(&mut self, amount: usize) {
+        let Some(buffer) = self.buffer.clone() else {
+            return;
+        };
+        let mut state = buffer.state();
+        let Some(buffer) = state.data() else {
+            return;
+        };
+
+        let length = buffer.channel_duration_in_samples() as f64;
+        if self.status != Status::Playing || length == 0.0 {
+            return;
+        }
+
+        let position = self.playback_pos + amount as f64 * self.pitch * self.resampling_multiplier;
+        if position < length {
+            self.playback_pos = position;
+        } else if self.looping {
+            self.playback_pos = position % length;
+        } else {
+            self.status = Status::Stopped;
+            self.playback_pos = 0.0;
+            self.buf_read_pos = 0.0;
+            if let SoundBuffer::Streaming(streaming) = buffer {
+                let _ = streaming.rewind();
+                streaming.read_next_block();
+            }
+        }
+    }
+
     // Distance models were taken from OpenAL Specification because it looks like they're
     // standard in industry and there is no need to reinvent it.
     // https://www.openal.org/documentation/openal-1.1-specification.pdf
@@ -716,6 +834,7 @@ pub struct SoundSourceBuilder {
     rolloff_factor: f32,
     spatial_blend: f32,
     bus: String,
+    priority: i32,
 }
 
 impl Default for SoundSourceBuilder {
@@ -743,6 +862,7 @@ impl SoundSourceBuilder {
             rolloff_factor: 1.0,
             spatial_blend: 1.0,
             bus: AudioBusGraph::PRIMARY_BUS.to_string(),
+            priority: 0,
         }
     }
 
@@ -836,6 +956,12 @@ impl SoundSourceBuilder {
         self
     }
 
+    /// Sets desired priority of the sound source. See [`SoundSource::set_priority`] for more info.
+    pub fn with_priority(mut self, priority: i32) -> Self {
+        self.priority = priority;
+        self
+    }
+
     /// Sets desired output bus for the sound source.
     pub fn with_bus<S: AsRef<str>>(mut self, bus: S) -> Self {
         self.bus = bus.as_ref().to_string();
@@ -862,6 +988,7 @@ impl SoundSourceBuilder {
             prev_left_samples: Default::default(),
             prev_right_samples: Default::default(),
             bus: self.bus,
+            priority: self.priority,
             ..Default::default()
         };
 
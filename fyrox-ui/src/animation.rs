@@ -94,7 +94,8 @@ pub trait AnimationPoseExt {
 
 impl AnimationPoseExt for AnimationPose {
     fn apply(&self, ui: &mut UserInterface) {
-        for (node, local_pose) in self.poses() {
+        for local_pose in self.poses() {
+            let node = &local_pose.node;
             if node.is_none() {
                 Log::writeln(MessageKind::Error, "Invalid node handle found for animation pose, most likely it means that animation retargeting failed!");
             } else if let Some(node) = ui.try_get_mut(*node) {
@@ -277,8 +277,8 @@ use std::any::TypeId;
 use std::ops::Deref;
 use std::{
     any::Any,
-    cell::{Ref, RefCell, RefMut},
-    collections::{btree_set::BTreeSet, hash_map::Entry, VecDeque},
+    cell::{Cell, Ref, RefCell, RefMut},
+    collections::{btree_set::BTreeSet, hash_map::Entry, BinaryHeap, VecDeque},
     error::Error,
     fmt::{Debug, Formatter},
     ops::DerefMut,
@@ -585,6 +585,20 @@ pub enum LayoutEvent {
     VisibilityChanged(Handle<UiNode>),
 }
 
+/// Statistics of the last layout pass of a user interface. See [`UserInterface::layout_statistics`]
+/// for more info.
+#[derive(Copy, Clone, Debug, Default, PartialEq, Eq)]
+pub struct LayoutStatistics {
+    /// Amount of widgets, that were measured during the last layout pass.
+    pub measured: usize,
+    /// Amount of widgets, that were arranged during the last layout pass.
+    pub arranged: usize,
+    /// Amount of measurement requests, that were satisfied by the results of previous measurement.
+    pub measure_cache_hits: usize,
+    /// Amount of arrangement requests, that were satisfied by the results of previous arrangement.
+    pub arrange_cache_hits: usize,
+}
+
 #[derive(Clone, Debug, Visit, Reflect, Default)]
 struct DoubleClickEntry {
     timer: f32,
@@ -672,7 +686,12 @@ pub struct UserInterface {
     layout_events_receiver: Receiver<LayoutEvent>,
     #[reflect(hidden)]
     layout_events_sender: Sender<LayoutEvent>,
-    need_update_global_transform: bool,
+    #[reflect(hidden)]
+    measure_queue: BinaryHeap<(usize, Handle<UiNode>)>,
+    #[reflect(hidden)]
+    arrange_queue: BinaryHeap<(usize, Handle<UiNode>)>,
+    #[reflect(hidden)]
+    layout_statistics: Cell<LayoutStatistics>,
     #[reflect(hidden)]
     pub default_font: FontResource,
     #[reflect(hidden)]
@@ -749,7 +768,9 @@ impl Clone for UserInterface {
             clipboard: Clipboard(ClipboardContext::new().ok().map(RefCell::new)),
             layout_events_receiver,
             layout_events_sender,
-            need_update_global_transform: self.need_update_global_transform,
+            measure_queue: self.measure_queue.clone(),
+            arrange_queue: self.arrange_queue.clone(),
+            layout_statistics: self.layout_statistics.clone(),
             default_font: self.default_font.clone(),
             double_click_entries: self.double_click_entries.clone(),
             double_click_time_slice: self.double_click_time_slice,
@@ -914,7 +935,9 @@ impl UserInterface {
             clipboard: Clipboard(ClipboardContext::new().ok().map(RefCell::new)),
             layout_events_receiver,
             layout_events_sender,
-            need_update_global_transform: Default::default(),
+            measure_queue: Default::default(),
+            arrange_queue: Default::default(),
+            layout_statistics: Default::default(),
             default_font: BUILT_IN_FONT.clone(),
             double_click_entries: Default::default(),
             double_click_time_slice: 0.5, // 500 ms is standard in most operating systems.
@@ -996,11 +1019,11 @@ impl UserInterface {
         }
     }
 
-    fn update_visual_transform(&mut self) {
+    fn update_visual_transform(&mut self, from: Handle<UiNode>) {
         scope_profile!();
 
         self.stack.clear();
-        self.stack.push(self.root_canvas);
+        self.stack.push(from);
         while let Some(node_handle) = self.stack.pop() {
             let (widget, parent) = self
                 .nodes
@@ -1035,32 +1058,50 @@ impl UserInterface {
         self.screen_size = screen_size;
     }
 
-    fn handle_layout_events(&mut self) {
-        fn invalidate_recursive_up(
-            nodes: &Pool<UiNode, WidgetContainer>,
-            node: Handle<UiNode>,
-            callback: fn(&UiNode),
-        ) {
-            if let Some(node_ref) = nodes.try_borrow(node) {
-                (callback)(node_ref);
-                if node_ref.parent().is_some() {
-                    invalidate_recursive_up(nodes, node_ref.parent(), callback);
-                }
-            }
+    fn layout_depth(&self, mut node: Handle<UiNode>) -> usize {
+        let mut depth = 0;
+        while let Some(node_ref) = self.nodes.try_borrow(node) {
+            node = node_ref.parent();
+            depth += 1;
+        }
+        depth
+    }
+
+    fn enqueue_measure(&mut self, node: Handle<UiNode>) {
+        if let Some(node_ref) = self.nodes.try_borrow(node) {
+            node_ref.measure_valid.set(false);
+            let depth = self.layout_depth(node);
+            self.measure_queue.push((depth, node));
         }
+    }
+
+    fn enqueue_arrange(&mut self, node: Handle<UiNode>) {
+        if let Some(node_ref) = self.nodes.try_borrow(node) {
+            node_ref.arrange_valid.set(false);
+            let depth = self.layout_depth(node);
+            self.arrange_queue.push((depth, node));
+        }
+    }
 
+    fn handle_layout_events(&mut self) {
+        // Layout properties of a widget (size, alignment, row, column, position, etc.) are used by
+        // its parent, so the parent must be updated as well. Everything above the parent will be
+        // updated only if the layout of the parent has actually changed.
         while let Ok(layout_event) = self.layout_events_receiver.try_recv() {
             match layout_event {
                 LayoutEvent::MeasurementInvalidated(node) => {
-                    invalidate_recursive_up(&self.nodes, node, |node_ref| {
-                        node_ref.measure_valid.set(false)
-                    });
+                    if let Some(node_ref) = self.nodes.try_borrow(node) {
+                        node_ref.measure_valid.set(false);
+                        let parent = node_ref.parent();
+                        self.enqueue_measure(parent);
+                    }
                 }
                 LayoutEvent::ArrangementInvalidated(node) => {
-                    invalidate_recursive_up(&self.nodes, node, |node_ref| {
-                        node_ref.arrange_valid.set(false)
-                    });
-                    self.need_update_global_transform = true;
+                    if let Some(node_ref) = self.nodes.try_borrow(node) {
+                        node_ref.arrange_valid.set(false);
+                        let parent = node_ref.parent();
+                        self.enqueue_arrange(parent);
+                    }
                 }
                 LayoutEvent::VisibilityChanged(node) => {
                     self.update_global_visibility(node);
@@ -1069,33 +1110,160 @@ impl UserInterface {
         }
     }
 
+    /// Re-measures invalidated widgets in-place, using their previous available size. Widgets are
+    /// processed from the deepest ones, and the invalidation is propagated to a parent widget only
+    /// if the desired size of its child has changed.
+    fn update_measure_queue(&mut self) {
+        while let Some((_, handle)) = self.measure_queue.pop() {
+            let Some(node) = self.nodes.try_borrow(handle) else {
+                continue;
+            };
+
+            if node.is_measure_valid() {
+                // Already re-measured.
+                continue;
+            }
+
+            let parent = node.parent();
+            if self
+                .nodes
+                .try_borrow(parent)
+                .map_or(false, |parent| !parent.is_measure_valid())
+            {
+                // The parent will re-measure the widget anyway.
+                continue;
+            }
+
+            if !node.measured_once.get() {
+                // There's no previous available size, so only the parent can measure the widget.
+                self.enqueue_measure(parent);
+                continue;
+            }
+
+            let prev_desired_size = node.desired_size();
+            self.measure_node(handle, node.prev_measure.get());
+            let desired_size_changed = self.nodes[handle].desired_size() != prev_desired_size;
+
+            self.enqueue_arrange(handle);
+            if desired_size_changed {
+                self.enqueue_measure(parent);
+            }
+        }
+    }
+
+    /// Re-arranges invalidated widgets in-place, using their previous final rectangle. Widgets are
+    /// processed from the deepest ones, and the invalidation is propagated to a parent widget only
+    /// if the bounds of its child has changed. Returns a list of re-arranged widgets.
+    fn update_arrange_queue(&mut self) -> Vec<Handle<UiNode>> {
+        let mut arranged = Vec::new();
+
+        while let Some((_, handle)) = self.arrange_queue.pop() {
+            let Some(node) = self.nodes.try_borrow(handle) else {
+                continue;
+            };
+
+            if node.is_arrange_valid() {
+                // Already re-arranged.
+                continue;
+            }
+
+            let parent = node.parent();
+            if self
+                .nodes
+                .try_borrow(parent)
+                .map_or(false, |parent| !parent.is_arrange_valid())
+            {
+                // The parent will re-arrange the widget anyway.
+                continue;
+            }
+
+            if !node.arranged_once.get() {
+                // There's no previous final rectangle, so only the parent can arrange the widget.
+                self.enqueue_arrange(parent);
+                continue;
+            }
+
+            let prev_position = node.actual_local_position();
+            let prev_size = node.actual_local_size();
+            self.arrange_node(handle, &node.prev_arrange.get());
+            let node = &self.nodes[handle];
+            let bounds_changed = node.actual_local_position() != prev_position
+                || node.actual_local_size() != prev_size;
+
+            arranged.push(handle);
+            if bounds_changed {
+                self.enqueue_arrange(parent);
+            }
+        }
+
+        arranged
+    }
+
     pub fn invalidate_layout(&mut self) {
         for node in self.nodes.iter_mut() {
             node.invalidate_layout();
         }
     }
 
+    /// Returns statistics of the last layout pass. It could be used to find out how much work the
+    /// layout system does every frame.
+    pub fn layout_statistics(&self) -> LayoutStatistics {
+        self.layout_statistics.get()
+    }
+
+    fn modify_layout_statistics(&self, func: impl FnOnce(&mut LayoutStatistics)) {
+        let mut statistics = self.layout_statistics.get();
+        func(&mut statistics);
+        self.layout_statistics.set(statistics);
+    }
+
+    /// Updates layout of the user interface. The layout is incremental: only the widgets, that were
+    /// invalidated since the last update (and their ancestors, whose layout depends on the changed
+    /// widgets), will be measured and arranged.
     pub fn update_layout(&mut self, screen_size: Vector2<f32>) {
+        scope_profile!();
+
         self.screen_size = screen_size;
+        self.layout_statistics.set(Default::default());
 
         self.handle_layout_events();
 
+        self.update_measure_queue();
         self.measure_node(self.root_canvas, screen_size);
-        let arrangement_changed = self.arrange_node(
-            self.root_canvas,
-            &Rect::new(0.0, 0.0, screen_size.x, screen_size.y),
-        );
 
-        if self.need_update_global_transform {
-            self.update_visual_transform();
-            self.need_update_global_transform = false;
-        }
+        let arranged = self.update_arrange_queue();
+        let screen_bounds = Rect::new(0.0, 0.0, screen_size.x, screen_size.y);
+        let root_arranged = self.arrange_node(self.root_canvas, &screen_bounds);
+
+        if root_arranged || arranged.contains(&self.root_canvas) {
+            self.update_visual_transform(self.root_canvas);
+            self.calculate_clip_bounds(self.root_canvas, screen_bounds);
+        } else if !arranged.is_empty() {
+            let arranged_set = arranged.iter().cloned().collect::<FxHashSet<_>>();
+            for &handle in arranged.iter() {
+                let parent = self.nodes[handle].parent();
+
+                // Skip widgets, that will be updated together with their re-arranged ancestor.
+                let mut ancestor = parent;
+                let mut has_arranged_ancestor = false;
+                while let Some(ancestor_ref) = self.nodes.try_borrow(ancestor) {
+                    if arranged_set.contains(&ancestor) {
+                        has_arranged_ancestor = true;
+                        break;
+                    }
+                    ancestor = ancestor_ref.parent();
+                }
+                if has_arranged_ancestor {
+                    continue;
+                }
 
-        if arrangement_changed {
-            self.calculate_clip_bounds(
-                self.root_canvas,
-                Rect::new(0.0, 0.0, self.screen_size.x, self.screen_size.y),
-            );
+                self.update_visual_transform(handle);
+                let parent_bounds = self
+                    .nodes
+                    .try_borrow(parent)
+                    .map_or(screen_bounds, |parent| parent.clip_bounds());
+                self.calculate_clip_bounds(handle, parent_bounds);
+            }
         }
     }
 
@@ -1217,10 +1385,13 @@ impl UserInterface {
         let node = self.node(handle);
 
         if node.is_arrange_valid() && node.prev_arrange.get() == *final_rect {
+            self.modify_layout_statistics(|s| s.arrange_cache_hits += 1);
             return false;
         }
 
         if node.visibility() {
+            self.modify_layout_statistics(|s| s.arranged += 1);
+
             node.prev_arrange.set(*final_rect);
 
             let margin = node.margin().axes_margin();
@@ -1299,10 +1470,13 @@ impl UserInterface {
         let node = self.node(handle);
 
         if node.is_measure_valid() && node.prev_measure.get() == available_size {
+            self.modify_layout_statistics(|s| s.measure_cache_hits += 1);
             return false;
         }
 
         if node.visibility() {
+            self.modify_layout_statistics(|s| s.measured += 1);
+
             node.prev_measure.set(available_size);
 
             let axes_margin = node.margin().axes_margin();
@@ -2772,7 +2946,7 @@ impl UserInterface {
     pub fn resolve(&mut self) {
         self.restore_dynamic_node_data();
         self.restore_original_handles_and_inherit_properties(&[], |_, _| {});
-        self.update_visual_transform();
+        self.update_visual_transform(self.root_canvas);
         self.update_global_visibility(self.root_canvas);
         let instances = self.restore_integrity(|model, model_data, handle, dest_graph| {
             model_data.copy_node_to(handle, dest_graph, &mut |_, original_handle, node| {
@@ -3225,13 +3399,16 @@ mod test {
     use crate::{
         border::BorderBuilder,
         core::algebra::{Rotation2, UnitComplex, Vector2},
+        core::pool::Handle,
         message::MessageDirection,
+        stack_panel::StackPanelBuilder,
         text_box::TextBoxBuilder,
         transform_size,
         widget::{WidgetBuilder, WidgetMessage},
-        OsEvent, UserInterface,
+        LayoutStatistics, OsEvent, UiNode, UserInterface,
     };
     use fyrox_graph::BaseSceneGraph;
+    use std::time::Instant;
 
     #[test]
     fn test_transform_size() {
@@ -3317,4 +3494,150 @@ mod test {
 
         assert!(ui.poll_message().is_none());
     }
+
+    fn layout_snapshot(ui: &UserInterface) -> Vec<(Handle<UiNode>, Vector2<f32>, Vector2<f32>)> {
+        ui.nodes
+            .pair_iter()
+            .map(|(handle, node)| {
+                (
+                    handle,
+                    node.actual_local_position(),
+                    node.actual_local_size(),
+                )
+            })
+            .collect()
+    }
+
+    fn build_panels(ui: &mut UserInterface, panels: usize, items: usize) -> Vec<Handle<UiNode>> {
+        let mut borders = Vec::new();
+        let ctx = &mut ui.build_ctx();
+        let mut panel_handles = Vec::new();
+        for _ in 0..panels {
+            let mut children = Vec::new();
+            for _ in 0..items {
+                let border =
+                    BorderBuilder::new(WidgetBuilder::new().with_width(20.0).with_height(10.0))
+                        .build(ctx);
+                borders.push(border);
+                children.push(border);
+            }
+            panel_handles.push(
+                StackPanelBuilder::new(WidgetBuilder::new().with_children(children)).build(ctx),
+            );
+        }
+        StackPanelBuilder::new(WidgetBuilder::new().with_children(panel_handles))
+            .with_orientation(crate::Orientation::Horizontal)
+            .build(ctx);
+        borders
+    }
+
+    #[test]
+    fn incremental_layout() {
+        let screen_size = Vector2::new(1000.0, 1000.0);
+        let mut ui = UserInterface::new(screen_size);
+        let borders = build_panels(&mut ui, 4, 10);
+
+        ui.update(screen_size, 0.0, &Default::default());
+        assert!(ui.layout_statistics().measured > borders.len());
+
+        // Nothing has changed, so there must be no layout work.
+        ui.update(screen_size, 0.0, &Default::default());
+        assert_eq!(
+            ui.layout_statistics(),
+            LayoutStatistics {
+                measure_cache_hits: 1,
+                arrange_cache_hits: 1,
+                ..Default::default()
+            }
+        );
+
+        // The size of the widget is changed, so every ancestor must be updated, but siblings must
+        // be taken from the cache.
+        ui.send_message(WidgetMessage::width(
+            borders[3],
+            MessageDirection::ToWidget,
+            30.0,
+        ));
+        while ui.poll_message().is_some() {}
+        ui.update(screen_size, 0.0, &Default::default());
+        let statistics = ui.layout_statistics();
+        assert!(statistics.measured < borders.len() / 2);
+        assert!(statistics.measure_cache_hits > 0);
+        assert_eq!(
+            ui.node(borders[3]).actual_local_size(),
+            Vector2::new(30.0, 10.0)
+        );
+
+        // The results must be the same as the results of full layout.
+        let incremental = layout_snapshot(&ui);
+        ui.invalidate_layout();
+        ui.update(screen_size, 0.0, &Default::default());
+        assert_eq!(incremental, layout_snapshot(&ui));
+    }
+
+    #[test]
+    fn layout_invalidation_stops_at_unchanged_parent() {
+        let screen_size = Vector2::new(1000.0, 1000.0);
+        let mut ui = UserInterface::new(screen_size);
+        let ctx = &mut ui.build_ctx();
+        let child = BorderBuilder::new(WidgetBuilder::new().with_width(10.0)).build(ctx);
+        let container = BorderBuilder::new(
+            WidgetBuilder::new()
+                .with_width(100.0)
+                .with_height(100.0)
+                .with_child(child),
+        )
+        .build(ctx);
+        StackPanelBuilder::new(WidgetBuilder::new().with_child(container)).build(ctx);
+
+        ui.update(screen_size, 0.0, &Default::default());
+
+        ui.send_message(WidgetMessage::width(
+            child,
+            MessageDirection::ToWidget,
+            20.0,
+        ));
+        while ui.poll_message().is_some() {}
+        ui.update(screen_size, 0.0, &Default::default());
+
+        // The size of the container is fixed, so only the container and its child must be updated.
+        let statistics = ui.layout_statistics();
+        assert_eq!(statistics.measured, 2);
+        assert_eq!(statistics.arranged, 2);
+        assert_eq!(ui.node(child).actual_local_size().x, 20.0);
+    }
+
+    #[ignore = "takes multiple seconds to run"]
+    #[test]
+    fn benchmark_incremental_layout() {
+        let screen_size = Vector2::new(1920.0, 1080.0);
+        let mut ui = UserInterface::new(screen_size);
+        let borders = build_panels(&mut ui, 100, 100);
+
+        let instant = Instant::now();
+        ui.update(screen_size, 0.0, &Default::default());
+        println!(
+            "Full layout of {} widgets took {:?}, {:?}",
+            ui.nodes.alive_count(),
+            instant.elapsed(),
+            ui.layout_statistics()
+        );
+
+        let frames = 1000;
+        let instant = Instant::now();
+        for i in 0..frames {
+            ui.send_message(WidgetMessage::width(
+                borders[i % borders.len()],
+                MessageDirection::ToWidget,
+                20.0 + (i % 2) as f32,
+            ));
+            while ui.poll_message().is_some() {}
+            ui.update(screen_size, 0.0, &Default::default());
+        }
+        println!(
+            "Incremental layout took {:?} per frame, {:?}",
+            instant.elapsed() / frames as u32,
+            ui.layout_statistics()
+        );
+    }
 }
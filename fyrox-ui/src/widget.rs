@@ -823,6 +823,16 @@ pub struct Widget {
     #[reflect(hidden)]
     #[visit(skip)]
     pub prev_arrange: Cell<Rect<f32>>,
+    /// A flag, that defines whether the widget was measured at least once. It is used to decide
+    /// whether the widget can be re-measured in-place using [`Self::prev_measure`].
+    #[reflect(hidden)]
+    #[visit(skip)]
+    pub(crate) measured_once: Cell<bool>,
+    /// A flag, that defines whether the widget was arranged at least once. It is used to decide
+    /// whether the widget can be re-arranged in-place using [`Self::prev_arrange`].
+    #[reflect(hidden)]
+    #[visit(skip)]
+    pub(crate) arranged_once: Cell<bool>,
     /// Desired size of the node after Measure pass.
     #[reflect(hidden)]
     #[visit(skip)]
@@ -1493,6 +1503,7 @@ impl Widget {
         self.actual_local_size.set(size);
         self.actual_local_position.set(position);
         self.arrange_valid.set(true);
+        self.arranged_once.set(true);
     }
 
     #[inline]
@@ -1512,6 +1523,7 @@ impl Widget {
     pub(crate) fn commit_measure(&self, desired_size: Vector2<f32>) {
         self.desired_size.set(desired_size);
         self.measure_valid.set(true);
+        self.measured_once.set(true);
     }
 
     /// Returns `true` if the current results of measurement of the widget are valid, `false` - otherwise.
@@ -2083,6 +2095,8 @@ impl WidgetBuilder {
             hit_test_visibility: self.is_hit_test_visible.into(),
             prev_measure: Default::default(),
             prev_arrange: Default::default(),
+            measured_once: Cell::new(false),
+            arranged_once: Cell::new(false),
             z_index: self.z_index.into(),
             allow_drag: self.allow_drag.into(),
             allow_drop: self.allow_drop.into(),